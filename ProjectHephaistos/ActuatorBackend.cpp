@@ -0,0 +1,91 @@
+#include "ActuatorBackend.h"
+
+ActuatorBackend::ActuatorBackend()
+    : outputMask(0),
+      levels(0),
+      stagedLevels(0),
+      pwmCount(0),
+      counters()
+{
+}
+
+bool ActuatorBackend::addDigitalOutput(uint8_t pin, bool level) {
+    if (pin >= maxPins) {
+        return false;
+    }
+    uint64_t bit = 1ULL << pin;
+    configureDigital(pin);
+    outputMask |= bit;
+    if (level) {
+        levels |= bit;
+        stagedLevels |= bit;
+        writeDigital(bit, 0);
+    } else {
+        levels &= ~bit;
+        stagedLevels &= ~bit;
+        writeDigital(0, bit);
+    }
+    return true;
+}
+
+bool ActuatorBackend::addPwmOutput(uint8_t pin, uint32_t frequencyHz, uint8_t resolutionBits) {
+    if (pwmCount >= maxPwmOutputs || !configurePwm(pin, frequencyHz, resolutionBits)) {
+        return false;
+    }
+    PwmOutput& output = pwm[pwmCount++];
+    output.pin = pin;
+    output.duty = 0;
+    output.stagedDuty = 0;
+    writePwm(pin, 0);
+    return true;
+}
+
+void ActuatorBackend::setDigital(uint8_t pin, bool level) {
+    if (pin >= maxPins) {
+        return;
+    }
+    uint64_t bit = 1ULL << pin;
+    if (level) {
+        stagedLevels |= bit;
+    } else {
+        stagedLevels &= ~bit;
+    }
+}
+
+void ActuatorBackend::setPwm(uint8_t pin, uint32_t duty) {
+    for (uint8_t i = 0; i < pwmCount; i++) {
+        if (pwm[i].pin == pin) {
+            pwm[i].stagedDuty = duty;
+            return;
+        }
+    }
+}
+
+void ActuatorBackend::commit() {
+    counters.commits++;
+
+    uint64_t changed = (stagedLevels ^ levels) & outputMask;
+    if (changed) {
+        writeDigital(stagedLevels & changed, ~stagedLevels & changed);
+        levels = (levels & ~changed) | (stagedLevels & changed);
+        counters.digitalWrites++;
+    }
+    for (uint64_t bits = outputMask; bits; bits &= bits - 1) {
+        if (changed & bits & ~(bits - 1)) {
+            counters.pinChanges++;
+        } else {
+            counters.skipped++;
+        }
+    }
+
+    for (uint8_t i = 0; i < pwmCount; i++) {
+        PwmOutput& output = pwm[i];
+        if (output.stagedDuty == output.duty) {
+            counters.skipped++;
+            continue;
+        }
+        writePwm(output.pin, output.stagedDuty);
+        output.duty = output.stagedDuty;
+        counters.pwmWrites++;
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef ACTUATOR_BACKEND_H
+#define ACTUATOR_BACKEND_H
+
+#include <stdint.h>
+
+// Collects the output changes of one control tick and writes them out
+// together in commit():
+//
+// - digital outputs with one clear and one set register write (per bank
+//   of 32 pins), so all pins change within a few cycles of each other;
+//   clears go first, so two pins swapping levels are never high together
+// - PWM duties in one pass right after
+//
+// Outputs that already have the requested level or duty are skipped.
+// Subclasses only provide the raw hardware writes.
+class ActuatorBackend {
+public:
+    static const uint8_t maxPins = 64;
+    static const uint8_t maxPwmOutputs = 8;
+
+    struct Stats {
+        uint32_t commits;
+        uint32_t digitalWrites;  // set/clear batches written
+        uint32_t pinChanges;     // digital pins that actually changed
+        uint32_t pwmWrites;
+        uint32_t skipped;        // outputs left alone because nothing changed
+    };
+
+    ActuatorBackend();
+    virtual ~ActuatorBackend() {}
+
+    // Setup, before the control loop starts. Both write the initial
+    // state right away.
+    bool addDigitalOutput(uint8_t pin, bool level);
+    bool addPwmOutput(uint8_t pin, uint32_t frequencyHz, uint8_t resolutionBits);
+
+    // Stage a change for the next commit()
+    void setDigital(uint8_t pin, bool level);
+    void setPwm(uint8_t pin, uint32_t duty);
+
+    void commit();
+
+    const Stats& stats() const { return counters; }
+
+protected:
+    virtual void configureDigital(uint8_t pin) = 0;
+    virtual bool configurePwm(uint8_t pin, uint32_t frequencyHz, uint8_t resolutionBits) = 0;
+
+    // Bit n of a mask is GPIO n
+    virtual void writeDigital(uint64_t setMask, uint64_t clearMask) = 0;
+    virtual void writePwm(uint8_t pin, uint32_t duty) = 0;
+
+private:
+    struct PwmOutput {
+        uint8_t pin;
+        uint32_t duty;         // on the output
+        uint32_t stagedDuty;
+    };
+
+    uint64_t outputMask;   // pins registered as digital outputs
+    uint64_t levels;       // on the outputs
+    uint64_t stagedLevels;
+
+    PwmOutput pwm[maxPwmOutputs];
+    uint8_t pwmCount;
+
+    Stats counters;
+};
+
+#endif // ACTUATOR_BACKEND_H
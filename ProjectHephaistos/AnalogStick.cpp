@@ -0,0 +1,149 @@
+#include "AnalogStick.h"
+
+static const int32_t fullScale = ResponseCurve::fullScale;
+
+// Integer square root (floor), bit by bit
+static uint32_t isqrt(uint32_t value) {
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+// -fullScale..fullScale to -100..100, rounded
+static int8_t toPercent(int32_t value) {
+    int32_t half = value < 0 ? -fullScale / 2 : fullScale / 2;
+    return (int8_t)((value * 100 + half) / fullScale);
+}
+
+// ----------------------
+// ResponseCurve
+// ----------------------
+ResponseCurve::ResponseCurve(uint8_t percent) {
+    setExpo(percent);
+}
+
+void ResponseCurve::setExpo(uint8_t percent) {
+    expoPercent = percent > 100 ? 100 : percent;
+
+    // Floats only here, when the table is rebuilt
+    float e = expoPercent / 100.0f;
+    for (uint16_t i = 0; i < pointCount; i++) {
+        float x = (float)i / (pointCount - 1);
+        float y = (1.0f - e) * x + e * x * x * x;
+        points[i] = (uint16_t)(y * fullScale + 0.5f);
+    }
+}
+
+int32_t ResponseCurve::apply(int32_t magnitude) const {
+    if (magnitude <= 0) {
+        return 0;
+    }
+    if (magnitude >= fullScale) {
+        return points[pointCount - 1];
+    }
+
+    const uint8_t shift = 15 - segmentBits;
+    uint32_t index = magnitude >> shift;
+    int32_t fraction = magnitude & ((1 << shift) - 1);
+    int32_t low = points[index];
+    int32_t high = points[index + 1];
+    return low + (((high - low) * fraction) >> shift);
+}
+
+// ----------------------
+// AnalogStick
+// ----------------------
+AnalogStick::AnalogStick()
+    : deadzoneMode(DEADZONE_RADIAL),
+      deadzone(0),
+      curve(nullptr)
+{
+    // Bluepad32 axes: -512 (left/up) .. 511 (right/down)
+    AxisCalibration axis = {-512, 0, 511, false};
+    calibrationX = axis;
+    calibrationY = axis;
+}
+
+void AnalogStick::setCalibration(const AxisCalibration& x, const AxisCalibration& y) {
+    calibrationX = x;
+    calibrationY = y;
+}
+
+void AnalogStick::setDeadzone(DeadzoneMode mode, uint8_t percent) {
+    deadzoneMode = mode;
+    // Keep some travel outside the deadzone so the rescale never divides by 0
+    if (percent > 90) {
+        percent = 90;
+    }
+    deadzone = fullScale * percent / 100;
+}
+
+void AnalogStick::setCurve(const ResponseCurve* responseCurve) {
+    curve = responseCurve;
+}
+
+int32_t AnalogStick::normalize(int16_t raw, const AxisCalibration& calibration) {
+    int32_t offset = (int32_t)raw - calibration.center;
+    int32_t span = offset >= 0 ? calibration.maximum - calibration.center
+                               : calibration.center - calibration.minimum;
+    if (span <= 0) {
+        return 0;
+    }
+
+    int32_t value = offset * fullScale / span;
+    if (value > fullScale) {
+        value = fullScale;
+    } else if (value < -fullScale) {
+        value = -fullScale;
+    }
+    return calibration.inverted ? -value : value;
+}
+
+int32_t AnalogStick::shapeMagnitude(int32_t magnitude) const {
+    if (magnitude <= deadzone) {
+        return 0;
+    }
+    if (magnitude > fullScale) {
+        magnitude = fullScale;
+    }
+
+    // Start from 0 right outside the deadzone
+    int32_t rescaled = (magnitude - deadzone) * fullScale / (fullScale - deadzone);
+    return curve ? curve->apply(rescaled) : rescaled;
+}
+
+void AnalogStick::process(int16_t rawX, int16_t rawY, int8_t& outX, int8_t& outY) const {
+    int32_t x = normalize(rawX, calibrationX);
+    int32_t y = normalize(rawY, calibrationY);
+
+    if (deadzoneMode == DEADZONE_RADIAL) {
+        int32_t magnitude = (int32_t)isqrt((uint32_t)(x * x) + (uint32_t)(y * y));
+        if (magnitude == 0) {
+            outX = 0;
+            outY = 0;
+            return;
+        }
+        // Scale the vector to the shaped length, keeping its direction
+        int32_t shaped = shapeMagnitude(magnitude);
+        x = x * shaped / magnitude;
+        y = y * shaped / magnitude;
+    } else {
+        x = x < 0 ? -shapeMagnitude(-x) : shapeMagnitude(x);
+        y = y < 0 ? -shapeMagnitude(-y) : shapeMagnitude(y);
+    }
+
+    outX = toPercent(x);
+    outY = toPercent(y);
+}
@@ -0,0 +1,69 @@
+#ifndef ANALOG_STICK_H
+#define ANALOG_STICK_H
+
+#include <stdint.h>
+
+// Maps one raw gamepad axis to -fullScale..fullScale
+struct AxisCalibration {
+    int16_t minimum;   // raw value at full deflection left/up
+    int16_t center;    // raw value at rest
+    int16_t maximum;   // raw value at full deflection right/down
+    bool inverted;
+};
+
+// Response curve on the stick magnitude, as a lookup table with linear
+// interpolation in between. The table is computed once in setExpo(), so
+// applying it per sample is integer only.
+class ResponseCurve {
+public:
+    static const int32_t fullScale = 32767;
+    static const uint8_t segmentBits = 6;
+    static const uint16_t pointCount = (1 << segmentBits) + 1;
+
+    ResponseCurve(uint8_t percent = 0);
+
+    // Blend between linear (0) and cubic (100): y = (1 - e) x + e x^3
+    void setExpo(uint8_t percent);
+    uint8_t expo() const { return expoPercent; }
+
+    // magnitude 0..fullScale in and out
+    int32_t apply(int32_t magnitude) const;
+
+private:
+    uint8_t expoPercent;
+    uint16_t points[pointCount];
+};
+
+// Turns the raw X/Y values of one stick into -100..100 percent:
+// calibration, then deadzone (per axis or on the stick radius, rescaled so
+// output starts at 0 right outside it), then the response curve.
+class AnalogStick {
+public:
+    enum DeadzoneMode {
+        DEADZONE_AXIAL,    // each axis on its own; keeps pure X or Y clean
+        DEADZONE_RADIAL    // on the distance from center; keeps the direction
+    };
+
+    AnalogStick();
+
+    void setCalibration(const AxisCalibration& x, const AxisCalibration& y);
+    void setDeadzone(DeadzoneMode mode, uint8_t percent);
+
+    // The curve is not copied, so it can be swapped (or edited) while
+    // the stick is in use
+    void setCurve(const ResponseCurve* curve);
+
+    void process(int16_t rawX, int16_t rawY, int8_t& outX, int8_t& outY) const;
+
+private:
+    AxisCalibration calibrationX;
+    AxisCalibration calibrationY;
+    DeadzoneMode deadzoneMode;
+    int32_t deadzone;  // 0..fullScale
+    const ResponseCurve* curve;
+
+    static int32_t normalize(int16_t raw, const AxisCalibration& calibration);
+    int32_t shapeMagnitude(int32_t magnitude) const;
+};
+
+#endif // ANALOG_STICK_H
@@ -1,4 +1,16 @@
+#include "ControlConfig.h"
+#ifdef CONTROL_MODE_BLUETOOTH
+
 #include "BluetoothControl.h"
+#include "TankMixer.h"
+#include "Log.h"
+#include "Profiler.h"
+#ifdef INPUT_RECORDING
+#include "InputRecorder.h"
+#endif
+
+// Expo of the response curve presets, cycled with the Select button
+const uint8_t BluetoothControl::curveExpo[BluetoothControl::curveCount] = {0, 30, 60};
 
 // Static members must be defined outside the class
 BluetoothControl* BluetoothControl::instance = nullptr;
@@ -6,29 +18,36 @@ ControllerPtr BluetoothControl::controller = nullptr;
 
 BluetoothControl::BluetoothControl()
     : currentGear(1),
-      leftTrackSpeed(0),
-      rightTrackSpeed(0),
-      turretRotation(0),
-      turretElevation(0),
-      flamethrowerActive(false),
-      forwardPressed(false),
-      backPressed(false),
-      leftPressed(false),
-      rightPressed(false),
-      turretLeftPressed(false),
-      turretRightPressed(false),
-      turretElevatePressed(false),
-      turretLowerPressed(false),
+      curveIndex(0),
+      driveInput(0),
+      turnInput(0),
+      turretRotationInput(0),
+      turretElevationInput(0),
       firePressed(false),
-      lastUpdateTime(0)
+      gearUpHeld(false),
+      gearDownHeld(false),
+      selectHeld(false),
+      lastReportTime(0),
+      replayInput(),
+      replayConnected(false),
+      replayReported(false)
 {
     instance = this;
 
+    // Driving uses a radial deadzone so diagonals keep their direction;
+    // the turret axes move separate servos, so each gets its own
+    driveStick.setDeadzone(AnalogStick::DEADZONE_RADIAL, stickDeadzonePercent);
+    turretStick.setDeadzone(AnalogStick::DEADZONE_AXIAL, stickDeadzonePercent);
+    for (uint8_t i = 0; i < curveCount; i++) {
+        curves[i].setExpo(curveExpo[i]);
+    }
+    selectCurve(defaultCurve);
+
     // Initialize Bluepad32
     BP32.setup(&BluetoothControl::onConnectedController, &BluetoothControl::onDisconnectedController);
     BP32.enableNewBluetoothConnections(true);
 
-    Serial.println("BluetoothControl Initialized. Waiting for gamepad...");
+    LOG_INFO("BluetoothControl Initialized. Waiting for gamepad...");
 }
 
 BluetoothControl::~BluetoothControl() {
@@ -38,178 +57,208 @@ BluetoothControl::~BluetoothControl() {
 
 void BluetoothControl::update() {
     // Fetch controller data
-    BP32.update();
+    bool received;
+    {
+        PROFILE_SECTION(SECTION_BLUEPAD32);
+        received = BP32.update();
+    }
+    if (received) {
+        // New report: when the input arrived, for latency tracing
+        markInput();
+    }
 
     // If there's a connected controller, process it
     if (controller && controller->isConnected()) {
-        processGamepad(controller);
+        GamepadInput pad = readGamepad(controller);
+#ifdef INPUT_RECORDING
+        if (received) {
+            int16_t values[InputRecord::gamepadValues];
+            values[InputRecord::GAMEPAD_X]       = pad.x;
+            values[InputRecord::GAMEPAD_Y]       = pad.y;
+            values[InputRecord::GAMEPAD_RX]      = pad.rx;
+            values[InputRecord::GAMEPAD_RY]      = pad.ry;
+            values[InputRecord::GAMEPAD_DPAD]    = pad.dpad;
+            values[InputRecord::GAMEPAD_BUTTONS] = (pad.a ? InputRecord::GAMEPAD_BUTTON_A : 0) |
+                                                   (pad.select ? InputRecord::GAMEPAD_BUTTON_SELECT : 0);
+            InputRecorder::record(InputRecord::TYPE_GAMEPAD, values, InputRecord::gamepadValues);
+        }
+#endif
+        processGamepad(pad);
+        if (inputFresh(received, millis())) {
+            markFresh();
+        }
+    } else {
+        // Keep the last values, only report the link as down
+        ControlState next = getState();
+        next.connected = false;
+        publishState(next, millis());
     }
 }
 
-bool BluetoothControl::isConnected() const {
-    return (controller && controller->isConnected());
-}
-
-int BluetoothControl::getLeftTrackSpeed() const {
-    return leftTrackSpeed;
-}
-
-int BluetoothControl::getRightTrackSpeed() const {
-    return rightTrackSpeed;
+void BluetoothControl::replaySample(const InputRecord::Sample& sample) {
+    if (sample.type == InputRecord::TYPE_LINK && sample.count >= 1) {
+        replayConnected = sample.values[0] != 0;
+    } else if (sample.type == InputRecord::TYPE_GAMEPAD && sample.count >= InputRecord::gamepadValues) {
+        replayInput.x      = sample.values[InputRecord::GAMEPAD_X];
+        replayInput.y      = sample.values[InputRecord::GAMEPAD_Y];
+        replayInput.rx     = sample.values[InputRecord::GAMEPAD_RX];
+        replayInput.ry     = sample.values[InputRecord::GAMEPAD_RY];
+        replayInput.dpad   = (uint8_t)sample.values[InputRecord::GAMEPAD_DPAD];
+        replayInput.a      = (sample.values[InputRecord::GAMEPAD_BUTTONS] & InputRecord::GAMEPAD_BUTTON_A) != 0;
+        replayInput.select = (sample.values[InputRecord::GAMEPAD_BUTTONS] & InputRecord::GAMEPAD_BUTTON_SELECT) != 0;
+        replayReported = true;
+    }
 }
 
-int BluetoothControl::getTurretRotation() const {
-    return turretRotation;
+void BluetoothControl::replayPoll() {
+    // Same as update(), with the recorded report
+    if (replayConnected) {
+        processGamepad(replayInput);
+        if (inputFresh(replayReported, millis())) {
+            markFresh();
+        }
+        replayReported = false;
+    } else {
+        ControlState next = getState();
+        next.connected = false;
+        publishState(next, millis());
+    }
 }
 
-int BluetoothControl::getTurretElevation() const {
-    return turretElevation;
+void BluetoothControl::selectCurve(uint8_t index) {
+    if (index >= curveCount) {
+        return;
+    }
+    curveIndex = index;
+    driveStick.setCurve(&curves[index]);
+    turretStick.setCurve(&curves[index]);
 }
 
-bool BluetoothControl::isFlamethrowerActive() const {
-    return flamethrowerActive;
+void BluetoothControl::setCurveExpo(uint8_t index, uint8_t expoPercent) {
+    if (index < curveCount) {
+        curves[index].setExpo(expoPercent);
+    }
 }
 
-int BluetoothControl::getCurrentGear() const {
-    return currentGear;
+void BluetoothControl::setCalibration(const AxisCalibration& x, const AxisCalibration& y,
+                                      const AxisCalibration& rx, const AxisCalibration& ry) {
+    driveStick.setCalibration(x, y);
+    turretStick.setCalibration(rx, ry);
 }
 
 // ----------------------
 // Static Callbacks
 // ----------------------
 void BluetoothControl::onConnectedController(ControllerPtr ctl) {
-    Serial.println("Gamepad connected via Bluetooth.");
+    LOG_INFO("Gamepad connected via Bluetooth.");
     controller = ctl;
+#ifdef INPUT_RECORDING
+    const int16_t link = 1;
+    InputRecorder::record(InputRecord::TYPE_LINK, &link, 1);
+#endif
 }
 
 void BluetoothControl::onDisconnectedController(ControllerPtr ctl) {
-    Serial.println("Gamepad disconnected.");
+    LOG_WARN("Gamepad disconnected.");
     if (ctl == controller) {
         controller = nullptr;
+#ifdef INPUT_RECORDING
+        const int16_t link = 0;
+        InputRecorder::record(InputRecord::TYPE_LINK, &link, 1);
+#endif
     }
 }
 
 // ----------------------
 // Process Gamepad
 // ----------------------
-void BluetoothControl::processGamepad(ControllerPtr ctl) {
-    // Limit update rate
-    unsigned long currentTime = millis();
-    if (currentTime - lastUpdateTime < updateInterval) {
-        return;
-    }
-    lastUpdateTime = currentTime;
-
-    // Reset the pressed states
-    forwardPressed       = false;
-    backPressed          = false;
-    leftPressed          = false;
-    rightPressed         = false;
-    turretLeftPressed    = false;
-    turretRightPressed   = false;
-    turretElevatePressed = false;
-    turretLowerPressed   = false;
-    firePressed          = false;
-
-    // Example usage: interpret left joystick Y for forward/back
-    // (on many controllers, up is negative Y, so adjust logic as needed)
-    int16_t axisY = ctl->axisY(); // -512 up, +511 down
-    if (axisY < -100) { 
-        forwardPressed = true; 
-    } else if (axisY > 100) { 
-        backPressed = true; 
-    }
-
-    // Interpret left joystick X for turning
-    int16_t axisX = ctl->axisX(); // -512 left, +511 right
-    if (axisX < -100) {
-        leftPressed = true;
-    } else if (axisX > 100) {
-        rightPressed = true;
-    }
-
-    // For turret: use right joystick or certain buttons
-    int16_t axisRX = ctl->axisRX();  // -512 left, +511 right
-    int16_t axisRY = ctl->axisRY();  // -512 up, +511 down
+BluetoothControl::GamepadInput BluetoothControl::readGamepad(ControllerPtr ctl) {
+    GamepadInput pad;
+    pad.x      = (int16_t)ctl->axisX();
+    pad.y      = (int16_t)ctl->axisY();
+    pad.rx     = (int16_t)ctl->axisRX();
+    pad.ry     = (int16_t)ctl->axisRY();
+    pad.dpad   = ctl->dpad();
+    pad.a      = ctl->a();
+    pad.select = ctl->miscSelect();
+    return pad;
+}
 
-    if (axisRX < -100) {
-        turretLeftPressed = true;
-    } else if (axisRX > 100) {
-        turretRightPressed = true;
-    }
+void BluetoothControl::processGamepad(const GamepadInput& pad) {
+    // Sticks, proportional: left drives, right aims the turret
+    // (up is negative Y on Bluepad32)
+    int8_t stickX, stickY;
+    driveStick.process(pad.x, pad.y, stickX, stickY);
+    turnInput  = stickX;
+    driveInput = -stickY;
 
-    if (axisRY < -100) {
-        turretElevatePressed = true;
-    } else if (axisRY > 100) {
-        turretLowerPressed = true;
-    }
+    turretStick.process(pad.rx, pad.ry, stickX, stickY);
+    turretRotationInput  = stickX;
+    turretElevationInput = -stickY;
 
     // Check a button for flamethrower
     // For example, "A" button on many controllers
-    if (ctl->a()) {
-        firePressed = true;
+    firePressed = pad.a;
+
+    // Select cycles through the response curves
+    bool select = pad.select;
+    if (select && !selectHeld) {
+        selectCurve((curveIndex + 1) % curveCount);
+        LOG_INFO("Stick response: expo %d%%", curves[curveIndex].expo());
     }
+    selectHeld = select;
 
     // Gear shifting with D-Pad up/down
-    uint8_t dpadVal = ctl->dpad();
+    uint8_t dpadVal = pad.dpad;
     // dpad() returns 0x00 to 0x08 or 0x0F depending on library
-    // We'll do a simple check if dpadVal == DPAD_UP or DPAD_DOWN
-    if (dpadVal == DPAD_UP && currentGear < 5) {
+    // We'll do a simple check if dpadVal == DPAD_UP or DPAD_DOWN,
+    // and only shift when the button goes down
+    bool gearUp   = (dpadVal == DPAD_UP);
+    bool gearDown = (dpadVal == DPAD_DOWN);
+    if (gearUp && !gearUpHeld && currentGear < 5) {
         currentGear++;
-        Serial.printf("Gear shifted up to %d\n", currentGear);
-    } else if (dpadVal == DPAD_DOWN && currentGear > 1) {
+        LOG_INFO("Gear shifted up to %d", currentGear);
+    } else if (gearDown && !gearDownHeld && currentGear > 1) {
         currentGear--;
-        Serial.printf("Gear shifted down to %d\n", currentGear);
+        LOG_INFO("Gear shifted down to %d", currentGear);
     }
+    gearUpHeld   = gearUp;
+    gearDownHeld = gearDown;
 
     // Now we update the control variables
     updateControlVariables();
 }
 
+// Whether the gamepad's input is fresh: a report is. Between reports it
+// still is for reportKeepAliveMs, for the pads that only report changes,
+// and for as long as the gamepad is centred, as a stalled link can't move
+// the tank then.
+bool BluetoothControl::inputFresh(bool received, unsigned long currentTime) {
+    if (received) {
+        lastReportTime = currentTime;
+        return true;
+    }
+    bool centred = driveInput == 0 && turnInput == 0 && turretRotationInput == 0 &&
+                   turretElevationInput == 0 && !firePressed;
+    return centred || currentTime - lastReportTime <= reportKeepAliveMs;
+}
+
 // ----------------------
 // updateControlVariables
 // ----------------------
 void BluetoothControl::updateControlVariables() {
-    // Movement
-    int forwardBackward = 0;
-    int turn = 0;
-
-    if (forwardPressed) {
-        forwardBackward += 100;
-    }
-    if (backPressed) {
-        forwardBackward -= 100;
-    }
-    if (leftPressed) {
-        turn -= 100;
-    }
-    if (rightPressed) {
-        turn += 100;
-    }
-
-    // Gear scaling
-    float gearScaling = (float)currentGear / 5.0f;
-
-    leftTrackSpeed  = constrain((forwardBackward + turn) * gearScaling, -100, 100);
-    rightTrackSpeed = constrain((forwardBackward - turn) * gearScaling, -100, 100);
-
-    // Turret
-    if (turretLeftPressed) {
-        turretRotation = -100;
-    } else if (turretRightPressed) {
-        turretRotation = 100;
-    } else {
-        turretRotation = 0;
-    }
-
-    if (turretElevatePressed) {
-        turretElevation = 100;
-    } else if (turretLowerPressed) {
-        turretElevation = -100;
-    } else {
-        turretElevation = 0;
-    }
-
-    // Flamethrower
-    flamethrowerActive = firePressed;
+    MixerInput input;
+    input.drive           = driveInput;
+    input.turn            = turnInput;
+    input.turretRotation  = turretRotationInput;
+    input.turretElevation = turretElevationInput;
+    input.fire            = firePressed;
+    input.gear            = currentGear;
+
+    ControlState next = getState();
+    next.connected = true;
+    TankMixer::mix(input, next);
+    publishState(next, millis());
 }
+
+#endif // CONTROL_MODE_BLUETOOTH
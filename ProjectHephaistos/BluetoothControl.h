@@ -2,62 +2,99 @@
 #define BLUETOOTH_CONTROL_H
 
 #include "TankControlInterface.h"
+#include "AnalogStick.h"
+#include "InputRecord.h"
 #include <Arduino.h>
 #include <Bluepad32.h>
 
-class BluetoothControl : public TankControlInterface {
+// Gamepad control through Bluepad32. Each report is fresh input for the
+// failsafe; a connected gamepad that goes quiet with a stick off centre
+// stays live for reportKeepAliveMs more, so a stalled one is stopped
+// within that plus FAILSAFE_DEADLINE_MS.
+class BluetoothControl final : public TankControlInterface {
 public:
     BluetoothControl();
     ~BluetoothControl();
 
     void update() override;
 
-    bool isConnected() const override;
+    // Allowance for gamepads that only report changes, e.g. a stick held
+    // still at full deflection
+    static const unsigned long reportKeepAliveMs = 200;
 
-    int getLeftTrackSpeed() const override;
-    int getRightTrackSpeed() const override;
+    // Stick response curves can be changed at runtime; Select on the
+    // gamepad cycles through them as well
+    static const uint8_t curveCount = 3;
+    void selectCurve(uint8_t index);
+    void setCurveExpo(uint8_t index, uint8_t expoPercent);
 
-    int getTurretRotation() const override;
-    int getTurretElevation() const override;
+    // Raw axis ranges of the connected gamepad (default -512..511)
+    void setCalibration(const AxisCalibration& x, const AxisCalibration& y,
+                        const AxisCalibration& rx, const AxisCalibration& ry);
 
-    bool isFlamethrowerActive() const override;
-
-    int getCurrentGear() const override;
+    // Input from a recorded session (ReplayControl.h) instead of BP32:
+    // replaySample() takes one sample, replayPoll() stands in for update()
+    void replaySample(const InputRecord::Sample& sample);
+    void replayPoll();
 
 private:
+    static const uint8_t stickDeadzonePercent = 8;
+    static const uint8_t defaultCurve = 1;
+    static const uint8_t curveExpo[curveCount];
+
     // Callback when a new controller is connected
     static void onConnectedController(ControllerPtr ctl);
     // Callback when a controller is disconnected
     static void onDisconnectedController(ControllerPtr ctl);
 
-    void processGamepad(ControllerPtr ctl);
+    // One gamepad report, as processGamepad() uses it
+    struct GamepadInput {
+        int16_t x;
+        int16_t y;
+        int16_t rx;
+        int16_t ry;
+        uint8_t dpad;
+        bool a;
+        bool select;
+    };
+
+    static GamepadInput readGamepad(ControllerPtr ctl);
+    void processGamepad(const GamepadInput& pad);
+    bool inputFresh(bool received, unsigned long currentTime);
     void updateControlVariables();
 
     // We'll store the currently connected controller
     static ControllerPtr controller;
 
-    // Internal control variables
+    // Selected gear (1..5)
     int currentGear;
-    int leftTrackSpeed;
-    int rightTrackSpeed;
-    int turretRotation;
-    int turretElevation;
-    bool flamethrowerActive;
-
-    // State variables for pressed states
-    bool forwardPressed;
-    bool backPressed;
-    bool leftPressed;
-    bool rightPressed;
-    bool turretLeftPressed;
-    bool turretRightPressed;
-    bool turretElevatePressed;
-    bool turretLowerPressed;
+
+    // Analog input pipeline
+    AnalogStick driveStick;
+    AnalogStick turretStick;
+    ResponseCurve curves[curveCount];
+    uint8_t curveIndex;
+
+    // Latest proportional inputs, -100..100
+    int8_t driveInput;
+    int8_t turnInput;
+    int8_t turretRotationInput;
+    int8_t turretElevationInput;
     bool firePressed;
 
-    // Update timing
-    unsigned long lastUpdateTime;
-    const unsigned long updateInterval = 50; // in milliseconds
+    // D-pad state of the previous poll, so a held button shifts only once
+    bool gearUpHeld;
+    bool gearDownHeld;
+    bool selectHeld;
+
+    // When the last report came, for the keep-alive
+    unsigned long lastReportTime;
+
+    // Latest replayed report and link state; whether a report came since
+    // the last poll
+    GamepadInput replayInput;
+    bool replayConnected;
+    bool replayReported;
 
     static BluetoothControl* instance;
 };
@@ -0,0 +1,92 @@
+#ifndef CONTROL_CONFIG_H
+#define CONTROL_CONFIG_H
+
+// Build configuration shared by the sketch and the backend sources.
+// Each backend .cpp is only compiled when its mode is selected, so
+// unused backends (and Bluepad32) stay out of the firmware.
+
+// -------------------------------
+// Control Mode
+// Pick one here, or pass it on the compiler command line
+// (e.g. -DCONTROL_MODE_SERIAL).
+#if !defined(CONTROL_MODE_SERIAL) && !defined(CONTROL_MODE_BLUETOOTH) && \
+    !defined(CONTROL_MODE_KEYBOARD) && !defined(CONTROL_MODE_RC) && \
+    !defined(CONTROL_MODE_RC_BUS) && !defined(CONTROL_MODE_UDP)
+// #define CONTROL_MODE_SERIAL
+#define CONTROL_MODE_BLUETOOTH
+// #define CONTROL_MODE_KEYBOARD
+//#define CONTROL_MODE_RC
+// #define CONTROL_MODE_RC_BUS
+// #define CONTROL_MODE_UDP
+#endif
+
+// Single-wire receiver settings for CONTROL_MODE_RC_BUS
+// (RCBusControl::PROTOCOL_SBUS, PROTOCOL_IBUS or PROTOCOL_PPM)
+#define RC_BUS_PROTOCOL RCBusControl::PROTOCOL_SBUS
+#define RC_BUS_RX_PIN   16
+
+// Wi-Fi settings for CONTROL_MODE_UDP. As an access point the tank is at
+// 192.168.4.1; the password needs at least 8 characters. Datagrams are
+// held UDP_JITTER_BUFFER_MS longer than the fastest ones took, 0 applies
+// each on arrival (see UdpControl.h).
+#define UDP_WIFI_SSID         "Hephaistos"
+#define UDP_WIFI_PASSWORD     "flamethrower"
+#define UDP_WIFI_ACCESS_POINT true
+#ifndef UDP_CONTROL_PORT
+#define UDP_CONTROL_PORT      4210
+#endif
+#define UDP_JITTER_BUFFER_MS  20
+// -------------------------------
+
+// -------------------------------
+// Controller Dispatch
+// By default the selected backend is a static object driven through
+// ControlLoop<Backend>, so update() and the getters are direct calls.
+// Define CONTROL_DISPATCH_VIRTUAL to heap-allocate the controller and call
+// it through TankControlInterface instead (useful to compare size and
+// loop time, see host/tools/size_report.sh).
+// #define CONTROL_DISPATCH_VIRTUAL
+// -------------------------------
+
+// -------------------------------
+// Logging
+// Messages above this level are compiled out: LOG_LEVEL_NONE, _ERROR,
+// _WARN, _INFO or _DEBUG (see Log.h)
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+// -------------------------------
+
+// -------------------------------
+// Latency tracing
+// Timestamps every control change from input arrival to the actuator
+// commit and streams the events as TYPE_TRACE frames (see LatencyTrace.h)
+// #define LATENCY_TRACE
+// -------------------------------
+
+// -------------------------------
+// Profiling
+// Per-section CPU time, task stacks and heap, reported on the "stats"
+// serial command (see Profiler.h). A few cycles per section.
+#define PROFILING
+// -------------------------------
+
+// -------------------------------
+// Input recording and replay
+// INPUT_RECORDING writes the backend's raw input to the "records" flash
+// partition (partitions.csv), one session per boot (see InputRecorder.h).
+// The partition is the stock layout's data partition renamed, so both OTA
+// app slots stay as they are in every build.
+// INPUT_REPLAY ignores the live input and plays back session
+// REPLAY_SESSION (0 = the latest) through the same backend instead, e.g.
+// to compare LATENCY_TRACE results before and after a change.
+// #define INPUT_RECORDING
+// #define INPUT_REPLAY
+#define REPLAY_SESSION 0
+
+#if defined(INPUT_RECORDING) && defined(INPUT_REPLAY)
+#error "INPUT_RECORDING and INPUT_REPLAY can't be used together"
+#endif
+// -------------------------------
+
+#endif // CONTROL_CONFIG_H
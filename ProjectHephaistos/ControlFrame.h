@@ -0,0 +1,137 @@
+#ifndef CONTROL_FRAME_H
+#define CONTROL_FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Binary serial frames
+//
+//   +------+------+-----+-------------------+------+
+//   | 0xA5 | type | len | payload (len B)   | crc8 |
+//   +------+------+-----+-------------------+------+
+//
+// The CRC-8 (polynomial 0x07) covers type, len and payload. The sync byte is
+// outside the ASCII range, so binary frames and text command lines can share
+// the same link.
+namespace ControlFrame {
+
+const uint8_t syncByte = 0xA5;
+const uint8_t maxPayload = 64;
+const uint8_t overhead = 4; // sync, type, len, crc
+
+enum Type {
+    TYPE_CONTROL_STATE = 0x01,
+    TYPE_TELEMETRY     = 0x02,  // tank -> host, see Telemetry.h
+    TYPE_TRACE         = 0x03,  // tank -> host, see LatencyTrace.h
+    TYPE_NET_STATE     = 0x04,  // host -> tank over UDP, see UdpControl.h
+    TYPE_NET_ACK       = 0x05,  // tank -> host over UDP
+    TYPE_PING          = 0x06,  // host -> tank, serial or UDP
+    TYPE_PONG          = 0x07   // tank -> host, the answer to a ping
+};
+
+// Full stick and button state, sent by the host whenever anything changes
+// (and periodically as a keep-alive)
+struct ControlStatePayload {
+    uint8_t sequence;        // increments with every frame
+    int8_t drive;            // -100..100, positive = forward
+    int8_t turn;             // -100..100, positive = right
+    int8_t turretRotation;   // -100..100, positive = right
+    int8_t turretElevation;  // -100..100, positive = up
+    uint8_t gear;            // 1..5, 0 = keep current gear
+    uint8_t buttons;         // BUTTON_* bits
+} __attribute__((packed));
+
+const uint8_t BUTTON_FIRE = 0x01;
+
+// Full state in one UDP datagram, sent at a fixed rate whether anything
+// changed or not. The 32-bit sequence doesn't wrap in practice, so late
+// and duplicated datagrams can be told apart from new ones.
+struct NetStatePayload {
+    uint32_t sequence;       // increments with every datagram
+    uint32_t sendTimeMs;     // sender's clock, echoed in the ack
+    int8_t drive;            // -100..100, positive = forward
+    int8_t turn;             // -100..100, positive = right
+    int8_t turretRotation;   // -100..100, positive = right
+    int8_t turretElevation;  // -100..100, positive = up
+    uint8_t gear;            // 1..5, 0 = keep current gear
+    uint8_t buttons;         // BUTTON_* bits
+} __attribute__((packed));
+
+// The tank's answer to every state datagram it could decode
+struct NetAckPayload {
+    uint32_t sequence;       // of the datagram answered
+    uint32_t sendTimeMs;     // echoed from it, for the round-trip time
+    uint32_t applied;        // last sequence that reached the outputs
+    uint16_t stale;          // datagrams dropped as late or duplicated so far
+    uint16_t overflowed;     // dropped from a full jitter buffer so far
+    uint8_t buffered;        // datagrams waiting in the jitter buffer
+    uint8_t flags;           // ACK_* bits
+} __attribute__((packed));
+
+const uint8_t ACK_STALE = 0x01;  // this datagram was dropped as stale
+
+// Latency probe, answered as soon as it is parsed. With the tank's
+// receive and send times the host can split the round trip into the two
+// directions (tank_controller.py), and the counters show whether the
+// tank keeps up with what it is sent.
+struct PingPayload {
+    uint32_t sequence;
+    uint32_t hostTimeUs;     // sender's clock, echoed
+} __attribute__((packed));
+
+struct PongPayload {
+    uint32_t sequence;       // of the ping answered
+    uint32_t hostTimeUs;     // echoed from it
+    uint32_t receivedUs;     // tank's clock as the ping was parsed
+    uint32_t sentUs;         // tank's clock as the pong went out
+    uint32_t frames;         // frames (serial) or datagrams (UDP) decoded so far, pings included
+    uint32_t rejected;       // bad CRC or not understood so far
+    uint16_t backlog;        // serial: bytes waiting behind the ping; UDP: datagrams held
+} __attribute__((packed));
+
+uint8_t crc8(const uint8_t* data, size_t length, uint8_t crc = 0);
+
+// Writes a complete frame to out (payload length + overhead bytes).
+// Returns the number of bytes written, 0 if the payload is too large.
+size_t encode(uint8_t type, const void* payload, uint8_t length, uint8_t* out, size_t outSize);
+
+// Incremental frame parser, fed one byte at a time
+class Parser {
+public:
+    Parser();
+
+    // Returns true when the byte completed a frame with a valid CRC
+    bool feed(uint8_t byte);
+
+    // True while a frame has started but is not complete yet
+    bool inFrame() const { return state != WAIT_SYNC; }
+
+    uint8_t type() const { return frameType; }
+    uint8_t length() const { return frameLength; }
+    const uint8_t* payload() const { return buffer; }
+
+    uint32_t framesReceived() const { return received; }
+    uint32_t framesRejected() const { return rejected; }
+
+private:
+    enum State {
+        WAIT_SYNC,
+        WAIT_TYPE,
+        WAIT_LENGTH,
+        WAIT_PAYLOAD,
+        WAIT_CRC
+    };
+
+    State state;
+    uint8_t frameType;
+    uint8_t frameLength;
+    uint8_t position;
+    uint8_t crc;
+    uint8_t buffer[maxPayload];
+    uint32_t received;
+    uint32_t rejected;
+};
+
+} // namespace ControlFrame
+
+#endif // CONTROL_FRAME_H
@@ -0,0 +1,32 @@
+#ifndef CONTROL_LOOP_H
+#define CONTROL_LOOP_H
+
+#include "TankControlInterface.h"
+#include "ControlState.h"
+
+// Input side of the control loop for one backend type.
+//
+// With Backend = TankControlInterface every update() goes through the
+// vtable. With the concrete (final) backend class the compiler knows the
+// exact type, so update() is a direct call it can inline together with
+// getState().
+template <typename Backend>
+class ControlLoop {
+public:
+    ControlLoop() : backend(nullptr) {}
+
+    void begin(Backend* control) { backend = control; }
+
+    // Polls the backend and returns its latest state
+    const ControlState& poll() {
+        backend->update();
+        return backend->getState();
+    }
+
+    Backend& controller() { return *backend; }
+
+private:
+    Backend* backend;
+};
+
+#endif // CONTROL_LOOP_H
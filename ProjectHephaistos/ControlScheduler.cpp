@@ -0,0 +1,116 @@
+#include "ControlScheduler.h"
+
+ControlScheduler::ControlScheduler(uint32_t baseRateHz)
+    : baseRateHz(baseRateHz),
+      periodUs(1000000UL / baseRateHz),
+      count(0),
+      started(false),
+      tickIndex(0),
+      releaseUs(0),
+      skipped(0)
+{
+#ifdef SCHEDULER_TICK_WAKEUPS
+    lastWakeTick = 0;
+    periodTicks = (TickType_t)(configTICK_RATE_HZ / baseRateHz);
+    if (periodTicks == 0) {
+        periodTicks = 1;
+    }
+#endif
+}
+
+bool ControlScheduler::addStage(const char* name, uint32_t rateHz, StageFunction function) {
+    if (count >= maxStages || rateHz == 0) {
+        return false;
+    }
+
+    Stage& stage = stages[count++];
+    stage.name = name;
+    stage.divider = baseRateHz / rateHz;
+    if (stage.divider == 0) {
+        stage.divider = 1;
+    }
+    stage.function = function;
+    stage.stats = StageStats();
+    return true;
+}
+
+void ControlScheduler::resetStats() {
+    for (uint8_t i = 0; i < count; i++) {
+        stages[i].stats = StageStats();
+    }
+    skipped = 0;
+}
+
+void ControlScheduler::waitForRelease() {
+    if (!started) {
+        started = true;
+#ifdef SCHEDULER_TICK_WAKEUPS
+        // Start on a tick boundary, where all later wake-ups are
+        lastWakeTick = xTaskGetTickCount();
+        vTaskDelayUntil(&lastWakeTick, 1);
+#endif
+        releaseUs = micros();
+        return;
+    }
+
+    releaseUs += periodUs;
+
+    // More than a full period behind: skip the missed ticks instead of
+    // running them back to back
+    int32_t late = (int32_t)(micros() - releaseUs);
+    if (late >= (int32_t)periodUs) {
+        uint32_t missed = (uint32_t)late / periodUs;
+        skipped += missed;
+        tickIndex += missed;
+        releaseUs += missed * periodUs;
+#ifdef SCHEDULER_TICK_WAKEUPS
+        // The same release, in ticks
+        lastWakeTick += (missed + 1) * periodTicks;
+#endif
+        return;
+    }
+
+#ifdef SCHEDULER_TICK_WAKEUPS
+    vTaskDelayUntil(&lastWakeTick, periodTicks);
+#else
+    if (late < 0) {
+        delayMicroseconds((unsigned int)-late);
+    }
+#endif
+}
+
+void ControlScheduler::runTick() {
+    waitForRelease();
+
+    for (uint8_t i = 0; i < count; i++) {
+        Stage& stage = stages[i];
+        if (tickIndex % stage.divider != 0) {
+            continue;
+        }
+
+        uint32_t startUs = micros();
+        stage.function();
+        uint32_t endUs = micros();
+
+        // Signed: a wake-up can come a little before releaseUs, by the
+        // difference in wake-up latency to the first tick
+        StageStats& stats = stage.stats;
+        int32_t startLate = (int32_t)(startUs - releaseUs);
+        uint32_t jitter = startLate > 0 ? (uint32_t)startLate : 0;
+        uint32_t runTime = endUs - startUs;
+        stats.runs++;
+        stats.totalJitterUs += jitter;
+        if (jitter > stats.maxJitterUs) {
+            stats.maxJitterUs = jitter;
+        }
+        stats.totalRunUs += runTime;
+        if (runTime > stats.maxRunUs) {
+            stats.maxRunUs = runTime;
+        }
+        if ((int32_t)(endUs - releaseUs) > (int32_t)(periodUs * stage.divider)) {
+            stats.deadlineMisses++;
+        }
+    }
+
+    tickIndex++;
+}
@@ -0,0 +1,93 @@
+#ifndef CONTROL_SCHEDULER_H
+#define CONTROL_SCHEDULER_H
+
+#include <Arduino.h>
+
+// Fixed-rate scheduler for the control loop.
+//
+// The scheduler ticks at a fixed base rate; each stage runs every n-th tick
+// so its rate is baseRate / n. Release times are absolute (tick k is due at
+// start + k * period), so the loop does not drift when a stage takes longer
+// than usual. On the ESP32 the wait between ticks is vTaskDelayUntil(), which
+// lets the other tasks run but wakes on FreeRTOS tick boundaries; release
+// times are counted in whole ticks from the first wake-up, so they match
+// the wake-ups, and the base period has to be a whole number of ticks
+// (rateSupported()). CONTROL_SCHEDULER_TICKS takes the same path on the
+// host, with the shim's ticks.
+#if defined(ESP32) || defined(CONTROL_SCHEDULER_TICKS)
+#define SCHEDULER_TICK_WAKEUPS
+#endif
+
+class ControlScheduler {
+public:
+    typedef void (*StageFunction)();
+
+    static const uint8_t maxStages = 6;
+
+    // Whether a base rate's period is a whole number of ticks (of
+    // microseconds without FreeRTOS); others would drift
+#ifdef SCHEDULER_TICK_WAKEUPS
+    static constexpr bool rateSupported(uint32_t rateHz) {
+        return rateHz > 0 && configTICK_RATE_HZ % rateHz == 0;
+    }
+#else
+    static constexpr bool rateSupported(uint32_t rateHz) {
+        return rateHz > 0 && 1000000UL % rateHz == 0;
+    }
+#endif
+
+    struct StageStats {
+        uint32_t runs;
+        uint32_t deadlineMisses;  // stage finished after its next release
+        uint32_t maxJitterUs;     // latest start after the ideal release
+        uint32_t totalJitterUs;
+        uint32_t totalRunUs;
+        uint32_t maxRunUs;        // longest execution time
+    };
+
+    ControlScheduler(uint32_t baseRateHz);
+
+    // Adds a stage running at rateHz (rounded to a divisor of the base rate).
+    // Stages run in the order they were added.
+    bool addStage(const char* name, uint32_t rateHz, StageFunction function);
+
+    // Waits for the next tick and runs every stage that is due
+    void runTick();
+
+    uint8_t stageCount() const { return count; }
+    const char* stageName(uint8_t index) const { return stages[index].name; }
+    uint32_t stageRateHz(uint8_t index) const { return baseRateHz / stages[index].divider; }
+    const StageStats& stats(uint8_t index) const { return stages[index].stats; }
+
+    // Ticks that started more than a full period late and were skipped
+    uint32_t skippedTicks() const { return skipped; }
+
+    void resetStats();
+
+private:
+    struct Stage {
+        const char* name;
+        uint32_t divider;
+        StageFunction function;
+        StageStats stats;
+    };
+
+    uint32_t baseRateHz;
+    uint32_t periodUs;
+    Stage stages[maxStages];
+    uint8_t count;
+
+    bool started;
+    uint32_t tickIndex;
+    uint32_t releaseUs;  // ideal start of the current tick
+    uint32_t skipped;
+
+    void waitForRelease();
+
+#ifdef SCHEDULER_TICK_WAKEUPS
+    TickType_t lastWakeTick;
+    TickType_t periodTicks;
+#endif
+};
+
+#endif // CONTROL_SCHEDULER_H
@@ -0,0 +1,27 @@
+#ifndef CONTROL_STATE_H
+#define CONTROL_STATE_H
+
+#include <stdint.h>
+
+// Bump when the layout below changes
+#define CONTROL_STATE_VERSION 1
+
+// Everything the actuation side needs from a control backend, handed over
+// as one unit. Fixed layout (16 bytes, no padding) so it can be copied
+// between cores, logged or sent over a link as is.
+struct ControlState {
+    uint32_t sequence;        // incremented whenever any value below changes
+    uint32_t timestampMs;     // millis() of the last change
+    uint8_t version;          // CONTROL_STATE_VERSION
+    bool connected;
+    int8_t leftTrackSpeed;    // -100..100
+    int8_t rightTrackSpeed;   // -100..100
+    int8_t turretRotation;    // -100..100, positive = right
+    int8_t turretElevation;   // -100..100, positive = up
+    bool flamethrowerActive;
+    uint8_t currentGear;      // 1..5
+} __attribute__((packed));
+
+static_assert(sizeof(ControlState) == 16, "ControlState layout changed, bump CONTROL_STATE_VERSION");
+
+#endif // CONTROL_STATE_H
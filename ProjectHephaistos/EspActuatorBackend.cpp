@@ -0,0 +1,56 @@
+#include "EspActuatorBackend.h"
+
+#if defined(ESP32)
+#include <soc/gpio_reg.h>
+#include <soc/soc_caps.h>
+#endif
+
+void EspActuatorBackend::configureDigital(uint8_t pin) {
+    pinMode(pin, OUTPUT);
+}
+
+bool EspActuatorBackend::configurePwm(uint8_t pin, uint32_t frequencyHz, uint8_t resolutionBits) {
+    // Picks a free LEDC channel and timer for the pin
+    return ledcAttach(pin, frequencyHz, resolutionBits);
+}
+
+void EspActuatorBackend::writeDigital(uint64_t setMask, uint64_t clearMask) {
+#if defined(ESP32)
+    // Clear first: pins swapping levels go through low, never both high
+    uint32_t clearLow = (uint32_t)clearMask;
+    uint32_t setLow = (uint32_t)setMask;
+    if (clearLow) {
+        REG_WRITE(GPIO_OUT_W1TC_REG, clearLow);
+    }
+#if SOC_GPIO_PIN_COUNT > 32
+    uint32_t clearHigh = (uint32_t)(clearMask >> 32);
+    uint32_t setHigh = (uint32_t)(setMask >> 32);
+    if (clearHigh) {
+        REG_WRITE(GPIO_OUT1_W1TC_REG, clearHigh);
+    }
+    if (setHigh) {
+        REG_WRITE(GPIO_OUT1_W1TS_REG, setHigh);
+    }
+#endif
+    if (setLow) {
+        REG_WRITE(GPIO_OUT_W1TS_REG, setLow);
+    }
+#else
+    for (uint8_t pin = 0; pin < maxPins; pin++) {
+        uint64_t bit = 1ULL << pin;
+        if (clearMask & bit) {
+            digitalWrite(pin, LOW);
+        }
+    }
+    for (uint8_t pin = 0; pin < maxPins; pin++) {
+        uint64_t bit = 1ULL << pin;
+        if (setMask & bit) {
+            digitalWrite(pin, HIGH);
+        }
+    }
+#endif
+}
+
+void EspActuatorBackend::writePwm(uint8_t pin, uint32_t duty) {
+    ledcWrite(pin, duty);
+}
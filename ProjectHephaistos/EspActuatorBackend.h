@@ -0,0 +1,18 @@
+#ifndef ESP_ACTUATOR_BACKEND_H
+#define ESP_ACTUATOR_BACKEND_H
+
+#include "ActuatorBackend.h"
+#include <Arduino.h>
+
+// ActuatorBackend for the ESP32: digital outputs go straight to the GPIO
+// write-1-to-set/clear registers, PWM outputs to LEDC. Other targets fall
+// back to digitalWrite() per pin.
+class EspActuatorBackend : public ActuatorBackend {
+protected:
+    void configureDigital(uint8_t pin) override;
+    bool configurePwm(uint8_t pin, uint32_t frequencyHz, uint8_t resolutionBits) override;
+    void writeDigital(uint64_t setMask, uint64_t clearMask) override;
+    void writePwm(uint8_t pin, uint32_t duty) override;
+};
+
+#endif // ESP_ACTUATOR_BACKEND_H
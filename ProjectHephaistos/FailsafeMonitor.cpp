@@ -0,0 +1,50 @@
+#include "FailsafeMonitor.h"
+
+FailsafeMonitor::FailsafeMonitor(uint32_t deadlineUs)
+    : deadlineUs(deadlineUs),
+      lastFreshUs(0),
+      fed(false),
+      safe(true),
+      everFed(false),
+      tripLastFreshUs(0),
+      counters()
+{
+}
+
+void FailsafeMonitor::feed(uint32_t nowUs) {
+    lastFreshUs.store(nowUs, std::memory_order_relaxed);
+    fed.store(true, std::memory_order_release);
+}
+
+bool FailsafeMonitor::check(uint32_t nowUs) {
+    if (!fed.load(std::memory_order_acquire)) {
+        // No input yet: safe, but nothing was lost
+        return true;
+    }
+    uint32_t freshUs = lastFreshUs.load(std::memory_order_relaxed);
+    // A feed() from the other core may be newer than nowUs
+    int32_t sinceUs = (int32_t)(nowUs - freshUs);
+    bool expired = sinceUs > (int32_t)deadlineUs;
+
+    if (expired && !safe) {
+        uint32_t detectionUs = (uint32_t)sinceUs;
+        counters.trips++;
+        counters.lastDetectionUs = detectionUs;
+        counters.maxDetectionUs = detectionUs > counters.maxDetectionUs ? detectionUs : counters.maxDetectionUs;
+        counters.totalDetectionUs += detectionUs;
+        tripLastFreshUs = freshUs;
+        published.store(counters);
+    } else if (!expired && safe) {
+        // Input is back after a trip, or here for the first time
+        if (everFed) {
+            uint32_t outageMs = (freshUs - tripLastFreshUs) / 1000;
+            if (outageMs > counters.longestOutageMs) {
+                counters.longestOutageMs = outageMs;
+                published.store(counters);
+            }
+        }
+        everFed = true;
+    }
+    safe = expired;
+    return safe;
+}
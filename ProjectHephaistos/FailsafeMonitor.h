@@ -0,0 +1,62 @@
+#ifndef FAILSAFE_MONITOR_H
+#define FAILSAFE_MONITOR_H
+
+#include <stdint.h>
+#include <atomic>
+#include "SeqLock.h"
+
+// Deadline on fresh control input, whatever the backend.
+//
+// The input side calls feed() whenever the backend had fresh input
+// (TankControlInterface::freshCount() moved); the actuation side calls
+// check() every tick and stops the tank while it returns true. It does
+// from the start until the first input, and again once deadlineUs has
+// passed without one. Detection takes at most the deadline plus the
+// period check() is called at; how long it took, from the last fresh
+// input, is kept per trip.
+//
+// feed() and check() may run on different cores. check() is the only
+// writer of the stats, which stats() copies out from anywhere.
+class FailsafeMonitor {
+public:
+    struct Stats {
+        uint32_t trips;              // deadline passed while input had been live
+        uint32_t lastDetectionUs;    // last fresh input to the trip, last one
+        uint32_t maxDetectionUs;
+        uint32_t totalDetectionUs;   // for the average
+        uint32_t longestOutageMs;    // of the outages that ended
+    };
+
+    explicit FailsafeMonitor(uint32_t deadlineUs);
+
+    void setDeadline(uint32_t us) { deadlineUs = us; }
+    uint32_t deadline() const { return deadlineUs; }
+
+    // Fresh input at nowUs
+    void feed(uint32_t nowUs);
+
+    // Whether the outputs have to be safe at nowUs
+    bool check(uint32_t nowUs);
+
+    // Whether the deadline has passed since the last input; not before
+    // the first one
+    bool tripped() const { return safe && everFed; }
+
+    void stats(Stats& out) const { published.load(out); }
+
+private:
+    uint32_t deadlineUs;
+
+    // Written by feed(), read by check()
+    std::atomic<uint32_t> lastFreshUs;
+    std::atomic<bool> fed;
+
+    // check()'s own
+    bool safe;
+    bool everFed;
+    uint32_t tripLastFreshUs;
+    Stats counters;
+    SeqLock<Stats> published;
+};
+
+#endif // FAILSAFE_MONITOR_H
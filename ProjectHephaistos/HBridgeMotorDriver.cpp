@@ -0,0 +1,24 @@
+#include "HBridgeMotorDriver.h"
+
+HBridgeMotorDriver::HBridgeMotorDriver(ActuatorBackend& actuators, uint8_t pwmPin,
+                                       uint8_t forwardPin, uint8_t reversePin)
+    : actuators(actuators),
+      pwmPin(pwmPin),
+      forwardPin(forwardPin),
+      reversePin(reversePin)
+{
+}
+
+bool HBridgeMotorDriver::begin(uint32_t frequencyHz, uint8_t resolutionBits) {
+    return actuators.addDigitalOutput(forwardPin, false) &&
+           actuators.addDigitalOutput(reversePin, false) &&
+           actuators.addPwmOutput(pwmPin, frequencyHz, resolutionBits);
+}
+
+void HBridgeMotorDriver::write(uint32_t duty, Direction direction) {
+    // The backend clears before it sets, so a reversal passes through
+    // coast instead of driving both bridge inputs high
+    actuators.setDigital(forwardPin, direction == DIRECTION_FORWARD);
+    actuators.setDigital(reversePin, direction == DIRECTION_REVERSE);
+    actuators.setPwm(pwmPin, duty);
+}
@@ -0,0 +1,25 @@
+#ifndef HBRIDGE_MOTOR_DRIVER_H
+#define HBRIDGE_MOTOR_DRIVER_H
+
+#include "MotorDriver.h"
+#include "ActuatorBackend.h"
+
+// H-bridge with a PWM enable input and two direction inputs (L298N style,
+// or a TB6612 with PWMx/INx1/INx2). Writes are staged on the actuator
+// backend and reach the pins with the next commit(), together with every
+// other output of the tick.
+class HBridgeMotorDriver : public MotorDriver {
+public:
+    HBridgeMotorDriver(ActuatorBackend& actuators, uint8_t pwmPin, uint8_t forwardPin, uint8_t reversePin);
+
+    bool begin(uint32_t frequencyHz, uint8_t resolutionBits) override;
+    void write(uint32_t duty, Direction direction) override;
+
+private:
+    ActuatorBackend& actuators;
+    uint8_t pwmPin;
+    uint8_t forwardPin;
+    uint8_t reversePin;
+};
+
+#endif // HBRIDGE_MOTOR_DRIVER_H
@@ -0,0 +1,140 @@
+#include "InputRecord.h"
+#include "ControlFrame.h"
+#include <string.h>
+
+namespace InputRecord {
+
+// Sticks, keys and pulse widths change a little at a time; serial bytes
+// and the link state don't
+static bool isDelta(uint8_t type) {
+    return type == TYPE_GAMEPAD || type == TYPE_KEYS || type == TYPE_RC_PULSES || type == TYPE_RC_FRAME;
+}
+
+static size_t putVarint(uint32_t value, uint8_t* out) {
+    size_t length = 0;
+    while (value >= 0x80) {
+        out[length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[length++] = (uint8_t)value;
+    return length;
+}
+
+// Reads a varint of up to 5 bytes from [*data, end); false if cut short
+static bool getVarint(const uint8_t*& data, const uint8_t* end, uint32_t& value) {
+    value = 0;
+    for (uint8_t shift = 0; shift < 35; shift += 7) {
+        if (data >= end) {
+            return false;
+        }
+        uint8_t byte = *data++;
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint32_t zigzag(int16_t value) {
+    return (uint16_t)((value << 1) ^ (value >> 15));
+}
+
+static int16_t unzigzag(uint32_t value) {
+    return (int16_t)((value >> 1) ^ (0u - (value & 1)));
+}
+
+Encoder::Encoder() {
+    reset();
+}
+
+void Encoder::reset() {
+    lastTimeUs = 0;
+    memset(previous, 0, sizeof(previous));
+}
+
+size_t Encoder::encode(const Sample& sample, uint8_t* out, size_t outSize) {
+    if (sample.type == 0 || sample.type >= typeCount || sample.count > maxValues || outSize < maxRecordSize) {
+        return 0;
+    }
+
+    uint8_t* body = out + 1;
+    size_t length = 0;
+    body[length++] = sample.type;
+    uint32_t dt = sample.timeUs >= lastTimeUs ? sample.timeUs - lastTimeUs : 0;
+    length += putVarint(dt, body + length);
+    body[length++] = sample.count;
+
+    bool delta = isDelta(sample.type);
+    int16_t* last = previous[sample.type];
+    for (uint8_t i = 0; i < sample.count; i++) {
+        // Wraps like the values themselves, so any change fits in 16 bits
+        int16_t value = delta ? (int16_t)(uint16_t)(sample.values[i] - last[i]) : sample.values[i];
+        length += putVarint(zigzag(value), body + length);
+        last[i] = sample.values[i];
+    }
+    body[length] = ControlFrame::crc8(body, length);
+    length++;
+
+    lastTimeUs = sample.timeUs;
+    out[0] = (uint8_t)length;
+    return length + 1;
+}
+
+Decoder::Decoder() {
+    reset();
+}
+
+void Decoder::reset() {
+    lastTimeUs = 0;
+    memset(previous, 0, sizeof(previous));
+}
+
+size_t Decoder::decode(const uint8_t* data, size_t length, Sample& sample) {
+    if (length < 1 || data[0] < 4 || length < (size_t)data[0] + 1) {
+        return 0;
+    }
+    const uint8_t* body = data + 1;
+    size_t bodyLength = data[0];
+    if (ControlFrame::crc8(body, bodyLength - 1) != body[bodyLength - 1]) {
+        return 0;
+    }
+
+    const uint8_t* in = body;
+    const uint8_t* end = body + bodyLength - 1;
+    uint8_t type = *in++;
+    uint32_t dt;
+    if (type == 0 || type >= typeCount || !getVarint(in, end, dt) || in >= end) {
+        return 0;
+    }
+    uint8_t count = *in++;
+    if (count > maxValues) {
+        return 0;
+    }
+
+    bool delta = isDelta(type);
+    int16_t* last = previous[type];
+    int16_t values[maxValues];
+    for (uint8_t i = 0; i < count; i++) {
+        uint32_t raw;
+        if (!getVarint(in, end, raw)) {
+            return 0;
+        }
+        int16_t value = unzigzag(raw);
+        values[i] = delta ? (int16_t)(uint16_t)(last[i] + value) : value;
+    }
+    if (in != end) {
+        return 0;
+    }
+
+    // Only a complete, valid record moves the state on
+    memcpy(last, values, count * sizeof(values[0]));
+    memcpy(sample.values, values, count * sizeof(values[0]));
+    lastTimeUs += dt;
+    sample.timeUs = lastTimeUs;
+    sample.type = type;
+    sample.count = count;
+    return bodyLength + 1;
+}
+
+} // namespace InputRecord
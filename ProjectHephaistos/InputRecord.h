@@ -0,0 +1,97 @@
+#ifndef INPUT_RECORD_H
+#define INPUT_RECORD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Raw control input as a backend read it, and the compact record format
+// the recorder stores it in (InputRecorder.h).
+//
+// A sample is one reading: gamepad axes and buttons, the keys held, a
+// block of received serial bytes, RC pulse widths, an RC bus frame or a
+// UDP datagram.
+// A session ends with a TYPE_END sample, unless the power was cut.
+// Records are framed like ControlFrame, without the sync byte:
+//   length  u8      bytes that follow
+//   type    u8      Type
+//   dt      varint  microseconds since the previous record
+//   count   u8      number of values
+//   values  zigzag varints; for the continuous types (sticks, keys,
+//           pulse widths) the change from the previous sample of the
+//           same type, so a stick that barely moved costs a byte per axis
+//   crc     u8      CRC-8 (ControlFrame::crc8) of type..values
+// A reset() makes the next record self-contained (dt from 0, values
+// from 0), which the recorder does at the start of every segment.
+namespace InputRecord {
+
+enum Type : uint8_t {
+    TYPE_LINK = 1,   // connected (1) or not (0)
+    TYPE_GAMEPAD,    // x, y, rx, ry, dpad, buttons (GAMEPAD_BUTTON_*)
+    TYPE_KEYS,       // held keys as bits
+    TYPE_SERIAL,     // received bytes
+    TYPE_RC_PULSES,  // pulse width per channel, us
+    TYPE_RC_FRAME,   // failsafe, then the channel widths, us
+    TYPE_END,        // recording stopped, no values
+    TYPE_DATAGRAM,   // one received datagram's bytes
+    typeCount
+};
+
+const uint8_t maxValues = 32;
+
+// length, type, dt, count, values, crc
+const size_t maxRecordSize = 1 + 1 + 5 + 1 + maxValues * 3 + 1;
+
+// Gamepad sample layout
+enum GamepadValue : uint8_t {
+    GAMEPAD_X = 0,
+    GAMEPAD_Y,
+    GAMEPAD_RX,
+    GAMEPAD_RY,
+    GAMEPAD_DPAD,
+    GAMEPAD_BUTTONS,
+    gamepadValues
+};
+const int16_t GAMEPAD_BUTTON_A      = 0x01;
+const int16_t GAMEPAD_BUTTON_SELECT = 0x02;
+
+struct Sample {
+    uint32_t timeUs;   // since the session started
+    uint8_t type;
+    uint8_t count;
+    int16_t values[maxValues];
+};
+
+class Encoder {
+public:
+    Encoder();
+
+    // Next record starts from zero time and values
+    void reset();
+
+    // Writes sample's record to out; returns its size, 0 if it doesn't fit
+    // or the sample is invalid
+    size_t encode(const Sample& sample, uint8_t* out, size_t outSize);
+
+private:
+    uint32_t lastTimeUs;
+    int16_t previous[typeCount][maxValues];
+};
+
+class Decoder {
+public:
+    Decoder();
+
+    void reset();
+
+    // Decodes the record at data; returns its size, 0 if it is incomplete
+    // (fewer than length bytes) or corrupt
+    size_t decode(const uint8_t* data, size_t length, Sample& sample);
+
+private:
+    uint32_t lastTimeUs;
+    int16_t previous[typeCount][maxValues];
+};
+
+} // namespace InputRecord
+
+#endif // INPUT_RECORD_H
@@ -0,0 +1,408 @@
+#include "InputRecorder.h"
+#include "MpscRing.h"
+#include <string.h>
+#include <sys/stat.h>
+#include <atomic>
+
+#if defined(ESP32)
+#include <LittleFS.h>
+#include <unistd.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+namespace InputRecorder {
+
+// At the start of every segment file
+struct SegmentHeader {
+    uint8_t magic[2];    // 'H', 'R'
+    uint8_t version;
+    uint8_t reserved;
+    uint16_t session;
+    uint16_t sequence;   // segment number within the session
+} __attribute__((packed));
+
+static const uint8_t formatVersion = 1;
+
+static MpscRing<InputRecord::Sample, queueLength> queue;
+static std::atomic<uint32_t> droppedCount(0);
+static std::atomic<bool> recording(false);
+static Clock timeSource = nullptr;
+static unsigned long startUs = 0;
+
+// Flush side only
+static char root[48];
+static uint32_t segmentSize = 0;
+static uint8_t segmentTotal = 0;
+static uint8_t segmentIndex = 0;
+static uint16_t segmentSequence = 0;
+static uint16_t sessionId = 0;
+static FILE* segmentFile = nullptr;
+static bool segmentStarted = false;
+static uint32_t segmentUsed = 0;
+static uint32_t writtenBytes = 0;
+static InputRecord::Encoder encoder;
+
+static void segmentPath(const char* directory, uint8_t index, char* path, size_t size) {
+    snprintf(path, size, "%s/seg%02u.rec", directory, (unsigned)index);
+}
+
+static bool readHeader(const char* directory, uint8_t index, SegmentHeader& header) {
+    char path[64];
+    segmentPath(directory, index, path, sizeof(path));
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 && header.magic[0] == 'H' &&
+                 header.magic[1] == 'R' && header.version == formatVersion;
+    fclose(file);
+    return valid;
+}
+
+// Later in recording order: a later session (session numbers wrap), or
+// a later segment of the same one
+static bool isNewer(const SegmentHeader& a, const SegmentHeader& b) {
+    if (a.session != b.session) {
+        return (int16_t)(a.session - b.session) > 0;
+    }
+    return a.sequence > b.sequence;
+}
+
+static bool mount(const char* directory) {
+#if defined(ESP32)
+    // Formats the partition if it holds no file system yet
+    return LittleFS.begin(true, directory, 4, partitionLabel);
+#else
+    mkdir(directory, 0755);
+    struct stat info;
+    return stat(directory, &info) == 0 && S_ISDIR(info.st_mode);
+#endif
+}
+
+bool begin(const char* directory, uint32_t segmentBytes, uint8_t segmentCount, Clock clock) {
+    if (recording || !directory || strlen(directory) >= sizeof(root) || !clock || segmentCount == 0 ||
+        segmentCount > maxSegments || segmentBytes < sizeof(SegmentHeader) + InputRecord::maxRecordSize) {
+        return false;
+    }
+    if (!mount(directory)) {
+        return false;
+    }
+    strcpy(root, directory);
+
+    // Carry on after the newest segment, with the next session number
+    SegmentHeader newest = {};
+    uint8_t newestIndex = 0;
+    bool found = false;
+    for (uint8_t i = 0; i < segmentCount; i++) {
+        SegmentHeader header;
+        if (readHeader(root, i, header) && (!found || isNewer(header, newest))) {
+            newest = header;
+            newestIndex = i;
+            found = true;
+        }
+    }
+    sessionId = found ? (uint16_t)(newest.session + 1) : 1;
+    if (sessionId == 0) {
+        sessionId = 1;
+    }
+    segmentIndex = found ? (uint8_t)((newestIndex + 1) % segmentCount) : 0;
+    segmentSequence = 0;
+    segmentStarted = false;
+    segmentSize = segmentBytes;
+    segmentTotal = segmentCount;
+    writtenBytes = 0;
+    droppedCount = 0;
+
+    timeSource = clock;
+    startUs = clock();
+    recording = true;
+    return true;
+}
+
+// Opens the next segment of the ring, overwriting what it held
+static bool nextSegment() {
+    if (segmentFile) {
+        fclose(segmentFile);
+        segmentFile = nullptr;
+    }
+    if (segmentStarted) {
+        segmentIndex = (uint8_t)((segmentIndex + 1) % segmentTotal);
+        segmentSequence++;
+    }
+    segmentStarted = true;
+
+    char path[64];
+    segmentPath(root, segmentIndex, path, sizeof(path));
+    segmentFile = fopen(path, "wb");
+    if (!segmentFile) {
+        return false;
+    }
+    SegmentHeader header = {{'H', 'R'}, formatVersion, 0, sessionId, segmentSequence};
+    if (fwrite(&header, sizeof(header), 1, segmentFile) != 1) {
+        fclose(segmentFile);
+        segmentFile = nullptr;
+        return false;
+    }
+    segmentUsed = sizeof(header);
+    encoder.reset();
+    return true;
+}
+
+static void writeQueued() {
+    InputRecord::Sample sample;
+    uint8_t record[InputRecord::maxRecordSize];
+    bool wrote = false;
+    while (queue.pop(sample)) {
+        size_t length = encoder.encode(sample, record, sizeof(record));
+        if (length == 0) {
+            droppedCount++;
+            continue;
+        }
+        if (!segmentFile || segmentUsed + length > segmentSize) {
+            // A new segment starts from scratch, so encode again
+            if (!nextSegment()) {
+                droppedCount++;
+                continue;
+            }
+            length = encoder.encode(sample, record, sizeof(record));
+        }
+        if (fwrite(record, 1, length, segmentFile) != length) {
+            droppedCount++;
+            continue;
+        }
+        segmentUsed += length;
+        writtenBytes += length;
+        wrote = true;
+    }
+    if (wrote) {
+        fflush(segmentFile);
+#if defined(ESP32)
+        // Commit to flash, so a power cut loses at most this batch
+        fsync(fileno(segmentFile));
+#endif
+    }
+}
+
+void flush() {
+    if (recording) {
+        writeQueued();
+    }
+}
+
+void end() {
+    if (!recording) {
+        return;
+    }
+    // Marks when the session stopped, for replay
+    record(InputRecord::TYPE_END, nullptr, 0);
+    recording = false;
+    writeQueued();
+    if (segmentFile) {
+        fclose(segmentFile);
+        segmentFile = nullptr;
+    }
+}
+
+void record(InputRecord::Type type, const int16_t* values, uint8_t count) {
+    if (!recording.load(std::memory_order_relaxed)) {
+        return;
+    }
+    InputRecord::Sample sample;
+    sample.timeUs = (uint32_t)(timeSource() - startUs);
+    sample.type = type;
+    sample.count = count < InputRecord::maxValues ? count : InputRecord::maxValues;
+    if (sample.count > 0) {
+        memcpy(sample.values, values, sample.count * sizeof(sample.values[0]));
+    }
+    if (!queue.push(sample)) {
+        droppedCount++;
+    }
+}
+
+void recordBytes(const uint8_t* data, size_t length) {
+    int16_t values[InputRecord::maxValues];
+    while (length > 0) {
+        uint8_t count = length < InputRecord::maxValues ? (uint8_t)length : InputRecord::maxValues;
+        for (uint8_t i = 0; i < count; i++) {
+            values[i] = data[i];
+        }
+        record(InputRecord::TYPE_SERIAL, values, count);
+        data += count;
+        length -= count;
+    }
+}
+
+bool active() {
+    return recording;
+}
+
+uint16_t session() {
+    return sessionId;
+}
+
+uint32_t dropped() {
+    return droppedCount;
+}
+
+uint32_t bytesWritten() {
+    return writtenBytes;
+}
+
+#if defined(ESP32)
+
+static void flushTask(void* parameter) {
+    TickType_t interval = pdMS_TO_TICKS((uint32_t)(uintptr_t)parameter);
+    if (interval == 0) {
+        interval = 1;
+    }
+    for (;;) {
+        flush();
+        vTaskDelay(interval);
+    }
+}
+
+bool startFlushTask(uint8_t priority, uint8_t core, uint32_t stackSize, uint32_t intervalMs) {
+    return xTaskCreatePinnedToCore(flushTask, "record", stackSize, (void*)(uintptr_t)intervalMs,
+                                   priority, nullptr, core) == pdPASS;
+}
+
+#else
+
+bool startFlushTask(uint8_t, uint8_t, uint32_t, uint32_t) {
+    return false;
+}
+
+#endif
+
+// ----------------------
+// SessionReader
+// ----------------------
+SessionReader::SessionReader()
+    : sessionId(0),
+      segmentCount(0),
+      segmentPosition(0),
+      file(nullptr),
+      bufferStart(0),
+      bufferEnd(0)
+{
+    directory[0] = '\0';
+}
+
+SessionReader::~SessionReader() {
+    close();
+}
+
+bool SessionReader::open(const char* path, uint16_t session) {
+    close();
+    if (!path || strlen(path) >= sizeof(directory)) {
+        return false;
+    }
+#if defined(ESP32)
+    if (!mount(path)) {
+        return false;
+    }
+#endif
+    strcpy(directory, path);
+
+    // Segment headers of every file there; the latest session if none
+    // was asked for
+    SegmentHeader headers[maxSegments];
+    bool present[maxSegments];
+    bool found = false;
+    SegmentHeader newest = {};
+    for (uint8_t i = 0; i < maxSegments; i++) {
+        present[i] = readHeader(directory, i, headers[i]);
+        if (present[i] && (!found || isNewer(headers[i], newest))) {
+            newest = headers[i];
+            found = true;
+        }
+    }
+    if (!found) {
+        return false;
+    }
+    sessionId = session ? session : newest.session;
+
+    // The session's segments, by sequence
+    segmentCount = 0;
+    for (uint8_t i = 0; i < maxSegments; i++) {
+        if (!present[i] || headers[i].session != sessionId) {
+            continue;
+        }
+        uint8_t position = segmentCount++;
+        while (position > 0 && headers[segments[position - 1]].sequence > headers[i].sequence) {
+            segments[position] = segments[position - 1];
+            position--;
+        }
+        segments[position] = i;
+    }
+    segmentPosition = 0;
+    return segmentCount > 0 && openSegment();
+}
+
+void SessionReader::close() {
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+    segmentCount = 0;
+    segmentPosition = 0;
+}
+
+// Opens the segment at segmentPosition, skipping ones that can't be read
+bool SessionReader::openSegment() {
+    while (segmentPosition < segmentCount) {
+        if (file) {
+            fclose(file);
+        }
+        char path[64];
+        segmentPath(directory, segments[segmentPosition], path, sizeof(path));
+        file = fopen(path, "rb");
+        if (file && fseek(file, sizeof(SegmentHeader), SEEK_SET) == 0) {
+            bufferStart = 0;
+            bufferEnd = 0;
+            decoder.reset();
+            return true;
+        }
+        segmentPosition++;
+    }
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+    return false;
+}
+
+bool SessionReader::next(InputRecord::Sample& sample) {
+    while (file) {
+        size_t available = bufferEnd - bufferStart;
+        if (available > 0) {
+            size_t length = decoder.decode(buffer + bufferStart, available, sample);
+            if (length > 0) {
+                bufferStart += length;
+                return true;
+            }
+            if (available > buffer[bufferStart]) {
+                // Complete but corrupt: the rest of this segment can't be
+                // trusted (a write cut short, or overwritten)
+                segmentPosition++;
+                openSegment();
+                continue;
+            }
+        }
+
+        // Need more: keep the partial record and read on
+        memmove(buffer, buffer + bufferStart, available);
+        bufferStart = 0;
+        bufferEnd = available;
+        size_t count = fread(buffer + bufferEnd, 1, sizeof(buffer) - bufferEnd, file);
+        bufferEnd += count;
+        if (count == 0) {
+            segmentPosition++;
+            openSegment();
+        }
+    }
+    return false;
+}
+
+} // namespace InputRecorder
@@ -0,0 +1,87 @@
+#ifndef INPUT_RECORDER_H
+#define INPUT_RECORDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "InputRecord.h"
+
+// Records the raw input of the control backend to flash, so a driving
+// session can be replayed later (ReplayControl.h), on the tank or in the
+// host build.
+//
+// Backends hand over what they read with record(), which only queues the
+// sample (lock-free, any task). flush() encodes the queue (InputRecord.h)
+// and appends it to a ring of segment files; a low-priority task calls it
+// on the ESP32. When the current segment is full the oldest one is
+// overwritten, so storage always holds the latest sessions. Every begin()
+// starts a new session. On the ESP32 the segments live on LittleFS in the
+// "records" partition (partitions.csv), on the host in any directory.
+namespace InputRecorder {
+
+const char* const partitionLabel = "records";
+const uint8_t queueLength = 64;    // samples
+const uint8_t maxSegments = 64;
+
+typedef unsigned long (*Clock)();
+
+// Mounts the storage (ESP32) and starts a new session in directory,
+// using up to segmentCount files of segmentBytes each. Sample times are
+// taken from clock (microseconds).
+bool begin(const char* directory, uint32_t segmentBytes, uint8_t segmentCount, Clock clock);
+
+// Writes what is queued and closes the current segment
+void end();
+
+// On the ESP32, a task that flushes every intervalMs; false elsewhere
+bool startFlushTask(uint8_t priority, uint8_t core, uint32_t stackSize, uint32_t intervalMs);
+
+// Queues a sample; values beyond InputRecord::maxValues are cut off.
+// Does nothing before begin().
+void record(InputRecord::Type type, const int16_t* values, uint8_t count);
+
+// Received serial bytes, as many TYPE_SERIAL samples as it takes
+void recordBytes(const uint8_t* data, size_t length);
+
+// Encodes and writes the queued samples. One caller at a time.
+void flush();
+
+bool active();
+uint16_t session();
+uint32_t dropped();       // samples lost to a full queue or a write error
+uint32_t bytesWritten();
+
+// Reads one session back, oldest sample first. Segments that were
+// overwritten since are simply missing.
+class SessionReader {
+public:
+    SessionReader();
+    ~SessionReader();
+
+    // Opens session in directory; 0 = the latest one
+    bool open(const char* directory, uint16_t session = 0);
+    void close();
+
+    // Next sample; false at the end of the session
+    bool next(InputRecord::Sample& sample);
+
+    uint16_t session() const { return sessionId; }
+
+private:
+    bool openSegment();
+
+    char directory[48];
+    uint16_t sessionId;
+    uint8_t segments[maxSegments];   // file indices, in recording order
+    uint8_t segmentCount;
+    uint8_t segmentPosition;
+    FILE* file;
+    uint8_t buffer[256];
+    size_t bufferStart;
+    size_t bufferEnd;
+    InputRecord::Decoder decoder;
+};
+
+} // namespace InputRecorder
+
+#endif // INPUT_RECORDER_H
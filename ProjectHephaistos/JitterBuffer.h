@@ -0,0 +1,125 @@
+#ifndef JITTER_BUFFER_H
+#define JITTER_BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Evens out bursty arrival of sequenced, timestamped full-state updates
+// (e.g. UDP datagrams over Wi-Fi), no heap.
+//
+// push() drops anything not newer than the newest update seen, so late
+// and duplicated ones never reach the outputs. Accepted updates are held
+// until the time they were sent plus the fastest transit seen so far plus
+// delayUs; an update that was delayed more than the others then still
+// comes out at the sender's pace, as long as it was no more than delayUs
+// later than the fastest. pop() returns the newest update that is due,
+// skipping older due ones, since each carries the whole state. With
+// delayUs = 0 every update is due as it arrives.
+//
+// The fastest transit follows clock drift between sender and receiver by
+// allowing it to grow 1 us per ms. All times are wrapping 32-bit
+// microsecond counters; only differences are used.
+template <typename T, size_t Capacity>
+class JitterBuffer {
+public:
+    enum PushResult {
+        PUSH_ACCEPTED,
+        PUSH_STALE,      // not newer than the newest update seen
+        PUSH_OVERFLOWED  // accepted, but the oldest waiting one was dropped
+    };
+
+    explicit JitterBuffer(uint32_t delayUs = 0) : delayUs(delayUs) {
+        reset();
+    }
+
+    // Forgets the sequence and the transit estimate, e.g. after the link
+    // was lost and the sender may have restarted
+    void reset() {
+        count = 0;
+        started = false;
+        newest = 0;
+        fastestTransit = 0;
+        fastestAtUs = 0;
+    }
+
+    void setDelay(uint32_t us) { delayUs = us; }
+    uint32_t delay() const { return delayUs; }
+
+    PushResult push(uint32_t sequence, uint32_t sendUs, uint32_t arrivalUs, const T& value) {
+        if (started && (int32_t)(sequence - newest) <= 0) {
+            return PUSH_STALE;
+        }
+        newest = sequence;
+
+        // Fastest transit, let grow with the time since it was seen
+        int32_t transit = (int32_t)(arrivalUs - sendUs);
+        int32_t allowed = fastestTransit + (int32_t)((arrivalUs - fastestAtUs) / 1000);
+        if (!started || transit <= allowed) {
+            fastestTransit = transit;
+            fastestAtUs = arrivalUs;
+            allowed = transit;
+        }
+        started = true;
+
+        PushResult result = PUSH_ACCEPTED;
+        if (count == Capacity) {
+            drop(1);
+            result = PUSH_OVERFLOWED;
+        }
+        Entry& entry = entries[count++];
+        entry.value = value;
+        entry.sequence = sequence;
+        entry.arrivalUs = arrivalUs;
+        entry.dueUs = sendUs + (uint32_t)allowed + delayUs;
+        return result;
+    }
+
+    // Newest update due at nowUs; false if none is
+    bool pop(uint32_t nowUs, T& value, uint32_t& sequence, uint32_t& arrivalUs) {
+        // A faster transit seen later can make a newer entry due first
+        size_t due = 0;
+        for (size_t i = 0; i < count; i++) {
+            if ((int32_t)(nowUs - entries[i].dueUs) >= 0) {
+                due = i + 1;
+            }
+        }
+        if (due == 0) {
+            return false;
+        }
+        const Entry& entry = entries[due - 1];
+        value = entry.value;
+        sequence = entry.sequence;
+        arrivalUs = entry.arrivalUs;
+        drop(due);
+        return true;
+    }
+
+    size_t size() const { return count; }
+    uint32_t newestSequence() const { return newest; }
+
+private:
+    struct Entry {
+        T value;
+        uint32_t sequence;
+        uint32_t arrivalUs;
+        uint32_t dueUs;
+    };
+
+    // Removes the n oldest entries
+    void drop(size_t n) {
+        for (size_t i = n; i < count; i++) {
+            entries[i - n] = entries[i];
+        }
+        count -= n;
+    }
+
+    Entry entries[Capacity];
+    size_t count;
+    uint32_t delayUs;
+    bool started;
+    uint32_t newest;
+    int32_t fastestTransit;
+    uint32_t fastestAtUs;
+};
+
+#endif // JITTER_BUFFER_H
@@ -1,4 +1,13 @@
+#include "ControlConfig.h"
+#ifdef CONTROL_MODE_KEYBOARD
+
 #include "KeyboardControl.h"
+#include "TankMixer.h"
+#include "Log.h"
+#include "Profiler.h"
+#ifdef INPUT_RECORDING
+#include "InputRecorder.h"
+#endif
 
 // Static members
 KeyboardControl* KeyboardControl::instance = nullptr;
@@ -6,11 +15,6 @@ ControllerPtr KeyboardControl::keyboardController = nullptr;
 
 KeyboardControl::KeyboardControl()
     : currentGear(1),
-      leftTrackSpeed(0),
-      rightTrackSpeed(0),
-      turretRotation(0),
-      turretElevation(0),
-      flamethrowerActive(false),
       forwardPressed(false),
       backPressed(false),
       leftPressed(false),
@@ -20,7 +24,10 @@ KeyboardControl::KeyboardControl()
       turretElevatePressed(false),
       turretLowerPressed(false),
       firePressed(false),
-      lastUpdateTime(0)
+      gearUpHeld(false),
+      gearDownHeld(false),
+      replayKeys(0),
+      replayConnected(false)
 {
     instance = this;
 
@@ -28,7 +35,7 @@ KeyboardControl::KeyboardControl()
     BP32.setup(&KeyboardControl::onConnectedController, &KeyboardControl::onDisconnectedController);
     BP32.enableNewBluetoothConnections(true);
 
-    Serial.println("KeyboardControl Initialized. Waiting for a BT Keyboard...");
+    LOG_INFO("KeyboardControl Initialized. Waiting for a BT Keyboard...");
 }
 
 KeyboardControl::~KeyboardControl() {
@@ -38,134 +45,173 @@ KeyboardControl::~KeyboardControl() {
 
 void KeyboardControl::update() {
     // Poll Bluepad32
-    BP32.update();
+    bool received;
+    {
+        PROFILE_SECTION(SECTION_BLUEPAD32);
+        received = BP32.update();
+    }
+    if (received) {
+        // New report: when the input arrived, for latency tracing
+        markInput();
+    }
 
     // If a keyboard is connected, process it
     if (keyboardController && keyboardController->isConnected()) {
-        processKeyboard(keyboardController);
+        // Keyboards only report changes, so held keys look the same as a
+        // stalled link: a connected keyboard is live input until the
+        // Bluetooth stack drops it (see KeyboardControl.h)
+        markFresh();
+        uint16_t keys = readKeys(keyboardController);
+#ifdef INPUT_RECORDING
+        if (received) {
+            const int16_t value = (int16_t)keys;
+            InputRecorder::record(InputRecord::TYPE_KEYS, &value, 1);
+        }
+#endif
+        processKeyboard(keys);
+    } else {
+        // Keep the last values, only report the link as down
+        ControlState next = getState();
+        next.connected = false;
+        publishState(next, millis());
     }
 }
 
-bool KeyboardControl::isConnected() const {
-    return (keyboardController && keyboardController->isConnected());
-}
-
-int KeyboardControl::getLeftTrackSpeed() const {
-    return leftTrackSpeed;
-}
-
-int KeyboardControl::getRightTrackSpeed() const {
-    return rightTrackSpeed;
-}
-
-int KeyboardControl::getTurretRotation() const {
-    return turretRotation;
-}
-
-int KeyboardControl::getTurretElevation() const {
-    return turretElevation;
-}
-
-bool KeyboardControl::isFlamethrowerActive() const {
-    return flamethrowerActive;
+void KeyboardControl::replaySample(const InputRecord::Sample& sample) {
+    if (sample.type == InputRecord::TYPE_LINK && sample.count >= 1) {
+        replayConnected = sample.values[0] != 0;
+    } else if (sample.type == InputRecord::TYPE_KEYS && sample.count >= 1) {
+        replayKeys = (uint16_t)sample.values[0];
+    }
 }
 
-int KeyboardControl::getCurrentGear() const {
-    return currentGear;
+void KeyboardControl::replayPoll() {
+    // Same as update(), with the recorded keys
+    if (replayConnected) {
+        markFresh();
+        processKeyboard(replayKeys);
+    } else {
+        ControlState next = getState();
+        next.connected = false;
+        publishState(next, millis());
+    }
 }
 
 // Static callbacks
 void KeyboardControl::onConnectedController(ControllerPtr ctl) {
     if (ctl->isKeyboard()) {
-        Serial.println("Bluetooth Keyboard connected.");
+        LOG_INFO("Bluetooth Keyboard connected.");
         keyboardController = ctl;
+#ifdef INPUT_RECORDING
+        const int16_t link = 1;
+        InputRecorder::record(InputRecord::TYPE_LINK, &link, 1);
+#endif
     }
 }
 
 void KeyboardControl::onDisconnectedController(ControllerPtr ctl) {
     if (ctl == keyboardController) {
-        Serial.println("Bluetooth Keyboard disconnected.");
+        LOG_WARN("Bluetooth Keyboard disconnected.");
         keyboardController = nullptr;
+#ifdef INPUT_RECORDING
+        const int16_t link = 0;
+        InputRecorder::record(InputRecord::TYPE_LINK, &link, 1);
+#endif
     }
 }
 
-void KeyboardControl::processKeyboard(ControllerPtr ctl) {
-    // Limit update rate
-    unsigned long currentTime = millis();
-    if (currentTime - lastUpdateTime < updateInterval) {
-        return;
+uint16_t KeyboardControl::readKeys(ControllerPtr ctl) {
+    uint16_t keys = 0;
+    keys |= ctl->isKeyPressed(KeyboardKey::Keyboard_W) ? KEY_FORWARD : 0;
+    keys |= ctl->isKeyPressed(KeyboardKey::Keyboard_S) ? KEY_BACK : 0;
+    keys |= ctl->isKeyPressed(KeyboardKey::Keyboard_A) ? KEY_LEFT : 0;
+    keys |= ctl->isKeyPressed(KeyboardKey::Keyboard_D) ? KEY_RIGHT : 0;
+    keys |= ctl->isKeyPressed(KeyboardKey::Keyboard_Q) ? KEY_TURRET_LEFT : 0;
+    keys |= ctl->isKeyPressed(KeyboardKey::Keyboard_E) ? KEY_TURRET_RIGHT : 0;
+    keys |= ctl->isKeyPressed(KeyboardKey::Keyboard_UpArrow) ? KEY_TURRET_ELEVATE : 0;
+    keys |= ctl->isKeyPressed(KeyboardKey::Keyboard_DownArrow) ? KEY_TURRET_LOWER : 0;
+    keys |= ctl->isKeyPressed(KeyboardKey::Keyboard_Spacebar) ? KEY_FIRE : 0;
+    if (ctl->isKeyPressed(KeyboardKey::Keyboard_LeftShift) ||
+        ctl->isKeyPressed(KeyboardKey::Keyboard_RightShift)) {
+        keys |= KEY_GEAR_UP;
+    }
+    if (ctl->isKeyPressed(KeyboardKey::Keyboard_LeftControl) ||
+        ctl->isKeyPressed(KeyboardKey::Keyboard_RightControl)) {
+        keys |= KEY_GEAR_DOWN;
     }
-    lastUpdateTime = currentTime;
+    return keys;
+}
 
+void KeyboardControl::processKeyboard(uint16_t keys) {
     // Reset all pressed states
-    forwardPressed       = ctl->isKeyPressed(KeyboardKey::Keyboard_W);
-    backPressed          = ctl->isKeyPressed(KeyboardKey::Keyboard_S);
-    leftPressed          = ctl->isKeyPressed(KeyboardKey::Keyboard_A);
-    rightPressed         = ctl->isKeyPressed(KeyboardKey::Keyboard_D);
-    turretLeftPressed    = ctl->isKeyPressed(KeyboardKey::Keyboard_Q);
-    turretRightPressed   = ctl->isKeyPressed(KeyboardKey::Keyboard_E);
-    turretElevatePressed = ctl->isKeyPressed(KeyboardKey::Keyboard_UpArrow);
-    turretLowerPressed   = ctl->isKeyPressed(KeyboardKey::Keyboard_DownArrow);
-    firePressed          = ctl->isKeyPressed(KeyboardKey::Keyboard_Spacebar);
+    forwardPressed       = keys & KEY_FORWARD;
+    backPressed          = keys & KEY_BACK;
+    leftPressed          = keys & KEY_LEFT;
+    rightPressed         = keys & KEY_RIGHT;
+    turretLeftPressed    = keys & KEY_TURRET_LEFT;
+    turretRightPressed   = keys & KEY_TURRET_RIGHT;
+    turretElevatePressed = keys & KEY_TURRET_ELEVATE;
+    turretLowerPressed   = keys & KEY_TURRET_LOWER;
+    firePressed          = keys & KEY_FIRE;
 
     // Gear up if Shift pressed, gear down if Ctrl pressed
-    bool shiftPressed = ctl->isKeyPressed(KeyboardKey::Keyboard_LeftShift) ||
-                        ctl->isKeyPressed(KeyboardKey::Keyboard_RightShift);
-    bool ctrlPressed  = ctl->isKeyPressed(KeyboardKey::Keyboard_LeftControl) ||
-                        ctl->isKeyPressed(KeyboardKey::Keyboard_RightControl);
+    bool shiftPressed = keys & KEY_GEAR_UP;
+    bool ctrlPressed  = keys & KEY_GEAR_DOWN;
 
-    if (shiftPressed && currentGear < 5) {
+    // Shift only when the key goes down, not on every poll while held
+    if (shiftPressed && !gearUpHeld && currentGear < 5) {
         currentGear++;
-        Serial.printf("Gear shifted up to %d\n", currentGear);
+        LOG_INFO("Gear shifted up to %d", currentGear);
     }
-    if (ctrlPressed && currentGear > 1) {
+    if (ctrlPressed && !gearDownHeld && currentGear > 1) {
         currentGear--;
-        Serial.printf("Gear shifted down to %d\n", currentGear);
+        LOG_INFO("Gear shifted down to %d", currentGear);
     }
+    gearUpHeld   = shiftPressed;
+    gearDownHeld = ctrlPressed;
 
     // Now update control variables
     updateControlVariables();
 }
 
 void KeyboardControl::updateControlVariables() {
-    // Movement
-    int forwardBackward = 0;
-    int turn = 0;
+    MixerInput input = {};
 
+    // Movement
     if (forwardPressed) {
-        forwardBackward += 100;
+        input.drive += 100;
     }
     if (backPressed) {
-        forwardBackward -= 100;
+        input.drive -= 100;
     }
     if (leftPressed) {
-        turn -= 100;
+        input.turn -= 100;
     }
     if (rightPressed) {
-        turn += 100;
+        input.turn += 100;
     }
 
-    float gearScaling = (float)currentGear / 5.0f;
-
-    leftTrackSpeed  = constrain((forwardBackward + turn) * gearScaling, -100, 100);
-    rightTrackSpeed = constrain((forwardBackward - turn) * gearScaling, -100, 100);
-
     // Turret
     if (turretLeftPressed) {
-        turretRotation = -100;
+        input.turretRotation = -100;
     } else if (turretRightPressed) {
-        turretRotation = 100;
-    } else {
-        turretRotation = 0;
+        input.turretRotation = 100;
     }
 
     if (turretElevatePressed) {
-        turretElevation = 100;
+        input.turretElevation = 100;
     } else if (turretLowerPressed) {
-        turretElevation = -100;
-    } else {
-        turretElevation = 0;
+        input.turretElevation = -100;
     }
 
-    flamethrowerActive = firePressed;
+    // Flamethrower
+    input.fire = firePressed;
+    input.gear = currentGear;
+
+    ControlState next = getState();
+    next.connected = true;
+    TankMixer::mix(input, next);
+    publishState(next, millis());
 }
+
+#endif // CONTROL_MODE_KEYBOARD
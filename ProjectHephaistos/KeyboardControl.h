@@ -2,45 +2,55 @@
 #define KEYBOARD_CONTROL_H
 
 #include "TankControlInterface.h"
+#include "InputRecord.h"
 #include <Arduino.h>
 #include <Bluepad32.h> // to detect keyboard events
 
-class KeyboardControl : public TankControlInterface {
+// Bluetooth keyboard control through Bluepad32. A keyboard reports only
+// when a key changes, so it counts as live for the failsafe for as long as
+// it is connected: a link that stalls with a key held is only stopped once
+// the Bluetooth stack gives up on it (its supervision timeout, seconds),
+// not within FAILSAFE_DEADLINE_MS.
+class KeyboardControl final : public TankControlInterface {
 public:
     KeyboardControl();
     ~KeyboardControl();
 
     void update() override;
 
-    bool isConnected() const override;
-
-    int getLeftTrackSpeed() const override;
-    int getRightTrackSpeed() const override;
-
-    int getTurretRotation() const override;
-    int getTurretElevation() const override;
-
-    bool isFlamethrowerActive() const override;
-
-    int getCurrentGear() const override;
+    // Input from a recorded session (ReplayControl.h) instead of BP32:
+    // replaySample() takes one sample, replayPoll() stands in for update()
+    void replaySample(const InputRecord::Sample& sample);
+    void replayPoll();
 
 private:
+    // Keys the tank uses, as bits of one keyboard report
+    enum KeyBit : uint16_t {
+        KEY_FORWARD        = 1 << 0,   // W
+        KEY_BACK           = 1 << 1,   // S
+        KEY_LEFT           = 1 << 2,   // A
+        KEY_RIGHT          = 1 << 3,   // D
+        KEY_TURRET_LEFT    = 1 << 4,   // Q
+        KEY_TURRET_RIGHT   = 1 << 5,   // E
+        KEY_TURRET_ELEVATE = 1 << 6,   // Up arrow
+        KEY_TURRET_LOWER   = 1 << 7,   // Down arrow
+        KEY_FIRE           = 1 << 8,   // Space
+        KEY_GEAR_UP        = 1 << 9,   // either Shift
+        KEY_GEAR_DOWN      = 1 << 10   // either Ctrl
+    };
+
     static void onConnectedController(ControllerPtr ctl);
     static void onDisconnectedController(ControllerPtr ctl);
 
-    void processKeyboard(ControllerPtr ctl);
+    static uint16_t readKeys(ControllerPtr ctl);
+    void processKeyboard(uint16_t keys);
     void updateControlVariables();
 
     static ControllerPtr keyboardController;
     static KeyboardControl* instance;
 
-    // Control variables
+    // Selected gear (1..5)
     int currentGear;
-    int leftTrackSpeed;
-    int rightTrackSpeed;
-    int turretRotation;
-    int turretElevation;
-    bool flamethrowerActive;
 
     // State variables
     bool forwardPressed;
@@ -53,8 +63,13 @@ private:
     bool turretLowerPressed;
     bool firePressed;
 
-    unsigned long lastUpdateTime;
-    const unsigned long updateInterval = 50; // ms
+    // Shift/Ctrl state of the previous poll, so a held key shifts only once
+    bool gearUpHeld;
+    bool gearDownHeld;
+
+    // Latest replayed keys and link state
+    uint16_t replayKeys;
+    bool replayConnected;
 };
 
 #endif // KEYBOARD_CONTROL_H
@@ -0,0 +1,114 @@
+#include "LatencyTrace.h"
+#include "ControlFrame.h"
+#include "MpscRing.h"
+
+#if defined(ESP32)
+#include <Arduino.h>
+#include <esp_cpu.h>
+#include <esp_timer.h>
+#endif
+
+namespace LatencyTrace {
+
+static_assert(sizeof(Event) == 7, "LatencyTrace::Event layout changed, update the frame format");
+static_assert(maxPayload <= ControlFrame::maxPayload, "Trace frame does not fit a ControlFrame");
+
+static MpscRing<Event, capacity> ring;
+static std::atomic<uint32_t> droppedCount(0);
+static Source traceSource = SOURCE_UNKNOWN;
+
+#if defined(ESP32)
+
+static uint32_t cyclesPerUs = 1;
+// Per core: cycle count at esp_timer zero, so that the counters of both
+// cores read the same time
+static uint32_t coreBase[portNUM_PROCESSORS];
+
+void begin(Source source, Clock) {
+    traceSource = source;
+    cyclesPerUs = getCpuFrequencyMhz();
+    syncCore();
+}
+
+void syncCore() {
+    uint32_t cycles = esp_cpu_get_cycle_count();
+    uint64_t us = (uint64_t)esp_timer_get_time();
+    coreBase[xPortGetCoreID()] = cycles - (uint32_t)(us * cyclesPerUs);
+}
+
+uint32_t now() {
+    return esp_cpu_get_cycle_count() - coreBase[xPortGetCoreID()];
+}
+
+uint32_t ticksPerUs() {
+    return cyclesPerUs;
+}
+
+#else
+
+static Clock timeSource = nullptr;
+
+void begin(Source source, Clock clock) {
+    traceSource = source;
+    timeSource = clock;
+}
+
+void syncCore() {}
+
+uint32_t now() {
+    return timeSource ? (uint32_t)timeSource() : 0;
+}
+
+uint32_t ticksPerUs() {
+    return 1;
+}
+
+#endif
+
+void record(Point point, uint32_t sequence, uint32_t ticks) {
+    Event event;
+    event.ticks = ticks;
+    event.sequence = (uint16_t)sequence;
+    event.point = point;
+    if (!ring.push(event)) {
+        droppedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+uint32_t dropped() {
+    return droppedCount.load(std::memory_order_relaxed);
+}
+
+size_t encodeFrame(uint8_t* out, size_t outSize) {
+    if (outSize < (size_t)maxPayload + ControlFrame::overhead) {
+        return 0;
+    }
+    uint8_t payload[maxPayload];
+    uint8_t length = headerSize;
+    Event event;
+    while (length + sizeof(Event) <= maxPayload && ring.pop(event)) {
+        uint8_t* p = payload + length;
+        p[0] = (uint8_t)event.ticks;
+        p[1] = (uint8_t)(event.ticks >> 8);
+        p[2] = (uint8_t)(event.ticks >> 16);
+        p[3] = (uint8_t)(event.ticks >> 24);
+        p[4] = (uint8_t)event.sequence;
+        p[5] = (uint8_t)(event.sequence >> 8);
+        p[6] = event.point;
+        length += sizeof(Event);
+    }
+    if (length == headerSize) {
+        return 0;
+    }
+
+    uint16_t ticks = (uint16_t)ticksPerUs();
+    uint16_t drops = (uint16_t)dropped();
+    payload[0] = traceSource;
+    payload[1] = (uint8_t)ticks;
+    payload[2] = (uint8_t)(ticks >> 8);
+    payload[3] = (uint8_t)drops;
+    payload[4] = (uint8_t)(drops >> 8);
+    return ControlFrame::encode(ControlFrame::TYPE_TRACE, payload, length, out, outSize);
+}
+
+} // namespace LatencyTrace
@@ -0,0 +1,98 @@
+#ifndef LATENCY_TRACE_H
+#define LATENCY_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ControlConfig.h"
+
+// Input-to-actuation latency tracing.
+//
+// Every control state change is timestamped at four points, keyed by its
+// ControlState sequence:
+//
+//   POINT_INPUT    the raw input arrived (report, serial bytes, RC pulse)
+//   POINT_UPDATE   the backend's update() published the new state
+//   POINT_MIX      the mix stage picked it up
+//   POINT_COMMIT   the actuate stage wrote the outputs for it
+//
+// Timestamps are CPU cycles on the ESP32. Each core has its own cycle
+// counter, so both are aligned to the shared esp_timer when tracing
+// starts (syncCore() on each core); elsewhere a microsecond clock is used.
+// Events go into a fixed-size lock-free ring and are sent as TYPE_TRACE
+// frames (ControlFrame.h):
+//
+//   +--------+-------------+---------+-------------------------------+
+//   | source | ticksPerUs  | dropped | events: ticks, sequence, point|
+//   | uint8  | uint16      | uint16  | uint32, uint16, uint8 each    |
+//   +--------+-------------+---------+-------------------------------+
+//
+// All little-endian. dropped counts the events lost to a full ring so far
+// (wrapping). host/tools/trace_latency.py turns the frames into per
+// backend latency histograms.
+//
+// Compiled in with LATENCY_TRACE (ControlConfig.h); TRACE_POINT() is a
+// no-op otherwise.
+
+#ifdef LATENCY_TRACE
+#define TRACE_POINT(point, sequence) LatencyTrace::record(LatencyTrace::point, sequence)
+#else
+#define TRACE_POINT(point, sequence) ((void)0)
+#endif
+
+namespace LatencyTrace {
+
+enum Point : uint8_t {
+    POINT_INPUT  = 0,
+    POINT_UPDATE = 1,
+    POINT_MIX    = 2,
+    POINT_COMMIT = 3
+};
+
+// Control backend the events belong to
+enum Source : uint8_t {
+    SOURCE_UNKNOWN   = 0,
+    SOURCE_BLUETOOTH = 1,
+    SOURCE_SERIAL    = 2,
+    SOURCE_KEYBOARD  = 3,
+    SOURCE_RC        = 4,
+    SOURCE_RC_BUS    = 5,
+    SOURCE_UDP       = 6
+};
+
+struct Event {
+    uint32_t ticks;
+    uint16_t sequence;   // low bits of ControlState::sequence
+    uint8_t point;
+} __attribute__((packed));
+
+const size_t capacity = 256;   // events, power of two
+const uint8_t headerSize = 5;
+const uint8_t maxFrameEvents = 8;
+const uint8_t maxPayload = headerSize + maxFrameEvents * sizeof(Event);
+
+typedef unsigned long (*Clock)();
+
+// clock is the microsecond source where there is no cycle counter
+// (ignored on the ESP32). Call from the core that runs the actuate stage.
+void begin(Source source, Clock clock);
+
+// Aligns this core's cycle counter with the others (ESP32). Call once on
+// every other core that records events, e.g. at the start of its task.
+void syncCore();
+
+uint32_t now();
+uint32_t ticksPerUs();
+
+// Any task or core; drops (and counts) the event if the ring is full
+void record(Point point, uint32_t sequence, uint32_t ticks);
+inline void record(Point point, uint32_t sequence) { record(point, sequence, now()); }
+
+uint32_t dropped();
+
+// Moves up to maxFrameEvents events into a TYPE_TRACE frame. Returns the
+// frame length, 0 if there are no events or out is too small.
+size_t encodeFrame(uint8_t* out, size_t outSize);
+
+} // namespace LatencyTrace
+
+#endif // LATENCY_TRACE_H
@@ -0,0 +1,216 @@
+#include "Log.h"
+#include "MpscRing.h"
+#include "Profiler.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+namespace Log {
+
+static MpscRing<Record, queueLength> queue;
+static std::atomic<uint32_t> droppedCount(0);
+static std::atomic<uint32_t> pushedCount(0);
+
+static Sink output = nullptr;
+static Clock timeSource = nullptr;
+
+// Drain side only: the line being written and how much of it is out
+static char line[maxLineLength + 1];
+static size_t lineLength = 0;
+static size_t lineWritten = 0;
+static uint32_t reportedDrops = 0;
+static uint32_t drainedCount = 0;
+
+static const char levelLetters[] = "?EWID";
+
+Text::Text(const char* text) : data(text), length(text ? strlen(text) : 0) {}
+
+void begin(Sink sink, Clock clockSource) {
+    timeSource = clockSource;
+    output = sink;
+}
+
+uint32_t timestamp() {
+    return timeSource ? (uint32_t)timeSource() : 0;
+}
+
+bool push(const Record& record) {
+    if (!queue.push(record)) {
+        droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    pushedCount.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+uint32_t dropped() {
+    return droppedCount.load(std::memory_order_relaxed);
+}
+
+uint32_t queued() {
+    return pushedCount.load(std::memory_order_relaxed) - drainedCount;
+}
+
+// Formats a single conversion; spec is "%" plus flags, width and
+// precision (length modifiers dropped), conversion is its last character
+static int formatArg(char* out, size_t size, char* spec, size_t specLength, char conversion,
+                     const Record& record, uint8_t index) {
+    spec[specLength] = conversion;
+    spec[specLength + 1] = '\0';
+    const Arg& arg = record.args[index];
+    switch (conversion) {
+    case 'd':
+    case 'i':
+    case 'c':
+        return snprintf(out, size, spec, (int)arg.i);
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+        return snprintf(out, size, spec, (unsigned int)arg.u);
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+        return snprintf(out, size, spec, (double)arg.f);
+    case 's': {
+        const char* text = index == record.textArg ? record.text : arg.s;
+        return snprintf(out, size, spec, text ? text : "(null)");
+    }
+    default:
+        return snprintf(out, size, "?");
+    }
+}
+
+size_t format(const Record& record, char* out, size_t size) {
+    if (size == 0) {
+        return 0;
+    }
+    size_t length = 0;
+    uint8_t argIndex = 0;
+    const char* p = record.format;
+    while (*p && length + 1 < size) {
+        if (*p != '%') {
+            out[length++] = *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            out[length++] = '%';
+            p += 2;
+            continue;
+        }
+
+        // Collect the conversion, without length modifiers
+        char spec[16];
+        size_t specLength = 0;
+        spec[specLength++] = *p++;
+        while (*p && strchr("-+ #0123456789.", *p) && specLength < sizeof(spec) - 2) {
+            spec[specLength++] = *p++;
+        }
+        while (*p && strchr("hlLjzt", *p)) {
+            p++;
+        }
+        char conversion = *p;
+        if (!conversion) {
+            break;
+        }
+        p++;
+
+        if (argIndex >= record.argCount) {
+            // More conversions than arguments: leave a marker
+            out[length++] = '?';
+            continue;
+        }
+        int written = formatArg(out + length, size - length, spec, specLength, conversion, record, argIndex++);
+        if (written > 0) {
+            length += (size_t)written < size - length ? (size_t)written : size - length - 1;
+        }
+    }
+    out[length] = '\0';
+    return length;
+}
+
+// Formats the next line to write; false when there is none
+static bool nextLine() {
+    int length;
+    // Report drops as they happen, ahead of what is still queued
+    uint32_t drops = droppedCount.load(std::memory_order_relaxed);
+    if (drops != reportedDrops) {
+        uint32_t now = timestamp();
+        length = snprintf(line, sizeof(line), "%lu.%03lu W log: %lu messages dropped\r\n",
+                          (unsigned long)(now / 1000), (unsigned long)(now % 1000),
+                          (unsigned long)(drops - reportedDrops));
+        reportedDrops = drops;
+    } else {
+        Record record;
+        if (!queue.pop(record)) {
+            return false;
+        }
+        drainedCount++;
+        length = snprintf(line, sizeof(line), "%lu.%03lu %c ",
+                          (unsigned long)(record.timestampMs / 1000),
+                          (unsigned long)(record.timestampMs % 1000),
+                          levelLetters[record.level < sizeof(levelLetters) - 1 ? record.level : 0]);
+        // Leave room for the line end
+        length += format(record, line + length, sizeof(line) - length - 2);
+        line[length++] = '\r';
+        line[length++] = '\n';
+    }
+    lineLength = length < (int)sizeof(line) ? (size_t)length : sizeof(line) - 1;
+    lineWritten = 0;
+    return true;
+}
+
+size_t drain() {
+    if (!output) {
+        return 0;
+    }
+    PROFILE_SECTION(SECTION_LOG);
+    size_t total = 0;
+    for (;;) {
+        if (lineWritten == lineLength && !nextLine()) {
+            return total;
+        }
+        size_t written = output((const uint8_t*)line + lineWritten, lineLength - lineWritten);
+        lineWritten += written;
+        total += written;
+        if (lineWritten < lineLength) {
+            // Output full; the rest goes out on the next drain
+            return total;
+        }
+    }
+}
+
+#if defined(ESP32)
+
+static void drainTask(void* parameter) {
+    TickType_t interval = pdMS_TO_TICKS((uint32_t)(uintptr_t)parameter);
+    if (interval == 0) {
+        interval = 1;
+    }
+    for (;;) {
+        drain();
+        vTaskDelay(interval);
+    }
+}
+
+bool startDrainTask(uint8_t priority, uint8_t core, uint32_t stackSize, uint32_t intervalMs) {
+    return xTaskCreatePinnedToCore(drainTask, "log", stackSize, (void*)(uintptr_t)intervalMs,
+                                   priority, nullptr, core) == pdPASS;
+}
+
+#else
+
+bool startDrainTask(uint8_t, uint8_t, uint32_t, uint32_t) {
+    return false;
+}
+
+#endif
+
+} // namespace Log
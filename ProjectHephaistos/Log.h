@@ -0,0 +1,173 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ControlConfig.h"
+
+// Deferred logging that never blocks the caller.
+//
+// LOG_INFO("Gear shifted up to %d", gear) only copies the format string
+// pointer (the literal is the message id) and the raw arguments into a
+// lock-free queue. A low-priority task formats the messages later and
+// writes as much as the output takes without waiting; when the queue is
+// full, messages are dropped and counted instead.
+//
+// - Arguments: integers, float/double, and string literals (the pointer
+//   is kept, so the string must outlive the message). Wrap any other
+//   string in Log::Text() to copy up to maxTextLength characters of it;
+//   one per message.
+// - Messages above LOG_LEVEL (ControlConfig.h) are compiled out, along
+//   with their arguments.
+
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) Log::write(Log::LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) Log::write(Log::LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) Log::write(Log::LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) Log::write(Log::LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+namespace Log {
+
+enum Level : uint8_t {
+    LEVEL_ERROR = LOG_LEVEL_ERROR,
+    LEVEL_WARN  = LOG_LEVEL_WARN,
+    LEVEL_INFO  = LOG_LEVEL_INFO,
+    LEVEL_DEBUG = LOG_LEVEL_DEBUG
+};
+
+const uint8_t maxArgs = 8;
+const uint8_t maxTextLength = 23;
+const uint8_t queueLength = 64;   // messages
+const uint8_t maxLineLength = 127;
+
+// Takes up to length bytes; returns how many it took (fewer when the
+// output is full, it is offered the rest later)
+typedef size_t (*Sink)(const uint8_t* data, size_t length);
+typedef unsigned long (*Clock)();
+
+union Arg {
+    int32_t i;
+    uint32_t u;
+    float f;
+    const char* s;
+};
+
+// A string argument copied into the message
+struct Text {
+    const char* data;
+    size_t length;
+
+    Text(const char* text, size_t length) : data(text), length(length) {}
+    explicit Text(const char* text);
+};
+
+struct Record {
+    const char* format;
+    uint32_t timestampMs;
+    uint8_t level;
+    uint8_t argCount;
+    uint8_t textArg;              // index of the Text argument, noText if none
+    char text[maxTextLength + 1];
+    Arg args[maxArgs];
+};
+
+const uint8_t noText = 0xFF;
+
+// Timestamps come from clock (millis()); until begin() messages queue up
+// and stay there
+void begin(Sink sink, Clock clock);
+
+// Starts a task that drains the queue every intervalMs. Returns false if
+// there is no task support; call drain() periodically then.
+bool startDrainTask(uint8_t priority, uint8_t core, uint32_t stackSize, uint32_t intervalMs);
+
+// Formats queued messages and hands them to the sink until the queue is
+// empty or the sink is full. Returns the number of bytes written.
+size_t drain();
+
+// Queues a message; returns false (and counts it) if the queue is full
+bool push(const Record& record);
+
+uint32_t dropped();
+uint32_t queued();
+
+// Formats one message into out (at most size - 1 characters plus NUL),
+// without the timestamp and level prefix; returns its length
+size_t format(const Record& record, char* out, size_t size);
+
+uint32_t timestamp();
+
+inline Arg toArg(int value) { Arg arg; arg.i = value; return arg; }
+inline Arg toArg(long value) { Arg arg; arg.i = (int32_t)value; return arg; }
+inline Arg toArg(unsigned int value) { Arg arg; arg.u = value; return arg; }
+inline Arg toArg(unsigned long value) { Arg arg; arg.u = (uint32_t)value; return arg; }
+inline Arg toArg(float value) { Arg arg; arg.f = value; return arg; }
+inline Arg toArg(double value) { Arg arg; arg.f = (float)value; return arg; }
+inline Arg toArg(const char* value) { Arg arg; arg.s = value; return arg; }
+
+inline void pack(Record&, uint8_t) {}
+
+template <typename... Rest>
+void pack(Record& record, uint8_t index, const Text& text, const Rest&... rest);
+
+template <typename T, typename... Rest>
+void pack(Record& record, uint8_t index, const T& value, const Rest&... rest) {
+    record.args[index] = toArg(value);
+    pack(record, index + 1, rest...);
+}
+
+template <typename... Rest>
+void pack(Record& record, uint8_t index, const Text& text, const Rest&... rest) {
+    size_t length = text.length < maxTextLength ? text.length : maxTextLength;
+    for (size_t i = 0; i < length; i++) {
+        record.text[i] = text.data[i];
+    }
+    record.text[length] = '\0';
+    record.textArg = index;
+    pack(record, index + 1, rest...);
+}
+
+template <typename... Args>
+inline void write(Level level, const char* format, const Args&... args) {
+    static_assert(sizeof...(Args) <= maxArgs, "Too many log arguments");
+    Record record;
+    record.format = format;
+    record.timestampMs = timestamp();
+    record.level = level;
+    record.argCount = sizeof...(Args);
+    record.textArg = noText;
+    pack(record, 0, args...);
+    push(record);
+}
+
+} // namespace Log
+
+#endif // LOG_H
@@ -0,0 +1,26 @@
+#ifndef MOTOR_DRIVER_H
+#define MOTOR_DRIVER_H
+
+#include <stdint.h>
+
+// Output stage for one motor: a PWM duty cycle plus the direction inputs
+// of an H-bridge. The firmware uses HBridgeMotorDriver; host runs substitute
+// one that records what would have been written.
+class MotorDriver {
+public:
+    enum Direction {
+        DIRECTION_REVERSE = -1,
+        DIRECTION_COAST   = 0,
+        DIRECTION_FORWARD = 1
+    };
+
+    virtual ~MotorDriver() {}
+
+    // Returns false if the PWM output could not be set up
+    virtual bool begin(uint32_t frequencyHz, uint8_t resolutionBits) = 0;
+
+    // duty is 0..(2^resolutionBits - 1)
+    virtual void write(uint32_t duty, Direction direction) = 0;
+};
+
+#endif // MOTOR_DRIVER_H
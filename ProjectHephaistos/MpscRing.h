@@ -0,0 +1,77 @@
+#ifndef MPSC_RING_H
+#define MPSC_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Bounded lock-free queue, many producers and one consumer, no heap.
+// Capacity must be a power of two.
+//
+// Every slot carries a sequence number telling whether it is free for the
+// producer at a given position or holds an item for the consumer, so
+// producers only contend on one compare-and-swap of the write position
+// and never wait: push() on a full queue fails right away. Safe to call
+// from any task or core, and from interrupt handlers.
+template <typename T, size_t Capacity>
+class MpscRing {
+    static_assert((Capacity & (Capacity - 1)) == 0, "MpscRing capacity must be a power of two");
+
+public:
+    MpscRing() : writePosition(0), readPosition(0) {
+        for (size_t i = 0; i < Capacity; i++) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Any producer; returns false if the queue is full
+    bool push(const T& item) {
+        size_t position = writePosition.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots[position & mask];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+            if (difference == 0) {
+                // Free for this position: claim it
+                if (writePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    slot.item = item;
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                // Still holds an item from one lap ago
+                return false;
+            } else {
+                // Another producer got there first
+                position = writePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Single consumer; returns false if there is nothing (complete) to take
+    bool pop(T& item) {
+        Slot& slot = slots[readPosition & mask];
+        size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence != readPosition + 1) {
+            return false;
+        }
+        item = slot.item;
+        slot.sequence.store(readPosition + Capacity, std::memory_order_release);
+        readPosition++;
+        return true;
+    }
+
+private:
+    static const size_t mask = Capacity - 1;
+
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T item;
+    };
+
+    Slot slots[Capacity];
+    std::atomic<size_t> writePosition;
+    size_t readPosition;
+};
+
+#endif // MPSC_RING_H
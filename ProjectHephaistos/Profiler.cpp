@@ -0,0 +1,221 @@
+#include "Profiler.h"
+#include "Log.h"
+#include <atomic>
+
+#if defined(ESP32)
+#include <Arduino.h>
+#include <esp_cpu.h>
+#include <esp_system.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+namespace Profiler {
+
+static const char* const sectionNames[sectionCount] = {
+    "bluepad32",
+    "rc input",
+    "parse",
+    "log",
+    "telemetry",
+};
+
+// Current window, written by the sections
+struct Counters {
+    std::atomic<uint32_t> ticks;
+    std::atomic<uint32_t> calls;
+    std::atomic<uint32_t> minTicks;
+    std::atomic<uint32_t> maxTicks;
+};
+
+static Counters counters[sectionCount];
+static SectionStats lastWindow[sectionCount];
+static uint32_t windowLength = 1000;
+static uint32_t windowStartMs = 0;
+static uint32_t lastWindowLength = 0;
+static bool windowStarted = false;
+static uint32_t ticksPerUs = 1;
+
+static const char* tasks[maxTasks];
+static uint8_t tasksWatched = 0;
+
+static std::atomic<bool> reportRequested(false);
+
+#if defined(ESP32)
+
+void begin(Clock, uint32_t windowMs) {
+    ticksPerUs = getCpuFrequencyMhz();
+    windowLength = windowMs > 0 ? windowMs : 1;
+    windowStarted = false;
+}
+
+uint32_t now() {
+    return esp_cpu_get_cycle_count();
+}
+
+int32_t stackHighWater(uint8_t index) {
+    if (index >= tasksWatched) {
+        return -1;
+    }
+    // Looked up every time: the task may not exist yet, or any more
+    TaskHandle_t task = xTaskGetHandle(tasks[index]);
+    if (!task) {
+        return -1;
+    }
+    // In bytes on ESP-IDF
+    return (int32_t)uxTaskGetStackHighWaterMark(task);
+}
+
+uint32_t freeHeap() {
+    return esp_get_free_heap_size();
+}
+
+uint32_t minFreeHeap() {
+    return esp_get_minimum_free_heap_size();
+}
+
+#else
+
+static Clock timeSource = nullptr;
+
+void begin(Clock clock, uint32_t windowMs) {
+    timeSource = clock;
+    ticksPerUs = 1;
+    windowLength = windowMs > 0 ? windowMs : 1;
+    windowStarted = false;
+}
+
+uint32_t now() {
+    return timeSource ? (uint32_t)timeSource() : 0;
+}
+
+int32_t stackHighWater(uint8_t) {
+    return -1;
+}
+
+uint32_t freeHeap() {
+    return 0;
+}
+
+uint32_t minFreeHeap() {
+    return 0;
+}
+
+#endif
+
+static void resetCounters(Counters& section) {
+    section.ticks.store(0, std::memory_order_relaxed);
+    section.calls.store(0, std::memory_order_relaxed);
+    section.minTicks.store(UINT32_MAX, std::memory_order_relaxed);
+    section.maxTicks.store(0, std::memory_order_relaxed);
+}
+
+void add(Section section, uint32_t startTicks) {
+    uint32_t ticks = now() - startTicks;
+    Counters& c = counters[section];
+    c.ticks.fetch_add(ticks, std::memory_order_relaxed);
+    c.calls.fetch_add(1, std::memory_order_relaxed);
+    uint32_t current = c.minTicks.load(std::memory_order_relaxed);
+    while (ticks < current && !c.minTicks.compare_exchange_weak(current, ticks, std::memory_order_relaxed)) {
+    }
+    current = c.maxTicks.load(std::memory_order_relaxed);
+    while (ticks > current && !c.maxTicks.compare_exchange_weak(current, ticks, std::memory_order_relaxed)) {
+    }
+}
+
+void update(uint32_t nowMs) {
+    if (!windowStarted) {
+        for (uint8_t i = 0; i < sectionCount; i++) {
+            resetCounters(counters[i]);
+        }
+        windowStartMs = nowMs;
+        windowStarted = true;
+        return;
+    }
+    uint32_t elapsedMs = nowMs - windowStartMs;
+    if (elapsedMs < windowLength) {
+        return;
+    }
+
+    // A section finishing right now may land half in either window;
+    // that is within the resolution of a load figure
+    for (uint8_t i = 0; i < sectionCount; i++) {
+        Counters& c = counters[i];
+        uint32_t ticks = c.ticks.exchange(0, std::memory_order_relaxed);
+        uint32_t calls = c.calls.exchange(0, std::memory_order_relaxed);
+        uint32_t minTicks = c.minTicks.exchange(UINT32_MAX, std::memory_order_relaxed);
+        uint32_t maxTicks = c.maxTicks.exchange(0, std::memory_order_relaxed);
+
+        SectionStats& s = lastWindow[i];
+        s.calls = calls;
+        s.minUs = calls ? minTicks / ticksPerUs : 0;
+        s.maxUs = maxTicks / ticksPerUs;
+        s.avgUs = calls ? ticks / calls / ticksPerUs : 0;
+        uint64_t permille = (uint64_t)ticks / ((uint64_t)elapsedMs * ticksPerUs);
+        s.loadPermille = (uint16_t)(permille > 1000 ? 1000 : permille);
+    }
+    lastWindowLength = elapsedMs;
+    windowStartMs = nowMs;
+}
+
+const char* sectionName(Section section) {
+    return section < sectionCount ? sectionNames[section] : "?";
+}
+
+const SectionStats& stats(Section section) {
+    return lastWindow[section];
+}
+
+uint32_t lastWindowMs() {
+    return lastWindowLength;
+}
+
+bool watchTask(const char* name) {
+    if (tasksWatched >= maxTasks) {
+        return false;
+    }
+    tasks[tasksWatched++] = name;
+    return true;
+}
+
+uint8_t taskCount() {
+    return tasksWatched;
+}
+
+const char* taskName(uint8_t index) {
+    return index < tasksWatched ? tasks[index] : "?";
+}
+
+void requestReport() {
+    reportRequested.store(true, std::memory_order_relaxed);
+}
+
+bool takeReportRequest() {
+    return reportRequested.exchange(false, std::memory_order_relaxed);
+}
+
+void report() {
+    LOG_INFO("------ Profile, last %lu ms ------", (unsigned long)lastWindowLength);
+    for (uint8_t i = 0; i < sectionCount; i++) {
+        const SectionStats& s = lastWindow[i];
+        if (s.calls == 0) {
+            continue;
+        }
+        LOG_INFO("%-9s cpu %2u.%u%%  calls %lu  min %lu us avg %lu us max %lu us",
+                 sectionNames[i], (unsigned)(s.loadPermille / 10), (unsigned)(s.loadPermille % 10),
+                 (unsigned long)s.calls, (unsigned long)s.minUs, (unsigned long)s.avgUs,
+                 (unsigned long)s.maxUs);
+    }
+    for (uint8_t i = 0; i < tasksWatched; i++) {
+        int32_t free = stackHighWater(i);
+        if (free >= 0) {
+            LOG_INFO("Task %-9s stack min free %ld B", tasks[i], (long)free);
+        }
+    }
+    uint32_t heap = freeHeap();
+    if (heap) {
+        LOG_INFO("Heap free %lu B, min free %lu B", (unsigned long)heap, (unsigned long)minFreeHeap());
+    }
+}
+
+} // namespace Profiler
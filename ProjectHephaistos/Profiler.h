@@ -0,0 +1,102 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ControlConfig.h"
+
+// Standing view of the firmware's load.
+//
+// PROFILE_SECTION(SECTION_PARSE) at the top of a block adds the block's
+// run time (CPU cycles on the ESP32) to the section's counters. update()
+// closes a window of windowMs and keeps, per section, the share of CPU
+// time it took and the min/avg/max time per call. report() logs those
+// with the stack high-water marks of the watched tasks and the free heap.
+//
+// Sections may be entered from any task or core; the counters are
+// atomics, so nothing waits. A query (requestReport(), e.g. from the
+// "stats" serial command) is answered by whichever stage polls
+// takeReportRequest(), so control never stops for it.
+//
+// Compiled in with PROFILING (ControlConfig.h); PROFILE_SECTION() is a
+// no-op otherwise.
+
+#ifdef PROFILING
+#define PROFILE_SECTION(section) Profiler::Scope profileScope(Profiler::section)
+#else
+#define PROFILE_SECTION(section) ((void)0)
+#endif
+
+namespace Profiler {
+
+enum Section : uint8_t {
+    SECTION_BLUEPAD32,   // BP32.update()
+    SECTION_RC_INPUT,    // reading the RC pulse capture
+    SECTION_PARSE,       // serial frames, text commands, RC bus frames, datagrams
+    SECTION_LOG,         // formatting and writing log messages
+    SECTION_TELEMETRY,   // the telemetry stage
+    sectionCount
+};
+
+struct SectionStats {
+    uint32_t calls;
+    uint32_t minUs;
+    uint32_t avgUs;
+    uint32_t maxUs;
+    uint16_t loadPermille;   // of one core
+};
+
+const uint8_t maxTasks = 6;
+
+typedef unsigned long (*Clock)();
+
+// clock is the microsecond source where there is no cycle counter
+// (ignored on the ESP32)
+void begin(Clock clock, uint32_t windowMs);
+
+uint32_t now();
+
+// Adds the time since startTicks (from now()) to the section
+void add(Section section, uint32_t startTicks);
+
+class Scope {
+public:
+    explicit Scope(Section section) : section(section), start(now()) {}
+    ~Scope() { add(section, start); }
+
+private:
+    Section section;
+    uint32_t start;
+};
+
+// Closes the window if windowMs have passed since the last one. Call
+// periodically from one stage.
+void update(uint32_t nowMs);
+
+const char* sectionName(Section section);
+
+// Of the last complete window
+const SectionStats& stats(Section section);
+uint32_t lastWindowMs();
+
+// Stack high-water marks are looked up by FreeRTOS task name
+bool watchTask(const char* name);
+uint8_t taskCount();
+const char* taskName(uint8_t index);
+// Least free stack seen so far, in bytes; -1 if the task doesn't exist
+int32_t stackHighWater(uint8_t index);
+
+// 0 where unknown
+uint32_t freeHeap();
+uint32_t minFreeHeap();
+
+// Any task; the next takeReportRequest() returns true
+void requestReport();
+bool takeReportRequest();
+
+// Logs the last window's sections, the tasks' stacks and the heap
+void report();
+
+} // namespace Profiler
+
+#endif // PROFILER_H
@@ -1,121 +1,742 @@
 #include <Arduino.h>
-#include "TankControlInterface.h"
-#include "SerialControl.h"
+#include "ControlConfig.h"
+#include "ControlLoop.h"
+#include "ControlScheduler.h"
+#include "ControlState.h"
+#include "SeqLock.h"
+#include "TrackMotor.h"
+#include "HBridgeMotorDriver.h"
+#include "EspActuatorBackend.h"
+#include "WheelEncoder.h"
+#include "TrackSpeedController.h"
+#include "TurretAxis.h"
+#include "ServoOutput.h"
+#include "ControlFrame.h"
+#include "Telemetry.h"
+#include "Log.h"
+#include "LatencyTrace.h"
+#include "Profiler.h"
+#include "SerialCommands.h"
+#include "FailsafeMonitor.h"
+#ifdef INPUT_RECORDING
+#include "InputRecorder.h"
+#endif
+#ifdef INPUT_REPLAY
+#include "ReplayControl.h"
+#endif
+
+// Only the selected backend is included and compiled
+// (choose it in ControlConfig.h)
+#ifdef CONTROL_MODE_BLUETOOTH
 #include "BluetoothControl.h"
+typedef BluetoothControl SelectedBackend;
+#define CONTROL_MODE_NAME "Bluetooth Gamepad"
+#define CONTROL_TRACE_SOURCE LatencyTrace::SOURCE_BLUETOOTH
+#define CONTROL_ARGS
+#elif defined(CONTROL_MODE_SERIAL)
+#include "SerialControl.h"
+typedef SerialControl SelectedBackend;
+#define CONTROL_MODE_NAME "Serial Control via Connected Laptop Keyboard"
+#define CONTROL_TRACE_SOURCE LatencyTrace::SOURCE_SERIAL
+#define CONTROL_ARGS
+#elif defined(CONTROL_MODE_KEYBOARD)
 #include "KeyboardControl.h"
+typedef KeyboardControl SelectedBackend;
+#define CONTROL_MODE_NAME "Keyboard Control via Bluetooth Keyboard"
+#define CONTROL_TRACE_SOURCE LatencyTrace::SOURCE_KEYBOARD
+#define CONTROL_ARGS
+#elif defined(CONTROL_MODE_RC)
 #include "RCControl.h"
-// or whichever control class you want to use
+typedef RCControl SelectedBackend;
+#define CONTROL_MODE_NAME "RC Control via RC Controller"
+#define CONTROL_TRACE_SOURCE LatencyTrace::SOURCE_RC
+#define CONTROL_ARGS
+#elif defined(CONTROL_MODE_RC_BUS)
+#include "RCBusControl.h"
+typedef RCBusControl SelectedBackend;
+#define CONTROL_MODE_NAME "RC Control via SBUS/iBUS/PPM Receiver"
+#define CONTROL_TRACE_SOURCE LatencyTrace::SOURCE_RC_BUS
+#define CONTROL_ARGS RC_BUS_PROTOCOL, RC_BUS_RX_PIN
+#elif defined(CONTROL_MODE_UDP)
+#include "UdpControl.h"
+typedef UdpControl SelectedBackend;
+#define CONTROL_MODE_NAME "UDP Control over Wi-Fi"
+#define CONTROL_TRACE_SOURCE LatencyTrace::SOURCE_UDP
+#define CONTROL_ARGS UDP_WIFI_SSID, UDP_WIFI_PASSWORD, UDP_WIFI_ACCESS_POINT, UDP_CONTROL_PORT, UDP_JITTER_BUFFER_MS
+#else
+    #error "No control mode defined!"
+#endif
+
+// With INPUT_REPLAY the backend is fed a recorded session instead
+#ifdef INPUT_REPLAY
+typedef ReplayControl<SelectedBackend> SelectedControl;
+#else
+typedef SelectedBackend SelectedControl;
+#endif
+
+// -------------------------------
+// Track Motor Pin Definitions
+// One H-bridge channel per track: PWM to the enable input, two pins for
+// the direction inputs. Choose pins that are safe for GPIO use on your
+// ESP32 module.
+#define LEFT_MOTOR_PWM_PIN      13
+#define LEFT_MOTOR_FORWARD_PIN  25
+#define LEFT_MOTOR_REVERSE_PIN  26
+#define RIGHT_MOTOR_PWM_PIN     4
+#define RIGHT_MOTOR_FORWARD_PIN 27
+#define RIGHT_MOTOR_REVERSE_PIN 33
+
+// PWM carrier; 20 kHz is above hearing, lower it if the bridge runs hot
+#define MOTOR_PWM_FREQUENCY_HZ    20000
+#define MOTOR_PWM_RESOLUTION_BITS 10
+
+// Speed ramp in % of full speed per second (and per second^2 for jerk).
+// Lower values are gentler on the gearbox and cut current peaks, higher
+// ones make the tank more responsive. 0 = no limit.
+#define MOTOR_MAX_ACCELERATION 250
+#define MOTOR_MAX_JERK         2500
+// -------------------------------
+
+// -------------------------------
+// Closed-Loop Track Speed
+// With quadrature encoders on both tracks, uncomment TRACK_SPEED_CONTROL
+// and the tracks hold the commanded speed under load and as the battery
+// drops, instead of just getting the commanded output. GPIO 34-39 are
+// input-only and free for the encoders (they have no pull-ups).
+// #define TRACK_SPEED_CONTROL
+#define LEFT_ENCODER_PIN_A   34
+#define LEFT_ENCODER_PIN_B   35
+#define RIGHT_ENCODER_PIN_A  36
+#define RIGHT_ENCODER_PIN_B  39
+
+// Encoder counts per second (4 per encoder line) at 100 % output with
+// the tracks off the ground; swap a track's A/B pins if it counts
+// backwards when driving forward
+#define ENCODER_FULL_SPEED_COUNTS 4000
+
+// Speed PID gains, tuned against the plant model in
+// host/bench/bench_speed_control.cpp
+#define SPEED_KP 5.0
+#define SPEED_KI 20.0
+#define SPEED_KD 0.0
+#define SPEED_KF 1.0
+// -------------------------------
+
+// -------------------------------
+// Turret Servos
+// The stick sets the turret's rate; the planner ramps it with an S-curve
+// (or trapezoidal) profile and stops it smoothly at the soft limits.
+// Servo frames run at TURRET_SERVO_FREQUENCY_HZ whatever the loop rate;
+// analog servos want 50 Hz, digital ones take up to 333 Hz.
+#define TURRET_ROTATION_SERVO_PIN   18
+#define TURRET_ELEVATION_SERVO_PIN  19
+#define TURRET_SERVO_FREQUENCY_HZ   50
+#define TURRET_PROFILE              TurretAxis::PROFILE_S_CURVE
+#define TURRET_ROTATION_RATE        90    // deg/s at full stick
+#define TURRET_ELEVATION_RATE       45
+#define TURRET_RAMP_TIME            0.25  // s from standstill to full rate
+
+// Soft limits in centidegrees from the centre position
+#define TURRET_ROTATION_MIN   -8500
+#define TURRET_ROTATION_MAX    8500
+#define TURRET_ELEVATION_MIN  -1000
+#define TURRET_ELEVATION_MAX   4500
+
+// Pulse widths at -90 and +90 degrees of servo travel
+#define TURRET_SERVO_MIN_PULSE_US  500
+#define TURRET_SERVO_MAX_PULSE_US  2500
+// -------------------------------
+
+// -------------------------------
+// Control Loop Rates (Hz)
+// The input side ticks at INPUT_RATE_HZ, the actuation side at
+// ACTUATE_RATE_HZ; the other stages run every n-th tick of their side,
+// so their rates should divide it. Both side rates have to be a whole
+// number of FreeRTOS ticks (1 ms by default: 1000, 500, 250, ... Hz).
+// Each can also be set on the compiler command line (host/sim/tank_sim.cpp
+// sweeps them).
+#ifndef INPUT_RATE_HZ
+#define INPUT_RATE_HZ      250   // poll the control backend
+#endif
+#ifndef MIX_RATE_HZ
+#define MIX_RATE_HZ        250   // turn inputs into track/turret commands
+#endif
+#ifndef ACTUATE_RATE_HZ
+#define ACTUATE_RATE_HZ    500   // drive relays, motors, servos
+#endif
+#ifndef TELEMETRY_RATE_HZ
+#define TELEMETRY_RATE_HZ  10    // status output
+#endif
+
+// -------------------------------
+// Failsafe
+// The tracks coast and the turret and flamethrower stop once no fresh
+// input has come from the control backend for FAILSAFE_DEADLINE_MS,
+// whatever the backend; they are stopped within that plus one input and
+// one actuation tick. Bluetooth backends report only some of the time: a
+// gamepad that goes quiet off centre counts as fresh for
+// BluetoothControl::reportKeepAliveMs more, and a keyboard for as long as
+// it is connected (see KeyboardControl.h).
+#ifndef FAILSAFE_DEADLINE_MS
+#define FAILSAFE_DEADLINE_MS 100
+#endif
+// -------------------------------
+
+// Scheduler stats (incl. stage run times) are printed on deadline misses
+// and every STATS_REPORT_MS; 0 = on misses only
+#define STATS_REPORT_MS    10000
+
+// The "stats" serial command also prints the profiler's view of the last
+// PROFILE_WINDOW_MS: CPU time per section, task stacks and heap
+#define PROFILE_WINDOW_MS  1000
 
+// Telemetry on Serial at TELEMETRY_RATE_HZ: binary frames carrying only
+// what changed (decoded by tank_controller.py) and/or the readable status
+// block. Scheduler stats are printed as text either way.
+#define TELEMETRY_BINARY
+// #define TELEMETRY_TEXT
+#define TELEMETRY_KEYFRAME_MS 1000   // full frame at least this often
+// -------------------------------
+
+// -------------------------------
+// Dual-Core Pipeline
+// Input polling (Bluepad32, serial parsing) and telemetry run in their own
+// task on core 0, next to the Bluetooth stack. Mixing and actuation stay
+// in the Arduino loop task on core 1, so slow input or logging never
+// delays motor output. Single-core chips run every stage from loop().
+#if defined(ESP32) && !CONFIG_FREERTOS_UNICORE
+#define DUAL_CORE_PIPELINE
+#endif
+#define INPUT_TASK_CORE      0
+#define INPUT_TASK_PRIORITY  2
+#define INPUT_TASK_STACK     4096
 
-// Define control mode
-// #define CONTROL_MODE_SERIAL
-#define CONTROL_MODE_BLUETOOTH
-// #define CONTROL_MODE_KEYBOARD
-//#define CONTROL_MODE_RC
+// Log messages are queued and written out by a low-priority task, so a
+// full UART buffer never holds up a control stage
+#define LOG_TASK_CORE         0
+#define LOG_TASK_PRIORITY     1
+#define LOG_TASK_STACK        3072
+#define LOG_DRAIN_INTERVAL_MS 10
+// -------------------------------
 
 // -------------------------------
-// Relay Pin Definitions
-// Choose pins that are safe for GPIO use on your ESP32 module
-// (e.g., GPIO4 and GPIO13, or whatever you prefer)
-#define LEFT_RELAY_PIN  13    // For left track relay
-#define RIGHT_RELAY_PIN 4   // For right track relay
+// Input Recording
+// With INPUT_RECORDING or INPUT_REPLAY (ControlConfig.h). Sessions are
+// kept in a ring of RECORD_SEGMENTS files of RECORD_SEGMENT_BYTES on the
+// "records" partition; once it is full the oldest are overwritten. A
+// low-priority task writes the queued samples out every
+// RECORD_FLUSH_INTERVAL_MS.
+#define RECORD_DIRECTORY         "/records"
+#define RECORD_SEGMENT_BYTES     16384
+#define RECORD_SEGMENTS          48
+#define RECORD_TASK_CORE         0
+#define RECORD_TASK_PRIORITY     1
+#define RECORD_TASK_STACK        4096
+#define RECORD_FLUSH_INTERVAL_MS 100
 // -------------------------------
 
-// Create a pointer to the control interface
-TankControlInterface* tankControl = nullptr;
+// Input side of the loop, bound to the controller in setup()
+#ifdef CONTROL_DISPATCH_VIRTUAL
+ControlLoop<TankControlInterface> controlLoop;
+#else
+ControlLoop<SelectedControl> controlLoop;
+#endif
+
+#if defined(ESP32)
+static_assert(ControlScheduler::rateSupported(INPUT_RATE_HZ),
+              "INPUT_RATE_HZ: the period has to be a whole number of FreeRTOS ticks");
+static_assert(ControlScheduler::rateSupported(ACTUATE_RATE_HZ),
+              "ACTUATE_RATE_HZ: the period has to be a whole number of FreeRTOS ticks");
+#endif
+ControlScheduler inputScheduler(INPUT_RATE_HZ);
+ControlScheduler controlScheduler(ACTUATE_RATE_HZ);
+
+// Latest input, published by the input stage and read by the mix stage
+SeqLock<ControlState> inputState;
+
+// Control values used by the actuate stage
+ControlState outputs = {};
+
+// Fed by the input stage, checked by the actuate stage
+FailsafeMonitor failsafe(FAILSAFE_DEADLINE_MS * 1000UL);
+uint32_t fedInputs = 0;
+bool failsafeTripped = false;
+
+// All outputs are staged during the actuate stage and written together
+// at its end
+EspActuatorBackend actuators;
+
+HBridgeMotorDriver leftMotorDriver(actuators, LEFT_MOTOR_PWM_PIN, LEFT_MOTOR_FORWARD_PIN, LEFT_MOTOR_REVERSE_PIN);
+HBridgeMotorDriver rightMotorDriver(actuators, RIGHT_MOTOR_PWM_PIN, RIGHT_MOTOR_FORWARD_PIN, RIGHT_MOTOR_REVERSE_PIN);
+TrackMotor leftMotor(leftMotorDriver);
+TrackMotor rightMotor(rightMotorDriver);
+
+TurretAxis turretRotation;
+TurretAxis turretElevation;
+ServoOutput rotationServo(actuators, TURRET_ROTATION_SERVO_PIN);
+ServoOutput elevationServo(actuators, TURRET_ELEVATION_SERVO_PIN);
+
+#ifdef TRACK_SPEED_CONTROL
+WheelEncoder leftEncoder(LEFT_ENCODER_PIN_A, LEFT_ENCODER_PIN_B);
+WheelEncoder rightEncoder(RIGHT_ENCODER_PIN_A, RIGHT_ENCODER_PIN_B);
+TrackSpeedController leftSpeedControl;
+TrackSpeedController rightSpeedControl;
+// Cleared if the encoders can't be set up; the tracks then run open loop
+bool speedControlActive = false;
+#endif
+
+#ifdef TELEMETRY_BINARY
+// What the actuate stage last drove, read by the telemetry stage
+SeqLock<Telemetry::Sample> actuationReport;
+Telemetry::Encoder telemetryEncoder(TELEMETRY_KEYFRAME_MS);
+#endif
+
+#ifdef LATENCY_TRACE
+// Last control state traced through to the actuator commit
+uint32_t tracedSequence = 0;
+#endif
+
+// Without a drain task the telemetry stage drains the log
+bool logTaskRunning = false;
+
+#ifdef INPUT_RECORDING
+// Without a flush task the telemetry stage writes the recording
+bool recordTaskRunning = false;
+#endif
+
+// Deadline misses already reported by the telemetry stage
+uint32_t reportedMisses = 0;
+unsigned long lastStatsReport = 0;
+
+void pollInputs();
+void mixOutputs();
+void actuateOutputs();
+void sendTelemetry();
+void reportActuation(bool live);
+void inputTask(void* parameter);
+size_t writeLog(const uint8_t* data, size_t length);
+void pollStatsQuery();
+void printFailsafeStats();
 
 void setup() {
     Serial.begin(115200);
+    Log::begin(writeLog, millis);
+    logTaskRunning = Log::startDrainTask(LOG_TASK_PRIORITY, LOG_TASK_CORE, LOG_TASK_STACK,
+                                         LOG_DRAIN_INTERVAL_MS);
+#ifdef LATENCY_TRACE
+    LatencyTrace::begin(CONTROL_TRACE_SOURCE, micros);
+#endif
+    Profiler::begin(micros, PROFILE_WINDOW_MS);
+    Profiler::watchTask("loopTask");
+    Profiler::watchTask("input");
+    Profiler::watchTask("log");
+#ifdef INPUT_RECORDING
+    Profiler::watchTask("record");
+#endif
 
-    // Initialize relay pins
-    pinMode(LEFT_RELAY_PIN, OUTPUT);
-    pinMode(RIGHT_RELAY_PIN, OUTPUT);
+    // Initialize the track motors, stopped
+    if (!leftMotor.begin(MOTOR_PWM_FREQUENCY_HZ, MOTOR_PWM_RESOLUTION_BITS) ||
+        !rightMotor.begin(MOTOR_PWM_FREQUENCY_HZ, MOTOR_PWM_RESOLUTION_BITS)) {
+        LOG_ERROR("Motor PWM setup failed!");
+    }
+    leftMotor.setRamp(MOTOR_MAX_ACCELERATION, MOTOR_MAX_JERK, ACTUATE_RATE_HZ);
+    rightMotor.setRamp(MOTOR_MAX_ACCELERATION, MOTOR_MAX_JERK, ACTUATE_RATE_HZ);
 
-#ifdef CONTROL_MODE_BLUETOOTH
-    tankControl = new BluetoothControl();
-    Serial.println("Control Mode: Bluetooth Gamepad");
-#elif defined(CONTROL_MODE_SERIAL)
-    tankControl = new SerialControl();
-    Serial.println("Control Mode: Serial Control via Connected Laptop Keyboard");
-#elif defined(CONTROL_MODE_KEYBOARD)
-    tankControl = new KeyboardControl();
-    Serial.println("Control Mode: Keyboard Control via Bluetooth Keyboard");
-#elif defined(CONTROL_MODE_RC)
-    tankControl = new RCControl();
-    Serial.println("Control Mode: RC Control via RC Controller");
+    // Turret centred, servos hold it from the first commit
+    turretRotation.configure(TURRET_PROFILE, TURRET_ROTATION_RATE, TURRET_RAMP_TIME, ACTUATE_RATE_HZ);
+    turretElevation.configure(TURRET_PROFILE, TURRET_ELEVATION_RATE, TURRET_RAMP_TIME, ACTUATE_RATE_HZ);
+    turretRotation.setLimits(TURRET_ROTATION_MIN, TURRET_ROTATION_MAX);
+    turretElevation.setLimits(TURRET_ELEVATION_MIN, TURRET_ELEVATION_MAX);
+    turretRotation.reset(0);
+    turretElevation.reset(0);
+    if (!rotationServo.begin(TURRET_SERVO_FREQUENCY_HZ) ||
+        !elevationServo.begin(TURRET_SERVO_FREQUENCY_HZ)) {
+        LOG_ERROR("Turret servo setup failed!");
+    }
+    rotationServo.setRange(-9000, 9000, TURRET_SERVO_MIN_PULSE_US, TURRET_SERVO_MAX_PULSE_US);
+    elevationServo.setRange(-9000, 9000, TURRET_SERVO_MIN_PULSE_US, TURRET_SERVO_MAX_PULSE_US);
+    rotationServo.write(turretRotation.position());
+    elevationServo.write(turretElevation.position());
+    actuators.commit();
+
+#ifdef TRACK_SPEED_CONTROL
+    speedControlActive = leftEncoder.begin() && rightEncoder.begin();
+    if (speedControlActive) {
+        // The speed controllers ramp the setpoint; the motors follow
+        // their output directly
+        const TrackSpeedController::Gains gains = {SPEED_KP, SPEED_KI, SPEED_KD, SPEED_KF};
+        leftSpeedControl.configure(gains, ENCODER_FULL_SPEED_COUNTS, ACTUATE_RATE_HZ);
+        rightSpeedControl.configure(gains, ENCODER_FULL_SPEED_COUNTS, ACTUATE_RATE_HZ);
+        leftSpeedControl.setRamp(MOTOR_MAX_ACCELERATION, MOTOR_MAX_JERK, ACTUATE_RATE_HZ);
+        rightSpeedControl.setRamp(MOTOR_MAX_ACCELERATION, MOTOR_MAX_JERK, ACTUATE_RATE_HZ);
+        leftSpeedControl.reset(leftEncoder.count());
+        rightSpeedControl.reset(rightEncoder.count());
+        leftMotor.setRamp(0, 0, ACTUATE_RATE_HZ);
+        rightMotor.setRamp(0, 0, ACTUATE_RATE_HZ);
+        LOG_INFO("Track Speed: closed loop");
+    } else {
+        LOG_ERROR("Encoder setup failed, track speed open loop!");
+    }
+#endif
+
+#ifdef CONTROL_DISPATCH_VIRTUAL
+    SelectedControl* control = new SelectedControl{CONTROL_ARGS};
+    LOG_INFO("Controller Dispatch: virtual");
 #else
-    #error "No control mode defined!"
+    // Constructed here on first use, after Serial is up
+    static SelectedControl staticControl{CONTROL_ARGS};
+    SelectedControl* control = &staticControl;
+    LOG_INFO("Controller Dispatch: static");
+#endif
+    controlLoop.begin(control);
+    LOG_INFO("Control Mode: " CONTROL_MODE_NAME);
+
+#ifdef INPUT_RECORDING
+    if (InputRecorder::begin(RECORD_DIRECTORY, RECORD_SEGMENT_BYTES, RECORD_SEGMENTS, micros)) {
+        recordTaskRunning = InputRecorder::startFlushTask(RECORD_TASK_PRIORITY, RECORD_TASK_CORE,
+                                                          RECORD_TASK_STACK, RECORD_FLUSH_INTERVAL_MS);
+        LOG_INFO("Recording input: session %u", (unsigned)InputRecorder::session());
+    } else {
+        LOG_ERROR("Input recording setup failed!");
+    }
+#endif
+#ifdef INPUT_REPLAY
+    control->open(RECORD_DIRECTORY, REPLAY_SESSION);
 #endif
 
     // Additional setup code for your tank hardware
     // e.g., Initialize motors, servos, sensors, etc.
+
+#ifdef DUAL_CORE_PIPELINE
+    ControlScheduler& inputSide = inputScheduler;
+#else
+    ControlScheduler& inputSide = controlScheduler;
+#endif
+    inputSide.addStage("input", INPUT_RATE_HZ, pollInputs);
+    controlScheduler.addStage("mix", MIX_RATE_HZ, mixOutputs);
+    controlScheduler.addStage("actuate", ACTUATE_RATE_HZ, actuateOutputs);
+    inputSide.addStage("telemetry", TELEMETRY_RATE_HZ, sendTelemetry);
+
+#ifdef DUAL_CORE_PIPELINE
+    xTaskCreatePinnedToCore(inputTask, "input", INPUT_TASK_STACK, nullptr,
+                            INPUT_TASK_PRIORITY, nullptr, INPUT_TASK_CORE);
+#endif
 }
 
 void loop() {
+    // Runs the stages that are due, then sleeps until the next tick
+    controlScheduler.runTick();
+}
+
+void inputTask(void* parameter) {
+#ifdef LATENCY_TRACE
+    LatencyTrace::syncCore();
+#endif
+    for (;;) {
+        inputScheduler.runTick();
+    }
+}
+
+void pollInputs() {
     // Update control inputs (keyboard commands, joystick data, etc.)
-    tankControl->update();
+    // and hand the values to the actuation side in one piece
+    inputState.store(controlLoop.poll());
 
-    // If there's no device connected, skip printing
-    if (!tankControl->isConnected()) {
-        delay(100);
+    uint32_t fresh = controlLoop.controller().freshCount();
+    if (fresh != fedInputs) {
+        fedInputs = fresh;
+        failsafe.feed(micros());
+    }
+}
+
+void mixOutputs() {
+    ControlState state;
+    inputState.load(state);
+
+    // Nothing changed since the last mix
+    if (state.sequence == outputs.sequence) {
         return;
     }
+    TRACE_POINT(POINT_MIX, state.sequence);
 
-    // Get control values
-    int leftSpeed   = tankControl->getLeftTrackSpeed();
-    int rightSpeed  = tankControl->getRightTrackSpeed();
-    int turretRot   = tankControl->getTurretRotation();
-    int turretElev  = tankControl->getTurretElevation();
-    bool flamethrower = tankControl->isFlamethrowerActive();
-    int gear        = tankControl->getCurrentGear();
-
-    // -------------------------------
-    // SMART RELAY CONTROL
-    //
-    // If speed is non-zero, turn relay ON (HIGH).
-    // If speed is zero, turn relay OFF (LOW).
-    // You can extend or refine this logic if you want
-    // to differentiate between forward/reverse, etc.
-    // -------------------------------
-    if (leftSpeed > 0) {
-      digitalWrite(LEFT_RELAY_PIN, HIGH);
-    } else {
-      digitalWrite(LEFT_RELAY_PIN, LOW);
+    // If there's no device connected, keep the last outputs
+    outputs.sequence = state.sequence;
+    outputs.connected = state.connected;
+    if (!state.connected) {
+        return;
+    }
+    outputs = state;
+}
+
+void actuateOutputs() {
+    // Without a connection, or without fresh input for the deadline,
+    // everything is stopped
+    bool live = !failsafe.check(micros()) && outputs.connected;
+    if (failsafe.tripped() != failsafeTripped) {
+        failsafeTripped = failsafe.tripped();
+        if (failsafeTripped) {
+            FailsafeMonitor::Stats stats;
+            failsafe.stats(stats);
+            LOG_WARN("Failsafe: no input for %lu us, outputs stopped", (unsigned long)stats.lastDetectionUs);
+        } else {
+            LOG_INFO("Failsafe: input back");
+        }
     }
 
-    if (rightSpeed > 0) {
-      digitalWrite(RIGHT_RELAY_PIN, HIGH);
+    if (live) {
+#ifdef TRACK_SPEED_CONTROL
+        // The mixer output is the speed setpoint; the PID steps at the
+        // actuation rate and sets the motor outputs
+        if (speedControlActive) {
+            leftMotor.setTarget(leftSpeedControl.update(outputs.leftTrackSpeed, leftEncoder.count()));
+            rightMotor.setTarget(rightSpeedControl.update(outputs.rightTrackSpeed, rightEncoder.count()));
+        } else
+#endif
+        {
+            leftMotor.setTarget(outputs.leftTrackSpeed);
+            rightMotor.setTarget(outputs.rightTrackSpeed);
+        }
     } else {
-      digitalWrite(RIGHT_RELAY_PIN, LOW);
+        // Coast right away; the ramp starts from standstill once input
+        // is back
+        leftMotor.stop();
+        rightMotor.stop();
+#ifdef TRACK_SPEED_CONTROL
+        if (speedControlActive) {
+            leftSpeedControl.reset(leftEncoder.count());
+            rightSpeedControl.reset(rightEncoder.count());
+        }
+#endif
+    }
+
+    // One ramp step per actuation tick
+    leftMotor.update();
+    rightMotor.update();
+
+    // Turret rates become position targets; when stopped the turret
+    // comes to a stop instead of running on to its limits
+    turretRotation.setRate(live ? outputs.turretRotation : 0);
+    turretElevation.setRate(live ? outputs.turretElevation : 0);
+    rotationServo.write(turretRotation.update());
+    elevationServo.write(turretElevation.update());
+
+    // Control your other tank hardware through the actuators as well,
+    // so it switches in the same commit
+    // actuators.setDigital(FLAMETHROWER_PIN, live && outputs.flamethrowerActive);
+
+    actuators.commit();
+
+#ifdef LATENCY_TRACE
+    if (outputs.sequence != tracedSequence) {
+        tracedSequence = outputs.sequence;
+        TRACE_POINT(POINT_COMMIT, outputs.sequence);
+    }
+#endif
+
+#ifdef TELEMETRY_BINARY
+    reportActuation(live);
+#endif
+}
+
+#ifdef TELEMETRY_BINARY
+void reportActuation(bool live) {
+    Telemetry::Sample& report = actuationReport.beginWrite();
+    report.flags = (outputs.connected ? Telemetry::FLAG_CONNECTED : 0) |
+                   (live && outputs.flamethrowerActive ? Telemetry::FLAG_FIRING : 0) |
+                   (failsafeTripped ? Telemetry::FLAG_FAILSAFE : 0);
+    report.gear = outputs.currentGear;
+    report.leftTrackCommand = outputs.leftTrackSpeed;
+    report.rightTrackCommand = outputs.rightTrackSpeed;
+    report.leftTrackOutput = (int8_t)lroundf(leftMotor.speed());
+    report.rightTrackOutput = (int8_t)lroundf(rightMotor.speed());
+    report.leftTrackMeasured = 0;
+    report.rightTrackMeasured = 0;
+#ifdef TRACK_SPEED_CONTROL
+    if (speedControlActive) {
+        report.flags |= Telemetry::FLAG_CLOSED_LOOP;
+        report.leftTrackMeasured = (int8_t)constrain(leftSpeedControl.measuredPercent(), -128, 127);
+        report.rightTrackMeasured = (int8_t)constrain(rightSpeedControl.measuredPercent(), -128, 127);
+    }
+#endif
+    report.turretRotationRate = live ? outputs.turretRotation : 0;
+    report.turretElevationRate = live ? outputs.turretElevation : 0;
+    report.turretRotation = (int16_t)turretRotation.position();
+    report.turretElevation = (int16_t)turretElevation.position();
+    report.controlSequence = (uint16_t)outputs.sequence;
+    actuationReport.endWrite();
+}
+#endif
+
+size_t writeLog(const uint8_t* data, size_t length) {
+    // Whole lines only, once they fit in the UART buffer; the log keeps
+    // the line until then. Part of a line would let a binary frame from
+    // the telemetry stage land in the middle of it. A line is at most
+    // Log::maxLineLength bytes, which the empty TX FIFO takes.
+    if (Serial.availableForWrite() < (int)length) {
+        return 0;
+    }
+    return Serial.write(data, length);
+}
+
+#ifndef CONTROL_MODE_SERIAL
+// Other backends leave the serial input alone; take the "stats" query
+// from it here
+void pollStatsQuery() {
+    static char line[16];
+    static size_t length = 0;
+    int byte;
+    while ((byte = Serial.read()) >= 0) {
+        if (byte == '\n' || byte == '\r') {
+            const SerialCommands::Command* command = SerialCommands::lookup(line, length);
+            if (command && command->action == SerialCommands::ACTION_STATS) {
+                Profiler::requestReport();
+            }
+            length = 0;
+        } else if (length < sizeof(line)) {
+            line[length++] = (char)byte;
+        }
+    }
+}
+#endif
+
+void printSchedulerStats(const char* label, const ControlScheduler& scheduler) {
+    if (scheduler.stageCount() == 0) {
+        return;
+    }
+    LOG_INFO("------ %s Scheduler ------", label);
+    for (uint8_t i = 0; i < scheduler.stageCount(); i++) {
+        const ControlScheduler::StageStats& stats = scheduler.stats(i);
+        LOG_INFO("%-9s %3lu Hz  misses %lu  jitter avg %lu us max %lu us  run avg %lu us max %lu us",
+                 scheduler.stageName(i), (unsigned long)scheduler.stageRateHz(i),
+                 (unsigned long)stats.deadlineMisses,
+                 (unsigned long)(stats.runs ? stats.totalJitterUs / stats.runs : 0),
+                 (unsigned long)stats.maxJitterUs,
+                 (unsigned long)(stats.runs ? stats.totalRunUs / stats.runs : 0),
+                 (unsigned long)stats.maxRunUs);
+    }
+    LOG_INFO("Skipped ticks: %lu", (unsigned long)scheduler.skippedTicks());
+}
+
+void printFailsafeStats() {
+    FailsafeMonitor::Stats stats;
+    failsafe.stats(stats);
+    LOG_INFO("Failsafe: deadline %lu ms  trips %lu  detection last %lu us avg %lu us max %lu us  longest outage %lu ms",
+             (unsigned long)(failsafe.deadline() / 1000), (unsigned long)stats.trips,
+             (unsigned long)stats.lastDetectionUs,
+             (unsigned long)(stats.trips ? stats.totalDetectionUs / stats.trips : 0),
+             (unsigned long)stats.maxDetectionUs, (unsigned long)stats.longestOutageMs);
+}
+
+uint32_t countDeadlineMisses(const ControlScheduler& scheduler) {
+    uint32_t misses = 0;
+    for (uint8_t i = 0; i < scheduler.stageCount(); i++) {
+        misses += scheduler.stats(i).deadlineMisses;
+    }
+    return misses;
+}
+
+void sendTelemetry() {
+    PROFILE_SECTION(SECTION_TELEMETRY);
+
+    if (!logTaskRunning) {
+        Log::drain();
+    }
+#ifdef INPUT_RECORDING
+    if (!recordTaskRunning) {
+        InputRecorder::flush();
+    }
+#endif
+
+#ifndef CONTROL_MODE_SERIAL
+    pollStatsQuery();
+#endif
+
+    // Report scheduler deadline misses as they happen, the stage run
+    // times now and then, and everything on a "stats" query
+    uint32_t misses = countDeadlineMisses(inputScheduler) + countDeadlineMisses(controlScheduler);
+    unsigned long now = millis();
+    Profiler::update(now);
+    bool queried = Profiler::takeReportRequest();
+    bool reportDue = STATS_REPORT_MS > 0 && now - lastStatsReport >= STATS_REPORT_MS;
+    if (misses != reportedMisses || reportDue || queried) {
+        reportedMisses = misses;
+        lastStatsReport = now;
+        printSchedulerStats("Input", inputScheduler);
+        printSchedulerStats("Control", controlScheduler);
+    }
+    if (queried) {
+        Profiler::report();
+        printFailsafeStats();
     }
 
+#ifdef TELEMETRY_BINARY
+    // Binary frame with the values that changed since the last one.
+    // Skipped while the UART buffer is full; the changes then go out
+    // with the next frame.
+    uint8_t frame[Telemetry::maxPayload + ControlFrame::overhead];
+    if (Serial.availableForWrite() >= (int)sizeof(frame)) {
+        Telemetry::Sample sample;
+        actuationReport.load(sample);
+        sample.deadlineMisses = (uint16_t)misses;
+        size_t length = telemetryEncoder.encode(sample, now, frame, sizeof(frame));
+        if (length > 0) {
+            Serial.write(frame, length);
+        }
+    }
+#endif
+
+#ifdef LATENCY_TRACE
+    // Trace events, as many frames as the UART buffer takes
+    uint8_t traceFrame[LatencyTrace::maxPayload + ControlFrame::overhead];
+    while (Serial.availableForWrite() >= (int)sizeof(traceFrame)) {
+        size_t length = LatencyTrace::encodeFrame(traceFrame, sizeof(traceFrame));
+        if (length == 0) {
+            break;
+        }
+        Serial.write(traceFrame, length);
+    }
+#endif
+
+#ifdef TELEMETRY_TEXT
+    // Print what the input stage last handed to the actuation side
+    ControlState state;
+    inputState.load(state);
+
+    // If there's no device connected, skip printing
+    if (!state.connected) {
+        return;
+    }
+
+    int leftSpeed     = state.leftTrackSpeed;
+    int rightSpeed    = state.rightTrackSpeed;
+    int turretRot     = state.turretRotation;
+    int turretElev    = state.turretElevation;
+    bool flamethrower = state.flamethrowerActive;
+    int gear          = state.currentGear;
+
     bool noMovement = (leftSpeed == 0 && rightSpeed == 0);
-    bool noTurret   = (tankControl->getTurretRotation() == 0 && tankControl->getTurretElevation() == 0);
-    bool noFlame    = !tankControl->isFlamethrowerActive();
+    bool noTurret   = (turretRot == 0 && turretElev == 0);
+    bool noFlame    = !flamethrower;
 
     if (noMovement && noTurret && noFlame) {
         // No reason to print anything
-        delay(100);
         return;
     }
 
-    // Control your other tank hardware (motors, servos, etc.)
-    // setMotorSpeed(leftMotorPin, leftSpeed);
-    // setMotorSpeed(rightMotorPin, rightSpeed);
-    // setServoPosition(turretRotationServoPin, turretRot);
-    // setServoPosition(turretElevationServoPin, turretElev);
-    // controlFlamethrower(flamethrower);
-
     // For testing/logging purposes, print the values
-    Serial.println("------ Tank Control Status ------");
-    Serial.printf("Gear: %d\n", gear);
-    Serial.printf("Left Track Speed: %d\n", leftSpeed);
-    Serial.printf("Right Track Speed: %d\n", rightSpeed);
-    Serial.printf("Turret Rotation: %d\n", turretRot);
-    Serial.printf("Turret Elevation: %d\n", turretElev);
-    Serial.printf("Flamethrower Active: %s\n", flamethrower ? "Yes" : "No");
-    Serial.println("---------------------------------");
-
-    // Delay to prevent flooding the serial output
-    delay(100);
+    LOG_INFO("------ Tank Control Status ------");
+    LOG_INFO("Gear: %d", gear);
+    LOG_INFO("Left Track Speed: %d", leftSpeed);
+    LOG_INFO("Right Track Speed: %d", rightSpeed);
+#ifdef TRACK_SPEED_CONTROL
+    if (speedControlActive) {
+        LOG_INFO("Measured Track Speed: %d / %d",
+                 leftSpeedControl.measuredPercent(), rightSpeedControl.measuredPercent());
+    }
+#endif
+    LOG_INFO("Turret Rotation: %d", turretRot);
+    LOG_INFO("Turret Elevation: %d", turretElev);
+    LOG_INFO("Flamethrower Active: %s", flamethrower ? "Yes" : "No");
+    LOG_INFO("---------------------------------");
+#endif
 }
@@ -0,0 +1,52 @@
+#include "PwmCapture.h"
+
+PwmCapture::PwmCapture() {
+    for (uint8_t i = 0; i < maxChannels; i++) {
+        riseUs[i] = 0;
+        riseSeen[i] = false;
+    }
+
+    PwmSnapshot empty;
+    for (uint8_t i = 0; i < maxChannels; i++) {
+        empty.widthUs[i] = 0;
+        empty.updatedUs[i] = 0;
+    }
+    snapshot.store(empty);
+}
+
+void IRAM_ATTR PwmCapture::onEdge(uint8_t channel, bool level, uint32_t timestampUs) {
+    if (channel >= maxChannels) {
+        return;
+    }
+
+    if (level) {
+        riseUs[channel] = timestampUs;
+        riseSeen[channel] = true;
+        return;
+    }
+
+    // Falling edge without a rising edge (e.g. right after attaching)
+    if (!riseSeen[channel]) {
+        return;
+    }
+    riseSeen[channel] = false;
+
+    uint32_t width = timestampUs - riseUs[channel];
+    if (width < minPulseUs || width > maxPulseUs) {
+        return;
+    }
+
+    PwmSnapshot& latest = snapshot.beginWrite();
+    latest.widthUs[channel] = (uint16_t)width;
+    latest.updatedUs[channel] = timestampUs;
+    snapshot.endWrite();
+}
+
+void PwmCapture::read(PwmSnapshot& out) const {
+    snapshot.load(out);
+}
+
+uint32_t PwmCapture::pulseCount() const {
+    // The constructor's initial store counts as one write
+    return snapshot.writeCount() - 1;
+}
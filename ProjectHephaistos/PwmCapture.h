@@ -0,0 +1,51 @@
+#ifndef PWM_CAPTURE_H
+#define PWM_CAPTURE_H
+
+#include <stdint.h>
+#include "SeqLock.h"
+
+#if defined(ESP32)
+#include <esp_attr.h>
+#endif
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+// Latest pulse widths of all captured channels
+struct PwmSnapshot {
+    static const uint8_t maxChannels = 8;
+
+    uint16_t widthUs[maxChannels];    // 0 until the first full pulse
+    uint32_t updatedUs[maxChannels];  // time of the falling edge that produced widthUs
+};
+
+// Edge-driven RC PWM capture.
+//
+// onEdge() is fed from a pin-change interrupt (or a simulated edge source on
+// the host) with the new pin level and a microsecond timestamp. Every falling
+// edge publishes the measured pulse width; read() hands out the latest widths
+// of all channels at once without blocking.
+class PwmCapture {
+public:
+    static const uint8_t maxChannels = PwmSnapshot::maxChannels;
+
+    // Pulses outside this window are glitches and are ignored
+    static const uint16_t minPulseUs = 500;
+    static const uint16_t maxPulseUs = 2600;
+
+    PwmCapture();
+
+    void onEdge(uint8_t channel, bool level, uint32_t timestampUs);
+
+    void read(PwmSnapshot& out) const;
+
+    // Number of pulses published so far, across all channels
+    uint32_t pulseCount() const;
+
+private:
+    uint32_t riseUs[maxChannels];
+    bool riseSeen[maxChannels];
+    SeqLock<PwmSnapshot> snapshot;
+};
+
+#endif // PWM_CAPTURE_H
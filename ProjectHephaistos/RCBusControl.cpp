@@ -0,0 +1,187 @@
+#include "ControlConfig.h"
+#ifdef CONTROL_MODE_RC_BUS
+
+#include "RCBusControl.h"
+#include "TankMixer.h"
+#include "Log.h"
+#include "Profiler.h"
+#ifdef INPUT_RECORDING
+#include "InputRecorder.h"
+#endif
+
+// Static members must be defined outside the class
+RCBusControl* RCBusControl::instance = nullptr;
+
+#ifdef INPUT_RECORDING
+// Failsafe flag, then the channel widths
+static void recordFrame(const RcFrame& frame) {
+    int16_t values[1 + RcFrame::maxChannels];
+    uint8_t count = frame.channelCount < RcFrame::maxChannels ? frame.channelCount : RcFrame::maxChannels;
+    values[0] = frame.failsafe;
+    for (uint8_t ch = 0; ch < count; ch++) {
+        values[1 + ch] = (int16_t)frame.channelUs[ch];
+    }
+    InputRecorder::record(InputRecord::TYPE_RC_FRAME, values, 1 + count);
+}
+#endif
+
+RCBusControl::RCBusControl(Protocol protocol, int rxPin)
+    : protocol(protocol),
+      rxPin(rxPin),
+      rxSerial(Serial2),
+      ppmFramesSeen(0),
+      lastFrameTime(0),
+      frameSeen(false),
+      failsafe(false),
+      received(getState())
+{
+    instance = this;
+
+    switch (protocol) {
+    case PROTOCOL_SBUS:
+        // SBUS is inverted 100000 baud 8E2
+        rxSerial.setRxBufferSize(rxBufferSize);
+        rxSerial.begin(100000, SERIAL_8E2, rxPin, -1, true);
+        LOG_INFO("RCBusControl Initialized. Reading SBUS...");
+        break;
+    case PROTOCOL_IBUS:
+        rxSerial.setRxBufferSize(rxBufferSize);
+        rxSerial.begin(115200, SERIAL_8N1, rxPin, -1);
+        LOG_INFO("RCBusControl Initialized. Reading iBUS...");
+        break;
+    case PROTOCOL_PPM:
+        pinMode(rxPin, INPUT);
+        attachInterrupt(digitalPinToInterrupt(rxPin), &RCBusControl::onPpmEdge, RISING);
+        LOG_INFO("RCBusControl Initialized. Reading PPM...");
+        break;
+    }
+}
+
+RCBusControl::~RCBusControl() {
+    if (protocol == PROTOCOL_PPM) {
+        detachInterrupt(digitalPinToInterrupt(rxPin));
+    } else {
+        rxSerial.end();
+    }
+    instance = nullptr;
+}
+
+void IRAM_ATTR RCBusControl::onPpmEdge() {
+    if (instance && instance->ppm.onEdge(micros())) {
+        instance->ppmFrames.store(instance->ppm.frame());
+    }
+}
+
+void RCBusControl::update() {
+    unsigned long currentTime = millis();
+
+    if (protocol == PROTOCOL_PPM) {
+        uint32_t frames = ppmFrames.writeCount();
+        if (frames != ppmFramesSeen) {
+            ppmFramesSeen = frames;
+            RcFrame frame;
+            ppmFrames.load(frame);
+#ifdef INPUT_RECORDING
+            recordFrame(frame);
+#endif
+            if (applyFrame(frame)) {
+                markInput();
+            }
+            lastFrameTime = currentTime;
+            frameSeen = true;
+        }
+    } else {
+        // Drain whatever the UART driver collected, without waiting for more
+        PROFILE_SECTION(SECTION_PARSE);
+        uint8_t chunk[readChunk];
+        int available;
+        while ((available = rxSerial.available()) > 0) {
+            size_t count = rxSerial.read(chunk, (size_t)available < readChunk ? available : readChunk);
+            for (size_t i = 0; i < count; i++) {
+                bool complete = (protocol == PROTOCOL_SBUS) ? sbus.feed(chunk[i]) : ibus.feed(chunk[i]);
+                if (complete) {
+                    const RcFrame& frame = (protocol == PROTOCOL_SBUS) ? sbus.frame() : ibus.frame();
+#ifdef INPUT_RECORDING
+                    recordFrame(frame);
+#endif
+                    if (applyFrame(frame)) {
+                        markInput();
+                    }
+                    lastFrameTime = currentTime;
+                    frameSeen = true;
+                }
+            }
+        }
+    }
+
+    publishLink(currentTime);
+}
+
+void RCBusControl::replaySample(const InputRecord::Sample& sample) {
+    if (sample.type != InputRecord::TYPE_RC_FRAME || sample.count < 1) {
+        return;
+    }
+    RcFrame frame = {};
+    frame.failsafe = sample.values[0] != 0;
+    frame.channelCount = sample.count - 1 < RcFrame::maxChannels ? sample.count - 1 : RcFrame::maxChannels;
+    for (uint8_t ch = 0; ch < frame.channelCount; ch++) {
+        frame.channelUs[ch] = (uint16_t)sample.values[1 + ch];
+    }
+    applyFrame(frame);
+    lastFrameTime = millis();
+    frameSeen = true;
+}
+
+void RCBusControl::replayPoll() {
+    publishLink(millis());
+}
+
+void RCBusControl::publishLink(unsigned long currentTime) {
+    // No frame for a while means the receiver (or its wiring) is gone
+    bool linkUp = frameSeen && (currentTime - lastFrameTime <= frameTimeoutMs);
+
+    ControlState next = received;
+    next.connected = linkUp && !failsafe;
+    if (!next.connected) {
+        next.leftTrackSpeed = 0;
+        next.rightTrackSpeed = 0;
+        next.turretRotation = 0;
+        next.turretElevation = 0;
+        next.flamethrowerActive = false;
+    }
+    publishState(next, currentTime);
+}
+
+const RcBusStats& RCBusControl::stats() const {
+    switch (protocol) {
+    case PROTOCOL_SBUS:
+        return sbus.stats();
+    case PROTOCOL_IBUS:
+        return ibus.stats();
+    default:
+        return ppm.stats();
+    }
+}
+
+bool RCBusControl::applyFrame(const RcFrame& frame) {
+    failsafe = frame.failsafe;
+    if (failsafe || frame.channelCount < requiredChannels) {
+        return false;
+    }
+
+    // Convert pulses to a -100..100 range or 1..5 for gear
+    MixerInput input;
+    input.drive           = map(frame.channelUs[throttleChannel], 1000, 2000, -100, 100);
+    input.turn            = map(frame.channelUs[steeringChannel], 1000, 2000, -100, 100);
+    input.gear            = constrain(map(frame.channelUs[gearChannel], 1000, 2000, 1, 5), 1, 5);
+    input.turretRotation  = map(frame.channelUs[turretRotationChannel], 1000, 2000, -100, 100);
+    input.turretElevation = map(frame.channelUs[turretElevationChannel], 1000, 2000, -100, 100);
+
+    // Flamethrower if e.g. > 1500 microseconds
+    input.fire = (frame.channelUs[fireChannel] > 1500);
+
+    TankMixer::mix(input, received);
+    return true;
+}
+
+#endif // CONTROL_MODE_RC_BUS
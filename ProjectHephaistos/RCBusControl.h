@@ -0,0 +1,82 @@
+#ifndef RC_BUS_CONTROL_H
+#define RC_BUS_CONTROL_H
+
+#include "TankControlInterface.h"
+#include "RcBusDecoder.h"
+#include "SeqLock.h"
+#include "InputRecord.h"
+#include <Arduino.h>
+
+// RC receiver on a single wire: SBUS or iBUS on a UART, or a PPM sum signal
+// on a pin interrupt. Uses the same channel order as RCControl.
+class RCBusControl final : public TankControlInterface {
+public:
+    enum Protocol {
+        PROTOCOL_SBUS,
+        PROTOCOL_IBUS,
+        PROTOCOL_PPM
+    };
+
+    RCBusControl(Protocol protocol, int rxPin);
+    ~RCBusControl();
+
+    void update() override;
+
+    // Decoder frame counters (decoded, rejected, lost, failsafe)
+    const RcBusStats& stats() const;
+
+    // Input from a recorded session (ReplayControl.h) instead of the
+    // receiver: replaySample() takes one sample, replayPoll() stands in
+    // for update()
+    void replaySample(const InputRecord::Sample& sample);
+    void replayPoll();
+
+private:
+    // Channel assignment, same as the PWM receiver in RCControl
+    enum Channel {
+        throttleChannel = 0,
+        steeringChannel,
+        gearChannel,
+        turretRotationChannel,
+        turretElevationChannel,
+        fireChannel,
+        requiredChannels
+    };
+
+    // No frame for this long means the receiver is gone
+    static const unsigned long frameTimeoutMs = 100;
+
+    // Bytes pulled from the UART driver per read() call
+    static const size_t readChunk = 64;
+
+    // The UART driver buffers this many received bytes between update() calls
+    static const size_t rxBufferSize = 512;
+
+    Protocol protocol;
+    int rxPin;
+    HardwareSerial& rxSerial;
+
+    SbusDecoder sbus;
+    IbusDecoder ibus;
+
+    // PPM frames are decoded in the pin interrupt and handed over here
+    PpmDecoder ppm;
+    SeqLock<RcFrame> ppmFrames;
+    uint32_t ppmFramesSeen;
+    static RCBusControl* instance;
+    static void onPpmEdge();
+
+    unsigned long lastFrameTime;
+    bool frameSeen;
+    bool failsafe;
+
+    // Values from the last good frame
+    ControlState received;
+
+    // Returns false for a frame that carries no input: failsafe flag set
+    // or too few channels
+    bool applyFrame(const RcFrame& frame);
+    void publishLink(unsigned long currentTime);
+};
+
+#endif // RC_BUS_CONTROL_H
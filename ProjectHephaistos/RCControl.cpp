@@ -1,13 +1,38 @@
+#include "ControlConfig.h"
+#ifdef CONTROL_MODE_RC
+
 #include "RCControl.h"
+#include "TankMixer.h"
+#include "Log.h"
+#include "Profiler.h"
+#ifdef INPUT_RECORDING
+#include "InputRecorder.h"
+#endif
+#include <string.h>
+
+// Static members must be defined outside the class
+PwmCapture RCControl::capture;
+
+const uint8_t RCControl::channelPins[RCControl::channelCount] = {
+    throttlePin,
+    steeringPin,
+    gearPin,
+    turretRotationPin,
+    turretElevationPin,
+    firePin
+};
 
 RCControl::RCControl()
-    : currentGear(1),
-      leftTrackSpeed(0),
-      rightTrackSpeed(0),
-      turretRotation(0),
-      turretElevation(0),
-      flamethrowerActive(false)
+    : lastPulseUs(0),
+      pulseSeen(false),
+      signalPresent(false),
+      currentGear(1),
+      replaySignal(false)
 {
+    memset(seenUpdatedUs, 0, sizeof(seenUpdatedUs));
+    memset(recordedWidths, 0, sizeof(recordedWidths));
+    memset(replayWidths, 0, sizeof(replayWidths));
+
     // Initialize pins
     pinMode(throttlePin, INPUT);
     pinMode(steeringPin, INPUT);
@@ -16,11 +41,27 @@ RCControl::RCControl()
     pinMode(turretElevationPin, INPUT);
     pinMode(firePin, INPUT);
 
-    Serial.println("RCControl Initialized. Reading RC signals...");
+    // Timestamp both edges of every channel in the background, so reading
+    // the inputs never waits for a pulse
+    for (uint8_t ch = 0; ch < channelCount; ch++) {
+        attachInterruptArg(digitalPinToInterrupt(channelPins[ch]),
+                           &RCControl::onChannelEdge,
+                           (void*)(uintptr_t)ch,
+                           CHANGE);
+    }
+
+    LOG_INFO("RCControl Initialized. Reading RC signals...");
 }
 
 RCControl::~RCControl() {
-    // Any cleanup if needed
+    for (uint8_t ch = 0; ch < channelCount; ch++) {
+        detachInterrupt(digitalPinToInterrupt(channelPins[ch]));
+    }
+}
+
+void IRAM_ATTR RCControl::onChannelEdge(void* arg) {
+    uint8_t ch = (uint8_t)(uintptr_t)arg;
+    capture.onEdge(ch, digitalRead(channelPins[ch]) == HIGH, micros());
 }
 
 void RCControl::update() {
@@ -28,66 +69,133 @@ void RCControl::update() {
     readRCInputs();
 }
 
-bool RCControl::isConnected() const {
-    return true;
-}
-
 void RCControl::readRCInputs() {
-    // Read pulse widths (in microseconds) from each channel
-    // e.g., typical RC range ~1000 - 2000 microseconds
-    unsigned long throttleVal       = pulseIn(throttlePin, HIGH, 25000);
-    unsigned long steeringVal       = pulseIn(steeringPin, HIGH, 25000);
-    unsigned long gearVal           = pulseIn(gearPin, HIGH, 25000);
-    unsigned long turretRotVal      = pulseIn(turretRotationPin, HIGH, 25000);
-    unsigned long turretElevVal     = pulseIn(turretElevationPin, HIGH, 25000);
-    unsigned long fireVal           = pulseIn(firePin, HIGH, 25000);
-
-    // Convert pulses to a -100..100 range or 1..5 for gear
-    int forwardBackward = map(throttleVal, 1000, 2000, -100, 100);
-    int turn            = map(steeringVal, 1000, 2000, -100, 100);
-
-    // Gear
-    int gearValue = map(gearVal, 1000, 2000, 1, 5);
-    gearValue = constrain(gearValue, 1, 5);
-    currentGear = gearValue;
+    PROFILE_SECTION(SECTION_RC_INPUT);
 
-    // Combine forward/back + turn for each track
-    float gearScaling = (float)currentGear / 5.0f;
-    leftTrackSpeed  = constrain((forwardBackward + turn) * gearScaling, -100, 100);
-    rightTrackSpeed = constrain((forwardBackward - turn) * gearScaling, -100, 100);
-
-    // Turret
-    turretRotation = map(turretRotVal, 1000, 2000, -100, 100);
-    turretElevation= map(turretElevVal, 1000, 2000, -100, 100);
-
-    // Flamethrower if e.g. > 1500 microseconds
-    flamethrowerActive = (fireVal > 1500);
-
-    // Debug (optional)
-    // Serial.printf("RC: throttle=%lu steer=%lu gear=%lu turretR=%lu turretE=%lu fire=%lu\n",
-    //              throttleVal, steeringVal, gearVal, turretRotVal, turretElevVal, fireVal);
+    // Latest pulse widths (in microseconds) from each channel
+    // e.g., typical RC range ~1000 - 2000 microseconds
+    PwmSnapshot pulses;
+    capture.read(pulses);
+
+    // The input arrived with the earliest pulse since the last read. A
+    // pulse is new if its edge time differs from the one read before on
+    // its channel, so one that ends while read() runs is not missed.
+    uint32_t nowUs = micros();
+    uint32_t ageUs = 0;
+    bool newPulse = false;
+    for (uint8_t ch = 0; ch < channelCount; ch++) {
+        if (validPulse(pulses.widthUs[ch]) && pulses.updatedUs[ch] != seenUpdatedUs[ch]) {
+            seenUpdatedUs[ch] = pulses.updatedUs[ch];
+            uint32_t age = nowUs - pulses.updatedUs[ch];
+            ageUs = newPulse && ageUs > age ? ageUs : age;
+            newPulse = true;
+        }
+    }
+    if (newPulse) {
+        markInput(ageUs);
+        lastPulseUs = nowUs - ageUs;
+        pulseSeen = true;
+    }
+
+    bool signal = pulseSeen && nowUs - lastPulseUs <= signalTimeoutUs;
+    if (signal != signalPresent) {
+        signalPresent = signal;
+        if (signal) {
+            LOG_INFO("RC signal acquired");
+        } else {
+            LOG_WARN("RC signal lost");
+        }
+#ifdef INPUT_RECORDING
+        const int16_t value = signal ? 1 : 0;
+        InputRecorder::record(InputRecord::TYPE_LINK, &value, 1);
+#endif
+    }
+
+#ifdef INPUT_RECORDING
+    // Only when a width changed; replay holds the last one like the capture
+    if (memcmp(recordedWidths, pulses.widthUs, sizeof(recordedWidths)) != 0) {
+        memcpy(recordedWidths, pulses.widthUs, sizeof(recordedWidths));
+        int16_t values[channelCount];
+        for (uint8_t ch = 0; ch < channelCount; ch++) {
+            values[ch] = (int16_t)pulses.widthUs[ch];
+        }
+        InputRecorder::record(InputRecord::TYPE_RC_PULSES, values, channelCount);
+    }
+#endif
+
+    applyPulses(pulses.widthUs, signalPresent);
 }
 
-int RCControl::getLeftTrackSpeed() const {
-    return leftTrackSpeed;
+void RCControl::replaySample(const InputRecord::Sample& sample) {
+    if (sample.type == InputRecord::TYPE_LINK && sample.count >= 1) {
+        replaySignal = sample.values[0] != 0;
+    } else if (sample.type == InputRecord::TYPE_RC_PULSES && sample.count >= channelCount) {
+        for (uint8_t ch = 0; ch < channelCount; ch++) {
+            replayWidths[ch] = (uint16_t)sample.values[ch];
+        }
+    }
 }
 
-int RCControl::getRightTrackSpeed() const {
-    return rightTrackSpeed;
+void RCControl::replayPoll() {
+    // Pulses are only recorded when a width changes
+    if (replaySignal) {
+        markFresh();
+    }
+    applyPulses(replayWidths, replaySignal);
 }
 
-int RCControl::getTurretRotation() const {
-    return turretRotation;
+bool RCControl::validPulse(uint16_t widthUs) {
+    return widthUs >= minValidPulseUs && widthUs <= maxValidPulseUs;
 }
 
-int RCControl::getTurretElevation() const {
-    return turretElevation;
+// -100..100, centred without a valid pulse
+int RCControl::stickPercent(uint16_t widthUs) {
+    if (!validPulse(widthUs)) {
+        return 0;
+    }
+    return constrain(map(widthUs, 1000, 2000, -100, 100), -100, 100);
 }
 
-bool RCControl::isFlamethrowerActive() const {
-    return flamethrowerActive;
-}
+void RCControl::applyPulses(const uint16_t* widthUs, bool signal) {
+    unsigned long throttleVal       = widthUs[throttleChannel];
+    unsigned long steeringVal       = widthUs[steeringChannel];
+    unsigned long gearVal           = widthUs[gearChannel];
+    unsigned long turretRotVal      = widthUs[turretRotationChannel];
+    unsigned long turretElevVal     = widthUs[turretElevationChannel];
+    unsigned long fireVal           = widthUs[fireChannel];
+
+    // Convert pulses to a -100..100 range or 1..5 for gear
+    if (validPulse(gearVal)) {
+        currentGear = constrain(map(gearVal, 1000, 2000, 1, 5), 1, 5);
+    }
+    MixerInput input;
+    input.drive           = stickPercent(throttleVal);
+    input.turn            = stickPercent(steeringVal);
+    input.gear            = currentGear;
+    input.turretRotation  = stickPercent(turretRotVal);
+    input.turretElevation = stickPercent(turretElevVal);
 
-int RCControl::getCurrentGear() const {
-    return currentGear;
+    // Flamethrower if e.g. > 1500 microseconds
+    input.fire = validPulse(fireVal) && fireVal > 1500;
+
+    // Without a signal, or without the drive channels, everything stops
+    bool connected = signal && validPulse(throttleVal) && validPulse(steeringVal);
+    if (!connected) {
+        input.drive = 0;
+        input.turn = 0;
+        input.turretRotation = 0;
+        input.turretElevation = 0;
+        input.fire = false;
+    }
+
+    ControlState next = getState();
+    next.connected = connected;
+    TankMixer::mix(input, next);
+    publishState(next, millis());
+
+    // Compiled in with LOG_LEVEL_DEBUG
+    LOG_DEBUG("RC: throttle=%lu steer=%lu gear=%lu turretR=%lu turretE=%lu fire=%lu",
+              throttleVal, steeringVal, gearVal, turretRotVal, turretElevVal, fireVal);
 }
+
+#endif // CONTROL_MODE_RC
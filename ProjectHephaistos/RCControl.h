@@ -2,26 +2,22 @@
 #define RC_CONTROL_H
 
 #include "TankControlInterface.h"
+#include "PwmCapture.h"
+#include "InputRecord.h"
 #include <Arduino.h>
 
-class RCControl : public TankControlInterface {
+class RCControl final : public TankControlInterface {
 public:
     RCControl();
     ~RCControl();
 
     void update() override;
 
-    bool isConnected() const override;
-
-    int getLeftTrackSpeed() const override;
-    int getRightTrackSpeed() const override;
-
-    int getTurretRotation() const override;
-    int getTurretElevation() const override;
-
-    bool isFlamethrowerActive() const override;
-
-    int getCurrentGear() const override;
+    // Input from a recorded session (ReplayControl.h) instead of the
+    // receiver: replaySample() takes one sample, replayPoll() stands in
+    // for update()
+    void replaySample(const InputRecord::Sample& sample);
+    void replayPoll();
 
 private:
     // Pins for RC receiver signals
@@ -32,16 +28,52 @@ private:
     static const int turretElevationPin= 6; // Turret up/down
     static const int firePin           = 7; // Flamethrower
 
-    // Control variables
-    int currentGear;
-    int leftTrackSpeed;
-    int rightTrackSpeed;
-    int turretRotation;
-    int turretElevation;
-    bool flamethrowerActive;
+    // Capture channel index of each signal
+    enum Channel {
+        throttleChannel = 0,
+        steeringChannel,
+        gearChannel,
+        turretRotationChannel,
+        turretElevationChannel,
+        fireChannel,
+        channelCount
+    };
+
+    static const uint8_t channelPins[channelCount];
+
+    // Widths outside this window mean no signal on the channel (0 before
+    // the first pulse), not a stick position
+    static const uint16_t minValidPulseUs = 800;
+    static const uint16_t maxValidPulseUs = 2200;
+
+    // No new pulse for this long means the receiver lost its signal (or
+    // was unplugged); the capture keeps the last widths meanwhile
+    static const uint32_t signalTimeoutUs = 100000;
+
+    // Pulse widths are measured in the pin-change interrupt
+    static PwmCapture capture;
+    static void onChannelEdge(void* arg);
+
+    // Falling edge of the last pulse read on each channel, to find the
+    // pulses that arrived since
+    uint32_t seenUpdatedUs[channelCount];
+    uint32_t lastPulseUs;
+    bool pulseSeen;
+    bool signalPresent;
+
+    // Kept while the gear channel has no valid pulse
+    uint8_t currentGear;
+
+    // Widths of the last recorded sample, and of the last replayed one
+    uint16_t recordedWidths[channelCount];
+    uint16_t replayWidths[channelCount];
+    bool replaySignal;
 
     // Internal reading method
     void readRCInputs();
+    void applyPulses(const uint16_t* widthUs, bool signal);
+    static bool validPulse(uint16_t widthUs);
+    static int stickPercent(uint16_t widthUs);
 };
 
 #endif // RC_CONTROL_H
@@ -0,0 +1,208 @@
+#include "RcBusDecoder.h"
+#include <string.h>
+
+#if defined(ESP32)
+#include <esp_attr.h>
+#endif
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+static void clearFrame(RcFrame& frame) {
+    memset(&frame, 0, sizeof(frame));
+}
+
+static void clearStats(RcBusStats& stats) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+// ----------------------
+// SBUS
+// ----------------------
+SbusDecoder::SbusDecoder() {
+    clearStats(counters);
+    reset();
+}
+
+void SbusDecoder::reset() {
+    length = 0;
+    clearFrame(current);
+}
+
+bool SbusDecoder::feed(uint8_t byte) {
+    // Hunt for the header byte
+    if (length == 0 && byte != headerByte) {
+        return false;
+    }
+
+    buffer[length++] = byte;
+    if (length < frameLength) {
+        return false;
+    }
+    length = 0;
+
+    if (decode()) {
+        return true;
+    }
+
+    // Lost sync: restart from the first header byte inside the bad frame
+    counters.framesRejected++;
+    for (uint8_t i = 1; i < frameLength; i++) {
+        if (buffer[i] == headerByte) {
+            length = frameLength - i;
+            memmove(buffer, buffer + i, length);
+            break;
+        }
+    }
+    return false;
+}
+
+bool SbusDecoder::decode() {
+    // Plain SBUS ends in 0x00, SBUS2 cycles the footer through 0x04..0x34
+    uint8_t footer = buffer[frameLength - 1];
+    if (footer != 0x00 && (footer & 0x0F) != 0x04) {
+        return false;
+    }
+
+    // 16 channels x 11 bits, LSB first, packed into bytes 1..22
+    const uint8_t* data = buffer + 1;
+    uint32_t bits = 0;
+    uint8_t bitCount = 0;
+    for (uint8_t ch = 0; ch < 16; ch++) {
+        while (bitCount < 11) {
+            bits |= (uint32_t)(*data++) << bitCount;
+            bitCount += 8;
+        }
+        uint16_t raw = bits & 0x07FF;
+        bits >>= 11;
+        bitCount -= 11;
+
+        // 172..1811 maps to 988..2012 us, 992 is centre (1500 us)
+        current.channelUs[ch] = (uint16_t)((raw * 5) / 8 + 880);
+    }
+    current.channelCount = 16;
+
+    uint8_t flags = buffer[23];
+    current.frameLost = (flags & 0x04) != 0;
+    current.failsafe  = (flags & 0x08) != 0;
+
+    counters.framesDecoded++;
+    if (current.frameLost) {
+        counters.framesLost++;
+    }
+    if (current.failsafe) {
+        counters.failsafeFrames++;
+    }
+    return true;
+}
+
+// ----------------------
+// iBUS
+// ----------------------
+IbusDecoder::IbusDecoder() {
+    clearStats(counters);
+    reset();
+}
+
+void IbusDecoder::reset() {
+    length = 0;
+    clearFrame(current);
+}
+
+bool IbusDecoder::feed(uint8_t byte) {
+    // Every servo frame starts with 0x20 0x40
+    if ((length == 0 && byte != lengthByte) || (length == 1 && byte != commandByte)) {
+        length = (byte == lengthByte) ? 1 : 0;
+        if (length == 1) {
+            buffer[0] = byte;
+        }
+        return false;
+    }
+
+    buffer[length++] = byte;
+    if (length < frameLength) {
+        return false;
+    }
+    length = 0;
+
+    if (decode()) {
+        return true;
+    }
+    counters.framesRejected++;
+    return false;
+}
+
+bool IbusDecoder::decode() {
+    uint16_t sum = 0xFFFF;
+    for (uint8_t i = 0; i < frameLength - 2; i++) {
+        sum -= buffer[i];
+    }
+    uint16_t checksum = buffer[frameLength - 2] | (buffer[frameLength - 1] << 8);
+    if (sum != checksum) {
+        return false;
+    }
+
+    for (uint8_t ch = 0; ch < 14; ch++) {
+        // The upper nibble carries sensor data on newer receivers
+        current.channelUs[ch] = (buffer[2 + ch * 2] | (buffer[3 + ch * 2] << 8)) & 0x0FFF;
+    }
+    current.channelCount = 14;
+
+    // iBUS has no flags: the receiver sends its configured failsafe values
+    // and simply stops sending when the link is gone
+    current.frameLost = false;
+    current.failsafe = false;
+
+    counters.framesDecoded++;
+    return true;
+}
+
+// ----------------------
+// PPM
+// ----------------------
+PpmDecoder::PpmDecoder() {
+    clearStats(counters);
+    reset();
+}
+
+void PpmDecoder::reset() {
+    lastEdgeUs = 0;
+    synced = false;
+    pendingCount = 0;
+    clearFrame(current);
+}
+
+bool IRAM_ATTR PpmDecoder::onEdge(uint32_t timestampUs) {
+    uint32_t interval = timestampUs - lastEdgeUs;
+    lastEdgeUs = timestampUs;
+
+    if (interval >= minSyncUs) {
+        // Sync gap: whatever was collected since the last gap is a frame
+        bool complete = synced && pendingCount >= minChannels;
+        if (complete) {
+            memcpy(current.channelUs, pending, pendingCount * sizeof(pending[0]));
+            current.channelCount = pendingCount;
+            counters.framesDecoded++;
+        } else if (synced) {
+            counters.framesRejected++;
+        }
+        synced = true;
+        pendingCount = 0;
+        return complete;
+    }
+
+    if (!synced) {
+        return false;
+    }
+
+    if (interval < minChannelUs || interval > maxChannelUs || pendingCount >= RcFrame::maxChannels) {
+        // Glitch or noise: drop the frame and wait for the next sync gap
+        counters.framesRejected++;
+        synced = false;
+        pendingCount = 0;
+        return false;
+    }
+
+    pending[pendingCount++] = (uint16_t)interval;
+    return false;
+}
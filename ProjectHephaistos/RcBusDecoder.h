@@ -0,0 +1,106 @@
+#ifndef RC_BUS_DECODER_H
+#define RC_BUS_DECODER_H
+
+#include <stdint.h>
+
+// One decoded receiver frame. Channel values are normalised to the usual
+// servo pulse width in microseconds (~1000..2000, 1500 = centre), whatever
+// the wire format was.
+struct RcFrame {
+    static const uint8_t maxChannels = 16;
+
+    uint16_t channelUs[maxChannels];
+    uint8_t channelCount;
+    bool frameLost;   // receiver reports it missed a frame from the transmitter
+    bool failsafe;    // receiver has lost the transmitter and is in failsafe
+};
+
+// Frame counters kept by every decoder
+struct RcBusStats {
+    uint32_t framesDecoded;
+    uint32_t framesRejected; // bad header/footer/checksum, or out-of-range timing
+    uint32_t framesLost;     // decoded frames with the frame-lost flag set
+    uint32_t failsafeFrames; // decoded frames with the failsafe flag set
+};
+
+// Futaba SBUS: 100000 baud 8E2 (inverted), 25-byte frames every 7 or 14 ms.
+// 16 proportional channels of 11 bits plus a flags byte.
+class SbusDecoder {
+public:
+    static const uint8_t frameLength = 25;
+
+    SbusDecoder();
+
+    // Feed one received byte. Returns true when it completed a valid frame.
+    bool feed(uint8_t byte);
+
+    const RcFrame& frame() const { return current; }
+    const RcBusStats& stats() const { return counters; }
+    void reset();
+
+private:
+    static const uint8_t headerByte = 0x0F;
+
+    uint8_t buffer[frameLength];
+    uint8_t length;
+    RcFrame current;
+    RcBusStats counters;
+
+    bool decode();
+};
+
+// FlySky iBUS: 115200 baud 8N1, 32-byte frames every 7 ms.
+// 14 channels as little-endian microseconds plus a 16-bit checksum.
+class IbusDecoder {
+public:
+    static const uint8_t frameLength = 32;
+
+    IbusDecoder();
+
+    bool feed(uint8_t byte);
+
+    const RcFrame& frame() const { return current; }
+    const RcBusStats& stats() const { return counters; }
+    void reset();
+
+private:
+    static const uint8_t lengthByte = 0x20;
+    static const uint8_t commandByte = 0x40;
+
+    uint8_t buffer[frameLength];
+    uint8_t length;
+    RcFrame current;
+    RcBusStats counters;
+
+    bool decode();
+};
+
+// PPM sum signal: one pulse train on a single wire, channel widths are the
+// intervals between consecutive rising edges, frames are separated by a
+// long sync gap. Fed from a pin interrupt with the time of each rising edge.
+class PpmDecoder {
+public:
+    PpmDecoder();
+
+    // Feed the time of one rising edge. Returns true when it completed a frame.
+    bool onEdge(uint32_t timestampUs);
+
+    const RcFrame& frame() const { return current; }
+    const RcBusStats& stats() const { return counters; }
+    void reset();
+
+private:
+    static const uint16_t minChannelUs = 700;
+    static const uint16_t maxChannelUs = 2300;
+    static const uint16_t minSyncUs = 3000;
+    static const uint8_t minChannels = 4;
+
+    uint32_t lastEdgeUs;
+    bool synced;
+    uint16_t pending[RcFrame::maxChannels];
+    uint8_t pendingCount;
+    RcFrame current;
+    RcBusStats counters;
+};
+
+#endif // RC_BUS_DECODER_H
@@ -0,0 +1,127 @@
+#ifndef REPLAY_CONTROL_H
+#define REPLAY_CONTROL_H
+
+#include "TankControlInterface.h"
+#include "InputRecorder.h"
+#include "Log.h"
+#include <Arduino.h>
+#include <utility>
+
+// Drives a backend with a recorded session (InputRecorder.h) instead of
+// its live input, with the original timing: each sample is handed to the
+// backend once as much time has passed since the first update() as had
+// passed when it was recorded. The backend then works out its state the
+// same way it did on the tank, so a session replays identically before
+// and after a change, on the tank or in the host build.
+//
+// Backend needs replaySample() and replayPoll(), which every backend
+// has. With LATENCY_TRACE the input time traced is when a sample was
+// due, so the trace shows the same path as with live input.
+template <typename Backend>
+class ReplayControl final : public TankControlInterface {
+public:
+    // Arguments are passed on to the backend's constructor
+    template <typename... Args>
+    explicit ReplayControl(Args&&... args)
+        : backend(std::forward<Args>(args)...),
+          started(false),
+          startUs(0),
+          pending(false),
+          exhausted(false),
+          ended(false),
+          lastSampleUs(0),
+          backendFresh(0)
+    {
+        // Only the replayed state is traced
+        backend.setTracing(false);
+    }
+
+    // Opens a recorded session; 0 = the latest one
+    bool open(const char* directory, uint16_t session = 0) {
+        if (!reader.open(directory, session)) {
+            LOG_ERROR("Replay: no session in %s", directory);
+            ended = true;
+            return false;
+        }
+        LOG_INFO("Replay: session %u from %s", (unsigned)reader.session(), directory);
+        return true;
+    }
+
+    void update() override {
+        unsigned long nowUs = micros();
+        if (!started) {
+            started = true;
+            startUs = nowUs;
+        }
+        uint32_t elapsedUs = (uint32_t)(nowUs - startUs);
+
+        // Hand over the samples that are due
+        while (!exhausted) {
+            if (!pending) {
+                if (!reader.next(sample)) {
+                    exhausted = true;
+                    break;
+                }
+                pending = true;
+            }
+            if ((int32_t)(sample.timeUs - elapsedUs) > 0) {
+                break;
+            }
+            markInput(elapsedUs - sample.timeUs);
+            backend.replaySample(sample);
+            lastSampleUs = sample.timeUs;
+            pending = false;
+        }
+
+        // Past the last sample the session is over, and the link with it
+        if (!ended && exhausted && (int32_t)(elapsedUs - lastSampleUs) > 0) {
+            ended = true;
+            LOG_INFO("Replay: session finished after %lu ms", (unsigned long)(lastSampleUs / 1000));
+        }
+
+        ControlState next;
+        if (ended) {
+            next = getState();
+            next.connected = false;
+            next.leftTrackSpeed = 0;
+            next.rightTrackSpeed = 0;
+            next.turretRotation = 0;
+            next.turretElevation = 0;
+            next.flamethrowerActive = false;
+        } else {
+            backend.replayPoll();
+            next = backend.getState();
+            // Live without a new sample, e.g. a connected keyboard
+            if (backend.freshCount() != backendFresh) {
+                backendFresh = backend.freshCount();
+                markFresh();
+            }
+        }
+        publishState(next, millis());
+    }
+
+    // True once the session has been played to its end
+    bool finished() const { return ended; }
+
+    Backend& controller() { return backend; }
+
+private:
+    Backend backend;
+    InputRecorder::SessionReader reader;
+
+    bool started;
+    unsigned long startUs;
+
+    // Next sample, read but not yet due
+    InputRecord::Sample sample;
+    bool pending;
+
+    bool exhausted;
+    bool ended;
+    uint32_t lastSampleUs;
+
+    // The backend's freshCount() as last passed on
+    uint32_t backendFresh;
+};
+
+#endif // REPLAY_CONTROL_H
@@ -0,0 +1,64 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Fixed-size FIFO, no heap. Capacity must be a power of two.
+//
+// Besides push()/pop() it exposes the contiguous free space, so a driver can
+// copy a block of received bytes straight into it (writeSpan/commitWrite).
+template <typename T, size_t Capacity>
+class RingBuffer {
+    static_assert((Capacity & (Capacity - 1)) == 0, "RingBuffer capacity must be a power of two");
+
+public:
+    RingBuffer() : head(0), tail(0) {}
+
+    size_t size() const { return head - tail; }
+    size_t space() const { return Capacity - size(); }
+    bool empty() const { return head == tail; }
+
+    bool push(const T& item) {
+        if (space() == 0) {
+            return false;
+        }
+        items[head & mask] = item;
+        head++;
+        return true;
+    }
+
+    bool pop(T& item) {
+        if (empty()) {
+            return false;
+        }
+        item = items[tail & mask];
+        tail++;
+        return true;
+    }
+
+    // Free space that can be written in one go (up to the wrap point)
+    T* writeSpan(size_t& length) {
+        size_t start = head & mask;
+        size_t untilWrap = Capacity - start;
+        length = space() < untilWrap ? space() : untilWrap;
+        return &items[start];
+    }
+
+    void commitWrite(size_t length) {
+        head += length;
+    }
+
+    void clear() {
+        head = tail = 0;
+    }
+
+private:
+    static const size_t mask = Capacity - 1;
+
+    T items[Capacity];
+    size_t head;
+    size_t tail;
+};
+
+#endif // RING_BUFFER_H
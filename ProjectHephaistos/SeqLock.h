@@ -0,0 +1,61 @@
+#ifndef SEQ_LOCK_H
+#define SEQ_LOCK_H
+
+#include <stdint.h>
+#include <atomic>
+
+// Single-writer sequence lock for small POD values.
+//
+// The writer never waits, so it is safe to call from an interrupt handler.
+// Readers copy the value and retry if a write happened in the meantime,
+// so they never see a half-updated ("torn") value.
+template <typename T>
+class SeqLock {
+public:
+    SeqLock() : sequence(0), value() {}
+
+    // Replace the whole value
+    void store(const T& next) {
+        T& slot = beginWrite();
+        slot = next;
+        endWrite();
+    }
+
+    // In-place update: beginWrite(), modify the returned value, endWrite()
+    T& beginWrite() {
+        uint32_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        return value;
+    }
+
+    void endWrite() {
+        uint32_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_release);
+    }
+
+    // Copy out a consistent value
+    void load(T& out) const {
+        uint32_t before, after;
+        do {
+            before = sequence.load(std::memory_order_acquire);
+            while (before & 1) {
+                before = sequence.load(std::memory_order_acquire);
+            }
+            out = value;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequence.load(std::memory_order_relaxed);
+        } while (before != after);
+    }
+
+    // Number of completed writes so far
+    uint32_t writeCount() const {
+        return sequence.load(std::memory_order_acquire) >> 1;
+    }
+
+private:
+    std::atomic<uint32_t> sequence;
+    T value;
+};
+
+#endif // SEQ_LOCK_H
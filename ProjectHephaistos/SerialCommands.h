@@ -0,0 +1,152 @@
+#ifndef SERIAL_COMMANDS_H
+#define SERIAL_COMMANDS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Text command table for SerialControl.
+//
+// A perfect hash over the command names is generated at compile time, so
+// lookup() costs one hash of the line plus one memcmp against the only
+// possible match, no matter how many commands exist or whether the line is
+// known at all. To add a command, add a row to `commands`; the hash seed
+// and slot table are recomputed by the compiler.
+namespace SerialCommands {
+
+// Bits of the key state kept by SerialControl
+enum InputBit : uint16_t {
+    INPUT_NONE           = 0,
+    INPUT_FORWARD        = 1 << 0,
+    INPUT_BACK           = 1 << 1,
+    INPUT_LEFT           = 1 << 2,
+    INPUT_RIGHT          = 1 << 3,
+    INPUT_TURRET_LEFT    = 1 << 4,
+    INPUT_TURRET_RIGHT   = 1 << 5,
+    INPUT_TURRET_ELEVATE = 1 << 6,
+    INPUT_TURRET_LOWER   = 1 << 7,
+    INPUT_FIRE           = 1 << 8
+};
+
+enum Action : uint8_t {
+    ACTION_PRESS,     // set `bit`
+    ACTION_RELEASE,   // clear `bit`
+    ACTION_GEAR_UP,
+    ACTION_GEAR_DOWN,
+    ACTION_STATS,     // log the profiler report
+    ACTION_PING       // nothing but fresh input: keeps the failsafe fed
+};
+
+struct Command {
+    const char* name;
+    Action action;
+    uint16_t bit;
+};
+
+constexpr Command commands[] = {
+    {"forward_press",          ACTION_PRESS,     INPUT_FORWARD},
+    {"forward_release",        ACTION_RELEASE,   INPUT_FORWARD},
+    {"back_press",             ACTION_PRESS,     INPUT_BACK},
+    {"back_release",           ACTION_RELEASE,   INPUT_BACK},
+    {"left_press",             ACTION_PRESS,     INPUT_LEFT},
+    {"left_release",           ACTION_RELEASE,   INPUT_LEFT},
+    {"right_press",            ACTION_PRESS,     INPUT_RIGHT},
+    {"right_release",          ACTION_RELEASE,   INPUT_RIGHT},
+    {"turret_left_press",      ACTION_PRESS,     INPUT_TURRET_LEFT},
+    {"turret_left_release",    ACTION_RELEASE,   INPUT_TURRET_LEFT},
+    {"turret_right_press",     ACTION_PRESS,     INPUT_TURRET_RIGHT},
+    {"turret_right_release",   ACTION_RELEASE,   INPUT_TURRET_RIGHT},
+    {"turret_elevate_press",   ACTION_PRESS,     INPUT_TURRET_ELEVATE},
+    {"turret_elevate_release", ACTION_RELEASE,   INPUT_TURRET_ELEVATE},
+    {"turret_lower_press",     ACTION_PRESS,     INPUT_TURRET_LOWER},
+    {"turret_lower_release",   ACTION_RELEASE,   INPUT_TURRET_LOWER},
+    {"fire_press",             ACTION_PRESS,     INPUT_FIRE},
+    {"fire_release",           ACTION_RELEASE,   INPUT_FIRE},
+    {"gear_up",                ACTION_GEAR_UP,   INPUT_NONE},
+    {"gear_down",              ACTION_GEAR_DOWN, INPUT_NONE},
+    {"stats",                  ACTION_STATS,     INPUT_NONE},
+    {"ping",                   ACTION_PING,      INPUT_NONE},
+};
+
+constexpr size_t commandCount = sizeof(commands) / sizeof(commands[0]);
+
+// ----------------------
+// Compile-time perfect hash
+// ----------------------
+constexpr size_t slotCount = 64; // power of two, > commandCount
+static_assert(commandCount < slotCount, "Grow slotCount to fit all commands");
+
+constexpr uint32_t hash(const char* text, size_t length, uint32_t seed) {
+    // FNV-1a with a seeded offset basis
+    uint32_t h = 2166136261u ^ seed;
+    for (size_t i = 0; i < length; i++) {
+        h = (h ^ (uint8_t)text[i]) * 16777619u;
+    }
+    return h ^ (h >> 15);
+}
+
+constexpr size_t nameLength(const char* name) {
+    size_t length = 0;
+    while (name[length] != '\0') {
+        length++;
+    }
+    return length;
+}
+
+constexpr bool seedIsPerfect(uint32_t seed) {
+    bool used[slotCount] = {};
+    for (size_t i = 0; i < commandCount; i++) {
+        size_t slot = hash(commands[i].name, nameLength(commands[i].name), seed) & (slotCount - 1);
+        if (used[slot]) {
+            return false;
+        }
+        used[slot] = true;
+    }
+    return true;
+}
+
+constexpr uint32_t findSeed() {
+    for (uint32_t seed = 0; seed < 100000; seed++) {
+        if (seedIsPerfect(seed)) {
+            return seed;
+        }
+    }
+    return UINT32_MAX;
+}
+
+constexpr uint32_t seed = findSeed();
+static_assert(seed != UINT32_MAX, "No perfect hash seed found, grow slotCount");
+
+struct SlotTable {
+    int8_t index[slotCount];
+    uint8_t length[commandCount];
+};
+
+constexpr SlotTable buildSlots() {
+    SlotTable table = {};
+    for (size_t slot = 0; slot < slotCount; slot++) {
+        table.index[slot] = -1;
+    }
+    for (size_t i = 0; i < commandCount; i++) {
+        size_t length = nameLength(commands[i].name);
+        table.index[hash(commands[i].name, length, seed) & (slotCount - 1)] = (int8_t)i;
+        table.length[i] = (uint8_t)length;
+    }
+    return table;
+}
+
+constexpr SlotTable slots = buildSlots();
+
+// Returns the command for the given bytes, or nullptr if it is unknown
+inline const Command* lookup(const char* text, size_t length) {
+    int8_t index = slots.index[hash(text, length, seed) & (slotCount - 1)];
+    if (index < 0 || slots.length[index] != length ||
+        memcmp(commands[index].name, text, length) != 0) {
+        return nullptr;
+    }
+    return &commands[index];
+}
+
+} // namespace SerialCommands
+
+#endif // SERIAL_COMMANDS_H
@@ -1,28 +1,35 @@
+#include "ControlConfig.h"
+#ifdef CONTROL_MODE_SERIAL
+
 #include "SerialControl.h"
+#include "TankMixer.h"
+#include "Log.h"
+#include "Profiler.h"
+#ifdef INPUT_RECORDING
+#include "InputRecorder.h"
+#endif
+#include <string.h>
 
-SerialControl::SerialControl()
+SerialControl::SerialControl(bool textCommands)
     : currentGear(1),
-      leftTrackSpeed(0),
-      rightTrackSpeed(0),
-      turretRotation(0),
-      turretElevation(0),
-      flamethrowerActive(false),
-      lastUpdateTime(0),
-      forwardPressed(false),
-      backPressed(false),
-      leftPressed(false),
-      rightPressed(false),
-      turretLeftPressed(false),
-      turretRightPressed(false),
-      turretElevatePressed(false),
-      turretLowerPressed(false),
-      firePressed(false) {
+      pressedInputs(0),
+      driveInput(0),
+      turnInput(0),
+      turretRotationInput(0),
+      turretElevationInput(0),
+      fireInput(false),
+      lastInputTime(0),
+      inputSeen(false),
+      linkUp(false),
+      textCommands(textCommands),
+      lineLength(0),
+      lineOverflow(false) {
     // Initialize Serial communication
     Serial.begin(115200);
     while (!Serial) {
         ; // Wait for Serial port to connect (needed for native USB)
     }
-    Serial.println("Serial Control Initialized.");
+    LOG_INFO("Serial Control Initialized.");
 }
 
 SerialControl::~SerialControl() {
@@ -33,146 +40,265 @@ void SerialControl::update() {
     // Read any available serial input
     processSerialInput();
 
-    // Limit update rate
-    unsigned long currentTime = millis();
-    if (currentTime - lastUpdateTime >= updateInterval) {
-        lastUpdateTime = currentTime;
-        updateControlVariables();
+    // The control loop scheduler sets the update rate
+    updateControlVariables();
+}
+
+void SerialControl::processSerialInput() {
+    PROFILE_SECTION(SECTION_PARSE);
+
+    // Copy whatever the UART driver has buffered, in blocks
+    int available;
+    while ((available = Serial.available()) > 0) {
+        size_t span;
+        uint8_t* dest = rxBuffer.writeSpan(span);
+        if (span == 0) {
+            break;
+        }
+        size_t count = Serial.read(dest, (size_t)available < span ? available : span);
+#ifdef INPUT_RECORDING
+        InputRecorder::recordBytes(dest, count);
+#endif
+        rxBuffer.commitWrite(count);
+    }
+
+    parseBuffered(true);
+}
+
+void SerialControl::replaySample(const InputRecord::Sample& sample) {
+    if (sample.type != InputRecord::TYPE_SERIAL) {
+        return;
+    }
+    // The buffer is empty between samples and one holds at most
+    // InputRecord::maxValues bytes, so they all fit
+    PROFILE_SECTION(SECTION_PARSE);
+    for (uint8_t i = 0; i < sample.count; i++) {
+        rxBuffer.push((uint8_t)sample.values[i]);
     }
+    // Pings were answered when recorded
+    parseBuffered(false);
 }
 
-bool SerialControl::isConnected() const {
-    return true;
+void SerialControl::replayPoll() {
+    updateControlVariables();
 }
 
-void SerialControl::processSerialInput() {
-    // Read lines from Serial
-    while (Serial.available()) {
-        String command = Serial.readStringUntil('\n');
-        command.trim();
-        if (command.length() == 0) {
+void SerialControl::parseBuffered(bool reply) {
+    uint8_t byte;
+    while (rxBuffer.pop(byte)) {
+        // Binary frames start with a non-ASCII sync byte
+        if (frameParser.inFrame() || byte == ControlFrame::syncByte) {
+            if (frameParser.feed(byte)) {
+                // Whatever came before the frame was no command
+                lineLength = 0;
+                lineOverflow = false;
+                processFrame(reply);
+            }
             continue;
         }
-        if (command == "forward_press") {
-            forwardPressed = true;
-        } else if (command == "forward_release") {
-            forwardPressed = false;
-        } else if (command == "back_press") {
-            backPressed = true;
-        } else if (command == "back_release") {
-            backPressed = false;
-        } else if (command == "left_press") {
-            leftPressed = true;
-        } else if (command == "left_release") {
-            leftPressed = false;
-        } else if (command == "right_press") {
-            rightPressed = true;
-        } else if (command == "right_release") {
-            rightPressed = false;
-        } else if (command == "turret_left_press") {
-            turretLeftPressed = true;
-        } else if (command == "turret_left_release") {
-            turretLeftPressed = false;
-        } else if (command == "turret_right_press") {
-            turretRightPressed = true;
-        } else if (command == "turret_right_release") {
-            turretRightPressed = false;
-        } else if (command == "turret_elevate_press") {
-            turretElevatePressed = true;
-        } else if (command == "turret_elevate_release") {
-            turretElevatePressed = false;
-        } else if (command == "turret_lower_press") {
-            turretLowerPressed = true;
-        } else if (command == "turret_lower_release") {
-            turretLowerPressed = false;
-        } else if (command == "fire_press") {
-            firePressed = true;
-        } else if (command == "fire_release") {
-            firePressed = false;
-        } else if (command == "gear_up") {
-            if (currentGear < 5) {
-                currentGear++;
-                Serial.printf("Gear shifted up to %d\n", currentGear);
-            }
-        } else if (command == "gear_down") {
-            if (currentGear > 1) {
-                currentGear--;
-                Serial.printf("Gear shifted down to %d\n", currentGear);
+
+        if (!textCommands) {
+            continue;
+        }
+
+        // Text commands: collect a line, drop it if it gets too long
+        if (byte == '\n' || byte == '\r') {
+            if (!lineOverflow) {
+                processCommand(lineBuffer, lineLength);
             }
+            lineLength = 0;
+            lineOverflow = false;
+        } else if (lineLength < maxLineLength) {
+            lineBuffer[lineLength++] = (char)byte;
         } else {
-            // Unknown command
-            Serial.print("Unknown command: ");
-            Serial.println(command);
+            lineOverflow = true;
         }
     }
 }
 
-void SerialControl::updateControlVariables() {
-    // Reset movement variables
-    int forwardBackward = 0;
-    int turn = 0;
+void SerialControl::processFrame(bool reply) {
+    if (frameParser.type() == ControlFrame::TYPE_PING &&
+        frameParser.length() == sizeof(ControlFrame::PingPayload)) {
+        if (reply) {
+            sendPong(micros());
+        }
+        return;
+    }
+    if (frameParser.type() != ControlFrame::TYPE_CONTROL_STATE ||
+        frameParser.length() != sizeof(ControlFrame::ControlStatePayload)) {
+        return;
+    }
 
-    // Movement control
-    if (forwardPressed) {
-        forwardBackward += 100;
+    acceptInput();
+    ControlFrame::ControlStatePayload frame;
+    memcpy(&frame, frameParser.payload(), sizeof(frame));
+
+    // A state frame replaces everything set by earlier text commands
+    pressedInputs = 0;
+
+    driveInput           = constrain(frame.drive, -100, 100);
+    turnInput            = constrain(frame.turn, -100, 100);
+    turretRotationInput  = constrain(frame.turretRotation, -100, 100);
+    turretElevationInput = constrain(frame.turretElevation, -100, 100);
+    fireInput            = (frame.buttons & ControlFrame::BUTTON_FIRE) != 0;
+
+    if (frame.gear != 0) {
+        int gear = constrain(frame.gear, 1, 5);
+        if (gear != currentGear) {
+            currentGear = gear;
+            LOG_INFO("Gear set to %d", currentGear);
+        }
+    }
+}
+
+void SerialControl::sendPong(uint32_t receivedUs) {
+    ControlFrame::PingPayload ping;
+    memcpy(&ping, frameParser.payload(), sizeof(ping));
+
+    ControlFrame::PongPayload pong;
+    pong.sequence = ping.sequence;
+    pong.hostTimeUs = ping.hostTimeUs;
+    pong.receivedUs = receivedUs;
+    pong.frames = frameParser.framesReceived();
+    pong.rejected = frameParser.framesRejected();
+    pong.backlog = (uint16_t)(rxBuffer.size() + Serial.available());
+
+    // Dropped rather than waited for if the UART buffer is full; the
+    // host counts it as lost
+    uint8_t frame[sizeof(pong) + ControlFrame::overhead];
+    if (Serial.availableForWrite() < (int)sizeof(frame)) {
+        return;
+    }
+    pong.sentUs = micros();
+    size_t length = ControlFrame::encode(ControlFrame::TYPE_PONG, &pong, sizeof(pong), frame, sizeof(frame));
+    Serial.write(frame, length);
+}
+
+// A whole state frame or command line: fresh input from the host
+void SerialControl::acceptInput() {
+    markInput();
+    lastInputTime = millis();
+    inputSeen = true;
+}
+
+void SerialControl::processCommand(const char* command, size_t length) {
+    // Trim surrounding whitespace
+    while (length > 0 && (*command == ' ' || *command == '\t')) {
+        command++;
+        length--;
+    }
+    while (length > 0 && (command[length - 1] == ' ' || command[length - 1] == '\t')) {
+        length--;
     }
-    if (backPressed) {
-        forwardBackward -= 100;
+    if (length == 0) {
+        // Blank lines are CR/LF noise as often as not: not input. A host
+        // with nothing to say sends "ping" to keep the link up.
+        return;
     }
-    if (leftPressed) {
-        turn -= 100;
+
+    const SerialCommands::Command* entry = SerialCommands::lookup(command, length);
+    if (!entry) {
+        LOG_WARN("Unknown command: %s", Log::Text(command, length));
+        return;
     }
-    if (rightPressed) {
-        turn += 100;
+    acceptInput();
+
+    switch (entry->action) {
+    case SerialCommands::ACTION_PRESS:
+        pressedInputs |= entry->bit;
+        break;
+    case SerialCommands::ACTION_RELEASE:
+        pressedInputs &= ~entry->bit;
+        break;
+    case SerialCommands::ACTION_GEAR_UP:
+        if (currentGear < 5) {
+            currentGear++;
+            LOG_INFO("Gear shifted up to %d", currentGear);
+        }
+        break;
+    case SerialCommands::ACTION_GEAR_DOWN:
+        if (currentGear > 1) {
+            currentGear--;
+            LOG_INFO("Gear shifted down to %d", currentGear);
+        }
+        break;
+    case SerialCommands::ACTION_STATS:
+        // Answered by the telemetry stage
+        Profiler::requestReport();
+        break;
+    case SerialCommands::ACTION_PING:
+        break;
     }
 
-    // Gear scaling
-    float gearScaling = (float)currentGear / 5;
+    applyPressedStates();
+}
 
-    leftTrackSpeed = constrain((forwardBackward + turn) * gearScaling, -100, 100);
-    rightTrackSpeed = constrain((forwardBackward - turn) * gearScaling, -100, 100);
+void SerialControl::applyPressedStates() {
+    using namespace SerialCommands;
+
+    // Movement control
+    driveInput = 0;
+    turnInput = 0;
+    if (pressedInputs & INPUT_FORWARD) {
+        driveInput += 100;
+    }
+    if (pressedInputs & INPUT_BACK) {
+        driveInput -= 100;
+    }
+    if (pressedInputs & INPUT_LEFT) {
+        turnInput -= 100;
+    }
+    if (pressedInputs & INPUT_RIGHT) {
+        turnInput += 100;
+    }
 
     // Turret control
-    if (turretLeftPressed) {
-        turretRotation = -100;
-    } else if (turretRightPressed) {
-        turretRotation = 100;
+    if (pressedInputs & INPUT_TURRET_LEFT) {
+        turretRotationInput = -100;
+    } else if (pressedInputs & INPUT_TURRET_RIGHT) {
+        turretRotationInput = 100;
     } else {
-        turretRotation = 0;
+        turretRotationInput = 0;
     }
 
-    if (turretElevatePressed) {
-        turretElevation = 100;
-    } else if (turretLowerPressed) {
-        turretElevation = -100;
+    if (pressedInputs & INPUT_TURRET_ELEVATE) {
+        turretElevationInput = 100;
+    } else if (pressedInputs & INPUT_TURRET_LOWER) {
+        turretElevationInput = -100;
     } else {
-        turretElevation = 0;
+        turretElevationInput = 0;
     }
 
-    // Flamethrower activation
-    flamethrowerActive = firePressed;
-}
-
-int SerialControl::getLeftTrackSpeed() const {
-    return leftTrackSpeed;
-}
-
-int SerialControl::getRightTrackSpeed() const {
-    return rightTrackSpeed;
+    fireInput = (pressedInputs & INPUT_FIRE) != 0;
 }
 
-int SerialControl::getTurretRotation() const {
-    return turretRotation;
-}
+void SerialControl::updateControlVariables() {
+    unsigned long currentTime = millis();
+    bool live = inputSeen && (currentTime - lastInputTime <= inputTimeoutMs);
+    if (live != linkUp) {
+        linkUp = live;
+        if (live) {
+            LOG_INFO("Serial host connected");
+        } else {
+            // A lost release must not leave a key held down
+            LOG_WARN("Serial host silent for %lu ms, releasing inputs", inputTimeoutMs);
+            pressedInputs = 0;
+            applyPressedStates();
+        }
+    }
 
-int SerialControl::getTurretElevation() const {
-    return turretElevation;
-}
+    MixerInput input;
+    input.drive           = driveInput;
+    input.turn            = turnInput;
+    input.turretRotation  = turretRotationInput;
+    input.turretElevation = turretElevationInput;
+    input.fire            = fireInput;
+    input.gear            = currentGear;
 
-bool SerialControl::isFlamethrowerActive() const {
-    return flamethrowerActive;
+    ControlState next = getState();
+    next.connected = linkUp;
+    TankMixer::mix(input, next);
+    publishState(next, currentTime);
 }
 
-int SerialControl::getCurrentGear() const {
-    return currentGear;
-}
+#endif // CONTROL_MODE_SERIAL
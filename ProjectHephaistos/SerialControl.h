@@ -2,53 +2,70 @@
 #define SERIAL_CONTROL_H
 
 #include "TankControlInterface.h"
+#include "ControlFrame.h"
+#include "SerialCommands.h"
+#include "RingBuffer.h"
+#include "InputRecord.h"
 #include <Arduino.h>
 
-class SerialControl : public TankControlInterface {
+// Control over the USB serial link. Accepts binary ControlFrame state frames
+// and, unless disabled, the line-based text commands sent by older host
+// scripts ("forward_press", "gear_up", ...). Pings are answered with a pong
+// right away, from the input stage.
+class SerialControl final : public TankControlInterface {
 public:
-    SerialControl();
+    SerialControl(bool textCommands = true);
     ~SerialControl();
 
     void update() override;
 
-    bool isConnected() const override;
+    // Input from a recorded session (ReplayControl.h) instead of the UART:
+    // replaySample() takes one sample, replayPoll() stands in for update()
+    void replaySample(const InputRecord::Sample& sample);
+    void replayPoll();
 
-    int getLeftTrackSpeed() const override;
-    int getRightTrackSpeed() const override;
+private:
+    // No state frame or known command line for this long means the host
+    // is gone (the host scripts resend the state while idle); held keys
+    // are released then. Noise, pings and broken frames don't count.
+    static const unsigned long inputTimeoutMs = 100;
 
-    int getTurretRotation() const override;
-    int getTurretElevation() const override;
+    // Selected gear (1..5)
+    int currentGear;
 
-    bool isFlamethrowerActive() const override;
+    // Keys held down via text commands (SerialCommands::InputBit)
+    uint16_t pressedInputs;
 
-    int getCurrentGear() const override;
+    // Stick and button input, from either protocol
+    int driveInput;
+    int turnInput;
+    int turretRotationInput;
+    int turretElevationInput;
+    bool fireInput;
 
-private:
-    // Control variables
-    int currentGear;
-    int leftTrackSpeed;
-    int rightTrackSpeed;
-    int turretRotation;
-    int turretElevation;
-    bool flamethrowerActive;
-
-    // Timing variables for smooth control
-    unsigned long lastUpdateTime;
-    const unsigned long updateInterval = 50; // in milliseconds
-
-    // State variables for controls
-    bool forwardPressed;
-    bool backPressed;
-    bool leftPressed;
-    bool rightPressed;
-    bool turretLeftPressed;
-    bool turretRightPressed;
-    bool turretElevatePressed;
-    bool turretLowerPressed;
-    bool firePressed;
+    // Link supervision
+    unsigned long lastInputTime;
+    bool inputSeen;
+    bool linkUp;
+
+    // Receive path: bytes are copied from the UART driver in blocks and
+    // parsed incrementally, so a partly received line or frame never blocks
+    static const size_t maxLineLength = 32;
+    bool textCommands;
+    RingBuffer<uint8_t, 256> rxBuffer;
+    ControlFrame::Parser frameParser;
+    char lineBuffer[maxLineLength];
+    size_t lineLength;
+    bool lineOverflow;
 
     // Methods
     void processSerialInput();
+    void parseBuffered(bool reply);
+    void processFrame(bool reply);
+    void sendPong(uint32_t receivedUs);
+    void acceptInput();
+    void processCommand(const char* command, size_t length);
+    void applyPressedStates();
     void updateControlVariables();
 };
 
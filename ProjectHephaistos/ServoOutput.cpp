@@ -0,0 +1,46 @@
+#include "ServoOutput.h"
+
+ServoOutput::ServoOutput(ActuatorBackend& actuators, uint8_t pin)
+    : actuators(actuators),
+      pin(pin),
+      frequencyHz(minFrequencyHz),
+      resolutionBits(14),
+      minPosition(-9000),
+      maxPosition(9000),
+      minPulseUs(1000),
+      maxPulseUs(2000),
+      lastPulseUs(0)
+{
+}
+
+bool ServoOutput::begin(uint32_t frequency, uint8_t resolution) {
+    frequencyHz = frequency < minFrequencyHz ? minFrequencyHz
+                : (frequency > maxFrequencyHz ? maxFrequencyHz : frequency);
+    resolutionBits = resolution;
+    // No pulses until the first write: the servo stays limp instead of
+    // jumping to an arbitrary position
+    return actuators.addPwmOutput(pin, frequencyHz, resolutionBits);
+}
+
+void ServoOutput::setRange(int32_t minPos, int32_t maxPos, uint16_t minPulse, uint16_t maxPulse) {
+    minPosition = minPos;
+    maxPosition = maxPos > minPos ? maxPos : minPos + 1;
+    minPulseUs = minPulse;
+    maxPulseUs = maxPulse;
+}
+
+void ServoOutput::write(int32_t position) {
+    if (position < minPosition) {
+        position = minPosition;
+    }
+    if (position > maxPosition) {
+        position = maxPosition;
+    }
+    int32_t span = maxPosition - minPosition;
+    int32_t pulse = minPulseUs + ((int32_t)maxPulseUs - minPulseUs) * (position - minPosition) / span;
+    lastPulseUs = (uint16_t)pulse;
+
+    // Pulse width as a fraction of the frame, in duty steps
+    uint32_t duty = (uint32_t)(((uint64_t)pulse * frequencyHz << resolutionBits) / 1000000);
+    actuators.setPwm(pin, duty);
+}
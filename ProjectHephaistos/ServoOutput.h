@@ -0,0 +1,44 @@
+#ifndef SERVO_OUTPUT_H
+#define SERVO_OUTPUT_H
+
+#include <stdint.h>
+#include "ActuatorBackend.h"
+
+// Hobby servo on a PWM output of the actuator backend. The LEDC timer
+// generates the pulses at the servo frame rate on its own; write() only
+// stages a new pulse width for the next commit(), so the frame rate
+// (50..333 Hz) is independent of how often the control loop runs.
+class ServoOutput {
+public:
+    static const uint32_t minFrequencyHz = 50;
+    static const uint32_t maxFrequencyHz = 333;
+
+    ServoOutput(ActuatorBackend& actuators, uint8_t pin);
+
+    // Servo frame rate, clamped to 50..333 Hz; 14 bits give ~1 us steps
+    // at 50 Hz
+    bool begin(uint32_t frequencyHz, uint8_t resolutionBits = 14);
+
+    // Maps positions (centidegrees) minPosition..maxPosition to pulse
+    // widths minPulseUs..maxPulseUs; swap the pulses to reverse the servo
+    void setRange(int32_t minPosition, int32_t maxPosition, uint16_t minPulseUs, uint16_t maxPulseUs);
+
+    // Positions outside the range are clamped to it
+    void write(int32_t position);
+
+    uint16_t pulseUs() const { return lastPulseUs; }
+
+private:
+    ActuatorBackend& actuators;
+    uint8_t pin;
+    uint32_t frequencyHz;
+    uint8_t resolutionBits;
+
+    int32_t minPosition;
+    int32_t maxPosition;
+    uint16_t minPulseUs;
+    uint16_t maxPulseUs;
+    uint16_t lastPulseUs;
+};
+
+#endif // SERVO_OUTPUT_H
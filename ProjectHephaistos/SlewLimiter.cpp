@@ -0,0 +1,68 @@
+#include "SlewLimiter.h"
+#include <math.h>
+
+SlewLimiter::SlewLimiter()
+    : maxStep(0),
+      maxStepChange(0),
+      current(0),
+      rate(0)
+{
+}
+
+void SlewLimiter::configure(float maxRate, float maxRateChange, uint32_t stepHz) {
+    if (stepHz == 0) {
+        stepHz = 1;
+    }
+    maxStep = maxRate > 0 ? maxRate / stepHz : 0;
+    maxStepChange = maxRateChange > 0 ? maxRateChange / ((float)stepHz * stepHz) : 0;
+}
+
+float SlewLimiter::step(float target) {
+    float error = target - current;
+    float distance = fabsf(error);
+
+    // Step we would like to take: straight to the target, but no faster
+    // than we can still brake from before reaching it
+    float desired = distance;
+    if (maxStepChange > 0) {
+        // Braking from a step of r covers about r^2 / 2j + r / 2
+        float j = maxStepChange;
+        float brake = sqrtf(2.0f * j * distance + 0.25f * j * j) - 0.5f * j;
+        if (brake < desired) {
+            desired = brake;
+        }
+    }
+    if (maxStep > 0 && desired > maxStep) {
+        desired = maxStep;
+    }
+    if (error < 0) {
+        desired = -desired;
+    }
+
+    // Change the step itself by at most the jerk limit
+    if (maxStepChange > 0) {
+        float change = desired - rate;
+        if (change > maxStepChange) {
+            change = maxStepChange;
+        } else if (change < -maxStepChange) {
+            change = -maxStepChange;
+        }
+        rate += change;
+    } else {
+        rate = desired;
+    }
+
+    current += rate;
+
+    // Landed on or past the target: settle there
+    if ((error >= 0 && current >= target) || (error <= 0 && current <= target)) {
+        current = target;
+        rate = 0;
+    }
+    return current;
+}
+
+void SlewLimiter::reset(float value) {
+    current = value;
+    rate = 0;
+}
@@ -0,0 +1,34 @@
+#ifndef SLEW_LIMITER_H
+#define SLEW_LIMITER_H
+
+#include <stdint.h>
+
+// Ramps a value towards a target with limited rate of change
+// (acceleration, for a speed) and limited change of that rate (jerk).
+//
+// Call step() at a fixed rate. With a jerk limit the ramp also eases in
+// towards the target, braking early enough not to overshoot it.
+class SlewLimiter {
+public:
+    SlewLimiter();
+
+    // maxRate in units per second, maxRateChange in units per second^2,
+    // for steps stepHz times a second; 0 disables that limit
+    void configure(float maxRate, float maxRateChange, uint32_t stepHz);
+
+    // Advances one step and returns the new value
+    float step(float target);
+
+    float value() const { return current; }
+
+    // Jumps to value and stops ramping
+    void reset(float value = 0);
+
+private:
+    float maxStep;        // max change of the value per step
+    float maxStepChange;  // max change of that per step
+    float current;
+    float rate;           // change applied in the last step
+};
+
+#endif // SLEW_LIMITER_H
@@ -0,0 +1,65 @@
+#include "TankControlInterface.h"
+#include "LatencyTrace.h"
+
+TankControlInterface::TankControlInterface() {
+    state.sequence = 0;
+    state.timestampMs = 0;
+    state.version = CONTROL_STATE_VERSION;
+    state.connected = false;
+    state.leftTrackSpeed = 0;
+    state.rightTrackSpeed = 0;
+    state.turretRotation = 0;
+    state.turretElevation = 0;
+    state.flamethrowerActive = false;
+    state.currentGear = 1;
+    inputTicks = 0;
+    freshInputs = 0;
+    inputMarked = false;
+    tracing = true;
+}
+
+void TankControlInterface::publishState(const ControlState& next, uint32_t nowMs) {
+    bool changed = next.connected != state.connected ||
+                   next.leftTrackSpeed != state.leftTrackSpeed ||
+                   next.rightTrackSpeed != state.rightTrackSpeed ||
+                   next.turretRotation != state.turretRotation ||
+                   next.turretElevation != state.turretElevation ||
+                   next.flamethrowerActive != state.flamethrowerActive ||
+                   next.currentGear != state.currentGear;
+    bool traceInput = inputMarked;
+    inputMarked = false;
+    if (!changed) {
+        return;
+    }
+
+    uint32_t sequence = state.sequence + 1;
+    state = next;
+    state.sequence = sequence;
+    state.timestampMs = nowMs;
+    state.version = CONTROL_STATE_VERSION;
+
+#ifdef LATENCY_TRACE
+    if (!tracing) {
+        return;
+    }
+    if (traceInput) {
+        LatencyTrace::record(LatencyTrace::POINT_INPUT, sequence, inputTicks);
+    }
+    LatencyTrace::record(LatencyTrace::POINT_UPDATE, sequence);
+#else
+    (void)traceInput;
+#endif
+}
+
+void TankControlInterface::markInput(uint32_t ageUs) {
+    freshInputs++;
+#ifdef LATENCY_TRACE
+    // Keep the earliest arrival since the last publishState()
+    if (!inputMarked) {
+        inputTicks = LatencyTrace::now() - ageUs * LatencyTrace::ticksPerUs();
+        inputMarked = true;
+    }
+#else
+    (void)ageUs;
+#endif
+}
@@ -1,29 +1,66 @@
 #ifndef TANK_CONTROL_INTERFACE_H
 #define TANK_CONTROL_INTERFACE_H
 
+#include "ControlState.h"
+
 class TankControlInterface {
 public:
+    TankControlInterface();
     virtual ~TankControlInterface() {}
 
     // Methods to update control inputs
     virtual void update() = 0;
 
+    // Complete control state in one call. state.sequence only changes when
+    // a value does, so callers can skip work if it matches the last one seen.
+    const ControlState& getState() const { return state; }
+
     // Getters for movement
-    virtual int getLeftTrackSpeed() const = 0;
-    virtual int getRightTrackSpeed() const = 0;
+    int getLeftTrackSpeed() const { return state.leftTrackSpeed; }
+    int getRightTrackSpeed() const { return state.rightTrackSpeed; }
 
     // Getters for turret control
-    virtual int getTurretRotation() const = 0;
-    virtual int getTurretElevation() const = 0;
+    int getTurretRotation() const { return state.turretRotation; }
+    int getTurretElevation() const { return state.turretElevation; }
 
     // Getter for flamethrower activation
-    virtual bool isFlamethrowerActive() const = 0;
+    bool isFlamethrowerActive() const { return state.flamethrowerActive; }
 
     // Getter for current gear
-    virtual int getCurrentGear() const = 0;
+    int getCurrentGear() const { return state.currentGear; }
 
     // Getter for connection status
-    virtual bool isConnected() const = 0;
+    bool isConnected() const { return state.connected; }
+
+    // Counts fresh input (markInput() and markFresh() calls); the input
+    // stage feeds the failsafe (FailsafeMonitor.h) when it moves
+    uint32_t freshCount() const { return freshInputs; }
+
+    // Latency tracing of this backend's changes (on by default). Off for
+    // a backend that another one wraps, e.g. in ReplayControl.
+    void setTracing(bool enabled) { tracing = enabled; }
+
+protected:
+    // Backends call this from update() with their new values. Sequence and
+    // timestamp are filled in here, and only advance if something changed.
+    void publishState(const ControlState& next, uint32_t nowMs);
+
+    // Backends call this when new input arrives, ageUs after it was
+    // received if it was timestamped earlier (e.g. by an interrupt). The
+    // next publishState() that changes a value traces it as the input
+    // time (LatencyTrace.h). It also counts as fresh input.
+    void markInput(uint32_t ageUs = 0);
+
+    // Backends call this when their input is still live without anything
+    // new, e.g. a connected Bluetooth keyboard, which only reports changes
+    void markFresh() { freshInputs++; }
+
+private:
+    ControlState state;
+    uint32_t inputTicks;
+    uint32_t freshInputs;
+    bool inputMarked;
+    bool tracing;
 };
 
 #endif // TANK_CONTROL_INTERFACE_H
@@ -0,0 +1,61 @@
+#ifndef TANK_MIXER_H
+#define TANK_MIXER_H
+
+#include <math.h>
+#include <stdint.h>
+#include "ControlState.h"
+
+// Raw operator inputs, as read by a control backend
+struct MixerInput {
+    int16_t drive;            // -100..100, positive = forward
+    int16_t turn;             // -100..100, positive = right
+    int16_t turretRotation;   // -100..100, positive = right
+    int16_t turretElevation;  // -100..100, positive = up
+    bool fire;
+    uint8_t gear;             // 1..maxGear
+};
+
+// Arcade mixer for the two tracks, shared by all control backends.
+//
+// Single-precision float, which the ESP32's FPU handles in hardware. If
+// drive plus turn would push a track past full speed, both tracks are
+// scaled down by the same factor, so the turn ratio is kept instead of
+// clipping one side.
+namespace TankMixer {
+    static const uint8_t maxGear = 5;
+
+    inline int16_t clampPercent(int32_t value) {
+        return value > 100 ? 100 : (value < -100 ? -100 : (int16_t)value);
+    }
+
+    // Rounded half away from zero; copysignf() is a bit operation, so the
+    // random sign of a track costs no branch
+    inline int8_t roundPercent(float value) {
+        return (int8_t)(value + copysignf(0.5f, value));
+    }
+
+    // Fills the track, turret, flamethrower and gear fields of out
+    inline void mix(const MixerInput& in, ControlState& out) {
+        uint8_t gear = in.gear < 1 ? 1 : (in.gear > maxGear ? maxGear : in.gear);
+        int32_t drive = clampPercent(in.drive);
+        int32_t turn  = clampPercent(in.turn);
+        float scale = (float)gear / maxGear;
+
+        float left  = (drive + turn) * scale;
+        float right = (drive - turn) * scale;
+
+        // Desaturate: scale both tracks so the faster one is at full speed.
+        // Always divided, which costs less than a mispredicted branch.
+        float factor = 100.0f / fmaxf(fmaxf(fabsf(left), fabsf(right)), 100.0f);
+        left  *= factor;
+        right *= factor;
+        out.leftTrackSpeed     = roundPercent(left);
+        out.rightTrackSpeed    = roundPercent(right);
+        out.turretRotation     = clampPercent(in.turretRotation);
+        out.turretElevation    = clampPercent(in.turretElevation);
+        out.flamethrowerActive = in.fire;
+        out.currentGear        = gear;
+    }
+}
+
+#endif // TANK_MIXER_H
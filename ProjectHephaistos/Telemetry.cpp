@@ -0,0 +1,159 @@
+#include "Telemetry.h"
+#include "ControlFrame.h"
+#include <stddef.h>
+#include <string.h>
+
+namespace Telemetry {
+
+#define TELEMETRY_FIELD(name) offsetof(Sample, name)
+
+const uint8_t fieldOffset[fieldCount] = {
+    TELEMETRY_FIELD(flags),
+    TELEMETRY_FIELD(gear),
+    TELEMETRY_FIELD(leftTrackCommand),
+    TELEMETRY_FIELD(rightTrackCommand),
+    TELEMETRY_FIELD(leftTrackOutput),
+    TELEMETRY_FIELD(rightTrackOutput),
+    TELEMETRY_FIELD(leftTrackMeasured),
+    TELEMETRY_FIELD(rightTrackMeasured),
+    TELEMETRY_FIELD(turretRotationRate),
+    TELEMETRY_FIELD(turretElevationRate),
+    TELEMETRY_FIELD(turretRotation),
+    TELEMETRY_FIELD(turretElevation),
+    TELEMETRY_FIELD(deadlineMisses),
+    TELEMETRY_FIELD(controlSequence),
+};
+
+const uint8_t fieldSize[fieldCount] = {
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2
+};
+
+#undef TELEMETRY_FIELD
+
+static_assert(sizeof(Sample) == 18, "Telemetry::Sample layout changed, update the field table");
+static_assert(maxPayload <= ControlFrame::maxPayload, "Telemetry frame does not fit a ControlFrame");
+
+static void putUint16(uint8_t* out, uint16_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+static uint16_t getUint16(const uint8_t* in) {
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+Encoder::Encoder(uint32_t keyframeIntervalMs)
+    : keyframeIntervalMs(keyframeIntervalMs),
+      lastKeyframeMs(0),
+      keyframeDue(true),
+      sequence(0),
+      last(),
+      frames(0),
+      bytes(0)
+{
+}
+
+size_t Encoder::encode(const Sample& sample, uint32_t nowMs, uint8_t* out, size_t outSize) {
+    if (nowMs - lastKeyframeMs >= keyframeIntervalMs) {
+        keyframeDue = true;
+    }
+
+    const uint8_t* next = (const uint8_t*)&sample;
+    const uint8_t* previous = (const uint8_t*)&last;
+    uint16_t mask = allFields;
+    if (!keyframeDue) {
+        mask = 0;
+        for (uint8_t i = 0; i < fieldCount; i++) {
+            if (memcmp(next + fieldOffset[i], previous + fieldOffset[i], fieldSize[i]) != 0) {
+                mask |= 1u << i;
+            }
+        }
+        if (mask == 0) {
+            return 0;
+        }
+    }
+
+    uint8_t payload[maxPayload];
+    putUint16(payload, sequence);
+    payload[2] = (uint8_t)nowMs;
+    payload[3] = (uint8_t)(nowMs >> 8);
+    payload[4] = (uint8_t)(nowMs >> 16);
+    payload[5] = (uint8_t)(nowMs >> 24);
+    putUint16(payload + 6, mask);
+    uint8_t length = headerSize;
+    for (uint8_t i = 0; i < fieldCount; i++) {
+        if (mask & (1u << i)) {
+            memcpy(payload + length, next + fieldOffset[i], fieldSize[i]);
+            length += fieldSize[i];
+        }
+    }
+
+    size_t written = ControlFrame::encode(ControlFrame::TYPE_TELEMETRY, payload, length, out, outSize);
+    if (written == 0) {
+        return 0;
+    }
+    if (mask == allFields) {
+        keyframeDue = false;
+        lastKeyframeMs = nowMs;
+    }
+    last = sample;
+    sequence++;
+    frames++;
+    bytes += written;
+    return written;
+}
+
+Decoder::Decoder()
+    : current(),
+      timestamp(0),
+      nextSequence(0),
+      synced(false),
+      started(false),
+      lost(0)
+{
+}
+
+bool Decoder::apply(const uint8_t* payload, uint8_t length) {
+    if (length < headerSize) {
+        return false;
+    }
+    uint16_t sequence = getUint16(payload);
+    uint16_t mask = getUint16(payload + 6);
+
+    // Check the length before touching the sample
+    uint8_t expected = headerSize;
+    for (uint8_t i = 0; i < fieldCount; i++) {
+        if (mask & (1u << i)) {
+            expected += fieldSize[i];
+        }
+    }
+    // Fields added after this build trail the known ones; skip them
+    bool newerFields = (mask & ~allFields) != 0;
+    if (newerFields ? length < expected : length != expected) {
+        return false;
+    }
+
+    if (started && sequence != nextSequence) {
+        lost += (uint16_t)(sequence - nextSequence);
+        synced = false;
+    }
+    started = true;
+    nextSequence = sequence + 1;
+    timestamp = (uint32_t)payload[2] | ((uint32_t)payload[3] << 8) |
+                ((uint32_t)payload[4] << 16) | ((uint32_t)payload[5] << 24);
+
+    uint8_t* sample = (uint8_t*)&current;
+    uint8_t position = headerSize;
+    for (uint8_t i = 0; i < fieldCount; i++) {
+        if (mask & (1u << i)) {
+            memcpy(sample + fieldOffset[i], payload + position, fieldSize[i]);
+            position += fieldSize[i];
+        }
+    }
+    if ((mask & allFields) == allFields) {
+        synced = true;
+    }
+    return true;
+}
+
+} // namespace Telemetry
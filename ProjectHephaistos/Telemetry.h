@@ -0,0 +1,105 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Binary telemetry, sent as ControlFrame TYPE_TELEMETRY frames
+//
+//   +----------+-------------+------------+---------------------------+
+//   | sequence | timestampMs | changeMask | changed fields, in order  |
+//   | uint16   | uint32      | uint16     | (sizes from the table)    |
+//   +----------+-------------+------------+---------------------------+
+//
+// Bit n of changeMask set means field n of TelemetrySample follows.
+// Only fields that changed since the last frame are sent; a keyframe
+// (all bits set) goes out at least every keyframeIntervalMs, so a
+// receiver that joins late or misses a frame (sequence gap) is back in
+// sync within that time. Nothing is sent while nothing changes, apart
+// from the keyframes. All values little-endian.
+namespace Telemetry {
+
+// Everything reported, in field order. Fixed layout; append new fields
+// at the end so older decoders keep working.
+struct Sample {
+    uint8_t flags;               // FLAG_* bits
+    uint8_t gear;
+    int8_t leftTrackCommand;     // -100..100 % from the mixer
+    int8_t rightTrackCommand;
+    int8_t leftTrackOutput;      // -100..100 % on the motor
+    int8_t rightTrackOutput;
+    int8_t leftTrackMeasured;    // -100..100 % from the encoder, 0 without
+    int8_t rightTrackMeasured;
+    int8_t turretRotationRate;   // -100..100 % commanded
+    int8_t turretElevationRate;
+    int16_t turretRotation;      // centidegrees
+    int16_t turretElevation;
+    uint16_t deadlineMisses;     // all scheduler stages
+    uint16_t controlSequence;    // low bits of ControlState::sequence
+} __attribute__((packed));
+
+const uint8_t FLAG_CONNECTED   = 0x01;
+const uint8_t FLAG_FIRING      = 0x02;
+const uint8_t FLAG_CLOSED_LOOP = 0x04;
+const uint8_t FLAG_FAILSAFE    = 0x08;   // stopped, input overdue
+
+const uint8_t fieldCount = 14;
+const uint16_t allFields = (1u << fieldCount) - 1;
+const uint8_t headerSize = 8;
+const uint8_t maxPayload = headerSize + sizeof(Sample);
+
+// Field n occupies fieldSize[n] bytes at fieldOffset[n] of Sample
+extern const uint8_t fieldOffset[fieldCount];
+extern const uint8_t fieldSize[fieldCount];
+
+class Encoder {
+public:
+    explicit Encoder(uint32_t keyframeIntervalMs = 1000);
+
+    // Writes the frame for sample to out (ControlFrame::encode() layout).
+    // Returns its length, or 0 if nothing changed and no keyframe is due.
+    size_t encode(const Sample& sample, uint32_t nowMs, uint8_t* out, size_t outSize);
+
+    // Makes the next frame a keyframe
+    void requestKeyframe() { keyframeDue = true; }
+
+    uint32_t framesSent() const { return frames; }
+    uint32_t bytesSent() const { return bytes; }
+
+private:
+    uint32_t keyframeIntervalMs;
+    uint32_t lastKeyframeMs;
+    bool keyframeDue;
+    uint16_t sequence;
+    Sample last;
+    uint32_t frames;
+    uint32_t bytes;
+};
+
+// Applies frame payloads to a copy of the sample, as a receiver does
+class Decoder {
+public:
+    Decoder();
+
+    // Returns false if the payload is malformed
+    bool apply(const uint8_t* payload, uint8_t length);
+
+    const Sample& sample() const { return current; }
+    uint32_t timestampMs() const { return timestamp; }
+
+    // False from a sequence gap until the next keyframe
+    bool inSync() const { return synced; }
+    uint32_t framesLost() const { return lost; }
+
+private:
+    Sample current;
+    uint32_t timestamp;
+    uint16_t nextSequence;
+    bool synced;
+    bool started;
+    uint32_t lost;
+};
+
+} // namespace Telemetry
+
+#endif // TELEMETRY_H
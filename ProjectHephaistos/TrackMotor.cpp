@@ -0,0 +1,65 @@
+#include "TrackMotor.h"
+
+TrackMotor::TrackMotor(MotorDriver& driver)
+    : driver(driver),
+      maxDuty(0),
+      target(0),
+      lastDuty(0),
+      lastDirection(MotorDriver::DIRECTION_COAST)
+{
+}
+
+bool TrackMotor::begin(uint32_t frequencyHz, uint8_t resolutionBits) {
+    maxDuty = (1UL << resolutionBits) - 1;
+    if (!driver.begin(frequencyHz, resolutionBits)) {
+        return false;
+    }
+    driver.write(0, MotorDriver::DIRECTION_COAST);
+    return true;
+}
+
+void TrackMotor::setRamp(float acceleration, float jerk, uint32_t updateHz) {
+    ramp.configure(acceleration, jerk, updateHz);
+}
+
+void TrackMotor::setTarget(int8_t speedPercent) {
+    if (speedPercent > 100) {
+        speedPercent = 100;
+    } else if (speedPercent < -100) {
+        speedPercent = -100;
+    }
+    target = speedPercent;
+}
+
+void TrackMotor::update() {
+    float speed = ramp.step(target);
+
+    MotorDriver::Direction direction = MotorDriver::DIRECTION_COAST;
+    if (speed > 0) {
+        direction = MotorDriver::DIRECTION_FORWARD;
+    } else if (speed < 0) {
+        direction = MotorDriver::DIRECTION_REVERSE;
+        speed = -speed;
+    }
+
+    write((uint32_t)(speed * maxDuty / 100.0f + 0.5f), direction);
+}
+
+void TrackMotor::stop() {
+    target = 0;
+    ramp.reset(0);
+    write(0, MotorDriver::DIRECTION_COAST);
+}
+
+void TrackMotor::write(uint32_t duty, MotorDriver::Direction direction) {
+    if (duty == 0) {
+        direction = MotorDriver::DIRECTION_COAST;
+    }
+    // The ramp holds most of the time; skip writes that change nothing
+    if (duty == lastDuty && direction == lastDirection) {
+        return;
+    }
+    driver.write(duty, direction);
+    lastDuty = duty;
+    lastDirection = direction;
+}
@@ -0,0 +1,44 @@
+#ifndef TRACK_MOTOR_H
+#define TRACK_MOTOR_H
+
+#include <stdint.h>
+#include "MotorDriver.h"
+#include "SlewLimiter.h"
+
+// One track motor: takes -100..100 % speed commands and ramps the output
+// towards them with limited acceleration and jerk, so a step on the stick
+// does not hit the drivetrain (and the battery) at full force.
+class TrackMotor {
+public:
+    TrackMotor(MotorDriver& driver);
+
+    bool begin(uint32_t frequencyHz, uint8_t resolutionBits);
+
+    // Acceleration in % of full speed per second, jerk in %/s^2, for
+    // update() being called updateHz times a second; 0 = unlimited
+    void setRamp(float acceleration, float jerk, uint32_t updateHz);
+
+    void setTarget(int8_t speedPercent);
+
+    // One actuation step: advance the ramp and write the output if it changed
+    void update();
+
+    // Cuts the output right away, without ramping
+    void stop();
+
+    float speed() const { return ramp.value(); }
+    uint32_t duty() const { return lastDuty; }
+
+private:
+    MotorDriver& driver;
+    SlewLimiter ramp;
+    uint32_t maxDuty;
+    int8_t target;
+
+    uint32_t lastDuty;
+    MotorDriver::Direction lastDirection;
+
+    void write(uint32_t duty, MotorDriver::Direction direction);
+};
+
+#endif // TRACK_MOTOR_H
@@ -0,0 +1,126 @@
+#include "TrackSpeedController.h"
+#include <math.h>
+
+static const int32_t fullScaleQ8 = 100 * 256;
+static const int32_t maxErrorQ8 = 2 * fullScaleQ8;
+static const int32_t integralLimitQ20 = 100 << 20;
+
+// Keeps (error in Q8) * (gain in Q12) within 32 bits
+static const float maxGain = 8.0f;
+
+static int32_t gainQ12(float gain) {
+    if (gain < 0) {
+        gain = 0;
+    }
+    if (gain > maxGain) {
+        gain = maxGain;
+    }
+    return (int32_t)lroundf(gain * 4096);
+}
+
+static int32_t clampQ8(int32_t value, int32_t limit) {
+    return value > limit ? limit : (value < -limit ? -limit : value);
+}
+
+TrackSpeedController::TrackSpeedController()
+    : kpQ12(0),
+      kiQ12(0),
+      kdQ12(0),
+      kfQ12(4096),
+      countsScaleQ8(0),
+      windowIndex(0),
+      setpointQ8(0),
+      measuredQ8(0),
+      integralQ20(0),
+      lastOutput(0)
+{
+    reset(0);
+}
+
+void TrackSpeedController::configure(const Gains& gains, int32_t fullSpeedCounts, uint32_t updateHz) {
+    kpQ12 = gainQ12(gains.kp);
+    kiQ12 = gainQ12(gains.ki / updateHz);
+    kdQ12 = gainQ12(gains.kd * updateHz);
+    kfQ12 = gainQ12(gains.kf);
+    // Window counts -> counts per second -> Q8 percent of full speed
+    countsScaleQ8 = fullSpeedCounts > 0
+        ? (int32_t)lroundf((float)updateHz * fullScaleQ8 * 256 / ((float)windowTicks * fullSpeedCounts))
+        : 0;
+}
+
+void TrackSpeedController::setRamp(float acceleration, float jerk, uint32_t updateHz) {
+    ramp.configure(acceleration, jerk, updateHz);
+}
+
+void TrackSpeedController::reset(int32_t encoderCount) {
+    for (uint8_t i = 0; i < windowTicks; i++) {
+        window[i] = encoderCount;
+    }
+    windowIndex = 0;
+    ramp.reset();
+    setpointQ8 = 0;
+    measuredQ8 = 0;
+    integralQ20 = 0;
+    lastOutput = 0;
+}
+
+int8_t TrackSpeedController::update(int8_t setpointPercent, int32_t encoderCount) {
+    setpointQ8 = (int32_t)lroundf(ramp.step(setpointPercent) * 256);
+
+    // Speed over the window: this count minus the oldest one
+    int32_t windowCounts = encoderCount - window[windowIndex];
+    window[windowIndex] = encoderCount;
+    windowIndex = (windowIndex + 1) % windowTicks;
+    int32_t previousQ8 = measuredQ8;
+    int32_t maxWindowCounts = countsScaleQ8 > 0 ? INT32_MAX / countsScaleQ8 : 0;
+    if (windowCounts > maxWindowCounts) {
+        windowCounts = maxWindowCounts;
+    }
+    if (windowCounts < -maxWindowCounts) {
+        windowCounts = -maxWindowCounts;
+    }
+    measuredQ8 = clampQ8((windowCounts * countsScaleQ8) >> 8, maxErrorQ8);
+
+    if (setpointQ8 == 0) {
+        // Stopped means stopped: no integrator creep, let the track coast
+        integralQ20 = 0;
+        lastOutput = 0;
+        return 0;
+    }
+
+    int32_t errorQ8 = clampQ8(setpointQ8 - measuredQ8, maxErrorQ8);
+
+    // Terms in Q12 percent; derivative on the measurement, so setpoint
+    // steps don't kick the output
+    int32_t feedforward = (setpointQ8 * kfQ12) >> 8;
+    int32_t proportional = (errorQ8 * kpQ12) >> 8;
+    int32_t derivative = -(clampQ8(measuredQ8 - previousQ8, maxErrorQ8) * kdQ12) >> 8;
+
+    int32_t integral = integralQ20 + errorQ8 * kiQ12;
+    if (integral > integralLimitQ20) {
+        integral = integralLimitQ20;
+    }
+    if (integral < -integralLimitQ20) {
+        integral = -integralLimitQ20;
+    }
+
+    int32_t outputQ12 = feedforward + proportional + derivative + (integral >> 8);
+    const int32_t fullScaleQ12 = 100 << 12;
+    bool saturatedHigh = outputQ12 > fullScaleQ12;
+    bool saturatedLow = outputQ12 < -fullScaleQ12;
+    if ((saturatedHigh && errorQ8 > 0) || (saturatedLow && errorQ8 < 0)) {
+        // Integrating further would only wind up
+        outputQ12 -= (integral >> 8) - (integralQ20 >> 8);
+    } else {
+        integralQ20 = integral;
+    }
+
+    if (outputQ12 > fullScaleQ12) {
+        outputQ12 = fullScaleQ12;
+    }
+    if (outputQ12 < -fullScaleQ12) {
+        outputQ12 = -fullScaleQ12;
+    }
+    lastOutput = (int8_t)((outputQ12 + 2048) >> 12);
+    return lastOutput;
+}
@@ -0,0 +1,67 @@
+#ifndef TRACK_SPEED_CONTROLLER_H
+#define TRACK_SPEED_CONTROLLER_H
+
+#include <stdint.h>
+#include "SlewLimiter.h"
+
+// Closed-loop speed control for one track: compares the commanded speed
+// (-100..100 % from the mixer) with the speed measured by the wheel
+// encoder and returns the motor output that makes them match, so both
+// tracks run at the commanded speed regardless of load and battery.
+//
+// Integer PID with the setpoint as feedforward. Internally speeds are
+// Q8 percent and gains Q12, so products stay within 32 bits. Anti-windup
+// by conditional integration: the integrator holds while the output is
+// saturated in the direction the error pushes it, and is bounded to
+// full scale.
+class TrackSpeedController {
+public:
+    struct Gains {
+        float kp;  // output % per % of speed error
+        float ki;  // output % per %*second of error
+        float kd;  // output % per %/second change of the measured speed
+        float kf;  // output % per % of setpoint (1 = open-loop output)
+    };
+
+    TrackSpeedController();
+
+    // fullSpeedCounts: encoder counts per second at 100 % output, no load.
+    // update() is called updateHz times a second.
+    void configure(const Gains& gains, int32_t fullSpeedCounts, uint32_t updateHz);
+
+    // Acceleration and jerk limits for the setpoint, as in TrackMotor
+    void setRamp(float acceleration, float jerk, uint32_t updateHz);
+
+    // One control step: returns the motor output in -100..100 %
+    int8_t update(int8_t setpointPercent, int32_t encoderCount);
+
+    // Clears the controller state, taking encoderCount as the new origin
+    void reset(int32_t encoderCount);
+
+    // Speeds from the last update, in % of full speed
+    int16_t measuredPercent() const { return (int16_t)(measuredQ8 / 256); }
+    int16_t setpointPercent() const { return (int16_t)(setpointQ8 / 256); }
+    int8_t output() const { return lastOutput; }
+
+private:
+    // Speed is measured over the last windowTicks updates
+    static const uint8_t windowTicks = 8;
+
+    int32_t kpQ12;
+    int32_t kiQ12;   // per update
+    int32_t kdQ12;   // per update
+    int32_t kfQ12;
+    int32_t countsScaleQ8;   // window counts -> Q8 percent, Q8
+
+    SlewLimiter ramp;
+
+    int32_t window[windowTicks];  // encoder counts at the last updates
+    uint8_t windowIndex;
+
+    int32_t setpointQ8;
+    int32_t measuredQ8;
+    int32_t integralQ20;
+    int8_t lastOutput;
+};
+
+#endif // TRACK_SPEED_CONTROLLER_H
@@ -0,0 +1,124 @@
+#include "TurretAxis.h"
+#include <math.h>
+
+// Until setLimits(): half a turn either way
+static const int32_t defaultLimit = 18000;
+
+TurretAxis::TurretAxis()
+    : steps(1),
+      tickHz(1),
+      minPositionQ8(-defaultLimit * 256),
+      maxPositionQ8(defaultLimit * 256),
+      targetSpeedQ8(0),
+      speedQ8(0),
+      step(0),
+      positionQ8(0)
+{
+    speedTable[0] = 0;
+    speedTable[1] = 0;
+    stopTable[0] = 0;
+    stopTable[1] = 0;
+}
+
+void TurretAxis::configure(Profile profile, float maxRate, float rampTime, uint32_t updateHz) {
+    tickHz = updateHz > 0 ? updateHz : 1;
+    long rampTicks = lroundf(rampTime * tickHz);
+    steps = rampTicks < 1 ? 1 : (rampTicks > maxRampSteps ? maxRampSteps : (uint16_t)rampTicks);
+
+    float maxSpeedQ8 = fabsf(maxRate) * 100 * 256 / tickHz;
+    stopTable[0] = 0;
+    for (uint16_t i = 0; i <= steps; i++) {
+        float x = (float)i / steps;
+        float shape = profile == PROFILE_S_CURVE ? x * x * (3 - 2 * x) : x;
+        speedTable[i] = (int32_t)lroundf(maxSpeedQ8 * shape);
+        // The first S-curve steps can round to nothing at high tick
+        // rates, which would keep the axis from ever starting
+        if (i > 0 && speedTable[i] < 1) {
+            speedTable[i] = 1;
+        }
+        if (i > 0) {
+            // Stopping from step i passes through steps i-1 .. 0
+            stopTable[i] = stopTable[i - 1] + speedTable[i - 1];
+        }
+    }
+    stop();
+}
+
+void TurretAxis::setLimits(int32_t minPosition, int32_t maxPosition) {
+    minPositionQ8 = minPosition * 256;
+    maxPositionQ8 = maxPosition * 256;
+    if (positionQ8 < minPositionQ8) {
+        positionQ8 = minPositionQ8;
+    }
+    if (positionQ8 > maxPositionQ8) {
+        positionQ8 = maxPositionQ8;
+    }
+}
+
+void TurretAxis::setRate(int8_t ratePercent) {
+    int32_t rate = ratePercent > 100 ? 100 : (ratePercent < -100 ? -100 : ratePercent);
+    targetSpeedQ8 = speedTable[steps] * rate / 100;
+}
+
+void TurretAxis::stop() {
+    targetSpeedQ8 = 0;
+    speedQ8 = 0;
+    step = 0;
+}
+
+void TurretAxis::reset(int32_t position) {
+    stop();
+    positionQ8 = position * 256;
+    setLimits(minPositionQ8 / 256, maxPositionQ8 / 256);
+}
+
+int32_t TurretAxis::update() {
+    // Direction of travel: the current one while moving, else the command's
+    int32_t direction = speedQ8 != 0 ? (speedQ8 > 0 ? 1 : -1)
+                                     : (targetSpeedQ8 > 0 ? 1 : (targetSpeedQ8 < 0 ? -1 : 0));
+    if (direction == 0) {
+        return position();
+    }
+    int32_t speed = speedQ8 * direction;
+    int32_t remaining = direction > 0 ? maxPositionQ8 - positionQ8 : positionQ8 - minPositionQ8;
+
+    // Speed to head for along that direction; a reversal stops first
+    int32_t goal = targetSpeedQ8 * direction;
+    if (goal < 0) {
+        goal = 0;
+    }
+
+    // One ramp step towards the goal
+    uint16_t nextStep = step;
+    int32_t nextSpeed = speed;
+    if (speed < goal) {
+        nextStep = step < steps ? step + 1 : steps;
+        nextSpeed = speedTable[nextStep] < goal ? speedTable[nextStep] : goal;
+    } else if (speed > goal) {
+        nextStep = step > 0 ? step - 1 : 0;
+        nextSpeed = speedTable[nextStep] > goal ? speedTable[nextStep] : goal;
+    }
+
+    // Brake instead if moving on at that speed would leave too little
+    // room to stop before the soft limit. Braking keeps that room, so
+    // the axis comes to rest right on the limit.
+    if (nextSpeed > remaining) {
+        nextSpeed = remaining;
+    }
+    if (remaining - nextSpeed < stopTable[nextStep] && step > 0) {
+        nextStep = step - 1;
+        nextSpeed = speedTable[nextStep] < speed ? speedTable[nextStep] : speed;
+        if (nextSpeed > remaining) {
+            nextSpeed = remaining;
+        }
+    }
+
+    step = nextSpeed > 0 ? nextStep : 0;
+    speedQ8 = nextSpeed * direction;
+    positionQ8 += speedQ8;
+    return position();
+}
+
+int32_t TurretAxis::velocity() const {
+    return (int32_t)((int64_t)speedQ8 * tickHz / 256);
+}
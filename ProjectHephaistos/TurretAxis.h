@@ -0,0 +1,71 @@
+#ifndef TURRET_AXIS_H
+#define TURRET_AXIS_H
+
+#include <stdint.h>
+
+// Motion planner for one turret axis: turns a -100..100 % rate command
+// into a position target that moves with a limited, smooth velocity
+// profile and stays within soft limits.
+//
+// The acceleration ramp is precomputed into integer step tables when the
+// axis is configured: velocity per tick for each ramp step, and the
+// distance needed to stop from there. update() then only walks the table
+// one step per tick, which gives a trapezoidal (linear ramp) or S-curve
+// (smoothstep ramp) velocity profile, and brakes early enough to come to
+// rest on a soft limit instead of hitting it.
+//
+// Positions are in centidegrees.
+class TurretAxis {
+public:
+    enum Profile {
+        PROFILE_TRAPEZOIDAL,
+        PROFILE_S_CURVE
+    };
+
+    static const uint16_t maxRampSteps = 256;
+
+    TurretAxis();
+
+    // maxRate in degrees per second at 100 %, rampTime in seconds from
+    // standstill to maxRate, for update() being called updateHz times a
+    // second. The ramp is cut to maxRampSteps ticks.
+    void configure(Profile profile, float maxRate, float rampTime, uint32_t updateHz);
+
+    // Soft limits in centidegrees; the position is moved inside them
+    void setLimits(int32_t minPosition, int32_t maxPosition);
+
+    void setRate(int8_t ratePercent);
+
+    // One planner tick; returns the new position target
+    int32_t update();
+
+    // Stops right away (no ramp) and holds the position
+    void stop();
+
+    void reset(int32_t position);
+
+    int32_t position() const { return positionQ8 >> 8; }
+    // Centidegrees per second, signed
+    int32_t velocity() const;
+    bool moving() const { return speedQ8 != 0; }
+    uint16_t rampSteps() const { return steps; }
+
+private:
+    // Q8 centidegrees per tick at ramp step i, rising from 0 at i = 0
+    // to the full rate at i = steps
+    int32_t speedTable[maxRampSteps + 1];
+    // Q8 centidegrees travelled stopping from step i
+    int32_t stopTable[maxRampSteps + 1];
+    uint16_t steps;
+    uint32_t tickHz;
+
+    int32_t minPositionQ8;
+    int32_t maxPositionQ8;
+
+    int32_t targetSpeedQ8;   // signed, from the rate command
+    int32_t speedQ8;         // signed, current
+    uint16_t step;           // ramp step the speed is at
+    int32_t positionQ8;
+};
+
+#endif // TURRET_AXIS_H
@@ -0,0 +1,251 @@
+#include "ControlConfig.h"
+#ifdef CONTROL_MODE_UDP
+
+#include "UdpControl.h"
+#include "TankMixer.h"
+#include "Log.h"
+#include "Profiler.h"
+#ifdef INPUT_RECORDING
+#include "InputRecorder.h"
+#endif
+#include <string.h>
+
+UdpControl::UdpControl(const char* ssid, const char* password, bool accessPoint, uint16_t port,
+                       uint32_t jitterBufferMs)
+    : listenPort(port),
+      listening(false),
+      accessPoint(accessPoint),
+      addressLogged(false),
+      jitter(jitterBufferMs * 1000),
+      counters(),
+      appliedSequence(0),
+      senderPort(0),
+      lastDatagramTime(0),
+      datagramSeen(false),
+      currentGear(1),
+      received(getState())
+{
+    if (accessPoint) {
+        WiFi.mode(WIFI_AP);
+        WiFi.softAP(ssid, password);
+    } else {
+        WiFi.mode(WIFI_STA);
+        WiFi.begin(ssid, password);
+    }
+    // Modem sleep holds received frames for up to a beacon interval
+    WiFi.setSleep(false);
+
+    listening = udp.begin(port);
+    if (listening) {
+        LOG_INFO("UdpControl Initialized. Listening on port %u (%s \"%s\")", (unsigned)port,
+                 accessPoint ? "access point" : "joining", ssid);
+    } else {
+        LOG_ERROR("UdpControl: can't listen on port %u", (unsigned)port);
+    }
+}
+
+UdpControl::~UdpControl() {
+    udp.stop();
+}
+
+void UdpControl::update() {
+    // The address comes once the access point is up or the network joined
+    if (!addressLogged && (accessPoint || WiFi.status() == WL_CONNECTED)) {
+        IPAddress ip = accessPoint ? WiFi.softAPIP() : WiFi.localIP();
+        LOG_INFO("Send control datagrams to %u.%u.%u.%u:%u", ip[0], ip[1], ip[2], ip[3], (unsigned)listenPort);
+        addressLogged = true;
+    }
+
+    receive();
+    applyDue();
+    publishLink(millis());
+}
+
+void UdpControl::receive() {
+    PROFILE_SECTION(SECTION_PARSE);
+    if (!listening) {
+        return;
+    }
+    for (uint8_t i = 0; i < maxDatagramsPerUpdate; i++) {
+        int size = udp.parsePacket();
+        if (size <= 0) {
+            break;
+        }
+        // Anything longer than a state datagram is rejected unread
+        uint8_t data[datagramSize + 1];
+        int length = udp.read(data, sizeof(data));
+#ifdef INPUT_RECORDING
+        int16_t values[InputRecord::maxValues];
+        uint8_t count = length < InputRecord::maxValues ? (uint8_t)length : InputRecord::maxValues;
+        for (uint8_t j = 0; j < count; j++) {
+            values[j] = data[j];
+        }
+        InputRecorder::record(InputRecord::TYPE_DATAGRAM, values, count);
+#endif
+        handleDatagram(data, length > 0 ? (size_t)length : 0, true);
+    }
+}
+
+void UdpControl::replaySample(const InputRecord::Sample& sample) {
+    if (sample.type != InputRecord::TYPE_DATAGRAM) {
+        return;
+    }
+    PROFILE_SECTION(SECTION_PARSE);
+    uint8_t data[InputRecord::maxValues];
+    for (uint8_t i = 0; i < sample.count; i++) {
+        data[i] = (uint8_t)sample.values[i];
+    }
+    handleDatagram(data, sample.count, false);
+}
+
+void UdpControl::replayPoll() {
+    applyDue();
+    publishLink(millis());
+}
+
+void UdpControl::handleDatagram(const uint8_t* data, size_t length, bool reply) {
+    // Exactly one state frame per datagram
+    ControlFrame::Parser parser;
+    bool complete = false;
+    for (size_t i = 0; i < length && !complete; i++) {
+        complete = parser.feed(data[i]);
+    }
+    if (complete && parser.type() == ControlFrame::TYPE_PING &&
+        parser.length() == sizeof(ControlFrame::PingPayload) &&
+        length == sizeof(ControlFrame::PingPayload) + ControlFrame::overhead) {
+        counters.pings++;
+        if (reply) {
+            ControlFrame::PingPayload ping;
+            memcpy(&ping, parser.payload(), sizeof(ping));
+            sendPong(ping, micros());
+        }
+        return;
+    }
+    if (length != datagramSize || !complete || parser.type() != ControlFrame::TYPE_NET_STATE ||
+        parser.length() != sizeof(ControlFrame::NetStatePayload)) {
+        counters.rejected++;
+        return;
+    }
+    ControlFrame::NetStatePayload state;
+    memcpy(&state, parser.payload(), sizeof(state));
+    counters.received++;
+
+    unsigned long now = millis();
+    expireLink(now);
+    lastDatagramTime = now;
+    datagramSeen = true;
+
+    JitterBuffer<ControlFrame::NetStatePayload, jitterSlots>::PushResult result =
+        jitter.push(state.sequence, state.sendTimeMs * 1000, micros(), state);
+    if (result == jitter.PUSH_STALE) {
+        counters.stale++;
+    } else if (result == jitter.PUSH_OVERFLOWED) {
+        counters.overflowed++;
+    }
+    if (reply) {
+        // Acks go to whoever sent the last state datagram
+        IPAddress from = udp.remoteIP();
+        uint16_t fromPort = udp.remotePort();
+        if (from != senderAddress || fromPort != senderPort) {
+            senderAddress = from;
+            senderPort = fromPort;
+            LOG_INFO("Control datagrams from %u.%u.%u.%u:%u", from[0], from[1], from[2], from[3],
+                     (unsigned)fromPort);
+        }
+        sendAck(state, result == jitter.PUSH_STALE);
+    }
+}
+
+void UdpControl::sendAck(const ControlFrame::NetStatePayload& state, bool stale) {
+    ControlFrame::NetAckPayload ack;
+    ack.sequence = state.sequence;
+    ack.sendTimeMs = state.sendTimeMs;
+    ack.applied = appliedSequence;
+    ack.stale = (uint16_t)counters.stale;
+    ack.overflowed = (uint16_t)counters.overflowed;
+    ack.buffered = (uint8_t)jitter.size();
+    ack.flags = stale ? ControlFrame::ACK_STALE : 0;
+
+    uint8_t frame[sizeof(ack) + ControlFrame::overhead];
+    size_t length = ControlFrame::encode(ControlFrame::TYPE_NET_ACK, &ack, sizeof(ack), frame, sizeof(frame));
+    udp.beginPacket(senderAddress, senderPort);
+    udp.write(frame, length);
+    udp.endPacket();
+}
+
+void UdpControl::sendPong(const ControlFrame::PingPayload& ping, uint32_t receivedUs) {
+    ControlFrame::PongPayload pong;
+    pong.sequence = ping.sequence;
+    pong.hostTimeUs = ping.hostTimeUs;
+    pong.receivedUs = receivedUs;
+    pong.frames = counters.received + counters.pings;
+    pong.rejected = counters.rejected;
+    pong.backlog = (uint16_t)jitter.size();
+    pong.sentUs = micros();
+
+    // To whoever pinged, which needn't be the one driving
+    uint8_t frame[sizeof(pong) + ControlFrame::overhead];
+    size_t length = ControlFrame::encode(ControlFrame::TYPE_PONG, &pong, sizeof(pong), frame, sizeof(frame));
+    udp.beginPacket(udp.remoteIP(), udp.remotePort());
+    udp.write(frame, length);
+    udp.endPacket();
+}
+
+void UdpControl::applyDue() {
+    ControlFrame::NetStatePayload state;
+    uint32_t sequence;
+    uint32_t arrivalUs;
+    uint32_t nowUs = micros();
+    if (!jitter.pop(nowUs, state, sequence, arrivalUs)) {
+        return;
+    }
+    // Traced from its arrival, so the time in the buffer shows
+    markInput(nowUs - arrivalUs);
+    appliedSequence = sequence;
+    counters.applied++;
+
+    if (state.gear != 0) {
+        uint8_t gear = constrain(state.gear, 1, TankMixer::maxGear);
+        if (gear != currentGear) {
+            currentGear = gear;
+            LOG_INFO("Gear set to %d", currentGear);
+        }
+    }
+
+    MixerInput input;
+    input.drive           = state.drive;
+    input.turn            = state.turn;
+    input.turretRotation  = state.turretRotation;
+    input.turretElevation = state.turretElevation;
+    input.fire            = (state.buttons & ControlFrame::BUTTON_FIRE) != 0;
+    input.gear            = currentGear;
+    TankMixer::mix(input, received);
+}
+
+void UdpControl::expireLink(unsigned long currentTime) {
+    if (datagramSeen && currentTime - lastDatagramTime > linkTimeoutMs) {
+        // Whatever is still held is too old, and the sender may come
+        // back with a new sequence
+        datagramSeen = false;
+        jitter.reset();
+        appliedSequence = 0;
+    }
+}
+
+void UdpControl::publishLink(unsigned long currentTime) {
+    expireLink(currentTime);
+    bool linkUp = datagramSeen && appliedSequence != 0;
+
+    ControlState next = received;
+    next.connected = linkUp;
+    if (!linkUp) {
+        next.leftTrackSpeed = 0;
+        next.rightTrackSpeed = 0;
+        next.turretRotation = 0;
+        next.turretElevation = 0;
+        next.flamethrowerActive = false;
+    }
+    publishState(next, currentTime);
+}
+
+#endif // CONTROL_MODE_UDP
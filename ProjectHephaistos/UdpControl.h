@@ -0,0 +1,92 @@
+#ifndef UDP_CONTROL_H
+#define UDP_CONTROL_H
+
+#include "TankControlInterface.h"
+#include "ControlFrame.h"
+#include "JitterBuffer.h"
+#include "InputRecord.h"
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+
+// Control over Wi-Fi: the host sends the full state in one UDP datagram
+// (a ControlFrame of TYPE_NET_STATE) at a fixed rate, and the tank answers
+// each with a TYPE_NET_ACK to the address it came from.
+//
+// Datagrams not newer than the newest seen are dropped as stale, the rest
+// pass through a small jitter buffer (JitterBuffer.h) so that bursts,
+// common on Wi-Fi, reach the outputs at the pace they were sent. No
+// datagram for linkTimeoutMs means the link is gone: the outputs stop and
+// the sequence starts over with the next sender. A TYPE_PING datagram is
+// answered with a TYPE_PONG right away and doesn't count as input.
+class UdpControl final : public TankControlInterface {
+public:
+    struct Stats {
+        uint32_t received;    // state datagrams decoded
+        uint32_t pings;       // ping datagrams decoded
+        uint32_t rejected;    // anything else on the port
+        uint32_t stale;       // late or duplicated
+        uint32_t overflowed;  // dropped from a full jitter buffer
+        uint32_t applied;     // reached the outputs
+    };
+
+    // Opens ssid as an access point (the host sends to 192.168.4.1) or
+    // joins it, and listens on port. Datagrams are held jitterBufferMs
+    // longer than the fastest ones took; 0 applies each on arrival.
+    UdpControl(const char* ssid, const char* password, bool accessPoint, uint16_t port,
+               uint32_t jitterBufferMs);
+    ~UdpControl();
+
+    void update() override;
+
+    const Stats& stats() const { return counters; }
+    uint16_t port() const { return listenPort; }
+
+    // Input from a recorded session (ReplayControl.h) instead of the
+    // socket: replaySample() takes one sample, replayPoll() stands in for
+    // update(). Nothing is acked.
+    void replaySample(const InputRecord::Sample& sample);
+    void replayPoll();
+
+private:
+    // No datagram for this long means the sender is gone
+    static const unsigned long linkTimeoutMs = 200;
+
+    // Datagrams taken from the socket per update(), so a flood can't
+    // stall the input stage
+    static const uint8_t maxDatagramsPerUpdate = 16;
+
+    static const size_t jitterSlots = 8;
+    static const size_t datagramSize = sizeof(ControlFrame::NetStatePayload) + ControlFrame::overhead;
+
+    WiFiUDP udp;
+    uint16_t listenPort;
+    bool listening;
+    bool accessPoint;
+    bool addressLogged;
+
+    JitterBuffer<ControlFrame::NetStatePayload, jitterSlots> jitter;
+    Stats counters;
+    uint32_t appliedSequence;
+
+    // Where acks go: the sender of the last state datagram
+    IPAddress senderAddress;
+    uint16_t senderPort;
+
+    unsigned long lastDatagramTime;
+    bool datagramSeen;
+    uint8_t currentGear;
+
+    // Values from the last applied datagram
+    ControlState received;
+
+    void receive();
+    void handleDatagram(const uint8_t* data, size_t length, bool reply);
+    void sendAck(const ControlFrame::NetStatePayload& state, bool stale);
+    void sendPong(const ControlFrame::PingPayload& ping, uint32_t receivedUs);
+    void applyDue();
+    void expireLink(unsigned long currentTime);
+    void publishLink(unsigned long currentTime);
+};
+
+#endif // UDP_CONTROL_H
@@ -0,0 +1,84 @@
+#include "WheelEncoder.h"
+
+#if defined(ESP32)
+
+static const int counterHighLimit = 32767;
+static const int counterLowLimit = -32768;
+
+WheelEncoder::WheelEncoder(uint8_t pinA, uint8_t pinB)
+    : pinA(pinA),
+      pinB(pinB),
+      unit(nullptr),
+      channelA(nullptr),
+      channelB(nullptr)
+{
+}
+
+WheelEncoder::~WheelEncoder() {
+    if (unit) {
+        pcnt_unit_stop(unit);
+        pcnt_unit_disable(unit);
+        pcnt_del_channel(channelA);
+        pcnt_del_channel(channelB);
+        pcnt_del_unit(unit);
+    }
+}
+
+bool WheelEncoder::begin(uint32_t glitchFilterNs) {
+    pcnt_unit_config_t unitConfig = {};
+    unitConfig.low_limit = counterLowLimit;
+    unitConfig.high_limit = counterHighLimit;
+    // Keep counting across wraps instead of restarting at 0
+    unitConfig.flags.accum_count = 1;
+    if (pcnt_new_unit(&unitConfig, &unit) != ESP_OK) {
+        unit = nullptr;
+        return false;
+    }
+
+    pcnt_glitch_filter_config_t filterConfig = {};
+    filterConfig.max_glitch_ns = glitchFilterNs;
+    pcnt_unit_set_glitch_filter(unit, &filterConfig);
+
+    // x4 decoding: each channel counts both edges of its pin, with the
+    // direction taken from the level of the other pin
+    pcnt_chan_config_t configA = {};
+    configA.edge_gpio_num = pinA;
+    configA.level_gpio_num = pinB;
+    pcnt_chan_config_t configB = {};
+    configB.edge_gpio_num = pinB;
+    configB.level_gpio_num = pinA;
+    if (pcnt_new_channel(unit, &configA, &channelA) != ESP_OK ||
+        pcnt_new_channel(unit, &configB, &channelB) != ESP_OK) {
+        return false;
+    }
+    pcnt_channel_set_edge_action(channelA, PCNT_CHANNEL_EDGE_ACTION_DECREASE, PCNT_CHANNEL_EDGE_ACTION_INCREASE);
+    pcnt_channel_set_level_action(channelA, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE);
+    pcnt_channel_set_edge_action(channelB, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_DECREASE);
+    pcnt_channel_set_level_action(channelB, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE);
+
+    // accum_count needs the limits as watch points
+    pcnt_unit_add_watch_point(unit, counterHighLimit);
+    pcnt_unit_add_watch_point(unit, counterLowLimit);
+
+    return pcnt_unit_enable(unit) == ESP_OK &&
+           pcnt_unit_clear_count(unit) == ESP_OK &&
+           pcnt_unit_start(unit) == ESP_OK;
+}
+
+int32_t WheelEncoder::count() const {
+    int value = 0;
+    if (unit) {
+        pcnt_unit_get_count(unit, &value);
+    }
+    return value;
+}
+
+#else
+
+// No PCNT: the encoder reads 0 (host runs use the plant model instead)
+WheelEncoder::WheelEncoder(uint8_t pinA, uint8_t pinB) : pinA(pinA), pinB(pinB) {}
+WheelEncoder::~WheelEncoder() {}
+bool WheelEncoder::begin(uint32_t) { return false; }
+int32_t WheelEncoder::count() const { return 0; }
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef WHEEL_ENCODER_H
+#define WHEEL_ENCODER_H
+
+#include <stdint.h>
+
+#if defined(ESP32)
+#include <driver/pulse_cnt.h>
+#endif
+
+// Quadrature wheel encoder counted by the ESP32 PCNT peripheral. Every
+// edge of both channels is counted in hardware (4 counts per encoder
+// line); the CPU only gets an interrupt when the 16-bit counter wraps,
+// which the driver folds into the accumulated count.
+class WheelEncoder {
+public:
+    WheelEncoder(uint8_t pinA, uint8_t pinB);
+    ~WheelEncoder();
+
+    // glitchFilterNs: pulses shorter than this are ignored (max ~12 us)
+    bool begin(uint32_t glitchFilterNs = 1000);
+
+    // Accumulated count since begin(); positive when A leads B
+    int32_t count() const;
+
+private:
+    uint8_t pinA;
+    uint8_t pinB;
+
+#if defined(ESP32)
+    pcnt_unit_handle_t unit;
+    pcnt_channel_handle_t channelA;
+    pcnt_channel_handle_t channelB;
+#endif
+};
+
+#endif // WHEEL_ENCODER_H
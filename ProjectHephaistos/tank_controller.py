@@ -1,101 +1,785 @@
-# pip install pyserial pynput
+# pip install pyserial pyserial-asyncio pynput
+#
+# Drives the tank from the keyboard: W/A/S/D the tracks, Q/E and the
+# up/down arrows the turret, space fires, shift and ctrl change gear,
+# F1 asks the tank for its stats, F2 prints the latency histograms and
+# Esc quits.
+#
+# Runs on asyncio. Key events only change the local key state; the full
+# state goes out at SEND_RATE_HZ, so any number of events between two
+# sends costs one frame. Pings every PING_INTERVAL measure the round trip
+# and, with the tank's timestamps in the pong, each direction.
+#
+#   python3 tank_controller.py [--transport udp] [--serial-port PORT] [--address HOST]
+#   python3 tank_controller.py --load SECONDS
+#
+# --load runs without the keyboard and floods the tank with state frames
+# at rising rates, up to as fast as the link takes them, to find where
+# its receive path falls behind (see LoadGenerator).
 
-import serial
+import argparse
+import asyncio
+import collections
+import struct
 import sys
-import threading
-from pynput import keyboard
+import time
+
+# 'serial' for the USB link (SerialControl), 'udp' for Wi-Fi
+# (CONTROL_MODE_UDP in the firmware, see UdpControl.h)
+TRANSPORT = 'serial'
 
 # Update this with the correct serial port (e.g., COM5 on Windows, /dev/ttyUSB0 on Linux)
 SERIAL_PORT = 'COM3'  # Replace with your port
 BAUD_RATE = 115200
 
-try:
-    ser = serial.Serial(SERIAL_PORT, BAUD_RATE, timeout=1)
-    print(f"Connected to {SERIAL_PORT} at {BAUD_RATE} baud.")
-except serial.SerialException as e:
-    print(f"Error opening serial port {SERIAL_PORT}: {e}")
-    exit(1)
+# Send the whole control state as one binary frame (see ControlFrame.h).
+# Set to False for the old one-text-line-per-key protocol; the key changes
+# since the last send then go out together.
+USE_BINARY_PROTOCOL = True
+
+# Show binary telemetry from the tank (TELEMETRY_BINARY in the firmware)
+# as a status line that updates in place; text output is printed above it
+SHOW_TELEMETRY_VIEW = True
+
+# UDP: the tank's address (192.168.4.1 when it is the access point)
+TANK_ADDRESS = ('192.168.4.1', 4210)
+
+# The full state is sent this often over either link, changed or not. A
+# lost frame is simply replaced by the next one, and the tank stops once
+# it has heard nothing for 100 ms (FAILSAFE_DEADLINE_MS).
+SEND_RATE_HZ = 50
 
-# Mapping keys to commands
-key_command_map = {
+# Latency probes; a ping unanswered for PING_TIMEOUT counts as lost
+PING_INTERVAL = 0.2
+PING_TIMEOUT = 1.0
+
+# Key names to text commands ("<command>_press" / "<command>_release")
+KEY_COMMANDS = {
     'w': 'forward',
     'a': 'left',
     's': 'back',
     'd': 'right',
     'q': 'turret_left',
     'e': 'turret_right',
+    'up': 'turret_elevate',
+    'down': 'turret_lower',
     'space': 'fire',
 }
 
-# Set to keep track of pressed keys
-pressed_keys = set()
+# Binary frame constants, must match ControlFrame.h
+SYNC_BYTE = 0xA5
+TYPE_CONTROL_STATE = 0x01
+TYPE_TELEMETRY = 0x02
+TYPE_NET_STATE = 0x04
+TYPE_NET_ACK = 0x05
+TYPE_PING = 0x06
+TYPE_PONG = 0x07
+MAX_PAYLOAD = 64
+BUTTON_FIRE = 0x01
+ACK_STALE = 0x01
 
-def on_press(key):
-    try:
-        char = key.char.lower()
-        if char in key_command_map:
-            command = key_command_map[char] + '_press'
-            ser.write((command + '\n').encode())
-            pressed_keys.add(char)
-    except AttributeError:
-        # Handle special keys
-        if key == keyboard.Key.up:
-            ser.write(('turret_elevate_press\n').encode())
-            pressed_keys.add('up')
-        elif key == keyboard.Key.down:
-            ser.write(('turret_lower_press\n').encode())
-            pressed_keys.add('down')
-        elif key == keyboard.Key.space:
-            ser.write(('fire_press\n').encode())
-            pressed_keys.add('space')
-        elif key == keyboard.Key.shift:
-            ser.write(('gear_up\n').encode())
-        elif key == keyboard.Key.ctrl_l or key == keyboard.Key.ctrl_r:
-            ser.write(('gear_down\n').encode())
-
-def on_release(key):
-    try:
-        char = key.char.lower()
-        if char in key_command_map:
-            command = key_command_map[char] + '_release'
-            ser.write((command + '\n').encode())
-            pressed_keys.discard(char)
-    except AttributeError:
-        # Handle special keys
-        if key == keyboard.Key.up:
-            ser.write(('turret_elevate_release\n').encode())
-            pressed_keys.discard('up')
-        elif key == keyboard.Key.down:
-            ser.write(('turret_lower_release\n').encode())
-            pressed_keys.discard('down')
-        elif key == keyboard.Key.space:
-            ser.write(('fire_release\n').encode())
-            pressed_keys.discard('space')
-        elif key == keyboard.Key.esc:
-            # Stop listener
-            ser.close()
+# UDP payloads, must match ControlFrame::NetStatePayload and NetAckPayload
+NET_STATE = struct.Struct('<IIbbbbBB')  # sequence, send time ms, sticks, gear, buttons
+NET_ACK = struct.Struct('<IIIHHBB')     # sequence, send time ms echoed, applied,
+                                        # stale, overflowed, buffered, flags
+
+# Latency probes, must match ControlFrame::PingPayload and PongPayload
+PING = struct.Struct('<II')             # sequence, host time us
+PONG = struct.Struct('<IIIIIIH')        # sequence, host time us echoed, tank receive
+                                        # and send time us, frames, rejected, backlog
+
+# Telemetry fields in frame order, must match Telemetry::Sample
+TELEMETRY_FIELDS = [
+    ('flags', '<B'),
+    ('gear', '<B'),
+    ('left_command', '<b'),
+    ('right_command', '<b'),
+    ('left_output', '<b'),
+    ('right_output', '<b'),
+    ('left_measured', '<b'),
+    ('right_measured', '<b'),
+    ('turret_rotation_rate', '<b'),
+    ('turret_elevation_rate', '<b'),
+    ('turret_rotation', '<h'),      # centidegrees
+    ('turret_elevation', '<h'),
+    ('deadline_misses', '<H'),
+    ('control_sequence', '<H'),
+]
+TELEMETRY_HEADER = struct.Struct('<HIH')  # sequence, timestamp ms, change mask
+ALL_FIELDS = (1 << len(TELEMETRY_FIELDS)) - 1
+FLAG_CONNECTED = 0x01
+FLAG_FIRING = 0x02
+FLAG_CLOSED_LOOP = 0x04
+FLAG_FAILSAFE = 0x08
+
+def crc8(data):
+    # CRC-8, polynomial 0x07, no reflection
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+def encode_frame(frame_type, payload):
+    body = bytes([frame_type, len(payload)]) + payload
+    return bytes([SYNC_BYTE]) + body + bytes([crc8(body)])
+
+def now_ms():
+    return int(time.monotonic() * 1000) & 0xFFFFFFFF
+
+def now_us():
+    return time.monotonic_ns() // 1000
+
+def signed32(value):
+    value &= 0xFFFFFFFF
+    return value - (1 << 32) if value & 0x80000000 else value
+
+class KeyState:
+    """Keys held down and the gear, as the next frame will carry them."""
+
+    def __init__(self):
+        self.pressed = set()
+        self.gear = 1
+        self.frame_sequence = 0
+        self.net_sequence = 0
+        # Text mode: what the tank has been told so far
+        self.sent_keys = set()
+        self.gear_steps = []
+
+    def press(self, name):
+        self.pressed.add(name)
+
+    def release(self, name):
+        self.pressed.discard(name)
+
+    def shift(self, step):
+        gear = min(max(self.gear + step, 1), 5)
+        if gear != self.gear:
+            self.gear = gear
+            self.gear_steps.append('gear_up' if step > 0 else 'gear_down')
+
+    def values(self):
+        """Drive, turn, turret rotation and elevation, buttons from the held keys."""
+        def axis(positive, negative):
+            return (100 if positive in self.pressed else 0) - (100 if negative in self.pressed else 0)
+        drive = axis('w', 's')
+        turn = axis('d', 'a')
+        turret_rotation = -100 if 'q' in self.pressed else (100 if 'e' in self.pressed else 0)
+        turret_elevation = 100 if 'up' in self.pressed else (-100 if 'down' in self.pressed else 0)
+        buttons = BUTTON_FIRE if 'space' in self.pressed else 0
+        return drive, turn, turret_rotation, turret_elevation, buttons
+
+    def state_frame(self):
+        drive, turn, turret_rotation, turret_elevation, buttons = self.values()
+        payload = struct.pack('<Bbbbbbb', self.frame_sequence, drive, turn,
+                              turret_rotation, turret_elevation, self.gear, buttons)
+        self.frame_sequence = (self.frame_sequence + 1) & 0xFF
+        return encode_frame(TYPE_CONTROL_STATE, payload)
+
+    def net_state(self):
+        self.net_sequence += 1
+        drive, turn, turret_rotation, turret_elevation, buttons = self.values()
+        payload = NET_STATE.pack(self.net_sequence, now_ms(), drive, turn,
+                                 turret_rotation, turret_elevation, self.gear, buttons)
+        return encode_frame(TYPE_NET_STATE, payload)
+
+    def text_commands(self):
+        """The presses, releases and gear changes since the last call, or a
+        ping to keep the link up."""
+        lines = [KEY_COMMANDS[k] + '_press' for k in sorted(self.pressed - self.sent_keys) if k in KEY_COMMANDS]
+        lines += [KEY_COMMANDS[k] + '_release' for k in sorted(self.sent_keys - self.pressed) if k in KEY_COMMANDS]
+        lines += self.gear_steps
+        self.sent_keys = set(self.pressed)
+        self.gear_steps = []
+        return ''.join(line + '\n' for line in lines).encode() if lines else b'ping\n'
+
+class Histogram:
+    """Counts of values in ms, with upper bucket bounds."""
+
+    BOUNDS_MS = [0.5, 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000]
+
+    def __init__(self, name):
+        self.name = name
+        self.values = []
+
+    def add(self, value_ms):
+        self.values.append(value_ms)
+
+    def percentile(self, fraction):
+        ordered = sorted(self.values)
+        return ordered[min(int(len(ordered) * fraction), len(ordered) - 1)] if ordered else None
+
+    def summary(self):
+        if not self.values:
+            return f"{self.name} -"
+        return (f"{self.name} median {self.percentile(0.5):.2f} ms 99th {self.percentile(0.99):.2f} ms "
+                f"max {max(self.values):.2f} ms")
+
+    def render(self, width=40):
+        counts = [0] * (len(self.BOUNDS_MS) + 1)
+        for value in self.values:
+            bucket = 0
+            while bucket < len(self.BOUNDS_MS) and value > self.BOUNDS_MS[bucket]:
+                bucket += 1
+            counts[bucket] += 1
+        lines = [self.summary()]
+        peak = max(counts) or 1
+        for bucket, count in enumerate(counts):
+            if not count:
+                continue
+            label = f"<= {self.BOUNDS_MS[bucket]:g} ms" if bucket < len(self.BOUNDS_MS) else f"> {self.BOUNDS_MS[-1]:g} ms"
+            lines.append(f"  {label:>11s} {'#' * max(1, count * width // peak):{width}s} {count}")
+        return '\n'.join(lines)
+
+class LatencyProbe:
+    """Pings the tank and turns the pongs into round-trip and one-way times.
+
+    The tank's clock is offset from ours by an unknown amount. Each pong
+    gives an estimate, assuming both directions took equally long; the
+    one from the fastest recent round trip is the least skewed, and the
+    one-way times are worked out with it. They are exact for that round
+    trip and show the asymmetry of the others."""
+
+    def __init__(self):
+        self.sequence = 0
+        self.pending = {}   # sequence -> (host time us, future or None)
+        self.pings = 0
+        self.pongs = 0
+        self.lost = 0
+        self.rtt = Histogram('rtt')
+        self.up = Histogram('to tank')
+        self.down = Histogram('from tank')
+        self.offsets = collections.deque(maxlen=64)   # (rtt us, offset us)
+        self.last = None    # last pong as a PONG tuple
+        self.backlog_max = 0
+
+    def ping_frame(self, future=None):
+        now = now_us()
+        for sequence, (sent, waiter) in list(self.pending.items()):
+            if now - sent > PING_TIMEOUT * 1e6:
+                del self.pending[sequence]
+                self.lost += 1
+                if waiter and not waiter.done():
+                    waiter.set_result(None)
+        self.sequence += 1
+        self.pending[self.sequence] = (now, future)
+        self.pings += 1
+        return encode_frame(TYPE_PING, PING.pack(self.sequence, now & 0xFFFFFFFF))
+
+    def apply_pong(self, payload):
+        received = now_us()
+        if len(payload) != PONG.size:
             return False
+        pong = PONG.unpack(payload)
+        sequence, _, tank_received, tank_sent = pong[:4]
+        entry = self.pending.pop(sequence, None)
+        if entry is None:
+            return False
+        sent, waiter = entry
+        rtt = received - sent
+        # Tank clock minus ours, seen each way
+        there = signed32(tank_received - sent)
+        back = signed32(tank_sent - received)
+        self.offsets.append((rtt, (there + back) / 2))
+        offset = min(self.offsets)[1]
 
-def keyboard_listener():
-    with keyboard.Listener(on_press=on_press, on_release=on_release) as listener:
-        listener.join()
+        self.pongs += 1
+        self.last = pong
+        self.backlog_max = max(self.backlog_max, pong[6])
+        self.rtt.add(rtt / 1000)
+        self.up.add(max(there - offset, 0) / 1000)
+        self.down.add(max(offset - back, 0) / 1000)
+        if waiter and not waiter.done():
+            waiter.set_result(pong)
+        return True
 
-def serial_reader():
-    try:
+    def render(self):
+        if not self.rtt.values:
+            return 'rtt -'
+        return f"rtt {self.rtt.values[-1]:5.1f} ms (lost {self.lost})"
+
+    def report(self):
+        return '\n'.join([f"pings {self.pings} pongs {self.pongs} lost {self.lost}",
+                          self.rtt.render(), self.up.render(), self.down.render()])
+
+class FrameReader:
+    """Splits the byte stream from the tank into binary frames and text lines."""
+
+    def __init__(self):
+        self.text = bytearray()
+        self.frame = None  # bytes after the sync byte while inside a frame
+        self.rejected = 0
+
+    def feed(self, data):
+        """Yields ('frame', type, payload) and ('text', line) items."""
+        for byte in data:
+            if self.frame is None:
+                if byte == SYNC_BYTE:
+                    self.frame = bytearray()
+                elif byte == ord('\n'):
+                    yield ('text', self.text.decode('utf-8', errors='ignore').rstrip())
+                    self.text.clear()
+                else:
+                    self.text.append(byte)
+                continue
+
+            self.frame.append(byte)
+            if len(self.frame) == 2 and self.frame[1] > MAX_PAYLOAD:
+                self.rejected += 1
+                self.frame = None
+            elif len(self.frame) >= 3 and len(self.frame) == self.frame[1] + 3:
+                body, crc = bytes(self.frame[:-1]), self.frame[-1]
+                self.frame = None
+                if crc8(body) == crc:
+                    yield ('frame', body[0], body[2:])
+                else:
+                    self.rejected += 1
+
+class TelemetryDecoder:
+    """Applies telemetry frames (only changed fields) to the last known values."""
+
+    def __init__(self):
+        self.values = {name: 0 for name, _ in TELEMETRY_FIELDS}
+        self.timestamp_ms = 0
+        self.next_sequence = None
+        self.in_sync = False  # False from a lost frame until the next keyframe
+        self.frames = 0
+        self.frames_lost = 0
+
+    def apply(self, payload):
+        if len(payload) < TELEMETRY_HEADER.size:
+            return False
+        sequence, timestamp_ms, mask = TELEMETRY_HEADER.unpack_from(payload)
+        position = TELEMETRY_HEADER.size
+        changes = {}
+        for bit, (name, fmt) in enumerate(TELEMETRY_FIELDS):
+            if mask & (1 << bit):
+                size = struct.calcsize(fmt)
+                if position + size > len(payload):
+                    return False
+                changes[name] = struct.unpack_from(fmt, payload, position)[0]
+                position += size
+        # Fields newer than this script trail the known ones
+        if position != len(payload) and not mask & ~ALL_FIELDS:
+            return False
+
+        if self.next_sequence is not None and sequence != self.next_sequence:
+            self.frames_lost += (sequence - self.next_sequence) & 0xFFFF
+            self.in_sync = False
+        self.next_sequence = (sequence + 1) & 0xFFFF
+        self.timestamp_ms = timestamp_ms
+        self.values.update(changes)
+        if mask & ALL_FIELDS == ALL_FIELDS:
+            self.in_sync = True
+        self.frames += 1
+        return True
+
+    def render(self):
+        v = self.values
+        flags = v['flags']
+        link = 'connected' if flags & FLAG_CONNECTED else 'no controller'
+        if flags & FLAG_FAILSAFE:
+            link = 'FAILSAFE'
+        measured = ''
+        if flags & FLAG_CLOSED_LOOP:
+            measured = f" meas {v['left_measured']:4d}/{v['right_measured']:4d}"
+        return (f"{self.timestamp_ms / 1000:9.2f}s {'    ' if self.in_sync else 'SYNC'} "
+                f"{link:13s} gear {v['gear']} "
+                f"tracks cmd {v['left_command']:4d}/{v['right_command']:4d} "
+                f"out {v['left_output']:4d}/{v['right_output']:4d}{measured} "
+                f"turret {v['turret_rotation'] / 100:6.1f}/{v['turret_elevation'] / 100:5.1f} deg "
+                f"{'FIRE ' if flags & FLAG_FIRING else ''}"
+                f"misses {v['deadline_misses']} lost {self.frames_lost}")
+
+class AckStats:
+    """Keeps track of the tank's acks to the UDP state datagrams."""
+
+    def __init__(self):
+        self.acked = 0
+        self.last_acked = 0
+        self.stale = 0
+        self.overflowed = 0
+        self.buffered = 0
+        self.rtt_ms = None
+        self.rtt_max_ms = 0
+
+    def apply(self, payload):
+        if len(payload) != NET_ACK.size:
+            return False
+        sequence, sent_ms, applied, stale, overflowed, buffered, flags = NET_ACK.unpack(payload)
+        rtt = (now_ms() - sent_ms) & 0xFFFFFFFF
+        # Smoothed like TCP's SRTT
+        self.rtt_ms = rtt if self.rtt_ms is None else self.rtt_ms + (rtt - self.rtt_ms) / 8
+        self.rtt_max_ms = max(self.rtt_max_ms, rtt)
+        self.acked += 1
+        self.last_acked = max(self.last_acked, sequence)
+        self.stale, self.overflowed, self.buffered = stale, overflowed, buffered
+        return True
+
+    def render(self, sent, sequence):
+        # Sent but not acked, apart from the ones still in flight
+        in_flight = sequence - self.last_acked
+        lost = max(0, sent - self.acked - in_flight)
+        rtt = f"{self.rtt_ms:5.1f}" if self.rtt_ms is not None else '    -'
+        return (f"sent {sent} acked {self.acked} lost {lost} "
+                f"rtt {rtt} ms (max {self.rtt_max_ms}) "
+                f"stale {self.stale} overflowed {self.overflowed} buffered {self.buffered}")
+
+class SerialLink:
+    """The USB serial link, as an asyncio stream."""
+
+    udp = False
+
+    def __init__(self, port, baud_rate):
+        self.port = port
+        self.baud_rate = baud_rate
+        self.reader = None
+        self.writer = None
+
+    async def open(self):
+        import serial_asyncio
+        self.reader, self.writer = await serial_asyncio.open_serial_connection(
+            url=self.port, baudrate=self.baud_rate)
+        print(f"Connected to {self.port} at {self.baud_rate} baud.")
+
+    def limit_buffering(self, size):
+        # So a flood waits in drain() instead of piling up here
+        self.writer.transport.set_write_buffer_limits(high=size)
+
+    def send(self, data):
+        self.writer.write(data)
+
+    async def drain(self):
+        await self.writer.drain()
+
+    async def receive(self):
+        return await self.reader.read(256)
+
+    def close(self):
+        if self.writer:
+            self.writer.close()
+
+class UdpLink(asyncio.DatagramProtocol):
+    """A UDP socket connected to the tank; datagrams are queued for receive()."""
+
+    udp = True
+
+    def __init__(self, address):
+        self.address = address
+        self.transport = None
+        self.queue = asyncio.Queue()
+
+    async def open(self):
+        loop = asyncio.get_running_loop()
+        await loop.create_datagram_endpoint(lambda: self, remote_addr=self.address)
+        print(f"Sending to {self.address[0]}:{self.address[1]} at {SEND_RATE_HZ} Hz.")
+
+    def connection_made(self, transport):
+        self.transport = transport
+
+    def datagram_received(self, data, address):
+        self.queue.put_nowait(data)
+
+    def error_received(self, error):
+        # Nobody listening (yet); the next datagram tries again
+        pass
+
+    def limit_buffering(self, size):
+        pass
+
+    def send(self, data):
+        self.transport.sendto(data)
+
+    async def drain(self):
+        # Datagrams are sent or dropped right away; let the reader run
+        await asyncio.sleep(0)
+
+    async def receive(self):
+        return await self.queue.get()
+
+    def close(self):
+        if self.transport:
+            self.transport.close()
+
+class Controller:
+    """Keyboard control: key state in, coalesced state frames out at a fixed rate."""
+
+    def __init__(self, link, binary):
+        self.link = link
+        self.binary = binary or link.udp
+        self.keys = KeyState()
+        self.probe = LatencyProbe()
+        self.telemetry = TelemetryDecoder()
+        self.acks = AckStats()
+        self.sent = 0
+        self.done = asyncio.Event()
+
+    def state(self):
+        if self.link.udp:
+            return self.keys.net_state()
+        return self.keys.state_frame() if self.binary else self.keys.text_commands()
+
+    async def sender(self):
+        # Paced from a fixed start, so a late wakeup doesn't shift the rest
+        period = 1.0 / SEND_RATE_HZ
+        next_time = time.monotonic()
         while True:
-            line = ser.readline().decode('utf-8', errors='ignore').rstrip()
-            if line:
-                print(f"ESP32: {line}")
-    except KeyboardInterrupt:
-        print("Keyboard interrupt received. Closing serial port and exiting...")
-        ser.close()
-        # Optionally do other cleanup here
-        sys.exit(0)
+            self.link.send(self.state())
+            self.sent += 1
+            next_time += period
+            delay = next_time - time.monotonic()
+            if delay > 0:
+                await asyncio.sleep(delay)
+            else:
+                next_time = time.monotonic()
+
+    async def pinger(self):
+        while True:
+            self.link.send(self.probe.ping_frame())
+            await asyncio.sleep(PING_INTERVAL)
+
+    async def reader(self):
+        frames = FrameReader()
+        while True:
+            data = await self.link.receive()
+            if self.link.udp:
+                # One frame per datagram
+                frames = FrameReader()
+            for item in frames.feed(data):
+                if item[0] == 'text':
+                    if item[1]:
+                        # Above the status line, which is redrawn after it
+                        print(f"\r\x1b[2KESP32: {item[1]}")
+                        self.show_status()
+                elif item[1] == TYPE_TELEMETRY and self.telemetry.apply(item[2]):
+                    self.show_status()
+                elif item[1] == TYPE_NET_ACK and self.acks.apply(item[2]):
+                    self.show_status()
+                elif item[1] == TYPE_PONG:
+                    self.probe.apply_pong(item[2])
+
+    def show_status(self):
+        if not SHOW_TELEMETRY_VIEW:
+            return
+        if self.link.udp:
+            line = self.acks.render(self.sent, self.keys.net_sequence)
+        elif self.telemetry.frames:
+            line = self.telemetry.render()
+        else:
+            return
+        print('\r\x1b[2K' + line + ' ' + self.probe.render(), end='', flush=True)
+
+    def on_key(self, name, pressed):
+        """Runs on the event loop, handed over from the keyboard thread."""
+        if name in KEY_COMMANDS:
+            if pressed:
+                self.keys.press(name)
+            else:
+                self.keys.release(name)
+        elif not pressed:
+            if name == 'esc':
+                self.done.set()
+        elif name == 'shift':
+            self.keys.shift(1)
+        elif name == 'ctrl':
+            self.keys.shift(-1)
+        elif name == 'f1' and not self.link.udp:
+            # Profiler report; a text command in either protocol mode
+            self.link.send(b'stats\n')
+        elif name == 'f2':
+            print('\r\x1b[2K' + self.probe.report())
+
+    def listen_to_keyboard(self, loop):
+        from pynput import keyboard
+        special = {
+            keyboard.Key.up: 'up',
+            keyboard.Key.down: 'down',
+            keyboard.Key.space: 'space',
+            keyboard.Key.shift: 'shift',
+            keyboard.Key.shift_r: 'shift',
+            keyboard.Key.ctrl_l: 'ctrl',
+            keyboard.Key.ctrl_r: 'ctrl',
+            keyboard.Key.f1: 'f1',
+            keyboard.Key.f2: 'f2',
+            keyboard.Key.esc: 'esc',
+        }
+
+        def handler(pressed):
+            def handle(key):
+                char = getattr(key, 'char', None)
+                name = ('space' if char == ' ' else char.lower()) if char else special.get(key)
+                if name:
+                    loop.call_soon_threadsafe(self.on_key, name, pressed)
+            return handle
 
-# Start the keyboard listener in a separate thread
-keyboard_thread = threading.Thread(target=keyboard_listener)
-keyboard_thread.daemon = True
-keyboard_thread.start()
+        listener = keyboard.Listener(on_press=handler(True), on_release=handler(False))
+        listener.daemon = True
+        listener.start()
 
-# Read from serial in the main thread
-serial_reader()
\ No newline at end of file
+    async def run(self):
+        self.listen_to_keyboard(asyncio.get_running_loop())
+        tasks = [asyncio.create_task(task) for task in (self.sender(), self.pinger(), self.reader())]
+        await self.done.wait()
+        for task in tasks:
+            task.cancel()
+        print('\n' + self.probe.report())
+
+class LoadGenerator:
+    """Floods the tank with state frames to find where it falls behind.
+
+    All sticks are centred, so the tank stays put. Each step sends at a
+    fixed rate (0 = as fast as the link takes them) with pings alongside.
+    Between the steps a ping is answered with the number of frames the
+    tank decoded so far, which is compared with what was sent; the pongs
+    also carry what was still waiting in its receive path. A step falls
+    behind when frames go missing or the round trip grows well past the
+    first step's, i.e. frames queue up somewhere on the way."""
+
+    RATES = [50, 100, 200, 500, 1000, 2000, 5000, 10000, 0]
+    BATCH = 16
+    SETTLE = 0.3
+
+    def __init__(self, link, seconds):
+        self.link = link
+        self.step_seconds = seconds / len(self.RATES)
+        self.keys = KeyState()
+        self.probe = LatencyProbe()
+        self.frames = 0   # everything sent, pings included
+
+    def frame(self):
+        return self.keys.net_state() if self.link.udp else self.keys.state_frame()
+
+    async def reader(self):
+        # Serial reads split frames anywhere, so the reader lasts
+        frames = FrameReader()
+        while True:
+            data = await self.link.receive()
+            if self.link.udp:
+                # One frame per datagram
+                frames = FrameReader()
+            for item in frames.feed(data):
+                if item[0] == 'frame' and item[1] == TYPE_PONG:
+                    self.probe.apply_pong(item[2])
+
+    async def snapshot(self):
+        """Pings and waits for the pong; None if it doesn't come."""
+        waiter = asyncio.get_running_loop().create_future()
+        self.link.send(self.probe.ping_frame(waiter))
+        self.frames += 1
+        await self.link.drain()
+        try:
+            return await asyncio.wait_for(waiter, PING_TIMEOUT * 2)
+        except asyncio.TimeoutError:
+            return None
+
+    async def step(self, rate):
+        await asyncio.sleep(self.SETTLE)
+        before = await self.snapshot()
+        frames_before = self.frames
+        first_pong = len(self.probe.rtt.values)
+        self.probe.backlog_max = 0
+        start = time.monotonic()
+        sent = 0
+        next_ping = start + PING_INTERVAL
+        while time.monotonic() - start < self.step_seconds:
+            if rate == 0:
+                due = self.BATCH
+            else:
+                due = min(int(rate * (time.monotonic() - start)) - sent, self.BATCH * 8)
+            for _ in range(due):
+                self.link.send(self.frame())
+            sent += due
+            if time.monotonic() >= next_ping:
+                next_ping += PING_INTERVAL
+                self.link.send(self.probe.ping_frame())
+                self.frames += 1
+            await self.link.drain()
+            if rate != 0:
+                await asyncio.sleep(0.001)
+        elapsed = time.monotonic() - start
+        self.frames += sent
+        await asyncio.sleep(self.SETTLE)
+        rtt = Histogram('rtt')
+        for value in self.probe.rtt.values[first_pong:]:
+            rtt.add(value)
+        backlog = self.probe.backlog_max
+        after = await self.snapshot()
+
+        result = {'rate': rate, 'per_second': sent / elapsed, 'rtt': rtt, 'backlog': backlog,
+                  'decoded': None, 'rejected': None, 'expected': self.frames - frames_before}
+        if before and after:
+            result['decoded'] = (after[4] - before[4]) & 0xFFFFFFFF
+            result['rejected'] = (after[5] - before[5]) & 0xFFFFFFFF
+        return result
+
+    async def run(self):
+        self.link.limit_buffering(1024)
+        reader = asyncio.create_task(self.reader())
+        print(f"Load: {len(self.RATES)} steps of {self.step_seconds:.1f} s, sticks centred")
+        print(f"{'target/s':>9s} {'sent/s':>8s} {'decoded':>8s} {'rejected':>8s} {'backlog':>8s} "
+              f"{'rtt median':>11s} {'rtt max':>9s}")
+        results = []
+        for rate in self.RATES:
+            result = await self.step(rate)
+            results.append(result)
+            decoded = '-' if result['decoded'] is None else f"{result['decoded'] * 100 / max(result['expected'], 1):.1f}%"
+            rejected = '-' if result['rejected'] is None else str(result['rejected'])
+            median = result['rtt'].percentile(0.5)
+            peak = max(result['rtt'].values) if result['rtt'].values else None
+            print(f"{rate if rate else 'max':>9} {result['per_second']:8.0f} {decoded:>8s} {rejected:>8s} "
+                  f"{result['backlog']:8d} "
+                  f"{f'{median:.2f} ms' if median is not None else '-':>11s} "
+                  f"{f'{peak:.1f} ms' if peak is not None else '-':>9s}")
+        reader.cancel()
+
+        baseline = results[0]['rtt'].percentile(0.5)
+        for result in results:
+            median = result['rtt'].percentile(0.5)
+            lost = result['decoded'] is None or result['decoded'] < result['expected'] * 0.99
+            queued = baseline is not None and median is not None and median > max(baseline * 4, baseline + 5)
+            if lost or queued:
+                why = 'frames lost' if lost else f"round trip up from {baseline:.1f} to {median:.1f} ms"
+                print(f"Falls behind at {result['per_second']:.0f} frames/s: {why}")
+                break
+        else:
+            print(f"Kept up with everything, up to {results[-1]['per_second']:.0f} frames/s")
+        print(self.probe.report())
+
+def parse_arguments():
+    parser = argparse.ArgumentParser(description='Keyboard control and link load test for the tank')
+    parser.add_argument('--transport', choices=['serial', 'udp'], default=TRANSPORT)
+    parser.add_argument('--serial-port', default=SERIAL_PORT)
+    parser.add_argument('--baud-rate', type=int, default=BAUD_RATE)
+    parser.add_argument('--address', default=f"{TANK_ADDRESS[0]}:{TANK_ADDRESS[1]}", help='host:port (UDP)')
+    parser.add_argument('--text', action='store_true', help='text commands instead of state frames (serial)')
+    parser.add_argument('--load', type=float, metavar='SECONDS', help='no keyboard: flood the tank, see LoadGenerator')
+    return parser.parse_args()
+
+async def main():
+    args = parse_arguments()
+    if args.transport == 'udp':
+        host, _, port = args.address.partition(':')
+        link = UdpLink((host, int(port or TANK_ADDRESS[1])))
+    else:
+        link = SerialLink(args.serial_port, args.baud_rate)
+    try:
+        await link.open()
+    except (OSError, ImportError) as e:
+        print(f"Error opening {args.transport} link: {e}")
+        return 1
+    try:
+        if args.load:
+            await LoadGenerator(link, args.load).run()
+        else:
+            await Controller(link, USE_BINARY_PROTOCOL and not args.text).run()
+    finally:
+        link.close()
+    return 0
+
+if __name__ == '__main__':
+    try:
+        sys.exit(asyncio.run(main()))
+    except KeyboardInterrupt:
+        print("\nKeyboard interrupt received. Exiting...")
+        sys.exit(0)
@@ -0,0 +1,54 @@
+# test_load_reader.py
+# Feeds tank_controller.py's load generator pongs the way the links
+# deliver them, without a tank: on serial, split across two reads; over
+# UDP, a truncated datagram followed by a whole one.
+#   python3 test_load_reader.py
+# Exits 1 if a pong is not decoded.
+import asyncio
+import sys
+
+import tank_controller as tc
+
+class ChunkLink:
+    """Hands the reader one chunk per receive(), then waits forever."""
+
+    def __init__(self, chunks, udp):
+        self.chunks = list(chunks)
+        self.udp = udp
+
+    async def receive(self):
+        if self.chunks:
+            return self.chunks.pop(0)
+        await asyncio.Event().wait()
+
+def pong_frame(generator):
+    # Answers the ping the probe has pending, as the tank would
+    generator.probe.ping_frame()
+    sequence = generator.probe.sequence
+    payload = tc.PONG.pack(sequence, 0, 1000, 1010, 1, 0, 0)
+    return tc.encode_frame(tc.TYPE_PONG, payload)
+
+async def pongs_decoded(chunks_of, udp):
+    generator = tc.LoadGenerator(ChunkLink([], udp), 1)
+    generator.link.chunks = chunks_of(pong_frame(generator))
+    reader = asyncio.create_task(generator.reader())
+    await asyncio.sleep(0.05)
+    reader.cancel()
+    return generator.probe.pongs
+
+def main():
+    failed = False
+    checks = [
+        ('serial: pong split across two reads', False, lambda frame: [frame[:9], frame[9:]]),
+        ('serial: pong split after the sync byte', False, lambda frame: [b'ok\n' + frame[:1], frame[1:]]),
+        ('udp: truncated datagram, then a whole one', True, lambda frame: [frame[:9], frame]),
+    ]
+    for name, udp, chunks_of in checks:
+        passed = asyncio.run(pongs_decoded(chunks_of, udp)) == 1
+        print(f"  {name:<50s} {'ok' if passed else 'FAIL'}")
+        failed = failed or not passed
+    print('FAIL' if failed else 'PASS')
+    return 1 if failed else 0
+
+if __name__ == '__main__':
+    sys.exit(main())
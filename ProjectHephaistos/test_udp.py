@@ -0,0 +1,120 @@
+# test_udp.py
+# Drives the tank over UDP (CONTROL_MODE_UDP) with a fixed-rate sender
+# and reports the acks: forward, a turn, stop, then the turret, at 50 Hz.
+# Against the host build, over loopback:
+#   build/host/hephaistos_sim_udp --listen 12 &
+#   python3 test_udp.py --address 127.0.0.1 --duplicate 0.05 --reorder 0.05
+# Exits 1 if fewer than 90 % of the datagrams were acked.
+import argparse
+import random
+import socket
+import struct
+import sys
+import time
+
+TYPE_NET_STATE = 0x04
+TYPE_NET_ACK = 0x05
+ACK_STALE = 0x01
+NET_STATE = struct.Struct('<IIbbbbBB')  # must match ControlFrame::NetStatePayload
+NET_ACK = struct.Struct('<IIIHHBB')     # must match ControlFrame::NetAckPayload
+
+# Seconds from the start, then drive, turn, turret rotation, turret elevation
+SCRIPT = [
+    (0.0, (0, 0, 0, 0)),
+    (1.0, (100, 0, 0, 0)),
+    (3.0, (100, 50, 0, 0)),
+    (5.0, (0, 0, 0, 0)),
+    (6.0, (0, 0, 100, 0)),
+    (8.0, (0, 0, 0, 0)),
+]
+DURATION = 9.0
+
+def crc8(data):
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+def encode_frame(frame_type, payload):
+    body = bytes([frame_type, len(payload)]) + payload
+    return bytes([0xA5]) + body + bytes([crc8(body)])
+
+def decode_ack(data):
+    if len(data) != NET_ACK.size + 4 or data[0] != 0xA5 or data[1] != TYPE_NET_ACK:
+        return None
+    if crc8(data[1:-1]) != data[-1]:
+        return None
+    return NET_ACK.unpack(data[3:-1])
+
+def now_ms():
+    return int(time.monotonic() * 1000) & 0xFFFFFFFF
+
+def main():
+    parser = argparse.ArgumentParser(description='Fixed-rate UDP control sender')
+    parser.add_argument('--address', default='192.168.4.1')
+    parser.add_argument('--port', type=int, default=4210)
+    parser.add_argument('--rate', type=float, default=50, help='datagrams per second')
+    parser.add_argument('--gear', type=int, default=3)
+    parser.add_argument('--duplicate', type=float, default=0, help='chance to send a datagram twice')
+    parser.add_argument('--reorder', type=float, default=0, help='chance to hold one back behind the next')
+    args = parser.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setblocking(False)
+    target = (args.address, args.port)
+    random.seed(1)
+
+    sent = acked = stale_acks = 0
+    rtts = []
+    held = None
+    sequence = 0
+    start = time.monotonic()
+    next_time = start
+    while time.monotonic() - start < DURATION + 0.5:
+        elapsed = time.monotonic() - start
+        if elapsed < DURATION and time.monotonic() >= next_time:
+            sticks = [values for at, values in SCRIPT if at <= elapsed][-1]
+            sequence += 1
+            datagram = encode_frame(TYPE_NET_STATE, NET_STATE.pack(sequence, now_ms(), *sticks, args.gear, 0))
+            if held is None and random.random() < args.reorder:
+                held = datagram
+            else:
+                sock.sendto(datagram, target)
+                sent += 1
+                if random.random() < args.duplicate:
+                    sock.sendto(datagram, target)
+                    sent += 1
+                if held is not None:
+                    sock.sendto(held, target)
+                    sent += 1
+                    held = None
+            next_time += 1.0 / args.rate
+
+        try:
+            while True:
+                ack = decode_ack(sock.recv(256))
+                if ack is None:
+                    continue
+                acked += 1
+                rtts.append((now_ms() - ack[1]) & 0xFFFFFFFF)
+                if ack[6] & ACK_STALE:
+                    stale_acks += 1
+                last = ack
+        except (BlockingIOError, ConnectionRefusedError):
+            # Nothing waiting, or nobody listening (yet)
+            pass
+        time.sleep(0.001)
+
+    if not rtts:
+        print(f"sent {sent}, no acks from {args.address}:{args.port}")
+        return 1
+    rtts.sort()
+    print(f"sent {sent} acked {acked} ({acked * 100 // sent} %), {stale_acks} acked as stale")
+    print(f"rtt median {rtts[len(rtts) // 2]} ms, 99th {rtts[len(rtts) * 99 // 100]} ms, max {rtts[-1]} ms")
+    print(f"tank: applied up to {last[2]}, stale {last[3]}, overflowed {last[4]}, buffered {last[5]}")
+    return 0 if acked * 10 >= sent * 9 else 1
+
+if __name__ == '__main__':
+    sys.exit(main())
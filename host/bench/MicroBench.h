@@ -0,0 +1,312 @@
+#ifndef MICRO_BENCH_H
+#define MICRO_BENCH_H
+
+// Small Google Benchmark style harness for the host build.
+//
+// A benchmark is a function that sets up, then runs its operation while
+// state.next() returns true:
+//
+//   static void parseFrame(MicroBench::State& state) {
+//       ...setup, not timed...
+//       while (state.next()) {
+//           ...one operation...
+//       }
+//       state.setItemsPerOp(frameBytes, "B");
+//   }
+//   MicroBench::add("serial/parse_frame", parseFrame);
+//
+// The harness calls it with growing iteration counts until a run lasts
+// minTimeMs, and reports ns/op, heap allocations per op (operator new
+// calls while the operation runs) and throughput. Names can't have spaces.
+// Results can be saved as a baseline and later runs compared against it.
+//
+// Include from the bench's one source file: it replaces the global
+// operator new/delete to count allocations.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace MicroBench {
+
+inline std::atomic<uint64_t>& allocationCount() {
+    static std::atomic<uint64_t> count(0);
+    return count;
+}
+
+// Keeps the compiler from optimizing value (and what leads to it) away
+template <typename T>
+inline void keep(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+class State {
+public:
+    explicit State(uint64_t iterations)
+        : remaining(iterations),
+          iterations(iterations),
+          started(false),
+          allocationsAtStart(0),
+          allocations(0),
+          elapsedNs(0),
+          itemsPerOp(0),
+          itemUnit("op") {}
+
+    // True while there are iterations left; the first call starts the
+    // timer, the last stops it
+    bool next() {
+        if (!started) {
+            started = true;
+            allocationsAtStart = allocationCount().load(std::memory_order_relaxed);
+            start = Clock::now();
+        }
+        if (remaining > 0) {
+            remaining--;
+            return true;
+        }
+        elapsedNs += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        allocations = allocationCount().load(std::memory_order_relaxed) - allocationsAtStart;
+        return false;
+    }
+
+    // What one operation processes, for the throughput column
+    void setItemsPerOp(double items, const char* unit) {
+        itemsPerOp = items;
+        itemUnit = unit;
+    }
+
+    uint64_t iterationCount() const { return iterations; }
+    double nanoseconds() const { return elapsedNs; }
+    uint64_t allocationTotal() const { return allocations; }
+    double items() const { return itemsPerOp; }
+    const char* unit() const { return itemUnit; }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    uint64_t remaining;
+    uint64_t iterations;
+    bool started;
+    Clock::time_point start;
+    uint64_t allocationsAtStart;
+    uint64_t allocations;
+    double elapsedNs;
+    double itemsPerOp;
+    const char* itemUnit;
+};
+
+typedef void (*Function)(State& state);
+
+struct Result {
+    std::string name;
+    double nsPerOp;
+    double allocsPerOp;
+    double itemsPerSecond;
+    std::string unit;
+};
+
+struct Entry {
+    const char* name;
+    Function function;
+};
+
+inline std::vector<Entry>& registry() {
+    static std::vector<Entry> entries;
+    return entries;
+}
+
+inline void add(const char* name, Function function) {
+    registry().push_back(Entry{name, function});
+}
+
+// Runs function with growing iteration counts until one run takes at
+// least minTimeMs
+inline Result measure(const char* name, Function function, double minTimeMs) {
+    uint64_t iterations = 1;
+    for (;;) {
+        State state(iterations);
+        function(state);
+        double ms = state.nanoseconds() / 1e6;
+        if (ms >= minTimeMs || iterations >= (1ULL << 34)) {
+            Result result;
+            result.name = name;
+            result.nsPerOp = state.nanoseconds() / iterations;
+            result.allocsPerOp = (double)state.allocationTotal() / iterations;
+            result.itemsPerSecond = result.nsPerOp > 0 ? state.items() * 1e9 / result.nsPerOp : 0;
+            result.unit = state.unit();
+            return result;
+        }
+        // Aim past minTimeMs in the next run, growing at most 10x
+        double scale = ms > 0 ? minTimeMs * 1.4 / ms : 10;
+        scale = scale > 10 ? 10 : (scale < 2 ? 2 : scale);
+        iterations = (uint64_t)(iterations * scale);
+    }
+}
+
+// Throughput with an SI prefix, e.g. "12.3M B/s"
+inline std::string formatRate(double perSecond, const std::string& unit) {
+    static const char* prefixes[] = {"", "k", "M", "G"};
+    int prefix = 0;
+    while (perSecond >= 1000 && prefix < 3) {
+        perSecond /= 1000;
+        prefix++;
+    }
+    char text[32];
+    snprintf(text, sizeof(text), "%.1f%s %s/s", perSecond, prefixes[prefix], unit.c_str());
+    return text;
+}
+
+// Baseline file: one "name ns_per_op allocs_per_op" line per benchmark,
+// # starts a comment
+inline bool loadBaseline(const char* path, std::vector<Result>& results) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        char name[128];
+        Result result;
+        if (line[0] == '#' || sscanf(line, "%127s %lf %lf", name, &result.nsPerOp, &result.allocsPerOp) != 3) {
+            continue;
+        }
+        result.name = name;
+        result.itemsPerSecond = 0;
+        results.push_back(result);
+    }
+    fclose(file);
+    return true;
+}
+
+inline bool saveBaseline(const char* path, const std::vector<Result>& results) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+    fprintf(file, "# name ns/op allocs/op (written by --save, compared by --baseline)\n");
+    for (const Result& result : results) {
+        fprintf(file, "%s %.1f %.2f\n", result.name.c_str(), result.nsPerOp, result.allocsPerOp);
+    }
+    fclose(file);
+    return true;
+}
+
+inline const Result* find(const std::vector<Result>& results, const std::string& name) {
+    for (const Result& result : results) {
+        if (result.name == name) {
+            return &result;
+        }
+    }
+    return nullptr;
+}
+
+// Command line: [--filter text] [--min-time ms] [--baseline file]
+// [--tolerance fraction] [--save file]. Returns the exit code: 1 if a
+// benchmark is slower than its baseline by more than the tolerance or
+// allocates more, 2 on bad arguments or files.
+inline int run(int argc, char** argv) {
+    const char* filter = nullptr;
+    const char* baselinePath = nullptr;
+    const char* savePath = nullptr;
+    double minTimeMs = 200;
+    double tolerance = 0.25;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--filter") == 0 && hasValue) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--min-time") == 0 && hasValue) {
+            minTimeMs = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--baseline") == 0 && hasValue) {
+            baselinePath = argv[++i];
+        } else if (strcmp(argv[i], "--tolerance") == 0 && hasValue) {
+            tolerance = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--save") == 0 && hasValue) {
+            savePath = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--filter text] [--min-time ms] [--baseline file] "
+                            "[--tolerance fraction] [--save file]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<Result> baseline;
+    if (baselinePath && !loadBaseline(baselinePath, baseline)) {
+        fprintf(stderr, "Can't read baseline %s\n", baselinePath);
+        return 2;
+    }
+
+    printf("%-36s %10s %10s %16s", "benchmark", "ns/op", "allocs/op", "throughput");
+    printf(baselinePath ? "  vs baseline\n" : "\n");
+    std::vector<Result> results;
+    int regressions = 0;
+    for (const Entry& entry : registry()) {
+        if (filter && !strstr(entry.name, filter)) {
+            continue;
+        }
+        Result result = measure(entry.name, entry.function, minTimeMs);
+        results.push_back(result);
+        printf("%-36s %10.1f %10.2f %16s", result.name.c_str(), result.nsPerOp, result.allocsPerOp,
+               formatRate(result.itemsPerSecond, result.unit).c_str());
+        const Result* base = baselinePath ? find(baseline, result.name) : nullptr;
+        if (base) {
+            double change = base->nsPerOp > 0 ? result.nsPerOp / base->nsPerOp - 1 : 0;
+            bool slower = change > tolerance;
+            bool allocates = result.allocsPerOp > base->allocsPerOp + 0.005;
+            printf("  %+6.1f %%%s%s", change * 100, slower ? "  SLOWER" : "", allocates ? "  ALLOCATES" : "");
+            regressions += slower || allocates;
+        } else if (baselinePath) {
+            printf("  (new)");
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+
+    if (savePath && !saveBaseline(savePath, results)) {
+        fprintf(stderr, "Can't write baseline %s\n", savePath);
+        return 2;
+    }
+    if (baselinePath) {
+        printf("\n%d regression(s) beyond %.0f %% or in allocations\n", regressions, tolerance * 100);
+    }
+    return regressions ? 1 : 0;
+}
+
+} // namespace MicroBench
+
+// Counting replacements for the global allocation functions
+void* operator new(size_t size) {
+    MicroBench::allocationCount().fetch_add(1, std::memory_order_relaxed);
+    void* block = malloc(size ? size : 1);
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    return block;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* block) noexcept {
+    free(block);
+}
+
+void operator delete[](void* block) noexcept {
+    free(block);
+}
+
+void operator delete(void* block, size_t) noexcept {
+    free(block);
+}
+
+void operator delete[](void* block, size_t) noexcept {
+    free(block);
+}
+
+#endif // MICRO_BENCH_H
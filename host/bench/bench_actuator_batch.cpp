@@ -0,0 +1,106 @@
+// Output writes per actuation tick: batched ActuatorBackend commits vs.
+// one write per output per tick, as the relay code in loop() did.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -IProjectHephaistos -Ihost/sim
+//       host/bench/bench_actuator_batch.cpp ProjectHephaistos/ActuatorBackend.cpp
+//       ProjectHephaistos/HBridgeMotorDriver.cpp ProjectHephaistos/TrackMotor.cpp
+//       ProjectHephaistos/SlewLimiter.cpp -o bench_actuator_batch
+//   ./bench_actuator_batch
+//
+// Two ramped track motors and a flamethrower output follow a scripted
+// drive (stick changes every few hundred ms) at the firmware's actuation
+// rate, through the mock backend. Exits non-zero if a commit ever leaves
+// both inputs of an H-bridge high.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ActuatorBackend.h"
+#include "HBridgeMotorDriver.h"
+#include "TrackMotor.h"
+#include "MockActuatorBackend.h"
+
+static const uint32_t updateHz = 500;
+static const uint32_t seconds = 60;
+
+enum Pin {
+    LEFT_PWM = 13, LEFT_FORWARD = 25, LEFT_REVERSE = 26,
+    RIGHT_PWM = 4, RIGHT_FORWARD = 27, RIGHT_REVERSE = 33,
+    FLAMETHROWER = 32
+};
+
+// Digital and PWM outputs the old code would write every tick
+static const uint32_t digitalOutputs = 5;
+static const uint32_t pwmOutputs = 2;
+
+static int constrainTrack(int speed) {
+    return speed > 100 ? 100 : (speed < -100 ? -100 : speed);
+}
+
+int main() {
+    MockActuatorBackend actuators;
+    HBridgeMotorDriver leftDriver(actuators, LEFT_PWM, LEFT_FORWARD, LEFT_REVERSE);
+    HBridgeMotorDriver rightDriver(actuators, RIGHT_PWM, RIGHT_FORWARD, RIGHT_REVERSE);
+    TrackMotor left(leftDriver);
+    TrackMotor right(rightDriver);
+
+    left.begin(20000, 10);
+    right.begin(20000, 10);
+    actuators.addDigitalOutput(FLAMETHROWER, false);
+    left.setRamp(250, 2500, updateHz);
+    right.setRamp(250, 2500, updateHz);
+    actuators.ticks.clear();
+
+    bool ok = true;
+    bool fire = false;
+    srand(7);
+    uint32_t nextChange = 0;
+    for (uint32_t tick = 0; tick < seconds * updateHz; tick++) {
+        if (tick == nextChange) {
+            int drive = rand() % 201 - 100;
+            int turn = (rand() % 3 == 0) ? rand() % 201 - 100 : 0;
+            left.setTarget((int8_t)constrainTrack(drive + turn));
+            right.setTarget((int8_t)constrainTrack(drive - turn));
+            fire = rand() % 5 == 0;
+            nextChange += updateHz / 10 + rand() % updateHz;
+        }
+
+        left.update();
+        right.update();
+        actuators.setDigital(FLAMETHROWER, fire);
+        actuators.commit();
+        actuators.endTick();
+
+        if ((actuators.level(LEFT_FORWARD) && actuators.level(LEFT_REVERSE)) ||
+            (actuators.level(RIGHT_FORWARD) && actuators.level(RIGHT_REVERSE))) {
+            printf("tick %u: both bridge inputs high\n", tick);
+            ok = false;
+        }
+    }
+
+    uint32_t ticks = actuators.ticks.size();
+    uint64_t registerWrites = 0, pwmWrites = 0;
+    uint32_t idleTicks = 0, maxWrites = 0;
+    for (const MockActuatorBackend::TickWrites& t : actuators.ticks) {
+        registerWrites += t.registerWrites;
+        pwmWrites += t.pwmWrites;
+        uint32_t writes = t.registerWrites + t.pwmWrites;
+        if (writes == 0) {
+            idleTicks++;
+        }
+        if (writes > maxWrites) {
+            maxWrites = writes;
+        }
+    }
+
+    const ActuatorBackend::Stats& stats = actuators.stats();
+    printf("%u ticks at %u Hz, %u digital + %u PWM outputs\n\n", ticks, updateHz, digitalOutputs, pwmOutputs);
+    printf("per output, every tick  %6.2f writes/tick  (%u digital + %u PWM)\n",
+           (double)(digitalOutputs + pwmOutputs), digitalOutputs, pwmOutputs);
+    printf("batched commits         %6.2f writes/tick  (%.2f register + %.2f PWM), max %u\n",
+           (double)(registerWrites + pwmWrites) / ticks, (double)registerWrites / ticks,
+           (double)pwmWrites / ticks, maxWrites);
+    printf("ticks without any write %5.1f %%\n", 100.0 * idleTicks / ticks);
+    printf("pin changes %u, outputs skipped %u\n", stats.pinChanges, stats.skipped);
+    return ok ? 0 : 1;
+}
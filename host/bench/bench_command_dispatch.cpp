@@ -0,0 +1,113 @@
+// Text command dispatch: compile-time perfect hash (SerialCommands::lookup)
+// vs. the if/else chain of strcmp() calls it replaced.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -IProjectHephaistos host/bench/bench_command_dispatch.cpp
+//       -o bench_command_dispatch
+//   ./bench_command_dispatch
+//
+// The corpus mixes all known commands with unknown lines, which used to
+// fall through every comparison in the chain.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "SerialCommands.h"
+
+static const int corpusSize = 100000;
+static const int repeats = 50;
+
+struct Line {
+    char text[40];
+    size_t length;
+};
+
+// The chain as it was in SerialControl::processCommand(); returns the
+// position in SerialCommands::commands, or -1
+static int chainDispatch(const char* command) {
+    if (strcmp(command, "forward_press") == 0) { return 0; }
+    else if (strcmp(command, "forward_release") == 0) { return 1; }
+    else if (strcmp(command, "back_press") == 0) { return 2; }
+    else if (strcmp(command, "back_release") == 0) { return 3; }
+    else if (strcmp(command, "left_press") == 0) { return 4; }
+    else if (strcmp(command, "left_release") == 0) { return 5; }
+    else if (strcmp(command, "right_press") == 0) { return 6; }
+    else if (strcmp(command, "right_release") == 0) { return 7; }
+    else if (strcmp(command, "turret_left_press") == 0) { return 8; }
+    else if (strcmp(command, "turret_left_release") == 0) { return 9; }
+    else if (strcmp(command, "turret_right_press") == 0) { return 10; }
+    else if (strcmp(command, "turret_right_release") == 0) { return 11; }
+    else if (strcmp(command, "turret_elevate_press") == 0) { return 12; }
+    else if (strcmp(command, "turret_elevate_release") == 0) { return 13; }
+    else if (strcmp(command, "turret_lower_press") == 0) { return 14; }
+    else if (strcmp(command, "turret_lower_release") == 0) { return 15; }
+    else if (strcmp(command, "fire_press") == 0) { return 16; }
+    else if (strcmp(command, "fire_release") == 0) { return 17; }
+    else if (strcmp(command, "gear_up") == 0) { return 18; }
+    else if (strcmp(command, "gear_down") == 0) { return 19; }
+    else if (strcmp(command, "stats") == 0) { return 20; }
+    else if (strcmp(command, "ping") == 0) { return 21; }
+    return -1;
+}
+
+static int tableDispatch(const char* command, size_t length) {
+    const SerialCommands::Command* entry = SerialCommands::lookup(command, length);
+    return entry ? (int)(entry - SerialCommands::commands) : -1;
+}
+
+static std::vector<Line> buildCorpus(int unknownPercent) {
+    static const char* unknown[] = {
+        "hello", "forward", "turret_left_pres", "fire_presss", "status", "gear_upp", "Hello from Python!"
+    };
+    std::vector<Line> corpus(corpusSize);
+    srand(3);
+    for (Line& line : corpus) {
+        const char* text = (rand() % 100 < unknownPercent)
+            ? unknown[rand() % 7]
+            : SerialCommands::commands[rand() % SerialCommands::commandCount].name;
+        line.length = strlen(text);
+        memcpy(line.text, text, line.length + 1);
+    }
+    return corpus;
+}
+
+template <typename Dispatch>
+static double run(const std::vector<Line>& corpus, Dispatch dispatch, long& checksum) {
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++) {
+        for (const Line& line : corpus) {
+            checksum += dispatch(line);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return seconds * 1e9 / ((double)corpus.size() * repeats);
+}
+
+int main() {
+    printf("%zu commands, perfect hash seed %u over %zu slots\n\n",
+           SerialCommands::commandCount, SerialCommands::seed, SerialCommands::slotCount);
+
+    // Both dispatchers must agree on every line
+    std::vector<Line> check = buildCorpus(30);
+    for (const Line& line : check) {
+        if (chainDispatch(line.text) != tableDispatch(line.text, line.length)) {
+            printf("MISMATCH on '%s'\n", line.text);
+            return 1;
+        }
+    }
+
+    const int mixes[] = {0, 10, 50};
+    for (int unknownPercent : mixes) {
+        std::vector<Line> corpus = buildCorpus(unknownPercent);
+        long chainSum = 0, tableSum = 0;
+        double chainNs = run(corpus, [](const Line& l) { return chainDispatch(l.text); }, chainSum);
+        double tableNs = run(corpus, [](const Line& l) { return tableDispatch(l.text, l.length); }, tableSum);
+        printf("%2d%% unknown   strcmp chain %6.1f ns/line   perfect hash %6.1f ns/line   (%.1fx)%s\n",
+               unknownPercent, chainNs, tableNs, chainNs / tableNs,
+               chainSum == tableSum ? "" : "   CHECKSUM MISMATCH");
+    }
+    return 0;
+}
@@ -0,0 +1,388 @@
+// Control hot paths: each backend's update() through to the published
+// state, the serial parser on realistic input, RC pulses to commands and
+// the status output, with ns/op, allocations/op and throughput.
+//
+// Built by CMake as bench_hot_paths (all control backends in one binary,
+// against the host shim):
+//   cmake -S . -B build && cmake --build build
+//   build/host/bench_hot_paths --baseline host/bench/baselines/bench_hot_paths.txt
+//
+// --save FILE writes the results as a new baseline; take it on the
+// machine the comparisons run on (timings only compare on the same
+// machine, allocation counts anywhere). Exits non-zero if a benchmark got
+// slower than --tolerance (default 25 %) or allocates more than its
+// baseline. The target "check_hot_paths" runs the comparison.
+//
+// Inputs arrive the way they do on the tank: bytes in the UART buffer,
+// gamepad and keyboard reports through BP32, edges on the receiver pins,
+// datagrams on a loopback socket;
+// putting them there is part of each measured operation.
+
+#include "MicroBench.h"
+#include <Arduino.h>
+#include <Bluepad32.h>
+#include <WiFiUdp.h>
+#include "HostSim.h"
+#include "RcPulseTrain.h"
+#include "ControlFrame.h"
+#include "Log.h"
+#include "Telemetry.h"
+#include "SerialControl.h"
+#include "BluetoothControl.h"
+#include "KeyboardControl.h"
+#include "RCControl.h"
+#include "RCBusControl.h"
+#include "UdpControl.h"
+
+static size_t discardLog(const uint8_t* data, size_t length) {
+    return length;
+}
+
+static size_t stateFrame(uint8_t sequence, int8_t drive, int8_t turn, uint8_t* out, size_t outSize) {
+    ControlFrame::ControlStatePayload payload = {sequence, drive, turn, 0, 0, 1, 0};
+    return ControlFrame::encode(ControlFrame::TYPE_CONTROL_STATE, &payload, sizeof(payload), out, outSize);
+}
+
+// ----------------------
+// Serial corpora
+// ----------------------
+
+// A driving session as tank_controller.py sends it in text mode: one
+// line per key press and release, with the odd gear change
+static std::string keySessionCorpus() {
+    static const char* keys[] = {"forward", "left", "right", "back", "turret_left", "turret_right",
+                                 "turret_elevate", "turret_lower", "fire"};
+    std::string corpus;
+    uint32_t seed = 1;
+    while (corpus.size() < 4096) {
+        seed = seed * 1103515245 + 12345;
+        const char* key = keys[(seed >> 16) % (sizeof(keys) / sizeof(keys[0]))];
+        corpus += std::string(key) + "_press\n";
+        if ((seed >> 8) % 8 == 0) {
+            corpus += (seed >> 12) % 2 ? "gear_up\n" : "gear_down\n";
+        }
+        corpus += std::string(key) + "_release\n";
+    }
+    return corpus;
+}
+
+// Full-state binary frames, a stick sweep
+static std::string frameStreamCorpus() {
+    std::string corpus;
+    uint8_t frame[sizeof(ControlFrame::ControlStatePayload) + ControlFrame::overhead];
+    for (uint8_t sequence = 0; corpus.size() < 4096; sequence++) {
+        size_t length = stateFrame(sequence, (int8_t)(sequence % 201 - 100), (int8_t)(sequence % 41 - 20),
+                                   frame, sizeof(frame));
+        corpus.append((const char*)frame, length);
+    }
+    return corpus;
+}
+
+// Text and frames with what a noisy link adds: unknown and overlong
+// lines, CRLF endings, stray sync bytes and a corrupted frame
+static std::string noisyCorpus() {
+    std::string corpus;
+    uint8_t frame[sizeof(ControlFrame::ControlStatePayload) + ControlFrame::overhead];
+    for (uint8_t round = 0; corpus.size() < 4096; round++) {
+        corpus += "forward_press\r\n";
+        corpus += "hello from the terminal\n";
+        corpus += std::string(120, 'x') + "\n";
+        size_t length = stateFrame(round, 50, -10, frame, sizeof(frame));
+        corpus.append((const char*)frame, length);
+        frame[4] ^= 0x20;
+        corpus.append((const char*)frame, length);
+        corpus += (char)ControlFrame::syncByte;
+        corpus += "  forward_release \n";
+    }
+    return corpus;
+}
+
+// Feeds corpus to the backend as the UART delivers it: a buffer's worth
+// at a time, an update() after each
+static void parseCorpus(MicroBench::State& state, const std::string& corpus) {
+    SerialControl control;
+    const size_t chunk = 256;
+    while (state.next()) {
+        for (size_t offset = 0; offset < corpus.size(); offset += chunk) {
+            size_t length = corpus.size() - offset < chunk ? corpus.size() - offset : chunk;
+            Serial.inject((const uint8_t*)corpus.data() + offset, length);
+            control.update();
+        }
+        MicroBench::keep(control.getState());
+    }
+    state.setItemsPerOp(corpus.size(), "B");
+}
+
+static void serialKeyCorpus(MicroBench::State& state) {
+    static const std::string corpus = keySessionCorpus();
+    parseCorpus(state, corpus);
+}
+
+static void serialFrameCorpus(MicroBench::State& state) {
+    static const std::string corpus = frameStreamCorpus();
+    parseCorpus(state, corpus);
+}
+
+static void serialNoisyCorpus(MicroBench::State& state) {
+    static const std::string corpus = noisyCorpus();
+    parseCorpus(state, corpus);
+}
+
+// ----------------------
+// Backend update()
+// ----------------------
+static void serialIdle(MicroBench::State& state) {
+    SerialControl control;
+    while (state.next()) {
+        control.update();
+        MicroBench::keep(control.getState());
+    }
+    state.setItemsPerOp(1, "update");
+}
+
+static void serialKeyLine(MicroBench::State& state) {
+    SerialControl control;
+    static const char* lines[] = {"forward_press\n", "right_press\n", "right_release\n", "forward_release\n"};
+    uint32_t i = 0;
+    while (state.next()) {
+        Serial.inject(lines[i++ % 4]);
+        control.update();
+        MicroBench::keep(control.getState());
+    }
+    state.setItemsPerOp(1, "update");
+}
+
+static void serialStateFrame(MicroBench::State& state) {
+    SerialControl control;
+    uint8_t frames[64][sizeof(ControlFrame::ControlStatePayload) + ControlFrame::overhead];
+    for (uint8_t i = 0; i < 64; i++) {
+        stateFrame(i, (int8_t)(i * 3 - 96), (int8_t)(i - 32), frames[i], sizeof(frames[i]));
+    }
+    uint32_t i = 0;
+    while (state.next()) {
+        Serial.inject(frames[i++ % 64], sizeof(frames[0]));
+        control.update();
+        MicroBench::keep(control.getState());
+    }
+    state.setItemsPerOp(1, "update");
+}
+
+// Stick positions across the range, as a gamepad sends them
+static int32_t stickPosition(uint32_t i) {
+    return (int32_t)((i * 37) % 1024) - 512;
+}
+
+static void bluetoothReport(MicroBench::State& state) {
+    BluetoothControl control;
+    Controller gamepad;
+    BP32.connect(&gamepad);
+    control.update();
+    uint32_t i = 0;
+    while (state.next()) {
+        gamepad.setAxes(stickPosition(i), stickPosition(i + 7), stickPosition(i + 13), stickPosition(i + 29));
+        i++;
+        BP32.report();
+        control.update();
+        MicroBench::keep(control.getState());
+    }
+    BP32.disconnect();
+    control.update();
+    state.setItemsPerOp(1, "update");
+}
+
+static void bluetoothNoReport(MicroBench::State& state) {
+    BluetoothControl control;
+    Controller gamepad;
+    gamepad.setAxes(100, -300, 0, 0);
+    BP32.connect(&gamepad);
+    control.update();
+    while (state.next()) {
+        control.update();
+        MicroBench::keep(control.getState());
+    }
+    BP32.disconnect();
+    control.update();
+    state.setItemsPerOp(1, "update");
+}
+
+static void keyboardReport(MicroBench::State& state) {
+    KeyboardControl control;
+    Controller keyboard(true);
+    BP32.connect(&keyboard);
+    control.update();
+    static const KeyboardKey keys[] = {KeyboardKey::Keyboard_W, KeyboardKey::Keyboard_D, KeyboardKey::Keyboard_E,
+                                       KeyboardKey::Keyboard_UpArrow, KeyboardKey::Keyboard_Spacebar};
+    uint32_t i = 0;
+    while (state.next()) {
+        keyboard.setKey(keys[i % 5], (i / 5) % 2 == 0);
+        i++;
+        BP32.report();
+        control.update();
+        MicroBench::keep(control.getState());
+    }
+    BP32.disconnect();
+    control.update();
+    state.setItemsPerOp(1, "update");
+}
+
+// RCControl's receiver pins, in channel order
+static const uint8_t receiverPins[] = {2, 3, 4, 5, 6, 7};
+
+// One receiver frame of pulses through the pin interrupts, then update()
+static void rcPulses(MicroBench::State& state) {
+    RCControl control;
+    RcPulseTrain receiver(sizeof(receiverPins));
+    uint32_t frame = 0;
+    uint64_t origin = HostSim::nowUs();
+    while (state.next()) {
+        receiver.setWidth(0, (uint16_t)(1000 + frame * 7 % 1000));
+        receiver.setWidth(1, (uint16_t)(1000 + frame * 13 % 1000));
+        uint32_t frameUs = frame * receiver.period();
+        receiver.emitEdges(frameUs, frameUs + receiver.period(), [origin](uint8_t ch, bool level, uint32_t atUs) {
+            HostSim::advanceTo(origin + atUs);
+            HostSim::setPin(receiverPins[ch], level);
+        });
+        frame++;
+        control.update();
+        MicroBench::keep(control.getState());
+    }
+    state.setItemsPerOp(1, "frame");
+}
+
+static void rcNoPulses(MicroBench::State& state) {
+    RCControl control;
+    while (state.next()) {
+        control.update();
+        MicroBench::keep(control.getState());
+    }
+    state.setItemsPerOp(1, "update");
+}
+
+static void rcBusSbusFrame(MicroBench::State& state) {
+    RCBusControl control(RCBusControl::PROTOCOL_SBUS, 16);
+    // Centred sticks, gear and fire low, an 11-bit channel sweep on throttle
+    uint8_t frames[16][25];
+    for (uint8_t f = 0; f < 16; f++) {
+        uint16_t channels[16];
+        for (uint8_t ch = 0; ch < 16; ch++) {
+            channels[ch] = ch == 2 || ch == 5 ? 192 : 992;
+        }
+        channels[0] = (uint16_t)(192 + f * 100);
+        memset(frames[f], 0, sizeof(frames[f]));
+        frames[f][0] = 0x0F;
+        for (uint16_t bit = 0; bit < 16 * 11; bit++) {
+            if (channels[bit / 11] & (1 << (bit % 11))) {
+                frames[f][1 + bit / 8] |= (uint8_t)(1 << (bit % 8));
+            }
+        }
+    }
+    uint32_t i = 0;
+    while (state.next()) {
+        Serial2.inject(frames[i++ % 16], 25);
+        control.update();
+        MicroBench::keep(control.getState());
+    }
+    state.setItemsPerOp(1, "frame");
+}
+
+static const uint16_t udpPort = 42130;
+
+// One state datagram sent over loopback, then update(), acks and all;
+// nobody reads the acks, so the kernel drops them once the sender's
+// receive buffer is full
+static void udpDatagram(MicroBench::State& state) {
+    UdpControl control("Hephaistos", "flamethrower", true, udpPort, 0);
+    WiFiUDP sender;
+    sender.begin(0);
+    uint32_t sequence = 0;
+    while (state.next()) {
+        sequence++;
+        ControlFrame::NetStatePayload payload = {sequence, (uint32_t)millis(), (int8_t)(sequence % 201 - 100), 0, 0, 0, 1, 0};
+        uint8_t frame[sizeof(payload) + ControlFrame::overhead];
+        size_t length = ControlFrame::encode(ControlFrame::TYPE_NET_STATE, &payload, sizeof(payload), frame,
+                                             sizeof(frame));
+        sender.beginPacket(IPAddress(127, 0, 0, 1), udpPort);
+        sender.write(frame, length);
+        sender.endPacket();
+        control.update();
+        MicroBench::keep(control.getState());
+    }
+    state.setItemsPerOp(1, "datagram");
+}
+
+static void udpIdle(MicroBench::State& state) {
+    UdpControl control("Hephaistos", "flamethrower", true, udpPort, 0);
+    while (state.next()) {
+        control.update();
+        MicroBench::keep(control.getState());
+    }
+    state.setItemsPerOp(1, "update");
+}
+
+// ----------------------
+// Status output
+// ----------------------
+
+// The TELEMETRY_TEXT status block of sendTelemetry(), queued and written
+// out by the log
+static void statusTextBlock(MicroBench::State& state) {
+    int i = 0;
+    while (state.next()) {
+        int leftSpeed = i % 201 - 100;
+        int rightSpeed = 100 - i % 201;
+        LOG_INFO("------ Tank Control Status ------");
+        LOG_INFO("Gear: %d", 1 + i % 5);
+        LOG_INFO("Left Track Speed: %d", leftSpeed);
+        LOG_INFO("Right Track Speed: %d", rightSpeed);
+        LOG_INFO("Turret Rotation: %d", i % 100);
+        LOG_INFO("Turret Elevation: %d", -(i % 100));
+        LOG_INFO("Flamethrower Active: %s", i % 2 ? "Yes" : "No");
+        LOG_INFO("---------------------------------");
+        Log::drain();
+        i++;
+    }
+    state.setItemsPerOp(1, "block");
+}
+
+static void statusBinaryFrame(MicroBench::State& state) {
+    Telemetry::Encoder encoder(1000);
+    Telemetry::Sample sample = {};
+    sample.flags = Telemetry::FLAG_CONNECTED;
+    sample.gear = 2;
+    uint8_t frame[Telemetry::maxPayload + ControlFrame::overhead];
+    uint32_t nowMs = 0;
+    while (state.next()) {
+        // Tracks ramping, turret moving: a few fields change per frame
+        sample.leftTrackOutput = (int8_t)(nowMs / 100 % 101);
+        sample.rightTrackOutput = (int8_t)(nowMs / 100 % 101);
+        sample.turretRotation = (int16_t)(nowMs % 9000);
+        sample.controlSequence = (uint16_t)(nowMs / 300);
+        MicroBench::keep(encoder.encode(sample, nowMs, frame, sizeof(frame)));
+        nowMs += 100;
+    }
+    state.setItemsPerOp(1, "frame");
+}
+
+int main(int argc, char** argv) {
+    Log::begin(discardLog, millis);
+    Serial.begin(115200);
+
+    MicroBench::add("serial/update_idle", serialIdle);
+    MicroBench::add("serial/update_key_line", serialKeyLine);
+    MicroBench::add("serial/update_state_frame", serialStateFrame);
+    MicroBench::add("serial/parse_key_session", serialKeyCorpus);
+    MicroBench::add("serial/parse_frame_stream", serialFrameCorpus);
+    MicroBench::add("serial/parse_noisy_link", serialNoisyCorpus);
+    MicroBench::add("bluetooth/update_report", bluetoothReport);
+    MicroBench::add("bluetooth/update_no_report", bluetoothNoReport);
+    MicroBench::add("keyboard/update_report", keyboardReport);
+    MicroBench::add("rc/update_pulse_frame", rcPulses);
+    MicroBench::add("rc/update_no_pulses", rcNoPulses);
+    MicroBench::add("rc_bus/update_sbus_frame", rcBusSbusFrame);
+    MicroBench::add("udp/update_datagram", udpDatagram);
+    MicroBench::add("udp/update_idle", udpIdle);
+    MicroBench::add("status/text_block", statusTextBlock);
+    MicroBench::add("status/binary_frame", statusBinaryFrame);
+
+    return MicroBench::run(argc, argv);
+}
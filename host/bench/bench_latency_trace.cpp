@@ -0,0 +1,211 @@
+// Latency trace: cost of a trace point, and a simulated control pipeline
+// traced end to end.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -DLATENCY_TRACE -IProjectHephaistos
+//       host/bench/bench_latency_trace.cpp ProjectHephaistos/LatencyTrace.cpp
+//       ProjectHephaistos/ControlFrame.cpp ProjectHephaistos/TankControlInterface.cpp
+//       -o bench_latency_trace
+//   ./bench_latency_trace [capture.bin]
+//
+// Inputs arrive at random times; the input, mix and actuate stages run at
+// the firmware's rates on a simulated microsecond clock and trace like the
+// firmware does. The trace frames are decoded again and every change's
+// input-to-commit latency must match the simulation's. Exits non-zero
+// otherwise. With a file name, the frames are also written there for
+// host/tools/trace_latency.py.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <vector>
+#include "ControlFrame.h"
+#include "LatencyTrace.h"
+#include "TankControlInterface.h"
+
+static unsigned long simMicros = 0;
+
+static unsigned long simClock() {
+    return simMicros;
+}
+
+// Publishes a new drive value for every input, noting its arrival
+class SimControl : public TankControlInterface {
+public:
+    SimControl() : pending(false), arrivalUs(0), drive(0) {}
+
+    void receive(uint32_t timeUs) {
+        if (!pending) {
+            arrivalUs = timeUs;
+        }
+        pending = true;
+    }
+
+    void update() override {
+        if (!pending) {
+            return;
+        }
+        pending = false;
+        markInput((uint32_t)simMicros - arrivalUs);
+        ControlState next = getState();
+        next.connected = true;
+        drive = drive >= 100 ? -100 : drive + 1;
+        next.leftTrackSpeed = drive;
+        publishState(next, simMicros / 1000);
+    }
+
+private:
+    bool pending;
+    uint32_t arrivalUs;
+    int8_t drive;
+};
+
+struct Run {
+    LatencyTrace::Source source;
+    const char* name;
+    uint32_t meanIntervalUs;   // between inputs
+};
+
+static void measureRecordCost() {
+    const uint32_t rounds = 200000;
+    uint8_t frame[LatencyTrace::maxPayload + ControlFrame::overhead];
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < rounds; i++) {
+        TRACE_POINT(POINT_MIX, i);
+        if ((i & 127) == 127) {
+            while (LatencyTrace::encodeFrame(frame, sizeof(frame)) > 0) {
+            }
+        }
+    }
+    double total = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    printf("Trace point incl. frame encoding: %.1f ns\n\n", total / rounds);
+}
+
+int main(int argc, char** argv) {
+    const uint32_t inputPeriodUs = 1000000 / 250;
+    const uint32_t mixPeriodUs = 1000000 / 250;
+    const uint32_t actuatePeriodUs = 1000000 / 500;
+    const uint32_t telemetryPeriodUs = 1000000 / 10;
+    const uint32_t durationUs = 60 * 1000000;
+
+    LatencyTrace::begin(LatencyTrace::SOURCE_UNKNOWN, simClock);
+    measureRecordCost();
+    uint32_t droppedBefore = LatencyTrace::dropped();
+
+    FILE* capture = argc > 1 ? fopen(argv[1], "wb") : nullptr;
+    if (argc > 1 && !capture) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    const Run runs[] = {
+        {LatencyTrace::SOURCE_SERIAL, "serial", 50000},
+        {LatencyTrace::SOURCE_BLUETOOTH, "bluetooth", 11250},
+    };
+    srand(1);
+    bool ok = true;
+    for (const Run& run : runs) {
+        LatencyTrace::begin(run.source, simClock);
+        SimControl control;
+        ControlState published = control.getState();
+        uint32_t mixedSequence = 0;
+        uint32_t tracedSequence = 0;
+
+        std::map<uint32_t, uint32_t> expected;   // sequence -> input to commit, us
+        std::vector<uint32_t> arrivals;
+        uint32_t nextArrival = 0;
+        uint32_t decodeMismatches = 0;
+        uint32_t decoded = 0;
+        std::map<uint16_t, uint32_t> inputTicks;
+        ControlFrame::Parser parser;
+
+        for (simMicros = 0; simMicros < durationUs; simMicros += 250) {
+            uint32_t now = (uint32_t)simMicros;
+            while (nextArrival <= now) {
+                control.receive(nextArrival);
+                arrivals.push_back(nextArrival);
+                nextArrival += 1 + (uint32_t)(rand() % (2 * run.meanIntervalUs));
+            }
+            if (now % inputPeriodUs == 0) {
+                uint32_t previous = published.sequence;
+                control.update();
+                published = control.getState();
+                uint32_t sequence = published.sequence;
+                if (sequence != previous) {
+                    expected.emplace(sequence, arrivals.front());
+                }
+                arrivals.clear();
+            }
+            if (now % mixPeriodUs == 1000 && published.sequence != mixedSequence) {
+                mixedSequence = published.sequence;
+                TRACE_POINT(POINT_MIX, mixedSequence);
+            }
+            if (now % actuatePeriodUs == 500 && mixedSequence != tracedSequence) {
+                tracedSequence = mixedSequence;
+                TRACE_POINT(POINT_COMMIT, tracedSequence);
+                std::map<uint32_t, uint32_t>::iterator change = expected.find(tracedSequence);
+                if (change != expected.end()) {
+                    change->second = now - change->second;
+                }
+            }
+            if (now % telemetryPeriodUs == 0 || now + 250 >= durationUs) {
+                uint8_t frame[LatencyTrace::maxPayload + ControlFrame::overhead];
+                size_t length;
+                while ((length = LatencyTrace::encodeFrame(frame, sizeof(frame))) > 0) {
+                    if (capture) {
+                        fwrite(frame, 1, length, capture);
+                    }
+                    // Decode again, as the host does
+                    for (size_t i = 0; i < length; i++) {
+                        if (!parser.feed(frame[i])) {
+                            continue;
+                        }
+                        const uint8_t* p = parser.payload() + LatencyTrace::headerSize;
+                        const uint8_t* end = parser.payload() + parser.length();
+                        for (; p + sizeof(LatencyTrace::Event) <= end; p += sizeof(LatencyTrace::Event)) {
+                            uint32_t ticks = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+                            uint16_t sequence = (uint16_t)(p[4] | (p[5] << 8));
+                            if (p[6] == LatencyTrace::POINT_INPUT) {
+                                inputTicks[sequence] = ticks;
+                            } else if (p[6] == LatencyTrace::POINT_COMMIT && inputTicks.count(sequence)) {
+                                decoded++;
+                                uint32_t latency = ticks - inputTicks[sequence];
+                                std::map<uint32_t, uint32_t>::iterator change = expected.find(sequence);
+                                if (change == expected.end() || change->second != latency) {
+                                    decodeMismatches++;
+                                }
+                                inputTicks.erase(sequence);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        std::vector<uint32_t> latencies;
+        for (const std::pair<const uint32_t, uint32_t>& change : expected) {
+            latencies.push_back(change.second);
+        }
+        std::sort(latencies.begin(), latencies.end());
+        printf("%s: %zu changes, %u decoded, %u mismatches\n", run.name, latencies.size(), decoded,
+               decodeMismatches);
+        if (!latencies.empty()) {
+            printf("  input -> commit  p50 %u us  p99 %u us  max %u us\n", latencies[latencies.size() / 2],
+                   latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)], latencies.back());
+        }
+        if (decodeMismatches != 0 || decoded != latencies.size()) {
+            ok = false;
+        }
+    }
+
+    uint32_t dropped = LatencyTrace::dropped() - droppedBefore;
+    printf("Events dropped: %u\n", dropped);
+    if (capture) {
+        fclose(capture);
+    }
+    ok = ok && dropped == 0;
+    printf("\n%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+// Deferred logger: cost of a LOG_* call on the caller's side, and a
+// multi-producer stress run against a slow output.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -pthread -IProjectHephaistos
+//       host/bench/bench_log.cpp ProjectHephaistos/Log.cpp ProjectHephaistos/Profiler.cpp
+//       -o bench_log
+//   ./bench_log
+//
+// Producers log numbered messages from several threads while one thread
+// drains into a sink that takes only a few bytes per call. Every line
+// must arrive whole, each producer's messages in order, and delivered
+// plus reported drops must add up to what was logged. Exits non-zero
+// otherwise.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Log.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static const int producerCount = 4;
+static const unsigned long messagesPerProducer = 200000;
+static const size_t sinkChunk = 7;
+
+static std::string output;
+static size_t sinkLimit = 0;
+
+static unsigned long benchMillis() {
+    static const Clock::time_point start = Clock::now();
+    return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+}
+
+// Takes at most sinkLimit bytes per call, like a nearly full UART buffer
+static size_t captureSink(const uint8_t* data, size_t length) {
+    size_t n = sinkLimit && length > sinkLimit ? sinkLimit : length;
+    output.append((const char*)data, n);
+    return n;
+}
+
+static double nanosecondsSince(Clock::time_point start, unsigned long operations) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / operations;
+}
+
+static void measureCallCost() {
+    const unsigned long rounds = 20000;
+    const int batch = Log::queueLength / 2;
+    sinkLimit = 0;
+
+    double logTotal = 0;
+    for (unsigned long r = 0; r < rounds; r++) {
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < batch; i++) {
+            LOG_INFO("Track speeds: left=%d right=%d gear=%d", i, -i, 3);
+        }
+        logTotal += nanosecondsSince(start, 1);
+        Log::drain();
+        output.clear();
+    }
+
+    char line[Log::maxLineLength + 1];
+    volatile size_t sink = 0;
+    Clock::time_point start = Clock::now();
+    for (unsigned long r = 0; r < rounds; r++) {
+        for (int i = 0; i < batch; i++) {
+            sink += snprintf(line, sizeof(line), "Track speeds: left=%d right=%d gear=%d", i, -i, 3);
+        }
+    }
+    double formatCost = nanosecondsSince(start, rounds * batch);
+
+    printf("Caller cost per message\n");
+    printf("  LOG_INFO (queue):     %7.1f ns\n", logTotal / (rounds * batch));
+    printf("  snprintf (format):    %7.1f ns  (before any output)\n\n", formatCost);
+}
+
+int main() {
+    Log::begin(captureSink, benchMillis);
+    measureCallCost();
+
+    // Stress run
+    output.clear();
+    output.reserve(messagesPerProducer * producerCount * 32);
+    sinkLimit = sinkChunk;
+    uint32_t droppedBefore = Log::dropped();
+
+    std::atomic<int> running(producerCount);
+    std::vector<std::thread> producers;
+    Clock::time_point start = Clock::now();
+    for (int p = 0; p < producerCount; p++) {
+        producers.emplace_back([p, &running]() {
+            for (unsigned long n = 0; n < messagesPerProducer; n++) {
+                LOG_INFO("P%d %lu", p, n);
+            }
+            running--;
+        });
+    }
+    std::thread consumer([&running]() {
+        while (running > 0) {
+            Log::drain();
+        }
+        while (Log::drain() > 0) {
+        }
+    });
+    for (std::thread& producer : producers) {
+        producer.join();
+    }
+    consumer.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Check the output
+    unsigned long lastSeen[producerCount];
+    for (int p = 0; p < producerCount; p++) {
+        lastSeen[p] = (unsigned long)-1;
+    }
+    unsigned long delivered = 0;
+    unsigned long reportedDrops = 0;
+    unsigned long malformed = 0;
+    unsigned long misordered = 0;
+    size_t position = 0;
+    while (position < output.size()) {
+        size_t end = output.find("\r\n", position);
+        if (end == std::string::npos) {
+            malformed++;
+            break;
+        }
+        std::string line = output.substr(position, end - position);
+        position = end + 2;
+
+        char level;
+        int producer;
+        unsigned long value;
+        if (sscanf(line.c_str(), "%*u.%*u %c P%d %lu", &level, &producer, &value) == 3 && level == 'I' &&
+            producer >= 0 && producer < producerCount) {
+            if (lastSeen[producer] != (unsigned long)-1 && value <= lastSeen[producer]) {
+                misordered++;
+            }
+            lastSeen[producer] = value;
+            delivered++;
+        } else if (sscanf(line.c_str(), "%*u.%*u W log: %lu messages dropped", &value) == 1) {
+            reportedDrops += value;
+        } else {
+            malformed++;
+        }
+    }
+
+    unsigned long sent = messagesPerProducer * producerCount;
+    unsigned long dropped = Log::dropped() - droppedBefore;
+    printf("Stress: %d producers x %lu messages, sink takes %zu bytes per call\n", producerCount,
+           messagesPerProducer, sinkChunk);
+    printf("  delivered %lu, dropped %lu (reported %lu), %.0f messages/s\n", delivered, dropped,
+           reportedDrops, sent / seconds);
+    printf("  malformed lines %lu, out of order %lu, still queued %lu\n", malformed, misordered,
+           (unsigned long)Log::queued());
+
+    bool ok = delivered > 0 && malformed == 0 && misordered == 0 && delivered + dropped == sent && reportedDrops == dropped &&
+              Log::queued() == 0;
+    printf("\n%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+// Track motor ramp: step response of TrackMotor for several acceleration
+// and jerk settings, recorded through a mock driver.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -IProjectHephaistos -Ihost/sim
+//       host/bench/bench_motor_ramp.cpp ProjectHephaistos/TrackMotor.cpp
+//       ProjectHephaistos/SlewLimiter.cpp -o bench_motor_ramp
+//   ./bench_motor_ramp [--csv profile]
+//
+// Each profile drives full forward, full reverse, then stop, at the
+// firmware's actuation rate. The table shows how long the ramps take and
+// the largest duty step per tick (a stand-in for the current peak the
+// bridge sees). Exits non-zero if a ramp overshoots its target or steps
+// faster than its acceleration limit. --csv prints the duty stream of one
+// profile (tick,duty) for plotting.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "TrackMotor.h"
+#include "RecordingMotorDriver.h"
+
+static const uint32_t updateHz = 500;
+static const uint8_t resolutionBits = 10;
+static const int32_t maxDuty = (1 << resolutionBits) - 1;
+
+struct Profile {
+    const char* name;
+    float acceleration;  // %/s
+    float jerk;          // %/s^2
+};
+
+static const Profile profiles[] = {
+    {"unlimited", 0, 0},
+    {"accel", 250, 0},
+    {"accel+jerk", 250, 2500},
+    {"gentle", 100, 500},
+};
+
+struct Segment {
+    int8_t target;
+    uint32_t ticks;
+};
+
+static const Segment script[] = {
+    {100, 2 * updateHz},
+    {-100, 3 * updateHz},
+    {0, 2 * updateHz},
+};
+
+// Ticks from start until the duty stays within 10 % of the target
+static uint32_t settleTicks(const RecordingMotorDriver& driver, uint32_t start, uint32_t end, int32_t targetDuty) {
+    uint32_t settled = end - start;
+    for (uint32_t t = end; t-- > start;) {
+        if (abs(driver.dutyAt(t) - targetDuty) > maxDuty / 10) {
+            break;
+        }
+        settled = t - start;
+    }
+    return settled;
+}
+
+int main(int argc, char** argv) {
+    const char* csvProfile = (argc > 2 && strcmp(argv[1], "--csv") == 0) ? argv[2] : nullptr;
+    bool ok = true;
+
+    if (!csvProfile) {
+        printf("%u Hz updates, %u-bit duty\n\n", updateHz, resolutionBits);
+        printf("%-11s %9s %9s %9s %11s %10s %7s\n",
+               "profile", "0->100", "100->-100", "-100->0", "max step", "max jerk", "writes");
+    }
+
+    for (const Profile& profile : profiles) {
+        if (csvProfile && strcmp(csvProfile, profile.name) != 0) {
+            continue;
+        }
+
+        RecordingMotorDriver driver;
+        TrackMotor motor(driver);
+        motor.begin(20000, resolutionBits);
+        motor.setRamp(profile.acceleration, profile.jerk, updateHz);
+        driver.clear();
+
+        uint32_t segmentStart[3];
+        uint32_t tick = 0;
+        for (int s = 0; s < 3; s++) {
+            segmentStart[s] = tick;
+            motor.setTarget(script[s].target);
+            for (uint32_t i = 0; i < script[s].ticks; i++) {
+                motor.update();
+                driver.advance();
+                tick++;
+            }
+        }
+
+        int32_t maxStep = 0, maxJerk = 0, previous = 0, previousStep = 0;
+        for (uint32_t t = 0; t < tick; t++) {
+            int32_t duty = driver.dutyAt(t);
+            int32_t step = duty - previous;
+            if (abs(step) > maxStep) {
+                maxStep = abs(step);
+            }
+            if (abs(step - previousStep) > maxJerk) {
+                maxJerk = abs(step - previousStep);
+            }
+            if (abs(duty) > maxDuty) {
+                printf("%s: duty %d out of range at tick %u\n", profile.name, duty, t);
+                ok = false;
+            }
+            previous = duty;
+            previousStep = step;
+            if (csvProfile) {
+                printf("%u,%d\n", t, duty);
+            }
+        }
+        if (csvProfile) {
+            return 0;
+        }
+
+        // Allowed duty change per tick, plus one count of rounding
+        if (profile.acceleration > 0) {
+            int32_t limit = (int32_t)(profile.acceleration / updateHz * maxDuty / 100.0f) + 1;
+            if (maxStep > limit) {
+                printf("%s: duty step %d exceeds the acceleration limit %d\n", profile.name, maxStep, limit);
+                ok = false;
+            }
+        }
+
+        int32_t targets[3] = {maxDuty, -maxDuty, 0};
+        double ms[3];
+        for (int s = 0; s < 3; s++) {
+            uint32_t end = s < 2 ? segmentStart[s + 1] : tick;
+            ms[s] = settleTicks(driver, segmentStart[s], end, targets[s]) * 1000.0 / updateHz;
+            if (driver.dutyAt(end - 1) != targets[s]) {
+                printf("%s: did not reach %d (ended at %d)\n", profile.name, targets[s], driver.dutyAt(end - 1));
+                ok = false;
+            }
+        }
+
+        printf("%-11s %7.0f ms %7.0f ms %7.0f ms %6d/tick %5d/tick2 %7zu\n",
+               profile.name, ms[0], ms[1], ms[2], maxStep, maxJerk, driver.samples.size());
+    }
+
+    if (csvProfile) {
+        printf("unknown profile '%s'\n", csvProfile);
+        return 1;
+    }
+    return ok ? 0 : 1;
+}
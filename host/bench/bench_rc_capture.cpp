@@ -0,0 +1,126 @@
+// RC input latency: sequential pulseIn() vs. interrupt-driven PwmCapture.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -IProjectHephaistos -Ihost/sim
+//       host/bench/bench_rc_capture.cpp ProjectHephaistos/PwmCapture.cpp
+//       -o bench_rc_capture
+//   ./bench_rc_capture
+//
+// "pulseIn" replays the old RCControl::readRCInputs() against a simulated
+// receiver and reports how long each update() blocked loop() in simulated
+// time. "capture" feeds the same edges into PwmCapture and times update()'s
+// snapshot read on the host clock.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include "PwmCapture.h"
+#include "RcPulseTrain.h"
+
+static const uint8_t channelCount = 6;
+static const uint32_t pulseTimeoutUs = 25000;
+static const int iterations = 2000;
+
+struct LatencyStats {
+    uint64_t totalUs = 0;
+    uint32_t maxUs = 0;
+
+    void add(uint32_t us) {
+        totalUs += us;
+        if (us > maxUs) {
+            maxUs = us;
+        }
+    }
+};
+
+static void runPulseIn(const RcPulseTrain& rx, const char* label) {
+    LatencyStats stats;
+    srand(1);
+    for (int i = 0; i < iterations; i++) {
+        // Each update() starts at an arbitrary phase of the frame
+        uint32_t start = 1000000 + (uint32_t)(rand() % rx.period());
+        uint32_t now = start;
+        for (uint8_t ch = 0; ch < channelCount; ch++) {
+            uint32_t end;
+            rx.pulseIn(ch, now, pulseTimeoutUs, end);
+            now = end;
+        }
+        stats.add(now - start);
+    }
+    printf("%-28s pulseIn   avg %8.1f us   max %8u us   (blocking, simulated time)\n",
+           label, (double)stats.totalUs / iterations, stats.maxUs);
+}
+
+static void runCapture(const RcPulseTrain& rx, const char* label) {
+    PwmCapture capture;
+    PwmSnapshot snapshot;
+    uint32_t now = 0;
+    uint64_t ageTotalUs = 0;
+    uint32_t ageMaxUs = 0;
+    double readNsTotal = 0;
+    int mismatches = 0;
+
+    srand(1);
+    for (int i = 0; i < iterations; i++) {
+        // Interrupts deliver every edge up to the moment update() runs
+        uint32_t next = now + 1000 + (uint32_t)(rand() % rx.period());
+        rx.emitEdges(now, next, [&](uint8_t ch, bool level, uint32_t t) {
+            capture.onEdge(ch, level, t);
+        });
+        now = next;
+
+        const int reads = 1000;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < reads; r++) {
+            capture.read(snapshot);
+            __asm__ __volatile__("" : : "g"(&snapshot) : "memory");
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        readNsTotal += std::chrono::duration<double, std::nano>(t1 - t0).count() / reads;
+
+        if (now < 2 * rx.period()) {
+            continue; // First frames are still filling in
+        }
+        for (uint8_t ch = 0; ch < channelCount; ch++) {
+            if (snapshot.widthUs[ch] == 0) {
+                continue; // Missing channel
+            }
+            if (snapshot.widthUs[ch] != rx.width(ch)) {
+                mismatches++;
+            }
+            uint32_t age = now - snapshot.updatedUs[ch];
+            ageTotalUs += age;
+            if (age > ageMaxUs) {
+                ageMaxUs = age;
+            }
+        }
+    }
+    printf("%-28s capture   avg %8.1f ns   (non-blocking, host time)"
+           "   sample age avg %.0f us max %u us   %d mismatches\n",
+           label, readNsTotal / iterations,
+           (double)ageTotalUs / (iterations * channelCount), ageMaxUs, mismatches);
+}
+
+int main() {
+    RcPulseTrain rx(channelCount);
+    const uint16_t widths[channelCount] = {1500, 1620, 1850, 1100, 1990, 1200};
+    for (uint8_t ch = 0; ch < channelCount; ch++) {
+        rx.setWidth(ch, widths[ch]);
+    }
+
+    printf("RC update() latency over %d iterations, %u us frames\n\n", iterations, rx.period());
+
+    runPulseIn(rx, "all channels");
+    runCapture(rx, "all channels");
+
+    rx.setPresent(5, false);
+    runPulseIn(rx, "fire channel missing");
+    runCapture(rx, "fire channel missing");
+
+    rx.setPresent(0, false);
+    rx.setPresent(1, false);
+    runPulseIn(rx, "three channels missing");
+    runCapture(rx, "three channels missing");
+
+    return 0;
+}
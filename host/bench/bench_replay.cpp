@@ -0,0 +1,444 @@
+// Record/replay round trip for every control backend: a scripted live
+// session is recorded through InputRecorder, then played back through
+// ReplayControl<Backend> at the same poll times, and every published
+// state must match the live one. Reports the record size per sample and
+// the replay cost per poll.
+//
+// Built by CMake as bench_replay (all control backends in one binary,
+// with INPUT_RECORDING, against the host shim):
+//   cmake -S . -B build && cmake --build build
+//   build/host/bench_replay
+//
+// --session DIR [--id N] instead replays a session copied off the tank
+// (the files of the "records" partition, see InputRecorder.h; N = 0 or
+// none for the latest) through the backend that recorded it, and prints
+// every state change with its time.
+// Exits non-zero if a replayed state differs from the live one.
+
+#include <Arduino.h>
+#include <Bluepad32.h>
+#include "HostSim.h"
+#include "RcPulseTrain.h"
+#include "ControlFrame.h"
+#include "Log.h"
+#include "InputRecorder.h"
+#include "ReplayControl.h"
+#include "SerialControl.h"
+#include "BluetoothControl.h"
+#include "KeyboardControl.h"
+#include "RCControl.h"
+#include "RCBusControl.h"
+#include "UdpControl.h"
+#include <WiFiUdp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+static const uint32_t pollPeriodUs = 4000;   // INPUT_RATE_HZ
+static const uint32_t sessionPolls = 5000;   // 20 s
+static const uint32_t segmentBytes = 2048;
+static const uint8_t segmentCount = 48;
+
+static size_t discardLog(const uint8_t* data, size_t length) {
+    return length;
+}
+
+// Small deterministic generator, so every run drives the same session
+static uint32_t nextRandom(uint32_t& seed) {
+    seed = seed * 1103515245 + 12345;
+    return seed >> 16;
+}
+
+// Everything but the timestamp, which is absolute virtual time
+static bool sameState(const ControlState& a, const ControlState& b) {
+    return a.sequence == b.sequence && a.connected == b.connected &&
+           a.leftTrackSpeed == b.leftTrackSpeed && a.rightTrackSpeed == b.rightTrackSpeed &&
+           a.turretRotation == b.turretRotation && a.turretElevation == b.turretElevation &&
+           a.flamethrowerActive == b.flamethrowerActive && a.currentGear == b.currentGear;
+}
+
+static void printState(const ControlState& state) {
+    printf("seq %lu %s L %4d R %4d rot %4d elev %4d gear %d%s\n", (unsigned long)state.sequence,
+           state.connected ? "up  " : "down", state.leftTrackSpeed, state.rightTrackSpeed,
+           state.turretRotation, state.turretElevation, state.currentGear,
+           state.flamethrowerActive ? " FIRE" : "");
+}
+
+static void removeSegments(const char* directory) {
+    for (uint8_t i = 0; i < InputRecorder::maxSegments; i++) {
+        char path[96];
+        snprintf(path, sizeof(path), "%s/seg%02u.rec", directory, (unsigned)i);
+        unlink(path);
+    }
+    rmdir(directory);
+}
+
+// Puts the input of poll step where the backend reads it, up to timeUs
+typedef std::function<void(uint32_t step, uint64_t timeUs)> Driver;
+
+// Records a live session with driver, replays it and compares. Returns
+// false on a mismatch.
+template <typename Backend, typename... Args>
+static bool roundTrip(const char* name, const Driver& driver, Args... args) {
+    char directory[] = "/tmp/hephaistos_replay_XXXXXX";
+    if (!mkdtemp(directory)) {
+        fprintf(stderr, "Can't create a temporary directory\n");
+        return false;
+    }
+
+    // Live, recording
+    std::vector<ControlState> live;
+    live.reserve(sessionPolls);
+    uint32_t samples = 0;
+    uint32_t bytes = 0;
+    uint32_t dropped = 0;
+    {
+        Backend control(args...);
+        uint64_t origin = HostSim::nowUs();
+        if (!InputRecorder::begin(directory, segmentBytes, segmentCount, micros)) {
+            fprintf(stderr, "%s: can't start recording in %s\n", name, directory);
+            removeSegments(directory);
+            return false;
+        }
+        for (uint32_t step = 0; step < sessionPolls; step++) {
+            uint64_t timeUs = origin + (uint64_t)step * pollPeriodUs;
+            driver(step, timeUs);
+            HostSim::advanceTo(timeUs);
+            control.update();
+            live.push_back(control.getState());
+            // The flush task's job on the tank
+            InputRecorder::flush();
+        }
+        InputRecorder::end();
+        bytes = InputRecorder::bytesWritten();
+        dropped = InputRecorder::dropped();
+    }
+
+    InputRecorder::SessionReader reader;
+    InputRecord::Sample sample;
+    if (reader.open(directory)) {
+        while (reader.next(sample)) {
+            samples++;
+        }
+    }
+
+    // Replayed at the same poll times, compared poll by poll
+    uint32_t mismatches = 0;
+    double replayNs = 0;
+    {
+        ReplayControl<Backend> replay(args...);
+        replay.open(directory);
+        uint64_t origin = HostSim::nowUs();
+        for (uint32_t step = 0; step < sessionPolls; step++) {
+            HostSim::advanceTo(origin + (uint64_t)step * pollPeriodUs);
+            auto start = std::chrono::steady_clock::now();
+            replay.update();
+            replayNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            if (!sameState(replay.getState(), live[step])) {
+                if (mismatches++ < 3) {
+                    printf("%s: poll %lu differs\n  live   ", name, (unsigned long)step);
+                    printState(live[step]);
+                    printf("  replay ");
+                    printState(replay.getState());
+                }
+            }
+        }
+    }
+    removeSegments(directory);
+
+    printf("%-10s %8lu %8lu %8lu %8.2f %10.0f %8lu  %s\n", name, (unsigned long)live.back().sequence,
+           (unsigned long)samples, (unsigned long)bytes, samples ? (double)bytes / samples : 0.0,
+           replayNs / sessionPolls, (unsigned long)dropped, mismatches || dropped ? "FAIL" : "ok");
+    return mismatches == 0 && dropped == 0;
+}
+
+// ----------------------
+// Scripted sessions
+// ----------------------
+
+static size_t stateFrame(uint8_t sequence, int8_t drive, int8_t turn, int8_t rotation, uint8_t gear, bool fire,
+                         uint8_t* out, size_t outSize) {
+    ControlFrame::ControlStatePayload payload = {sequence, drive, turn, rotation, 0, gear,
+                                                 (uint8_t)(fire ? ControlFrame::BUTTON_FIRE : 0)};
+    return ControlFrame::encode(ControlFrame::TYPE_CONTROL_STATE, &payload, sizeof(payload), out, outSize);
+}
+
+// Full-state frames every 40 ms, with text commands in between
+static bool serialSession() {
+    uint32_t seed = 1;
+    uint8_t sequence = 0;
+    Driver driver = [&](uint32_t step, uint64_t timeUs) {
+        if (step % 10 != 0) {
+            return;
+        }
+        uint32_t roll = nextRandom(seed);
+        if (roll % 8 == 0) {
+            static const char* lines[] = {"forward_press\n", "forward_release\n", "gear_up\n", "gear_down\n",
+                                          "turret_left_press\r\n", "turret_left_release\n", "bogus\n"};
+            Serial.inject(lines[nextRandom(seed) % 7]);
+            return;
+        }
+        uint8_t frame[sizeof(ControlFrame::ControlStatePayload) + ControlFrame::overhead];
+        size_t length = stateFrame(sequence++, (int8_t)(nextRandom(seed) % 201 - 100),
+                                   (int8_t)(nextRandom(seed) % 201 - 100), (int8_t)(nextRandom(seed) % 201 - 100),
+                                   (uint8_t)(nextRandom(seed) % 6), nextRandom(seed) % 4 == 0, frame, sizeof(frame));
+        Serial.inject(frame, length);
+    };
+    return roundTrip<SerialControl>("serial", driver);
+}
+
+// Sticks moving every 10 ms, gear and curve buttons, and a dropout
+static bool bluetoothSession() {
+    static Controller gamepad;
+    uint32_t seed = 2;
+    Driver driver = [&](uint32_t step, uint64_t timeUs) {
+        if (step == 5 || step == 3250) {
+            BP32.connect(&gamepad);
+        } else if (step == 3000 || step == sessionPolls - 1) {
+            BP32.disconnect();
+        }
+        if (step % 5 == 0) {
+            uint32_t phase = step * 7;
+            gamepad.setAxes((int32_t)(phase % 1024) - 512, 511 - (int32_t)(phase * 3 % 1024),
+                            (int32_t)(nextRandom(seed) % 1024) - 512, (int32_t)(nextRandom(seed) % 1024) - 512);
+            uint32_t roll = nextRandom(seed);
+            gamepad.setButtons(roll % 5 == 0, false, false, false, roll % 37 == 0);
+            gamepad.setDpad(roll % 23 == 0 ? DPAD_UP : (roll % 29 == 0 ? DPAD_DOWN : 0));
+            BP32.report();
+        }
+    };
+    return roundTrip<BluetoothControl>("bluetooth", driver);
+}
+
+// A key pressed or released every 60 ms
+static bool keyboardSession() {
+    static Controller keyboard(true);
+    uint32_t seed = 3;
+    Driver driver = [&](uint32_t step, uint64_t timeUs) {
+        if (step == 5) {
+            BP32.connect(&keyboard);
+        } else if (step == sessionPolls - 1) {
+            BP32.disconnect();
+        }
+        if (step % 15 == 0) {
+            static const KeyboardKey keys[] = {
+                KeyboardKey::Keyboard_W, KeyboardKey::Keyboard_S, KeyboardKey::Keyboard_A,
+                KeyboardKey::Keyboard_D, KeyboardKey::Keyboard_Q, KeyboardKey::Keyboard_E,
+                KeyboardKey::Keyboard_UpArrow, KeyboardKey::Keyboard_DownArrow, KeyboardKey::Keyboard_Spacebar,
+                KeyboardKey::Keyboard_LeftShift, KeyboardKey::Keyboard_RightControl};
+            uint32_t roll = nextRandom(seed);
+            keyboard.setKey(keys[roll % 11], (roll >> 4) % 2 == 0);
+            BP32.report();
+        }
+    };
+    return roundTrip<KeyboardControl>("keyboard", driver);
+}
+
+// PWM receiver at 50 Hz, a stick moved every 200 ms
+static bool rcSession() {
+    static const uint8_t receiverPins[] = {2, 3, 4, 5, 6, 7};
+    RcPulseTrain receiver(sizeof(receiverPins));
+    uint32_t seed = 4;
+    uint64_t origin = 0;
+    uint32_t emittedUs = 0;
+    Driver driver = [&](uint32_t step, uint64_t timeUs) {
+        if (step == 0) {
+            origin = timeUs;
+            emittedUs = 0;
+        }
+        if (step % 50 == 0) {
+            uint32_t roll = nextRandom(seed);
+            receiver.setWidth(roll % 6, (uint16_t)(1000 + (roll >> 3) % 1001));
+        }
+        uint32_t untilUs = (uint32_t)(timeUs - origin);
+        receiver.emitEdges(emittedUs, untilUs, [&](uint8_t ch, bool level, uint32_t atUs) {
+            HostSim::advanceTo(origin + atUs);
+            HostSim::setPin(receiverPins[ch], level);
+        });
+        emittedUs = untilUs;
+    };
+    return roundTrip<RCControl>("rc", driver);
+}
+
+// SBUS frames every 16 ms with the sticks moving, a 500 ms dropout and a
+// stretch of failsafe frames
+static bool rcBusSession() {
+    uint32_t seed = 5;
+    uint16_t channels[16];
+    for (uint8_t ch = 0; ch < 16; ch++) {
+        channels[ch] = 992;
+    }
+    Driver driver = [&](uint32_t step, uint64_t timeUs) {
+        if (step % 4 != 0 || (step >= 2000 && step < 2125)) {
+            return;
+        }
+        if (step % 40 == 0) {
+            uint32_t roll = nextRandom(seed);
+            channels[roll % 6] = (uint16_t)(192 + (roll >> 3) % 1601);
+        }
+        uint8_t frame[25] = {};
+        frame[0] = 0x0F;
+        for (uint16_t bit = 0; bit < 16 * 11; bit++) {
+            if (channels[bit / 11] & (1 << (bit % 11))) {
+                frame[1 + bit / 8] |= (uint8_t)(1 << (bit % 8));
+            }
+        }
+        frame[23] = (step >= 3500 && step < 3600) ? 0x08 : 0x00;
+        Serial2.inject(frame, sizeof(frame));
+    };
+    return roundTrip<RCBusControl>("rc_bus", driver, RCBusControl::PROTOCOL_SBUS, 16);
+}
+
+// State datagrams every 20 ms on loopback, some swapped, duplicated or
+// bunched up, and a 400 ms dropout
+static const uint16_t replayUdpPort = 42110;
+
+static bool udpSession() {
+    static WiFiUDP sender;
+    sender.begin(0);
+    uint32_t seed = 6;
+    ControlFrame::NetStatePayload state = {};
+    state.gear = 1;
+    std::vector<std::vector<uint8_t> > held;
+    Driver driver = [&](uint32_t step, uint64_t timeUs) {
+        while (sender.parsePacket() > 0) {
+        }
+        if (step % 5 != 0 || (step >= 2500 && step < 2600)) {
+            return;
+        }
+        uint32_t roll = nextRandom(seed);
+        if (step % 50 == 0) {
+            state.drive = (int8_t)(nextRandom(seed) % 201 - 100);
+            state.turn = (int8_t)(nextRandom(seed) % 201 - 100);
+            state.turretRotation = (int8_t)(nextRandom(seed) % 201 - 100);
+            state.gear = (uint8_t)(nextRandom(seed) % 6);
+            state.buttons = nextRandom(seed) % 4 == 0 ? ControlFrame::BUTTON_FIRE : 0;
+        }
+        state.sequence++;
+        state.sendTimeMs = millis();
+        std::vector<uint8_t> frame(sizeof(state) + ControlFrame::overhead);
+        ControlFrame::encode(ControlFrame::TYPE_NET_STATE, &state, sizeof(state), frame.data(), frame.size());
+        held.push_back(frame);
+        if (roll % 7 == 0) {
+            held.push_back(frame);
+        }
+        // Held back to go out with the next one (bunched), or after it
+        if (roll % 11 == 0 && held.size() < 4) {
+            return;
+        }
+        if (roll % 13 == 0 && held.size() > 1) {
+            std::swap(held.front(), held.back());
+        }
+        for (const std::vector<uint8_t>& datagram : held) {
+            sender.beginPacket(IPAddress(127, 0, 0, 1), replayUdpPort);
+            sender.write(datagram.data(), datagram.size());
+            sender.endPacket();
+        }
+        held.clear();
+    };
+    return roundTrip<UdpControl>("udp", driver, "Hephaistos", "flamethrower", true, replayUdpPort, (uint32_t)20);
+}
+
+// ----------------------
+// Recorded sessions
+// ----------------------
+
+// Replays the session through Backend, printing every state change
+template <typename Backend, typename... Args>
+static int replaySession(const char* directory, uint16_t id, Args... args) {
+    ReplayControl<Backend> replay(args...);
+    if (!replay.open(directory, id)) {
+        return 1;
+    }
+    uint64_t origin = HostSim::nowUs();
+    uint32_t lastSequence = replay.getState().sequence;
+    for (uint32_t step = 0; !replay.finished(); step++) {
+        HostSim::advanceTo(origin + (uint64_t)step * pollPeriodUs);
+        replay.update();
+        const ControlState& state = replay.getState();
+        if (state.sequence != lastSequence) {
+            lastSequence = state.sequence;
+            printf("%9.3f s  ", step * pollPeriodUs / 1e6);
+            printState(state);
+        }
+    }
+    return 0;
+}
+
+static int replayRecorded(const char* directory, uint16_t id) {
+    // The sample types tell which backend recorded it
+    InputRecorder::SessionReader reader;
+    if (!reader.open(directory, id)) {
+        fprintf(stderr, "No session in %s\n", directory);
+        return 2;
+    }
+    uint32_t counts[InputRecord::typeCount] = {};
+    InputRecord::Sample sample;
+    while (reader.next(sample)) {
+        counts[sample.type]++;
+    }
+    printf("Session %u: %lu gamepad, %lu keys, %lu serial, %lu rc, %lu rc bus, %lu datagram samples\n",
+           (unsigned)reader.session(), (unsigned long)counts[InputRecord::TYPE_GAMEPAD],
+           (unsigned long)counts[InputRecord::TYPE_KEYS], (unsigned long)counts[InputRecord::TYPE_SERIAL],
+           (unsigned long)counts[InputRecord::TYPE_RC_PULSES], (unsigned long)counts[InputRecord::TYPE_RC_FRAME],
+           (unsigned long)counts[InputRecord::TYPE_DATAGRAM]);
+    id = reader.session();
+
+    if (counts[InputRecord::TYPE_GAMEPAD]) {
+        return replaySession<BluetoothControl>(directory, id);
+    } else if (counts[InputRecord::TYPE_KEYS]) {
+        return replaySession<KeyboardControl>(directory, id);
+    } else if (counts[InputRecord::TYPE_SERIAL]) {
+        return replaySession<SerialControl>(directory, id);
+    } else if (counts[InputRecord::TYPE_RC_PULSES]) {
+        return replaySession<RCControl>(directory, id);
+    } else if (counts[InputRecord::TYPE_RC_FRAME]) {
+        return replaySession<RCBusControl>(directory, id, RCBusControl::PROTOCOL_SBUS, 16);
+    } else if (counts[InputRecord::TYPE_DATAGRAM]) {
+        return replaySession<UdpControl>(directory, id, "Hephaistos", "flamethrower", true, replayUdpPort,
+                                         (uint32_t)20);
+    }
+    fprintf(stderr, "Session %u has no input samples\n", (unsigned)id);
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    Log::begin(discardLog, millis);
+    Serial.begin(115200);
+
+    if (argc > 1) {
+        const char* directory = nullptr;
+        uint16_t id = 0;
+        for (int i = 1; i < argc; i++) {
+            bool hasValue = i + 1 < argc;
+            if (strcmp(argv[i], "--session") == 0 && hasValue) {
+                directory = argv[++i];
+            } else if (strcmp(argv[i], "--id") == 0 && hasValue) {
+                id = (uint16_t)atoi(argv[++i]);
+            } else {
+                directory = nullptr;
+                break;
+            }
+        }
+        if (!directory) {
+            fprintf(stderr, "usage: %s [--session dir [--id n]]\n", argv[0]);
+            return 2;
+        }
+        return replayRecorded(directory, id);
+    }
+
+    printf("%-10s %8s %8s %8s %8s %10s %8s\n", "backend", "changes", "samples", "bytes", "B/sample",
+           "ns/poll", "dropped");
+    bool ok = true;
+    ok &= serialSession();
+    ok &= bluetoothSession();
+    ok &= keyboardSession();
+    ok &= rcSession();
+    ok &= rcBusSession();
+    ok &= udpSession();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,124 @@
+// ControlScheduler on FreeRTOS-style ticks: ControlScheduler.cpp built
+// with CONTROL_SCHEDULER_TICKS, so it waits with vTaskDelayUntil() like
+// on the ESP32; the shim wakes it on 1 ms tick boundaries, in virtual
+// time.
+//
+// Built by CMake as bench_scheduler:
+//   cmake -S . -B build && cmake --build build
+//   build/host/bench_scheduler
+//
+// Checks that a loop started part way into a tick, whose later wake-ups
+// come sooner after their boundary than the first one did, counts no
+// jitter beyond the wake-up latency and no deadline misses; that it keeps
+// the base rate; that after an overrun the missed ticks are skipped and
+// the releases line up with the tick boundaries again; and that only
+// rates of whole ticks are supported. Exits non-zero if a check fails.
+
+#include <Arduino.h>
+#include "HostSim.h"
+#include "ControlScheduler.h"
+#include <stdio.h>
+
+static bool failed = false;
+
+static void check(bool pass, const char* what) {
+    printf("  %-58s %s\n", what, pass ? "ok" : "FAIL");
+    failed = failed || !pass;
+}
+
+// Stage bodies: take stageUs, or overrunUs once if set
+static uint32_t stageUs = 100;
+static uint32_t overrunUs = 0;
+static uint64_t lastStartUs = 0;
+
+static void fastStage() {
+    lastStartUs = HostSim::nowUs();
+    if (overrunUs) {
+        HostSim::advance(overrunUs);
+        overrunUs = 0;
+    } else {
+        HostSim::advance(stageUs);
+    }
+}
+
+static void slowStage() {
+    HostSim::advance(stageUs);
+}
+
+static uint32_t maxJitter(const ControlScheduler& scheduler) {
+    uint32_t worst = 0;
+    for (uint8_t i = 0; i < scheduler.stageCount(); i++) {
+        worst = scheduler.stats(i).maxJitterUs > worst ? scheduler.stats(i).maxJitterUs : worst;
+    }
+    return worst;
+}
+
+static uint32_t misses(const ControlScheduler& scheduler) {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < scheduler.stageCount(); i++) {
+        total += scheduler.stats(i).deadlineMisses;
+    }
+    return total;
+}
+
+static void checkTickWakeups() {
+    printf("Tick wake-ups, 500 Hz base, started 0.3 ms into a tick\n");
+    HostSim::advance(1300);
+    ControlScheduler scheduler(500);
+    scheduler.addStage("fast", 500, fastStage);
+    scheduler.addStage("slow", 250, slowStage);
+
+    // The first wake-up is slow, the later ones less so: they come
+    // before the release taken from the first
+    HostSim::setTickWakeLatency(80);
+    scheduler.runTick();
+    HostSim::setTickWakeLatency(5);
+    uint64_t startUs = HostSim::nowUs();
+    while (HostSim::nowUs() - startUs < 1000000) {
+        scheduler.runTick();
+    }
+
+    const ControlScheduler::StageStats& fast = scheduler.stats(0);
+    printf("  fast: %lu runs, jitter max %lu us, avg %lu us\n", (unsigned long)fast.runs,
+           (unsigned long)fast.maxJitterUs, (unsigned long)(fast.totalJitterUs / fast.runs));
+    check(misses(scheduler) == 0 && scheduler.skippedTicks() == 0, "no deadline misses, nothing skipped");
+    check(maxJitter(scheduler) <= stageUs + 5, "jitter within the stage ahead plus the wake-up latency");
+    check(fast.runs >= 500 && fast.runs <= 502 && scheduler.stats(1).runs >= 250 && scheduler.stats(1).runs <= 252,
+          "base rate kept over a second");
+
+    printf("Overrun of 6.5 ms\n");
+    overrunUs = 6500;
+    scheduler.runTick();
+    // The next tick is late and skips the missed ones
+    scheduler.runTick();
+    uint32_t skipped = scheduler.skippedTicks();
+    scheduler.resetStats();
+    uint64_t afterUs = HostSim::nowUs();
+    bool aligned = true;
+    while (HostSim::nowUs() - afterUs < 200000) {
+        scheduler.runTick();
+        aligned = aligned && lastStartUs % 2000 == 5;
+    }
+    check(skipped == 2, "missed ticks skipped");
+    check(misses(scheduler) == 0 && maxJitter(scheduler) <= stageUs + 5 && aligned,
+          "releases on tick boundaries again");
+    HostSim::setTickWakeLatency(0);
+}
+
+static void checkRates() {
+    printf("Supported rates (1 kHz ticks)\n");
+    check(ControlScheduler::rateSupported(1000) && ControlScheduler::rateSupported(500) &&
+              ControlScheduler::rateSupported(250) && ControlScheduler::rateSupported(100),
+          "whole ticks supported");
+    check(!ControlScheduler::rateSupported(400) && !ControlScheduler::rateSupported(300) &&
+              !ControlScheduler::rateSupported(2000) && !ControlScheduler::rateSupported(0),
+          "fractions of a tick rejected");
+}
+
+int main() {
+    checkTickWakeups();
+    checkRates();
+
+    printf("%s\n", failed ? "FAIL" : "PASS");
+    return failed ? 1 : 0;
+}
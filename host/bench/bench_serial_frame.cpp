@@ -0,0 +1,144 @@
+// Serial receive path throughput: binary ControlFrame parser vs. the old
+// String-per-line text parser.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -IProjectHephaistos host/bench/bench_serial_frame.cpp
+//       ProjectHephaistos/ControlFrame.cpp -o bench_serial_frame
+//   ./bench_serial_frame
+//
+// The text side reproduces what SerialControl::processSerialInput() used to
+// do for every line: grow a heap string byte by byte (readStringUntil),
+// trim it and walk the chain of 20 comparisons.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "ControlFrame.h"
+
+static const int frameCount = 20000;
+static const int repeats = 50;
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::vector<uint8_t> buildBinaryCorpus() {
+    std::vector<uint8_t> corpus;
+    srand(7);
+    for (int i = 0; i < frameCount; i++) {
+        ControlFrame::ControlStatePayload state;
+        state.sequence = (uint8_t)i;
+        state.drive = (int8_t)(rand() % 201 - 100);
+        state.turn = (int8_t)(rand() % 201 - 100);
+        state.turretRotation = (int8_t)(rand() % 3 * 100 - 100);
+        state.turretElevation = (int8_t)(rand() % 3 * 100 - 100);
+        state.gear = (uint8_t)(rand() % 6);
+        state.buttons = (uint8_t)(rand() % 2);
+
+        uint8_t frame[ControlFrame::maxPayload + ControlFrame::overhead];
+        size_t length = ControlFrame::encode(ControlFrame::TYPE_CONTROL_STATE, &state, sizeof(state),
+                                             frame, sizeof(frame));
+        corpus.insert(corpus.end(), frame, frame + length);
+
+        // Occasional line noise between frames
+        if (i % 100 == 0) {
+            corpus.push_back((uint8_t)rand());
+        }
+    }
+    return corpus;
+}
+
+static std::vector<uint8_t> buildTextCorpus() {
+    static const char* keys[] = {
+        "forward", "back", "left", "right", "turret_left",
+        "turret_right", "turret_elevate", "turret_lower", "fire"
+    };
+    std::string text;
+    srand(7);
+    for (int i = 0; i < frameCount; i++) {
+        int r = rand() % 20;
+        if (r == 18) {
+            text += "gear_up\n";
+        } else if (r == 19) {
+            text += "gear_down\n";
+        } else {
+            text += keys[r % 9];
+            text += (r < 9) ? "_press\n" : "_release\n";
+        }
+    }
+    return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+static int legacyDispatch(const std::string& command) {
+    static const char* commands[] = {
+        "forward_press", "forward_release", "back_press", "back_release",
+        "left_press", "left_release", "right_press", "right_release",
+        "turret_left_press", "turret_left_release", "turret_right_press", "turret_right_release",
+        "turret_elevate_press", "turret_elevate_release", "turret_lower_press", "turret_lower_release",
+        "fire_press", "fire_release", "gear_up", "gear_down"
+    };
+    for (int i = 0; i < 20; i++) {
+        if (command == commands[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void benchBinary(const std::vector<uint8_t>& corpus) {
+    ControlFrame::Parser parser;
+    uint32_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++) {
+        for (uint8_t byte : corpus) {
+            if (parser.feed(byte)) {
+                checksum += parser.payload()[1];
+            }
+        }
+    }
+    double seconds = secondsSince(start);
+    double bytes = (double)corpus.size() * repeats;
+    printf("binary frames  %7.1f MB/s  %6.2f ns/byte  %7.1f ns/update  %5.1f bytes/update"
+           "  (%u ok, %u rejected, checksum %u)\n",
+           bytes / seconds / 1e6, seconds * 1e9 / bytes,
+           seconds * 1e9 / ((double)frameCount * repeats), (double)corpus.size() / frameCount,
+           parser.framesReceived(), parser.framesRejected(), checksum);
+}
+
+static void benchText(const std::vector<uint8_t>& corpus) {
+    int checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++) {
+        std::string line;
+        for (uint8_t byte : corpus) {
+            if (byte != '\n') {
+                line += (char)byte;
+                continue;
+            }
+            size_t first = line.find_first_not_of(" \t\r");
+            size_t last = line.find_last_not_of(" \t\r");
+            std::string command = (first == std::string::npos) ? std::string() : line.substr(first, last - first + 1);
+            checksum += legacyDispatch(command);
+            line = std::string();
+        }
+    }
+    double seconds = secondsSince(start);
+    double bytes = (double)corpus.size() * repeats;
+    printf("text lines     %7.1f MB/s  %6.2f ns/byte  %7.1f ns/update  %5.1f bytes/update"
+           "  (checksum %d)\n",
+           bytes / seconds / 1e6, seconds * 1e9 / bytes,
+           seconds * 1e9 / ((double)frameCount * repeats), (double)corpus.size() / frameCount, checksum);
+}
+
+int main() {
+    std::vector<uint8_t> binary = buildBinaryCorpus();
+    std::vector<uint8_t> text = buildTextCorpus();
+
+    printf("%d state updates x %d repeats\n", frameCount, repeats);
+    printf("(a binary update carries the whole control state, a text update one key event)\n\n");
+    benchBinary(binary);
+    benchText(text);
+    return 0;
+}
@@ -0,0 +1,214 @@
+// Closed-loop track speed control against the differential-drive plant,
+// compared with the open-loop output, faster than real time.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -IProjectHephaistos -Ihost/sim
+//       host/bench/bench_speed_control.cpp ProjectHephaistos/TrackSpeedController.cpp
+//       ProjectHephaistos/TrackMotor.cpp ProjectHephaistos/SlewLimiter.cpp
+//       -o bench_speed_control
+//   ./bench_speed_control [kp ki kd kf]
+//
+// Gains default to the firmware's SPEED_* values; pass others to tune.
+// Scenarios, with the left track dragging more than the right one:
+//   straight  60 % for 10 s while the battery sags to 85 %: heading drift
+//             and speed error of each track
+//   step      0 -> 50 %: settling time and overshoot
+//   windup    100 % (out of reach under load) for 3 s, then 40 %: time
+//             until the speed is back within 2 % of the command
+// Exits non-zero if the closed loop misses any of the limits below.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include "TrackMotor.h"
+#include "TrackSpeedController.h"
+#include "TankPlant.h"
+
+static const uint32_t updateHz = 500;
+static const uint32_t plantSubsteps = 4;
+static const int32_t fullSpeedCounts = 4000;  // 1 m/s * 4000 counts/m
+
+// Firmware defaults (ProjectHephaistos.ino)
+static const float acceleration = 250;
+static const float jerk = 2500;
+static TrackSpeedController::Gains gains = {5.0f, 20.0f, 0.0f, 1.0f};
+
+// Regression limits for the closed loop
+static const float maxDriftDegrees = 2.0f;
+static const float maxSpeedError = 2.0f;   // % of full speed
+static const float maxSettleSeconds = 0.6f;
+static const float maxOvershoot = 5.0f;    // % of full speed
+static const float maxWindupSeconds = 0.5f;
+
+struct Tank {
+    TankPlant plant;
+    TankPlant::Driver leftDriver;
+    TankPlant::Driver rightDriver;
+    TrackMotor leftMotor;
+    TrackMotor rightMotor;
+    TrackSpeedController leftSpeed;
+    TrackSpeedController rightSpeed;
+    bool closedLoop;
+    uint32_t tick;
+
+    explicit Tank(bool closedLoop)
+        : leftDriver(plant.left),
+          rightDriver(plant.right),
+          leftMotor(leftDriver),
+          rightMotor(rightDriver),
+          closedLoop(closedLoop),
+          tick(0)
+    {
+        plant.left.load = 0.15f;
+        plant.right.load = 0.05f;
+        leftMotor.begin(20000, 10);
+        rightMotor.begin(20000, 10);
+        if (closedLoop) {
+            // As in the firmware: the controller ramps the setpoint
+            leftMotor.setRamp(0, 0, updateHz);
+            rightMotor.setRamp(0, 0, updateHz);
+            leftSpeed.configure(gains, fullSpeedCounts, updateHz);
+            rightSpeed.configure(gains, fullSpeedCounts, updateHz);
+            leftSpeed.setRamp(acceleration, jerk, updateHz);
+            rightSpeed.setRamp(acceleration, jerk, updateHz);
+        } else {
+            leftMotor.setRamp(acceleration, jerk, updateHz);
+            rightMotor.setRamp(acceleration, jerk, updateHz);
+        }
+    }
+
+    // One actuation tick, as actuateOutputs() does it
+    void step(int8_t left, int8_t right) {
+        if (closedLoop) {
+            leftMotor.setTarget(leftSpeed.update(left, plant.left.encoderCount()));
+            rightMotor.setTarget(rightSpeed.update(right, plant.right.encoderCount()));
+        } else {
+            leftMotor.setTarget(left);
+            rightMotor.setTarget(right);
+        }
+        leftMotor.update();
+        rightMotor.update();
+        for (uint32_t i = 0; i < plantSubsteps; i++) {
+            plant.step(1.0f / (updateHz * plantSubsteps));
+        }
+        tick++;
+    }
+
+    float leftPercent() const { return 100 * plant.left.speed / plant.left.noLoadSpeed; }
+    float rightPercent() const { return 100 * plant.right.speed / plant.right.noLoadSpeed; }
+};
+
+struct StraightResult {
+    float driftDegrees;
+    float leftError;
+    float rightError;
+};
+
+static StraightResult runStraight(bool closedLoop) {
+    Tank tank(closedLoop);
+    const uint32_t ticks = 10 * updateHz;
+    const int8_t command = 60;
+    double leftError = 0, rightError = 0;
+    uint32_t samples = 0;
+    for (uint32_t t = 0; t < ticks; t++) {
+        tank.plant.battery = 1.0f - 0.15f * t / ticks;
+        tank.step(command, command);
+        if (t >= ticks / 2) {
+            leftError += fabs(tank.leftPercent() - command);
+            rightError += fabs(tank.rightPercent() - command);
+            samples++;
+        }
+    }
+    StraightResult result;
+    result.driftDegrees = (float)(tank.plant.heading * 180 / M_PI);
+    result.leftError = (float)(leftError / samples);
+    result.rightError = (float)(rightError / samples);
+    return result;
+}
+
+// Seconds after t0 until the left track stays within band % of target
+static float settleTime(const float* speeds, uint32_t t0, uint32_t ticks, float target, float band) {
+    uint32_t settled = t0;
+    for (uint32_t t = t0; t < ticks; t++) {
+        if (fabsf(speeds[t] - target) > band) {
+            settled = t + 1;
+        }
+    }
+    return (float)(settled - t0) / updateHz;
+}
+
+static void runStep(bool closedLoop, float& settle, float& overshoot) {
+    Tank tank(closedLoop);
+    const uint32_t ticks = 3 * updateHz;
+    const int8_t command = 50;
+    static float speeds[3 * updateHz];
+    overshoot = 0;
+    for (uint32_t t = 0; t < ticks; t++) {
+        tank.step(command, command);
+        speeds[t] = tank.leftPercent();
+        if (speeds[t] - command > overshoot) {
+            overshoot = speeds[t] - command;
+        }
+    }
+    settle = settleTime(speeds, 0, ticks, command, 2.0f);
+}
+
+static float runWindup(bool closedLoop) {
+    Tank tank(closedLoop);
+    const uint32_t saturated = 3 * updateHz;
+    const uint32_t ticks = saturated + 3 * updateHz;
+    const int8_t command = 40;
+    static float speeds[6 * updateHz];
+    for (uint32_t t = 0; t < ticks; t++) {
+        int8_t target = t < saturated ? 100 : command;
+        tank.step(target, target);
+        speeds[t] = tank.leftPercent();
+    }
+    return settleTime(speeds, saturated, ticks, command, 2.0f);
+}
+
+int main(int argc, char** argv) {
+    if (argc == 5) {
+        gains.kp = (float)atof(argv[1]);
+        gains.ki = (float)atof(argv[2]);
+        gains.kd = (float)atof(argv[3]);
+        gains.kf = (float)atof(argv[4]);
+    } else if (argc != 1) {
+        fprintf(stderr, "usage: %s [kp ki kd kf]\n", argv[0]);
+        return 2;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    StraightResult open = runStraight(false);
+    StraightResult closed = runStraight(true);
+    float openSettle, openOvershoot, closedSettle, closedOvershoot;
+    runStep(false, openSettle, openOvershoot);
+    runStep(true, closedSettle, closedOvershoot);
+    float openWindup = runWindup(false);
+    float closedWindup = runWindup(true);
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const double simulated = 2 * (10 + 3 + 6);
+
+    printf("gains kp %.2f ki %.2f kd %.3f kf %.2f, %u Hz\n\n", gains.kp, gains.ki, gains.kd, gains.kf, updateHz);
+    printf("                     open loop   closed loop   limit\n");
+    printf("straight drift       %7.2f deg  %7.2f deg  %5.1f deg\n",
+           open.driftDegrees, closed.driftDegrees, maxDriftDegrees);
+    printf("  left speed error   %7.2f %%    %7.2f %%    %5.1f %%\n", open.leftError, closed.leftError, maxSpeedError);
+    printf("  right speed error  %7.2f %%    %7.2f %%    %5.1f %%\n", open.rightError, closed.rightError, maxSpeedError);
+    printf("step settling        %7.3f s    %7.3f s    %5.2f s\n", openSettle, closedSettle, maxSettleSeconds);
+    printf("  overshoot          %7.2f %%    %7.2f %%    %5.1f %%\n", openOvershoot, closedOvershoot, maxOvershoot);
+    printf("windup recovery      %7.3f s    %7.3f s    %5.2f s\n", openWindup, closedWindup, maxWindupSeconds);
+    printf("\n%.0f s simulated in %.3f s (%.0fx real time)\n", simulated, elapsed, simulated / elapsed);
+
+    bool ok = fabsf(closed.driftDegrees) <= maxDriftDegrees &&
+              closed.leftError <= maxSpeedError && closed.rightError <= maxSpeedError &&
+              closedSettle <= maxSettleSeconds && closedOvershoot <= maxOvershoot &&
+              closedWindup <= maxWindupSeconds;
+    if (!ok) {
+        printf("closed loop outside limits\n");
+    }
+    return ok ? 0 : 1;
+}
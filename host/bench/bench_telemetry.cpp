@@ -0,0 +1,142 @@
+// Telemetry bandwidth: delta-encoded binary frames vs. the text status
+// block, plus a round trip through the frame parser and decoder.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -IProjectHephaistos
+//       host/bench/bench_telemetry.cpp ProjectHephaistos/Telemetry.cpp
+//       ProjectHephaistos/ControlFrame.cpp -o bench_telemetry
+//   ./bench_telemetry [capture.bin]
+//
+// A scripted 60 s drive is reported at the firmware's telemetry rate.
+// The decoder gets the stream with one frame in 20 dropped; every value
+// must match whenever it reports being in sync, and it must be back in
+// sync within one keyframe interval of the last drop. Exits non-zero otherwise.
+// With a file name, the stream (without drops) is also written there,
+// e.g. to feed tank_controller.py's decoder.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ControlFrame.h"
+#include "Telemetry.h"
+
+static const uint32_t telemetryHz = 10;
+static const uint32_t seconds = 60;
+static const uint32_t keyframeMs = 1000;
+
+// Bytes of the status block sendTelemetry() prints as text
+static size_t textBlockSize(const Telemetry::Sample& s) {
+    char buffer[512];
+    bool firing = (s.flags & Telemetry::FLAG_FIRING) != 0;
+    if (!(s.flags & Telemetry::FLAG_CONNECTED) ||
+        (s.leftTrackCommand == 0 && s.rightTrackCommand == 0 && s.turretRotationRate == 0 &&
+         s.turretElevationRate == 0 && !firing)) {
+        return 0;
+    }
+    return snprintf(buffer, sizeof(buffer),
+                    "------ Tank Control Status ------\r\n"
+                    "Gear: %d\r\nLeft Track Speed: %d\r\nRight Track Speed: %d\r\n"
+                    "Turret Rotation: %d\r\nTurret Elevation: %d\r\nFlamethrower Active: %s\r\n"
+                    "---------------------------------\r\n",
+                    s.gear, s.leftTrackCommand, s.rightTrackCommand, s.turretRotationRate,
+                    s.turretElevationRate, firing ? "Yes" : "No");
+}
+
+static int8_t approach(int8_t value, int8_t target, int step) {
+    int next = value < target ? value + step : value - step;
+    if ((value < target && next > target) || (value > target && next < target)) {
+        next = target;
+    }
+    return (int8_t)next;
+}
+
+int main(int argc, char** argv) {
+    FILE* capture = argc > 1 ? fopen(argv[1], "wb") : nullptr;
+    if (argc > 1 && !capture) {
+        perror(argv[1]);
+        return 2;
+    }
+
+    Telemetry::Encoder encoder(keyframeMs);
+    ControlFrame::Parser parser;
+    Telemetry::Decoder decoder;
+
+    Telemetry::Sample sample = {};
+    sample.flags = Telemetry::FLAG_CONNECTED;
+    sample.gear = 3;
+    int8_t leftTarget = 0, rightTarget = 0, turretRate = 0;
+
+    srand(5);
+    uint64_t textBytes = 0;
+    uint32_t dropped = 0, mismatches = 0, maxResyncMs = 0;
+    uint32_t lastDropMs = 0;
+    bool waitingForSync = false;
+    const uint32_t frames = seconds * telemetryHz;
+
+    for (uint32_t i = 0; i < frames; i++) {
+        uint32_t nowMs = i * 1000 / telemetryHz;
+
+        // Stick changes every second or two, motors and turret follow
+        if (i % (telemetryHz + rand() % telemetryHz) == 0) {
+            leftTarget = (int8_t)(rand() % 201 - 100);
+            rightTarget = rand() % 2 ? leftTarget : (int8_t)(rand() % 201 - 100);
+            turretRate = rand() % 3 == 0 ? (int8_t)(rand() % 201 - 100) : 0;
+            sample.flags = Telemetry::FLAG_CONNECTED | (rand() % 6 == 0 ? Telemetry::FLAG_FIRING : 0);
+        }
+        sample.leftTrackCommand = leftTarget;
+        sample.rightTrackCommand = rightTarget;
+        sample.leftTrackOutput = approach(sample.leftTrackOutput, leftTarget, 25);
+        sample.rightTrackOutput = approach(sample.rightTrackOutput, rightTarget, 25);
+        sample.turretRotationRate = turretRate;
+        sample.turretRotation = (int16_t)(sample.turretRotation + turretRate * 9 / 10);
+        sample.controlSequence = (uint16_t)(sample.controlSequence + (rand() % 4 == 0));
+        textBytes += textBlockSize(sample);
+
+        uint8_t frame[Telemetry::maxPayload + ControlFrame::overhead];
+        size_t length = encoder.encode(sample, nowMs, frame, sizeof(frame));
+        if (length == 0) {
+            continue;
+        }
+        if (capture) {
+            fwrite(frame, 1, length, capture);
+        }
+        if (rand() % 20 == 0) {
+            dropped++;
+            lastDropMs = nowMs;
+            waitingForSync = true;
+            continue;
+        }
+
+        for (size_t b = 0; b < length; b++) {
+            if (parser.feed(frame[b]) && parser.type() == ControlFrame::TYPE_TELEMETRY) {
+                decoder.apply(parser.payload(), parser.length());
+            }
+        }
+        if (waitingForSync && decoder.inSync()) {
+            waitingForSync = false;
+            if (nowMs - lastDropMs > maxResyncMs) {
+                maxResyncMs = nowMs - lastDropMs;
+            }
+        }
+        if (decoder.inSync() && memcmp(&decoder.sample(), &sample, sizeof(sample)) != 0) {
+            mismatches++;
+        }
+    }
+    if (capture) {
+        fclose(capture);
+    }
+
+    uint32_t binaryBytes = encoder.bytesSent();
+    printf("%u s at %u Hz, keyframe every %u ms\n\n", seconds, telemetryHz, keyframeMs);
+    printf("text status block   %7llu bytes  %6.1f B/s\n",
+           (unsigned long long)textBytes, (double)textBytes / seconds);
+    printf("binary delta frames %7u bytes  %6.1f B/s  (%u frames, avg %.1f B)\n",
+           binaryBytes, (double)binaryBytes / seconds, encoder.framesSent(),
+           (double)binaryBytes / encoder.framesSent());
+    printf("full frame          %7u bytes\n\n", (unsigned)(Telemetry::maxPayload + ControlFrame::overhead));
+    printf("dropped %u frames, decoder counted %u lost, longest resync %u ms, mismatches %u\n",
+           dropped, decoder.framesLost(), maxResyncMs, mismatches);
+
+    bool ok = mismatches == 0 && decoder.framesLost() == dropped && maxResyncMs <= keyframeMs;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,199 @@
+// Turret motion planner driving a simulated servo, faster than real time.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -IProjectHephaistos -Ihost/sim
+//       host/bench/bench_turret_motion.cpp ProjectHephaistos/TurretAxis.cpp
+//       ProjectHephaistos/ServoOutput.cpp ProjectHephaistos/ActuatorBackend.cpp
+//       -o bench_turret_motion
+//   ./bench_turret_motion
+//
+// The rotation axis runs at the firmware's actuation rate through
+// ServoOutput and the mock actuator backend into a ServoPlant that only
+// picks up a pulse once per servo frame. For no ramp (the rate snapping
+// between -100/0/+100), the trapezoidal and the S-curve profile, at 50
+// and 333 Hz servo frames:
+//   tracking  random stick for 20 s: servo angle vs. planner position
+//   settle    full rate for 0.5 s, then release: time until the servo
+//             stays within 0.5 deg of where the planner stopped
+//   limit     full rate into the soft limit: servo overshoot past it
+// Exits non-zero if the planner ever leaves the soft limits, or a
+// profile settles slower than the limit below.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "TurretAxis.h"
+#include "ServoOutput.h"
+#include "MockActuatorBackend.h"
+#include "ServoPlant.h"
+
+static const uint32_t updateHz = 500;
+static const uint32_t plantSubsteps = 10;
+static const uint8_t servoPin = 18;
+static const uint8_t resolutionBits = 14;
+
+// Firmware defaults (ProjectHephaistos.ino)
+static const float rotationRate = 90;
+static const float rampTime = 0.25f;
+static const int32_t minPosition = -8500;
+static const int32_t maxPosition = 8500;
+static const uint16_t minPulseUs = 500;
+static const uint16_t maxPulseUs = 2500;
+
+static const float maxSettleSeconds = 0.3f;
+
+struct Turret {
+    MockActuatorBackend actuators;
+    TurretAxis axis;
+    ServoOutput servo;
+    ServoPlant plant;
+    uint32_t frameHz;
+    bool limitsKept;
+
+    Turret(TurretAxis::Profile profile, float ramp, uint32_t frameHz)
+        : servo(actuators, servoPin),
+          plant(frameHz, minPulseUs, maxPulseUs),
+          frameHz(frameHz),
+          limitsKept(true)
+    {
+        axis.configure(profile, rotationRate, ramp, updateHz);
+        axis.setLimits(minPosition, maxPosition);
+        axis.reset(0);
+        servo.begin(frameHz, resolutionBits);
+        servo.setRange(-9000, 9000, minPulseUs, maxPulseUs);
+        servo.write(axis.position());
+        actuators.commit();
+    }
+
+    // One actuation tick, as actuateOutputs() does it
+    void step(int8_t rate) {
+        axis.setRate(rate);
+        int32_t position = axis.update();
+        if (position < minPosition || position > maxPosition) {
+            limitsKept = false;
+        }
+        servo.write(position);
+        actuators.commit();
+
+        // What the LEDC output sends, back in microseconds
+        uint32_t duty = actuators.duty(servoPin);
+        uint16_t pulseUs = (uint16_t)lround((double)duty * 1000000 / ((uint64_t)frameHz << resolutionBits));
+        for (uint32_t i = 0; i < plantSubsteps; i++) {
+            plant.step(pulseUs, 1.0 / (updateHz * plantSubsteps));
+        }
+    }
+
+    double error() const { return plant.angle - axis.position() / 100.0; }
+};
+
+struct Result {
+    double rmsError;
+    double maxError;
+    double settleSeconds;
+    double overshoot;     // degrees past the soft limit
+    double peakAccel;     // planner, deg/s^2
+    bool limitsKept;
+};
+
+static Result run(TurretAxis::Profile profile, float ramp, uint32_t frameHz) {
+    Result result = {};
+    result.limitsKept = true;
+
+    // Tracking under a random stick
+    {
+        Turret turret(profile, ramp, frameHz);
+        srand(11);
+        int8_t rate = 0;
+        uint32_t nextChange = 0;
+        double sumSquares = 0;
+        int32_t lastVelocity = 0;
+        const uint32_t ticks = 20 * updateHz;
+        for (uint32_t t = 0; t < ticks; t++) {
+            if (t == nextChange) {
+                rate = (int8_t)(rand() % 3 == 0 ? 0 : rand() % 201 - 100);
+                nextChange += updateHz / 5 + rand() % updateHz;
+            }
+            turret.step(rate);
+            double error = fabs(turret.error());
+            sumSquares += error * error;
+            if (error > result.maxError) {
+                result.maxError = error;
+            }
+            double accel = fabs((double)(turret.axis.velocity() - lastVelocity) * updateHz / 100);
+            if (accel > result.peakAccel) {
+                result.peakAccel = accel;
+            }
+            lastVelocity = turret.axis.velocity();
+        }
+        result.rmsError = sqrt(sumSquares / ticks);
+        result.limitsKept = result.limitsKept && turret.limitsKept;
+    }
+
+    // Settling after the stick is released
+    {
+        Turret turret(profile, ramp, frameHz);
+        const uint32_t moving = updateHz / 2;
+        const uint32_t ticks = moving + 2 * updateHz;
+        uint32_t settled = moving;
+        for (uint32_t t = 0; t < ticks; t++) {
+            turret.step(t < moving ? 100 : 0);
+            if (t >= moving && (turret.axis.moving() || fabs(turret.error()) > 0.5)) {
+                settled = t + 1;
+            }
+        }
+        result.settleSeconds = (double)(settled - moving) / updateHz;
+        result.limitsKept = result.limitsKept && turret.limitsKept;
+    }
+
+    // Running into the soft limit
+    {
+        Turret turret(profile, ramp, frameHz);
+        double furthest = 0;
+        for (uint32_t t = 0; t < 3 * updateHz; t++) {
+            turret.step(100);
+            if (turret.plant.angle > furthest) {
+                furthest = turret.plant.angle;
+            }
+        }
+        result.overshoot = furthest - maxPosition / 100.0;
+        if (turret.axis.position() != maxPosition) {
+            result.limitsKept = false;
+        }
+        result.limitsKept = result.limitsKept && turret.limitsKept;
+    }
+    return result;
+}
+
+int main() {
+    struct Case {
+        const char* name;
+        TurretAxis::Profile profile;
+        float ramp;
+    };
+    const Case cases[] = {
+        {"no ramp",     TurretAxis::PROFILE_TRAPEZOIDAL, 0},
+        {"trapezoidal", TurretAxis::PROFILE_TRAPEZOIDAL, rampTime},
+        {"s-curve",     TurretAxis::PROFILE_S_CURVE,     rampTime},
+    };
+    const uint32_t frameRates[] = {50, 333};
+
+    printf("%.0f deg/s, %.2f s ramp, soft limits %.0f..%.0f deg, planner at %u Hz\n\n",
+           rotationRate, rampTime, minPosition / 100.0, maxPosition / 100.0, updateHz);
+    printf("profile      frame   rms err  max err  settle   overshoot  peak accel\n");
+
+    bool ok = true;
+    for (const Case& c : cases) {
+        for (uint32_t frameHz : frameRates) {
+            Result r = run(c.profile, c.ramp, frameHz);
+            printf("%-12s %3u Hz  %5.2f    %5.2f    %5.3f s  %5.2f deg  %6.0f deg/s^2%s\n",
+                   c.name, frameHz, r.rmsError, r.maxError, r.settleSeconds, r.overshoot, r.peakAccel,
+                   r.limitsKept ? "" : "  LIMIT VIOLATED");
+            ok = ok && r.limitsKept;
+            if (c.ramp > 0 && r.settleSeconds > maxSettleSeconds) {
+                ok = false;
+            }
+        }
+    }
+    printf("\nerrors in degrees, servo angle vs. planner position\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,314 @@
+// UDP control channel over loopback: UdpControl on a real socket, driven
+// by a sender socket in the same process, in virtual time.
+//
+// Built by CMake as bench_udp_control (UdpControl against the host shim):
+//   cmake -S . -B build && cmake --build build
+//   build/host/bench_udp_control
+//
+// Checks that every state datagram is acked with its sequence and send
+// time, that late and duplicated ones are dropped and flagged, that
+// other datagrams are ignored, that the jitter buffer hands datagrams
+// delayed by up to its length to the outputs at the sender's pace, that
+// a full buffer drops the oldest, that the link times out and comes
+// back with a restarted sender, and that pings are answered without
+// counting as input. Reports the cost of update() with and
+// without a datagram waiting. Exits non-zero if a check fails.
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+#include "HostSim.h"
+#include "ControlFrame.h"
+#include "Log.h"
+#include "UdpControl.h"
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+
+static const uint16_t tankPort = 42120;
+static const uint32_t sendPeriodMs = 20;
+static const uint32_t pollPeriodUs = 1000;
+
+static size_t discardLog(const uint8_t* data, size_t length) {
+    return length;
+}
+
+static bool failed = false;
+
+static void check(bool pass, const char* what) {
+    printf("  %-58s %s\n", what, pass ? "ok" : "FAIL");
+    failed = failed || !pass;
+}
+
+// Small deterministic generator, so every run sends the same
+static uint32_t nextRandom(uint32_t& seed) {
+    seed = seed * 1103515245 + 12345;
+    return seed >> 16;
+}
+
+// ----------------------
+// Host side
+// ----------------------
+class Sender {
+public:
+    Sender() { socket.begin(0); }
+
+    void send(uint32_t sequence, uint32_t sendTimeMs, int8_t drive) {
+        ControlFrame::NetStatePayload state = {sequence, sendTimeMs, drive, 0, 0, 0, 1, 0};
+        uint8_t frame[sizeof(state) + ControlFrame::overhead];
+        size_t length = ControlFrame::encode(ControlFrame::TYPE_NET_STATE, &state, sizeof(state), frame,
+                                             sizeof(frame));
+        sendRaw(frame, length);
+    }
+
+    void sendRaw(const uint8_t* data, size_t length) {
+        socket.beginPacket(IPAddress(127, 0, 0, 1), tankPort);
+        socket.write(data, length);
+        socket.endPacket();
+    }
+
+    void ping(uint32_t sequence, uint32_t hostTimeUs) {
+        ControlFrame::PingPayload ping = {sequence, hostTimeUs};
+        uint8_t frame[sizeof(ping) + ControlFrame::overhead];
+        size_t length = ControlFrame::encode(ControlFrame::TYPE_PING, &ping, sizeof(ping), frame, sizeof(frame));
+        sendRaw(frame, length);
+    }
+
+    // Every ack waiting, in order; pongs go to pongsOut if given
+    std::vector<ControlFrame::NetAckPayload> acks(std::vector<ControlFrame::PongPayload>* pongsOut = 0) {
+        std::vector<ControlFrame::NetAckPayload> result;
+        while (socket.parsePacket() > 0) {
+            uint8_t data[64];
+            int length = socket.read(data, sizeof(data));
+            ControlFrame::Parser parser;
+            for (int i = 0; i < length; i++) {
+                if (!parser.feed(data[i])) {
+                    continue;
+                }
+                if (parser.type() == ControlFrame::TYPE_NET_ACK &&
+                    parser.length() == sizeof(ControlFrame::NetAckPayload)) {
+                    ControlFrame::NetAckPayload ack;
+                    memcpy(&ack, parser.payload(), sizeof(ack));
+                    result.push_back(ack);
+                } else if (parser.type() == ControlFrame::TYPE_PONG && pongsOut &&
+                           parser.length() == sizeof(ControlFrame::PongPayload)) {
+                    ControlFrame::PongPayload pong;
+                    memcpy(&pong, parser.payload(), sizeof(pong));
+                    pongsOut->push_back(pong);
+                }
+            }
+        }
+        return result;
+    }
+
+private:
+    WiFiUDP socket;
+};
+
+// Polls control until virtual time untilUs, like the input stage
+static void pollUntil(UdpControl& control, uint64_t untilUs) {
+    while (HostSim::nowUs() + pollPeriodUs <= untilUs) {
+        HostSim::advance(pollPeriodUs);
+        control.update();
+    }
+}
+
+// ----------------------
+// Checks
+// ----------------------
+static void checkAcks() {
+    printf("Acks and stale datagrams\n");
+    UdpControl control("Hephaistos", "flamethrower", true, tankPort, 0);
+    Sender sender;
+
+    uint32_t startMs = millis();
+    sender.send(1, startMs, 50);
+    pollUntil(control, HostSim::nowUs() + 2000);
+    std::vector<ControlFrame::NetAckPayload> acks = sender.acks();
+    check(acks.size() == 1 && acks[0].sequence == 1 && acks[0].sendTimeMs == startMs && !acks[0].flags,
+          "ack echoes sequence and send time");
+    check(control.getState().connected && control.getState().leftTrackSpeed > 0, "state applied, link up");
+
+    sender.send(2, startMs + 20, 100);
+    pollUntil(control, HostSim::nowUs() + 2000);
+    check(control.getState().leftTrackSpeed == 20 && control.stats().applied == 2, "newer datagram applied");
+
+    // A duplicate and a late one
+    sender.send(2, startMs + 20, -100);
+    sender.send(1, startMs, -100);
+    pollUntil(control, HostSim::nowUs() + 2000);
+    acks = sender.acks();
+    bool flagged = acks.size() == 3 && acks[1].flags == ControlFrame::ACK_STALE &&
+                   acks[2].flags == ControlFrame::ACK_STALE && acks[2].stale == 2 && acks[2].applied == 2;
+    check(flagged, "duplicate and late datagram acked as stale");
+    check(control.stats().stale == 2 && control.getState().leftTrackSpeed == 20, "stale datagrams not applied");
+
+    // Not a state datagram: ignored, no ack
+    uint8_t noise[] = {'h', 'e', 'l', 'l', 'o'};
+    sender.sendRaw(noise, sizeof(noise));
+    uint8_t frame[sizeof(ControlFrame::NetStatePayload) + ControlFrame::overhead];
+    ControlFrame::NetStatePayload state = {3, startMs + 40, -100, 0, 0, 0, 1, 0};
+    ControlFrame::encode(ControlFrame::TYPE_NET_STATE, &state, sizeof(state), frame, sizeof(frame));
+    frame[sizeof(frame) - 1] ^= 0xFF;
+    sender.sendRaw(frame, sizeof(frame));
+    pollUntil(control, HostSim::nowUs() + 2000);
+    check(control.stats().rejected == 2 && sender.acks().empty() && control.getState().leftTrackSpeed == 20,
+          "noise and bad CRC rejected without an ack");
+}
+
+// Datagrams sent every 20 ms, each delayed by 0..maxDelayMs on the way;
+// returns the largest deviation from 20 ms between two applied ones
+static uint32_t appliedJitterUs(uint32_t bufferMs, uint32_t maxDelayMs, uint32_t& applied, double& nsPerUpdate,
+                                double& nsPerDatagram) {
+    UdpControl control("Hephaistos", "flamethrower", true, tankPort, bufferMs);
+    Sender sender;
+    uint32_t seed = 8;
+    const uint32_t count = 500;
+
+    uint64_t originUs = HostSim::nowUs() + 1000 - HostSim::nowUs() % 1000;
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t sendUs = originUs + (uint64_t)i * sendPeriodMs * 1000;
+        // The first one is as fast as any, so the buffer's estimate holds
+        uint64_t delayUs = i == 0 ? 0 : (nextRandom(seed) % (maxDelayMs * 1000 + 1));
+        uint32_t sequence = i + 1;
+        HostSim::schedule(sendUs + delayUs, [&sender, sequence, sendUs]() {
+            sender.send(sequence, (uint32_t)(sendUs / 1000), (int8_t)(sequence % 2 ? 40 : 60));
+        });
+    }
+
+    std::vector<uint64_t> appliedAt;
+    uint32_t lastApplied = 0;
+    double idleNs = 0;
+    uint32_t idlePolls = 0;
+    double busyNs = 0;
+    uint32_t busyPolls = 0;
+    uint64_t endUs = originUs + (uint64_t)(count + 5) * sendPeriodMs * 1000 + bufferMs * 1000;
+    while (HostSim::nowUs() < endUs) {
+        HostSim::advance(pollPeriodUs);
+        uint32_t receivedBefore = control.stats().received;
+        auto start = std::chrono::steady_clock::now();
+        control.update();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        if (control.stats().received != receivedBefore) {
+            busyNs += ns;
+            busyPolls++;
+        } else {
+            idleNs += ns;
+            idlePolls++;
+        }
+        if (control.stats().applied != lastApplied) {
+            lastApplied = control.stats().applied;
+            appliedAt.push_back(HostSim::nowUs());
+        }
+        sender.acks();
+    }
+    applied = control.stats().applied;
+    nsPerUpdate = idlePolls ? idleNs / idlePolls : 0;
+    nsPerDatagram = busyPolls ? busyNs / busyPolls : 0;
+
+    uint32_t worstUs = 0;
+    for (size_t i = 1; i < appliedAt.size(); i++) {
+        int64_t deviation = (int64_t)(appliedAt[i] - appliedAt[i - 1]) - sendPeriodMs * 1000;
+        uint32_t magnitude = (uint32_t)(deviation < 0 ? -deviation : deviation);
+        worstUs = magnitude > worstUs ? magnitude : worstUs;
+    }
+    return worstUs;
+}
+
+static void checkJitterBuffer() {
+    printf("Jitter buffer, datagrams delayed by 0..15 ms\n");
+    uint32_t directApplied = 0;
+    uint32_t bufferedApplied = 0;
+    double idleNs = 0;
+    double datagramNs = 0;
+    uint32_t directUs = appliedJitterUs(0, 15, directApplied, idleNs, datagramNs);
+    uint32_t bufferedUs = appliedJitterUs(20, 15, bufferedApplied, idleNs, datagramNs);
+    printf("  %-12s %8s %14s\n", "buffer", "applied", "worst jitter");
+    printf("  %-12s %8lu %11.1f ms\n", "none", (unsigned long)directApplied, directUs / 1000.0);
+    printf("  %-12s %8lu %11.1f ms\n", "20 ms", (unsigned long)bufferedApplied, bufferedUs / 1000.0);
+    printf("  update(): %.0f ns idle, %.0f ns with a datagram\n", idleNs, datagramNs);
+    check(bufferedApplied == 500, "every datagram within the buffer applied");
+    check(bufferedUs <= 2 * pollPeriodUs, "applied at the sender's pace (within 2 polls)");
+    check(directUs > bufferedUs, "smoother than without the buffer");
+}
+
+static void checkOverflowAndTimeout() {
+    printf("Overflow and link timeout\n");
+    UdpControl control("Hephaistos", "flamethrower", true, tankPort, 500);
+    Sender sender;
+
+    // Ten at once into eight slots, none due yet
+    uint32_t nowMs = millis();
+    for (uint32_t i = 1; i <= 10; i++) {
+        sender.send(i, nowMs, 30);
+    }
+    pollUntil(control, HostSim::nowUs() + 2000);
+    std::vector<ControlFrame::NetAckPayload> acks = sender.acks();
+    check(control.stats().overflowed == 2 && !acks.empty() && acks.back().buffered == 8,
+          "full buffer drops the oldest");
+
+    // Silence past the timeout: the held ones are dropped, not applied late
+    pollUntil(control, HostSim::nowUs() + 600000);
+    check(!control.getState().connected && control.getState().leftTrackSpeed == 0 &&
+              control.stats().applied == 0,
+          "link down after silence, held datagrams dropped");
+}
+
+static void checkRestartedSequence() {
+    printf("Sender restart\n");
+    UdpControl control("Hephaistos", "flamethrower", true, tankPort, 0);
+    Sender sender;
+    for (uint32_t i = 100; i < 110; i++) {
+        sender.send(i, millis(), 30);
+        pollUntil(control, HostSim::nowUs() + sendPeriodMs * 1000);
+    }
+    pollUntil(control, HostSim::nowUs() + 300000);
+    check(!control.getState().connected && control.getState().leftTrackSpeed == 0, "link down after silence");
+
+    Sender restarted;
+    restarted.send(1, millis(), -30);
+    pollUntil(control, HostSim::nowUs() + 2000);
+    check(control.getState().connected && control.getState().leftTrackSpeed < 0 && restarted.acks().size() == 1,
+          "lower sequence accepted after the timeout");
+}
+
+static void checkPing() {
+    printf("Ping\n");
+    UdpControl control("Hephaistos", "flamethrower", true, tankPort, 0);
+    Sender sender;
+    sender.send(1, millis(), 40);
+    pollUntil(control, HostSim::nowUs() + 2000);
+    sender.acks();
+
+    uint32_t sentUs = micros();
+    sender.ping(7, 123456);
+    pollUntil(control, HostSim::nowUs() + 2000);
+    std::vector<ControlFrame::PongPayload> pongs;
+    std::vector<ControlFrame::NetAckPayload> acks = sender.acks(&pongs);
+    check(acks.empty() && pongs.size() == 1 && pongs[0].sequence == 7 && pongs[0].hostTimeUs == 123456,
+          "pong echoes sequence and host time, no ack");
+    check(pongs.size() == 1 && pongs[0].receivedUs >= sentUs && pongs[0].sentUs >= pongs[0].receivedUs &&
+              pongs[0].frames == 2 && pongs[0].rejected == 0,
+          "pong carries tank timestamps and counters");
+
+    // Pings alone don't keep the link up
+    for (uint32_t i = 0; i < 20; i++) {
+        sender.ping(8 + i, 0);
+        pollUntil(control, HostSim::nowUs() + sendPeriodMs * 1000);
+    }
+    check(control.stats().pings == 21 && !control.getState().connected && control.stats().applied == 1,
+          "pings not taken as input");
+}
+
+int main() {
+    Log::begin(discardLog, millis);
+    Serial.begin(115200);
+
+    checkAcks();
+    checkJitterBuffer();
+    checkOverflowAndTimeout();
+    checkRestartedSequence();
+    checkPing();
+
+    printf("%s\n", failed ? "FAIL" : "PASS");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,152 @@
+// Torn-read stress test for the ControlState hand-over between the input
+// task and the actuation task.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -pthread -IProjectHephaistos host/bench/stress_seqlock.cpp
+//       -o stress_seqlock
+//   ./stress_seqlock [seconds]
+//
+// One writer thread publishes ControlState values whose fields are all
+// derived from the same counter; reader threads check that every snapshot
+// they get is internally consistent. The same run is repeated with a plain
+// field-by-field copy to show the check does catch tearing. Exits non-zero
+// if the SeqLock ever hands out a torn value.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "ControlState.h"
+#include "SeqLock.h"
+
+static const int readerCount = 3;
+
+static ControlState makeState(uint32_t n) {
+    int k = (int)(n % 201);
+    ControlState state;
+    state.sequence = n;
+    state.timestampMs = n * 4;
+    state.version = CONTROL_STATE_VERSION;
+    state.connected = (n & 1) != 0;
+    state.leftTrackSpeed = (int8_t)(k - 100);
+    state.rightTrackSpeed = (int8_t)(100 - k);
+    state.turretRotation = (int8_t)(k - 100);
+    state.turretElevation = (int8_t)(100 - k);
+    state.flamethrowerActive = (n & 1) == 0;
+    state.currentGear = (uint8_t)(k % 5 + 1);
+    return state;
+}
+
+static bool consistent(const ControlState& s) {
+    int k = s.leftTrackSpeed + 100;
+    return s.sequence % 201 == (uint32_t)k &&
+           s.timestampMs == s.sequence * 4 &&
+           s.rightTrackSpeed == 100 - k &&
+           s.turretRotation == k - 100 &&
+           s.turretElevation == 100 - k &&
+           s.currentGear == k % 5 + 1 &&
+           s.connected != s.flamethrowerActive;
+}
+
+// Same fields without any protocol, copied one by one
+struct UnprotectedState {
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint32_t> timestampMs;
+    std::atomic<bool> connected;
+    std::atomic<int8_t> leftTrackSpeed;
+    std::atomic<int8_t> rightTrackSpeed;
+    std::atomic<int8_t> turretRotation;
+    std::atomic<int8_t> turretElevation;
+    std::atomic<bool> flamethrowerActive;
+    std::atomic<uint8_t> currentGear;
+
+    void store(const ControlState& s) {
+        sequence.store(s.sequence, std::memory_order_relaxed);
+        timestampMs.store(s.timestampMs, std::memory_order_relaxed);
+        connected.store(s.connected, std::memory_order_relaxed);
+        leftTrackSpeed.store(s.leftTrackSpeed, std::memory_order_relaxed);
+        rightTrackSpeed.store(s.rightTrackSpeed, std::memory_order_relaxed);
+        turretRotation.store(s.turretRotation, std::memory_order_relaxed);
+        turretElevation.store(s.turretElevation, std::memory_order_relaxed);
+        flamethrowerActive.store(s.flamethrowerActive, std::memory_order_relaxed);
+        currentGear.store(s.currentGear, std::memory_order_relaxed);
+    }
+
+    void load(ControlState& s) const {
+        s.sequence = sequence.load(std::memory_order_relaxed);
+        s.timestampMs = timestampMs.load(std::memory_order_relaxed);
+        s.connected = connected.load(std::memory_order_relaxed);
+        s.leftTrackSpeed = leftTrackSpeed.load(std::memory_order_relaxed);
+        s.rightTrackSpeed = rightTrackSpeed.load(std::memory_order_relaxed);
+        s.turretRotation = turretRotation.load(std::memory_order_relaxed);
+        s.turretElevation = turretElevation.load(std::memory_order_relaxed);
+        s.flamethrowerActive = flamethrowerActive.load(std::memory_order_relaxed);
+        s.currentGear = currentGear.load(std::memory_order_relaxed);
+    }
+};
+
+template <typename Slot>
+static uint64_t run(const char* label, Slot& slot, double seconds) {
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> reads(0), torn(0);
+    uint64_t writes = 0;
+
+    slot.store(makeState(0));
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < readerCount; i++) {
+        readers.emplace_back([&]() {
+            uint64_t localReads = 0, localTorn = 0;
+            ControlState state;
+            while (!stop.load(std::memory_order_relaxed)) {
+                slot.load(state);
+                localReads++;
+                if (!consistent(state)) {
+                    localTorn++;
+                }
+            }
+            reads += localReads;
+            torn += localTorn;
+        });
+    }
+
+    std::thread writer([&]() {
+        uint32_t n = 1;
+        while (!stop.load(std::memory_order_relaxed)) {
+            slot.store(makeState(n++));
+        }
+        writes = n - 1;
+    });
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop = true;
+    writer.join();
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+
+    printf("%-12s %12llu writes  %12llu reads  %10llu torn\n", label,
+           (unsigned long long)writes, (unsigned long long)reads.load(),
+           (unsigned long long)torn.load());
+    return torn;
+}
+
+int main(int argc, char** argv) {
+    double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+
+    printf("1 writer, %d readers, %.1f s per run\n\n", readerCount, seconds);
+
+    SeqLock<ControlState> seqLock;
+    uint64_t seqLockTorn = run("SeqLock", seqLock, seconds);
+
+    UnprotectedState plain;
+    run("plain copy", plain, seconds);
+
+    if (seqLockTorn != 0) {
+        printf("\nFAIL: SeqLock returned torn snapshots\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,133 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Host stand-in for the parts of the Arduino-ESP32 core the firmware uses.
+//
+// Time is virtual: millis()/micros() only move when delay(),
+// delayMicroseconds() or pulseIn() wait, or when the simulator advances
+// it (HostSim.h). Waiting runs the pin and serial events the simulator
+// scheduled, in time order, so interrupt handlers see the exact edge
+// times. ESP32 is not defined, so the firmware takes its portable paths.
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+
+using std::max;
+using std::min;
+
+#define HIGH 1
+#define LOW  0
+
+#define INPUT        0x01
+#define OUTPUT       0x03
+#define INPUT_PULLUP 0x05
+
+#define RISING  0x01
+#define FALLING 0x02
+#define CHANGE  0x03
+
+#define SERIAL_8N1 0x800001c
+#define SERIAL_8E2 0x800003e
+
+#define IRAM_ATTR
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+inline long map(long x, long inMin, long inMax, long outMin, long outMax) {
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+inline void yield() {}
+
+// FreeRTOS ticks at 1 kHz, as on the ESP32, in virtual time.
+// vTaskDelayUntil() wakes on a tick boundary, plus the latency set with
+// HostSim::setTickWakeLatency().
+typedef uint32_t TickType_t;
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms) ((TickType_t)((uint64_t)(ms) * configTICK_RATE_HZ / 1000))
+TickType_t xTaskGetTickCount();
+void vTaskDelayUntil(TickType_t* previousWakeTick, TickType_t increment);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t level);
+int digitalRead(uint8_t pin);
+
+// Waits (in virtual time) for a pulse of the given level; its width in us,
+// 0 on timeout
+unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeoutUs = 1000000);
+
+inline int digitalPinToInterrupt(uint8_t pin) { return pin; }
+void attachInterrupt(int pin, void (*handler)(), int mode);
+void attachInterruptArg(int pin, void (*handler)(void*), void* arg, int mode);
+void detachInterrupt(int pin);
+
+bool ledcAttach(uint8_t pin, uint32_t frequencyHz, uint8_t resolutionBits);
+bool ledcWrite(uint8_t pin, uint32_t duty);
+
+// A UART. What the firmware writes is collected for the simulator; what
+// the simulator injects (now or at a scheduled time) is there to read.
+// Like the driver's, the receive buffer has a fixed size (256 bytes
+// unless set) and bytes that don't fit are lost. availableForWrite()
+// reports the free transmit space the simulator sets (4096 bytes unless
+// set); writes are taken whole regardless.
+class HardwareSerial {
+public:
+    static const size_t maxRxBufferSize = 4096;
+
+    HardwareSerial() : open(false), rxSize(256), rxHead(0), rxCount(0), rxOverflows(0), txSpace(4096) {}
+
+    void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int rxPin = -1, int txPin = -1,
+               bool invert = false);
+    void end() { open = false; }
+    size_t setRxBufferSize(size_t size);
+    explicit operator bool() const { return true; }
+
+    int available() { return (int)rxCount; }
+    int read();
+    size_t read(uint8_t* buffer, size_t length);
+    int peek() { return rxCount ? rx[rxHead] : -1; }
+
+    int availableForWrite() { return txSpace; }
+    size_t write(uint8_t byte);
+    size_t write(const uint8_t* data, size_t length);
+    size_t print(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+    size_t print(long value);
+    size_t println(const char* text = "") { return print(text) + print("\r\n"); }
+    size_t println(long value) { return print(value) + print("\r\n"); }
+    int printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+    void flush() {}
+
+    // Simulator side; inject() returns how many bytes fit
+    size_t inject(const uint8_t* data, size_t length);
+    size_t inject(const char* text) { return inject((const uint8_t*)text, strlen(text)); }
+    std::string takeOutput();
+    bool isOpen() const { return open; }
+    uint32_t overflows() const { return rxOverflows; }
+    void setTxSpace(int bytes) { txSpace = bytes; }
+
+private:
+    bool open;
+    uint8_t rx[maxRxBufferSize];
+    size_t rxSize;
+    size_t rxHead;
+    size_t rxCount;
+    uint32_t rxOverflows;
+    int txSpace;
+    std::string tx;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,103 @@
+#ifndef HOST_BLUEPAD32_H
+#define HOST_BLUEPAD32_H
+
+// Host stand-in for Bluepad32: a controller whose sticks, buttons and
+// keys the simulator sets. Like the real library, (dis)connection
+// callbacks and new reports are delivered from BP32.update().
+
+#include <stdint.h>
+
+#define DPAD_UP    0x01
+#define DPAD_DOWN  0x02
+#define DPAD_RIGHT 0x04
+#define DPAD_LEFT  0x08
+
+enum class KeyboardKey : uint8_t {
+    Keyboard_A,
+    Keyboard_D,
+    Keyboard_E,
+    Keyboard_Q,
+    Keyboard_S,
+    Keyboard_W,
+    Keyboard_Spacebar,
+    Keyboard_UpArrow,
+    Keyboard_DownArrow,
+    Keyboard_LeftArrow,
+    Keyboard_RightArrow,
+    Keyboard_LeftShift,
+    Keyboard_RightShift,
+    Keyboard_LeftControl,
+    Keyboard_RightControl,
+    keyCount
+};
+
+class Controller {
+public:
+    explicit Controller(bool keyboard = false);
+
+    bool isConnected() const { return connected; }
+    bool isGamepad() const { return !keyboard; }
+    bool isKeyboard() const { return keyboard; }
+
+    int32_t axisX() const { return axes[0]; }
+    int32_t axisY() const { return axes[1]; }
+    int32_t axisRX() const { return axes[2]; }
+    int32_t axisRY() const { return axes[3]; }
+    uint8_t dpad() const { return dpadBits; }
+    bool a() const { return buttons & 0x01; }
+    bool b() const { return buttons & 0x02; }
+    bool x() const { return buttons & 0x04; }
+    bool y() const { return buttons & 0x08; }
+    bool miscSelect() const { return buttons & 0x10; }
+    bool isKeyPressed(KeyboardKey key) const;
+
+    // Simulator side. Axes are -512..511, up is negative Y.
+    void setAxes(int32_t x, int32_t y, int32_t rx, int32_t ry);
+    void setDpad(uint8_t bits) { dpadBits = bits; }
+    void setButtons(bool a, bool b, bool x, bool y, bool select);
+    void setKey(KeyboardKey key, bool pressed);
+
+private:
+    friend class Bluepad32;
+
+    bool keyboard;
+    bool connected;
+    int32_t axes[4];
+    uint8_t dpadBits;
+    uint8_t buttons;
+    uint32_t keys;
+};
+
+typedef Controller* ControllerPtr;
+
+class Bluepad32 {
+public:
+    typedef void (*Callback)(ControllerPtr);
+
+    Bluepad32();
+
+    void setup(Callback onConnect, Callback onDisconnect);
+    void enableNewBluetoothConnections(bool enabled) { acceptConnections = enabled; }
+    void forgetBluetoothKeys() {}
+
+    // Delivers pending (dis)connections; true if there is a new report
+    bool update();
+
+    // Simulator side: take effect on the next update()
+    void connect(Controller* controller);
+    void disconnect();
+    void report() { reportPending = true; }
+
+private:
+    Callback connected;
+    Callback disconnected;
+    bool acceptConnections;
+    Controller* pendingConnect;
+    Controller* active;
+    bool disconnectPending;
+    bool reportPending;
+};
+
+extern Bluepad32 BP32;
+
+#endif // HOST_BLUEPAD32_H
@@ -0,0 +1,406 @@
+#include "HostSim.h"
+#include "Arduino.h"
+#include "Bluepad32.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <map>
+#include <chrono>
+#include <thread>
+
+HardwareSerial Serial;
+HardwareSerial Serial1;
+HardwareSerial Serial2;
+Bluepad32 BP32;
+
+namespace HostSim {
+
+static const uint8_t pinCount = 64;
+
+struct Interrupt {
+    void (*handler)();
+    void (*handlerArg)(void*);
+    void* arg;
+    int mode;
+};
+
+static uint64_t timeUs = 0;
+static std::multimap<uint64_t, std::function<void()> > events;
+static PinState pins[pinCount];
+static Interrupt interrupts[pinCount];
+
+// Wall clock time that goes with virtual time realTimeOriginUs
+static bool realTime = false;
+static uint64_t realTimeOriginUs = 0;
+static std::chrono::steady_clock::time_point wallOrigin;
+
+uint64_t nowUs() {
+    return timeUs;
+}
+
+void setRealTime(bool enabled) {
+    realTime = enabled;
+    realTimeOriginUs = timeUs;
+    wallOrigin = std::chrono::steady_clock::now();
+}
+
+// Before virtual time moves to targetUs
+static void waitForWall(uint64_t targetUs) {
+    if (realTime && targetUs > timeUs) {
+        std::this_thread::sleep_until(wallOrigin + std::chrono::microseconds(targetUs - realTimeOriginUs));
+    }
+}
+
+bool nextEvent(uint64_t& eventUs) {
+    if (events.empty()) {
+        return false;
+    }
+    eventUs = events.begin()->first;
+    return true;
+}
+
+static void runNextEvent() {
+    std::multimap<uint64_t, std::function<void()> >::iterator next = events.begin();
+    std::function<void()> event = next->second;
+    if (next->first > timeUs) {
+        waitForWall(next->first);
+        timeUs = next->first;
+    }
+    events.erase(next);
+    event();
+}
+
+void advanceTo(uint64_t targetUs) {
+    uint64_t eventUs;
+    while (nextEvent(eventUs) && eventUs <= targetUs) {
+        runNextEvent();
+    }
+    if (targetUs > timeUs) {
+        waitForWall(targetUs);
+        timeUs = targetUs;
+    }
+}
+
+void advance(uint64_t us) {
+    advanceTo(timeUs + us);
+}
+
+void schedule(uint64_t eventUs, std::function<void()> event) {
+    events.emplace(eventUs, event);
+}
+
+void setPin(uint8_t pin, bool level) {
+    if (pin >= pinCount || pins[pin].level == level) {
+        return;
+    }
+    pins[pin].level = level;
+    const Interrupt& irq = interrupts[pin];
+    bool fire = irq.mode == CHANGE || (irq.mode == RISING && level) || (irq.mode == FALLING && !level);
+    if (!fire) {
+        return;
+    }
+    if (irq.handler) {
+        irq.handler();
+    } else if (irq.handlerArg) {
+        irq.handlerArg(irq.arg);
+    }
+}
+
+const PinState& pin(uint8_t pin) {
+    return pins[pin < pinCount ? pin : 0];
+}
+
+// Waits for the pin to reach level; false if the deadline comes first
+static bool waitForLevel(uint8_t pin, bool level, uint64_t deadlineUs) {
+    while (pins[pin].level != level) {
+        uint64_t eventUs;
+        if (!nextEvent(eventUs) || eventUs > deadlineUs) {
+            advanceTo(deadlineUs);
+            return false;
+        }
+        runNextEvent();
+    }
+    return true;
+}
+
+unsigned long measurePulse(uint8_t pin, bool level, unsigned long timeoutUs) {
+    if (pin >= pinCount) {
+        return 0;
+    }
+    uint64_t deadline = timeUs + timeoutUs;
+    // A pulse already in progress doesn't count, like on the hardware
+    if (!waitForLevel(pin, !level, deadline) || !waitForLevel(pin, level, deadline)) {
+        return 0;
+    }
+    uint64_t start = timeUs;
+    if (!waitForLevel(pin, !level, deadline)) {
+        return 0;
+    }
+    return (unsigned long)(timeUs - start);
+}
+
+} // namespace HostSim
+
+// ----------------------
+// Arduino core
+// ----------------------
+unsigned long millis() {
+    return (unsigned long)(HostSim::timeUs / 1000);
+}
+
+unsigned long micros() {
+    return (unsigned long)HostSim::timeUs;
+}
+
+void delay(unsigned long ms) {
+    HostSim::advance((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+    HostSim::advance(us);
+}
+
+// ----------------------
+// FreeRTOS ticks
+// ----------------------
+static const uint64_t tickUs = 1000000 / configTICK_RATE_HZ;
+static uint32_t tickWakeLatencyUs = 0;
+
+void HostSim::setTickWakeLatency(uint32_t us) {
+    tickWakeLatencyUs = us;
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)(HostSim::timeUs / tickUs);
+}
+
+void vTaskDelayUntil(TickType_t* previousWakeTick, TickType_t increment) {
+    *previousWakeTick += increment;
+    // Already past it: returns at once, like the real one
+    if ((int32_t)(*previousWakeTick - xTaskGetTickCount()) <= 0) {
+        return;
+    }
+    HostSim::advanceTo((uint64_t)*previousWakeTick * tickUs + tickWakeLatencyUs);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    if (pin < HostSim::pinCount) {
+        HostSim::pins[pin].mode = mode;
+    }
+}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+    if (pin < HostSim::pinCount) {
+        HostSim::pins[pin].level = level != LOW;
+    }
+}
+
+int digitalRead(uint8_t pin) {
+    return pin < HostSim::pinCount && HostSim::pins[pin].level ? HIGH : LOW;
+}
+
+unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeoutUs) {
+    return HostSim::measurePulse(pin, state != LOW, timeoutUs);
+}
+
+void attachInterrupt(int pin, void (*handler)(), int mode) {
+    if (pin >= 0 && pin < HostSim::pinCount) {
+        HostSim::interrupts[pin] = {handler, nullptr, nullptr, mode};
+    }
+}
+
+void attachInterruptArg(int pin, void (*handler)(void*), void* arg, int mode) {
+    if (pin >= 0 && pin < HostSim::pinCount) {
+        HostSim::interrupts[pin] = {nullptr, handler, arg, mode};
+    }
+}
+
+void detachInterrupt(int pin) {
+    if (pin >= 0 && pin < HostSim::pinCount) {
+        HostSim::interrupts[pin] = {nullptr, nullptr, nullptr, 0};
+    }
+}
+
+bool ledcAttach(uint8_t pin, uint32_t frequencyHz, uint8_t resolutionBits) {
+    if (pin >= HostSim::pinCount || resolutionBits == 0 || resolutionBits > 20) {
+        return false;
+    }
+    HostSim::PinState& state = HostSim::pins[pin];
+    state.mode = OUTPUT;
+    state.pwm = true;
+    state.frequencyHz = frequencyHz;
+    state.resolutionBits = resolutionBits;
+    state.duty = 0;
+    return true;
+}
+
+bool ledcWrite(uint8_t pin, uint32_t duty) {
+    if (pin >= HostSim::pinCount || !HostSim::pins[pin].pwm) {
+        return false;
+    }
+    HostSim::pins[pin].duty = duty;
+    return true;
+}
+
+// ----------------------
+// HardwareSerial
+// ----------------------
+void HardwareSerial::begin(unsigned long, uint32_t, int, int, bool) {
+    open = true;
+}
+
+size_t HardwareSerial::setRxBufferSize(size_t size) {
+    // Only before begin(), as on the ESP32
+    if (open || size == 0) {
+        return 0;
+    }
+    rxSize = size < maxRxBufferSize ? size : maxRxBufferSize;
+    return rxSize;
+}
+
+int HardwareSerial::read() {
+    if (rxCount == 0) {
+        return -1;
+    }
+    uint8_t byte = rx[rxHead];
+    rxHead = (rxHead + 1) % rxSize;
+    rxCount--;
+    return byte;
+}
+
+size_t HardwareSerial::read(uint8_t* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length && rxCount > 0) {
+        buffer[count++] = rx[rxHead];
+        rxHead = (rxHead + 1) % rxSize;
+        rxCount--;
+    }
+    return count;
+}
+
+size_t HardwareSerial::inject(const uint8_t* data, size_t length) {
+    size_t count = 0;
+    while (count < length && rxCount < rxSize) {
+        rx[(rxHead + rxCount) % rxSize] = data[count++];
+        rxCount++;
+    }
+    if (count < length) {
+        rxOverflows++;
+    }
+    return count;
+}
+
+size_t HardwareSerial::write(uint8_t byte) {
+    tx.push_back((char)byte);
+    return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* data, size_t length) {
+    tx.append((const char*)data, length);
+    return length;
+}
+
+size_t HardwareSerial::print(long value) {
+    char text[24];
+    snprintf(text, sizeof(text), "%ld", value);
+    return print(text);
+}
+
+int HardwareSerial::printf(const char* format, ...) {
+    char text[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    print(text);
+    return length;
+}
+
+std::string HardwareSerial::takeOutput() {
+    std::string output;
+    output.swap(tx);
+    return output;
+}
+
+// ----------------------
+// Bluepad32
+// ----------------------
+Controller::Controller(bool keyboard)
+    : keyboard(keyboard),
+      connected(false),
+      axes{0, 0, 0, 0},
+      dpadBits(0),
+      buttons(0),
+      keys(0)
+{
+}
+
+bool Controller::isKeyPressed(KeyboardKey key) const {
+    return keys & (1u << (uint8_t)key);
+}
+
+void Controller::setAxes(int32_t x, int32_t y, int32_t rx, int32_t ry) {
+    axes[0] = x;
+    axes[1] = y;
+    axes[2] = rx;
+    axes[3] = ry;
+}
+
+void Controller::setButtons(bool a, bool b, bool x, bool y, bool select) {
+    buttons = (a ? 0x01 : 0) | (b ? 0x02 : 0) | (x ? 0x04 : 0) | (y ? 0x08 : 0) | (select ? 0x10 : 0);
+}
+
+void Controller::setKey(KeyboardKey key, bool pressed) {
+    uint32_t bit = 1u << (uint8_t)key;
+    keys = pressed ? keys | bit : keys & ~bit;
+}
+
+static_assert((uint8_t)KeyboardKey::keyCount <= 32, "Controller::keys holds 32 keys");
+
+Bluepad32::Bluepad32()
+    : connected(nullptr),
+      disconnected(nullptr),
+      acceptConnections(false),
+      pendingConnect(nullptr),
+      active(nullptr),
+      disconnectPending(false),
+      reportPending(false)
+{
+}
+
+void Bluepad32::setup(Callback onConnect, Callback onDisconnect) {
+    connected = onConnect;
+    disconnected = onDisconnect;
+}
+
+bool Bluepad32::update() {
+    if (disconnectPending) {
+        disconnectPending = false;
+        if (active) {
+            active->connected = false;
+            if (disconnected) {
+                disconnected(active);
+            }
+            active = nullptr;
+        }
+    }
+    if (pendingConnect && acceptConnections) {
+        active = pendingConnect;
+        pendingConnect = nullptr;
+        active->connected = true;
+        if (connected) {
+            connected(active);
+        }
+    }
+    bool newReport = reportPending && active;
+    reportPending = false;
+    return newReport;
+}
+
+void Bluepad32::connect(Controller* controller) {
+    pendingConnect = controller;
+    reportPending = true;
+}
+
+void Bluepad32::disconnect() {
+    disconnectPending = true;
+}
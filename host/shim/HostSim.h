@@ -0,0 +1,49 @@
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+
+// Simulator side of the host shim: virtual time, scheduled events and the
+// pins as the firmware left them.
+
+#include <stdint.h>
+#include <functional>
+
+namespace HostSim {
+
+uint64_t nowUs();
+
+// Moves time forward, running every event due on the way at its time
+void advance(uint64_t us);
+void advanceTo(uint64_t timeUs);
+
+// Paces virtual time to the wall clock from now on (or stops doing so),
+// for runs that talk to the outside world, e.g. a sender on a real UDP
+// socket (WiFiUdp.h)
+void setRealTime(bool enabled);
+
+// Runs event at timeUs (or right away on the next advance if that has
+// passed), e.g. a pin edge or bytes arriving on a serial port
+void schedule(uint64_t timeUs, std::function<void()> event);
+
+// How long after its tick boundary vTaskDelayUntil() returns (0 at first)
+void setTickWakeLatency(uint32_t us);
+
+// Time of the next event; false if there is none
+bool nextEvent(uint64_t& timeUs);
+
+// Sets an input pin, calling its interrupt handler on a matching edge
+void setPin(uint8_t pin, bool level);
+
+struct PinState {
+    uint8_t mode;
+    bool level;
+    bool pwm;
+    uint32_t frequencyHz;
+    uint8_t resolutionBits;
+    uint32_t duty;
+};
+
+const PinState& pin(uint8_t pin);
+
+} // namespace HostSim
+
+#endif // HOST_SIM_H
@@ -0,0 +1,102 @@
+#include "WiFi.h"
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+WiFiClass WiFi;
+
+WiFiUDP::WiFiUDP()
+    : fd(-1),
+      rxLength(0),
+      rxPosition(0),
+      remotePortNumber(0),
+      txLength(0),
+      txPort(0)
+{
+}
+
+WiFiUDP::~WiFiUDP() {
+    stop();
+}
+
+uint8_t WiFiUDP::begin(uint16_t port) {
+    stop();
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        return 0;
+    }
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(fd, (sockaddr*)&address, sizeof(address)) != 0 ||
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0) {
+        stop();
+        return 0;
+    }
+    return 1;
+}
+
+void WiFiUDP::stop() {
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+    rxLength = rxPosition = 0;
+}
+
+int WiFiUDP::parsePacket() {
+    rxLength = rxPosition = 0;
+    if (fd < 0) {
+        return 0;
+    }
+    sockaddr_in from = {};
+    socklen_t fromLength = sizeof(from);
+    ssize_t n = recvfrom(fd, rx, sizeof(rx), 0, (sockaddr*)&from, &fromLength);
+    if (n <= 0) {
+        return 0;
+    }
+    uint32_t ip = ntohl(from.sin_addr.s_addr);
+    remoteAddress = IPAddress((uint8_t)(ip >> 24), (uint8_t)(ip >> 16), (uint8_t)(ip >> 8), (uint8_t)ip);
+    remotePortNumber = ntohs(from.sin_port);
+    rxLength = (size_t)n;
+    return (int)n;
+}
+
+int WiFiUDP::read(uint8_t* buffer, size_t length) {
+    size_t count = rxLength - rxPosition < length ? rxLength - rxPosition : length;
+    memcpy(buffer, rx + rxPosition, count);
+    rxPosition += count;
+    return (int)count;
+}
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port) {
+    txAddress = ip;
+    txPort = port;
+    txLength = 0;
+    return fd >= 0 ? 1 : 0;
+}
+
+size_t WiFiUDP::write(const uint8_t* data, size_t length) {
+    size_t count = sizeof(tx) - txLength < length ? sizeof(tx) - txLength : length;
+    memcpy(tx + txLength, data, count);
+    txLength += count;
+    return count;
+}
+
+int WiFiUDP::endPacket() {
+    if (fd < 0) {
+        return 0;
+    }
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl((uint32_t)txAddress[0] << 24 | (uint32_t)txAddress[1] << 16 |
+                                    (uint32_t)txAddress[2] << 8 | txAddress[3]);
+    address.sin_port = htons(txPort);
+    ssize_t n = sendto(fd, tx, txLength, 0, (sockaddr*)&address, sizeof(address));
+    txLength = 0;
+    return n >= 0 ? 1 : 0;
+}
@@ -0,0 +1,51 @@
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+// Host stand-in for the Arduino-ESP32 WiFi class. There is no radio:
+// joining a network or opening an access point succeeds at once, and the
+// tank's address is the loopback one, so WiFiUDP sockets (real ones, see
+// WiFiUdp.h) talk to senders on the same machine.
+
+#include <stdint.h>
+#include "WiFiUdp.h"
+
+enum wifi_mode_t {
+    WIFI_OFF = 0,
+    WIFI_STA,
+    WIFI_AP,
+    WIFI_AP_STA
+};
+
+enum wl_status_t {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL,
+    WL_SCAN_COMPLETED,
+    WL_CONNECTED,
+    WL_CONNECT_FAILED,
+    WL_CONNECTION_LOST,
+    WL_DISCONNECTED
+};
+
+class WiFiClass {
+public:
+    WiFiClass() : currentMode(WIFI_OFF), joined(false) {}
+
+    bool mode(wifi_mode_t mode) { currentMode = mode; return true; }
+    wifi_mode_t getMode() const { return currentMode; }
+    bool setSleep(bool) { return true; }
+
+    bool softAP(const char*, const char* = nullptr) { return true; }
+    IPAddress softAPIP() const { return IPAddress(127, 0, 0, 1); }
+
+    wl_status_t begin(const char*, const char* = nullptr) { joined = true; return WL_CONNECTED; }
+    wl_status_t status() const { return joined ? WL_CONNECTED : WL_DISCONNECTED; }
+    IPAddress localIP() const { return IPAddress(127, 0, 0, 1); }
+
+private:
+    wifi_mode_t currentMode;
+    bool joined;
+};
+
+extern WiFiClass WiFi;
+
+#endif // HOST_WIFI_H
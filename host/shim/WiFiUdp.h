@@ -0,0 +1,65 @@
+#ifndef HOST_WIFI_UDP_H
+#define HOST_WIFI_UDP_H
+
+// Host stand-in for the Arduino-ESP32 WiFiUDP class, on a real,
+// non-blocking UDP socket, so the firmware can be driven over loopback
+// (or the LAN) by the same senders as the tank. Datagrams arrive in real
+// time whatever the virtual clock says.
+
+#include <stddef.h>
+#include <stdint.h>
+
+class IPAddress {
+public:
+    IPAddress() : bytes{0, 0, 0, 0} {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : bytes{a, b, c, d} {}
+
+    uint8_t operator[](int index) const { return bytes[index]; }
+    bool operator==(const IPAddress& other) const {
+        return bytes[0] == other.bytes[0] && bytes[1] == other.bytes[1] &&
+               bytes[2] == other.bytes[2] && bytes[3] == other.bytes[3];
+    }
+    bool operator!=(const IPAddress& other) const { return !(*this == other); }
+
+private:
+    uint8_t bytes[4];
+};
+
+class WiFiUDP {
+public:
+    static const size_t maxDatagram = 1460;
+
+    WiFiUDP();
+    ~WiFiUDP();
+
+    // 1 if the socket is bound to port on all interfaces
+    uint8_t begin(uint16_t port);
+    void stop();
+
+    // Takes the next datagram; its size, 0 if there is none
+    int parsePacket();
+    int available() const { return (int)(rxLength - rxPosition); }
+    int read(uint8_t* buffer, size_t length);
+    int read(char* buffer, size_t length) { return read((uint8_t*)buffer, length); }
+    IPAddress remoteIP() const { return remoteAddress; }
+    uint16_t remotePort() const { return remotePortNumber; }
+
+    int beginPacket(IPAddress ip, uint16_t port);
+    size_t write(uint8_t byte) { return write(&byte, 1); }
+    size_t write(const uint8_t* data, size_t length);
+    int endPacket();
+
+private:
+    int fd;
+    uint8_t rx[maxDatagram];
+    size_t rxLength;
+    size_t rxPosition;
+    IPAddress remoteAddress;
+    uint16_t remotePortNumber;
+    uint8_t tx[maxDatagram];
+    size_t txLength;
+    IPAddress txAddress;
+    uint16_t txPort;
+};
+
+#endif // HOST_WIFI_UDP_H
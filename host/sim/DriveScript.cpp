@@ -0,0 +1,91 @@
+#include "DriveScript.h"
+#include <string.h>
+
+const Drive& DriveScript::inputAt(uint32_t timeMs) const {
+    return phases[phaseAt(timeMs)].input;
+}
+
+size_t DriveScript::phaseAt(uint32_t timeMs) const {
+    size_t index = 0;
+    while (index + 1 < phaseCount && phases[index + 1].startMs <= timeMs) {
+        index++;
+    }
+    return index;
+}
+
+// Track steps: full ahead, stop, full reverse, half ahead
+static const DrivePhase stepPhases[] = {
+    {"idle", 0, {0, 0, 0, 0, false}},
+    {"forward", 500, {100, 0, 0, 0, false}},
+    {"stop", 3000, {0, 0, 0, 0, false}},
+    {"reverse", 5000, {-100, 0, 0, 0, false}},
+    {"stop", 7500, {0, 0, 0, 0, false}},
+    {"half", 9000, {50, 0, 0, 0, false}},
+    {"stop", 11000, {0, 0, 0, 0, false}},
+};
+
+// Turning on the spot and in arcs
+static const DrivePhase turnPhases[] = {
+    {"idle", 0, {0, 0, 0, 0, false}},
+    {"spin right", 500, {0, 100, 0, 0, false}},
+    {"stop", 2500, {0, 0, 0, 0, false}},
+    {"arc left", 3500, {100, -40, 0, 0, false}},
+    {"arc right", 6000, {100, 40, 0, 0, false}},
+    {"spin left", 8500, {0, -60, 0, 0, false}},
+    {"stop", 10000, {0, 0, 0, 0, false}},
+};
+
+// Weaving at speed, for path tracking
+static const DrivePhase slalomPhases[] = {
+    {"idle", 0, {0, 0, 0, 0, false}},
+    {"straight", 500, {100, 0, 0, 0, false}},
+    {"left", 2000, {100, -60, 0, 0, false}},
+    {"right", 3500, {100, 60, 0, 0, false}},
+    {"left", 5000, {100, -60, 0, 0, false}},
+    {"right", 6500, {100, 60, 0, 0, false}},
+    {"left", 8000, {100, -60, 0, 0, false}},
+    {"straight", 9500, {100, 0, 0, 0, false}},
+    {"stop", 11000, {0, 0, 0, 0, false}},
+};
+
+// Turret slews with the tank standing; short enough to stay off the
+// soft limits
+static const DrivePhase turretPhases[] = {
+    {"idle", 0, {0, 0, 0, 0, false}},
+    {"slew right", 500, {0, 0, 100, 0, false}},
+    {"hold", 1100, {0, 0, 0, 0, false}},
+    {"slew left", 2500, {0, 0, -50, 0, false}},
+    {"hold", 4000, {0, 0, 0, 0, false}},
+    {"nudge right", 5500, {0, 0, 30, 0, false}},
+    {"hold", 6500, {0, 0, 0, 0, false}},
+};
+
+#define PHASES(p) p, sizeof(p) / sizeof(p[0])
+
+static const DriveScript scripts[] = {
+    {"step", "track step response", PHASES(stepPhases), 13000},
+    {"turn", "spins and arcs", PHASES(turnPhases), 11500},
+    {"slalom", "weaving at full speed", PHASES(slalomPhases), 13000},
+    {"turret", "turret slews, tank standing", PHASES(turretPhases), 8000},
+};
+
+namespace DriveScripts {
+
+size_t count() {
+    return sizeof(scripts) / sizeof(scripts[0]);
+}
+
+const DriveScript& at(size_t index) {
+    return scripts[index];
+}
+
+const DriveScript* find(const char* name) {
+    for (const DriveScript& script : scripts) {
+        if (strcmp(script.name, name) == 0) {
+            return &script;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace DriveScripts
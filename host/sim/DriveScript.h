@@ -0,0 +1,49 @@
+#ifndef DRIVE_SCRIPT_H
+#define DRIVE_SCRIPT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Operator input, -100..100 like a MixerInput
+struct Drive {
+    int8_t drive;
+    int8_t turn;
+    int8_t turretRotation;
+    int8_t turretElevation;
+    bool fire;
+};
+
+// Scripted operator input for host runs: each phase holds its input until
+// the next one starts, the last one until endMs.
+struct DrivePhase {
+    const char* name;
+    uint32_t startMs;
+    Drive input;
+};
+
+struct DriveScript {
+    const char* name;
+    const char* description;
+    const DrivePhase* phases;
+    size_t phaseCount;
+    uint32_t endMs;
+
+    // Input at timeMs
+    const Drive& inputAt(uint32_t timeMs) const;
+
+    // Index of the phase running at timeMs
+    size_t phaseAt(uint32_t timeMs) const;
+
+    uint32_t phaseEndMs(size_t index) const {
+        return index + 1 < phaseCount ? phases[index + 1].startMs : endMs;
+    }
+};
+
+// Built-in scripts: "step", "turn", "slalom" and "turret"
+namespace DriveScripts {
+    size_t count();
+    const DriveScript& at(size_t index);
+    const DriveScript* find(const char* name);
+}
+
+#endif // DRIVE_SCRIPT_H
@@ -0,0 +1,61 @@
+#ifndef MOCK_ACTUATOR_BACKEND_H
+#define MOCK_ACTUATOR_BACKEND_H
+
+#include <stdint.h>
+#include <map>
+#include <vector>
+#include "ActuatorBackend.h"
+
+// ActuatorBackend for host runs: keeps the pin levels and PWM duties in
+// memory and counts the hardware writes each commit() would have made.
+class MockActuatorBackend : public ActuatorBackend {
+public:
+    struct TickWrites {
+        uint32_t registerWrites;  // GPIO set/clear register writes
+        uint32_t pwmWrites;
+    };
+
+    MockActuatorBackend() : pinLevels(0), current() {}
+
+    // Closes the counters of the current tick; call after commit()
+    void endTick() {
+        ticks.push_back(current);
+        current = TickWrites();
+    }
+
+    bool level(uint8_t pin) const { return (pinLevels >> pin) & 1; }
+
+    uint32_t duty(uint8_t pin) const {
+        std::map<uint8_t, uint32_t>::const_iterator it = duties.find(pin);
+        return it == duties.end() ? 0 : it->second;
+    }
+
+    uint64_t pinLevels;
+    std::map<uint8_t, uint32_t> duties;
+    std::vector<TickWrites> ticks;
+
+protected:
+    void configureDigital(uint8_t) override {}
+
+    bool configurePwm(uint8_t pin, uint32_t, uint8_t) override {
+        duties[pin] = 0;
+        return true;
+    }
+
+    void writeDigital(uint64_t setMask, uint64_t clearMask) override {
+        // One write per non-empty register, as on the ESP32
+        current.registerWrites += ((uint32_t)clearMask != 0) + ((clearMask >> 32) != 0) +
+                                  ((uint32_t)setMask != 0) + ((setMask >> 32) != 0);
+        pinLevels = (pinLevels & ~clearMask) | setMask;
+    }
+
+    void writePwm(uint8_t pin, uint32_t duty) override {
+        current.pwmWrites++;
+        duties[pin] = duty;
+    }
+
+private:
+    TickWrites current;
+};
+
+#endif // MOCK_ACTUATOR_BACKEND_H
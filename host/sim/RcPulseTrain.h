@@ -0,0 +1,95 @@
+#ifndef RC_PULSE_TRAIN_H
+#define RC_PULSE_TRAIN_H
+
+#include <stdint.h>
+
+// Simulated RC receiver output for host-side runs.
+//
+// Every frame the receiver emits one pulse per channel, back to back
+// (channel 0 first), like most PWM receivers do. Widths and missing channels
+// can be changed at any time. Edges can either be pushed into a capture
+// engine in time order (emitEdges) or consumed the way Arduino's blocking
+// pulseIn() would (pulseIn).
+class RcPulseTrain {
+public:
+    static const uint8_t maxChannels = 8;
+
+    RcPulseTrain(uint8_t channelCount, uint32_t framePeriodUs = 20000)
+        : channelCount(channelCount > maxChannels ? maxChannels : channelCount),
+          framePeriodUs(framePeriodUs) {
+        for (uint8_t ch = 0; ch < maxChannels; ch++) {
+            widthUs[ch] = 1500;
+            present[ch] = true;
+        }
+    }
+
+    void setWidth(uint8_t ch, uint16_t width) { widthUs[ch] = width; }
+    void setPresent(uint8_t ch, bool isPresent) { present[ch] = isPresent; }
+    uint16_t width(uint8_t ch) const { return widthUs[ch]; }
+    uint32_t period() const { return framePeriodUs; }
+
+    // Rising/falling edge times of a channel's pulse in a given frame
+    bool pulse(uint8_t ch, uint32_t frame, uint32_t& riseUs, uint32_t& fallUs) const {
+        if (ch >= channelCount || !present[ch]) {
+            return false;
+        }
+        uint32_t start = frame * framePeriodUs + gapUs;
+        for (uint8_t i = 0; i < ch; i++) {
+            start += widthUs[i] + gapUs;
+        }
+        riseUs = start;
+        fallUs = start + widthUs[ch];
+        return true;
+    }
+
+    // Deliver every edge in [fromUs, toUs) in time order to
+    // sink(channel, level, timestampUs)
+    template <typename Sink>
+    void emitEdges(uint32_t fromUs, uint32_t toUs, Sink sink) const {
+        for (uint32_t frame = fromUs / framePeriodUs; frame * framePeriodUs < toUs; frame++) {
+            // Pulses are back to back, so per-channel order is time order
+            for (uint8_t ch = 0; ch < channelCount; ch++) {
+                uint32_t rise, fall;
+                if (!pulse(ch, frame, rise, fall)) {
+                    continue;
+                }
+                if (rise >= fromUs && rise < toUs) {
+                    sink(ch, true, rise);
+                }
+                if (fall >= fromUs && fall < toUs) {
+                    sink(ch, false, fall);
+                }
+            }
+        }
+    }
+
+    // Arduino pulseIn(pin, HIGH, timeout) semantics: wait for a pulse that
+    // is already in progress to end, then for the next full pulse. Returns
+    // the width (0 on timeout) and the time the call returns in endUs.
+    unsigned long pulseIn(uint8_t ch, uint32_t startUs, uint32_t timeoutUs, uint32_t& endUs) const {
+        uint32_t deadline = startUs + timeoutUs;
+        for (uint32_t frame = startUs / framePeriodUs; frame * framePeriodUs < deadline; frame++) {
+            uint32_t rise, fall;
+            if (!pulse(ch, frame, rise, fall) || rise < startUs) {
+                continue;
+            }
+            if (fall > deadline) {
+                break;
+            }
+            endUs = fall;
+            return fall - rise;
+        }
+        endUs = deadline;
+        return 0;
+    }
+
+private:
+    static const uint32_t gapUs = 300;
+
+    uint8_t channelCount;
+    uint32_t framePeriodUs;
+    uint16_t widthUs[maxChannels];
+    bool present[maxChannels];
+};
+
+#endif // RC_PULSE_TRAIN_H
@@ -0,0 +1,56 @@
+#ifndef RECORDING_MOTOR_DRIVER_H
+#define RECORDING_MOTOR_DRIVER_H
+
+#include <stdint.h>
+#include <vector>
+#include "MotorDriver.h"
+
+// MotorDriver for host runs: keeps every write, stamped with the
+// actuation tick it happened in, instead of driving hardware.
+class RecordingMotorDriver : public MotorDriver {
+public:
+    struct Sample {
+        uint32_t tick;
+        uint32_t duty;
+        Direction direction;
+    };
+
+    RecordingMotorDriver() : frequencyHz(0), resolutionBits(0), tick(0) {}
+
+    bool begin(uint32_t frequency, uint8_t resolution) override {
+        frequencyHz = frequency;
+        resolutionBits = resolution;
+        return true;
+    }
+
+    void write(uint32_t duty, Direction direction) override {
+        samples.push_back(Sample{tick, duty, direction});
+    }
+
+    // Call once per actuation tick
+    void advance() { tick++; }
+
+    // Signed duty at tick t (writes are only made on change)
+    int32_t dutyAt(uint32_t t) const {
+        int32_t duty = 0;
+        for (const Sample& sample : samples) {
+            if (sample.tick > t) {
+                break;
+            }
+            duty = (int32_t)sample.duty * sample.direction;
+        }
+        return duty;
+    }
+
+    void clear() {
+        samples.clear();
+        tick = 0;
+    }
+
+    uint32_t frequencyHz;
+    uint8_t resolutionBits;
+    uint32_t tick;
+    std::vector<Sample> samples;
+};
+
+#endif // RECORDING_MOTOR_DRIVER_H
@@ -0,0 +1,408 @@
+#ifndef SCRIPTED_INPUT_H
+#define SCRIPTED_INPUT_H
+
+// Operator input for the backend selected at build time, delivered the
+// way it gets it on the tank: state frames on Serial, gamepad or keyboard
+// reports through BP32, PWM edges on the receiver pins, SBUS frames on
+// Serial2 or state datagrams on a loopback UDP socket. Include after
+// ProjectHephaistos.ino.
+//
+// connectInput() brings the link up, selectGear() shifts from gear 1 to
+// the given one (right after connecting), applyInput() hands over a new
+// drive. dropInput() cuts the link the way it fails on the tank and
+// restoreInput() brings it back with the last drive; lastInputUs() is
+// when the tank last got input. With linkReportsLoss the backend is told
+// of the loss (Bluetooth disconnects), otherwise its input just stops.
+// The Bluetooth backends also have stallInput(): the reports stop while
+// the link stays up.
+
+#include <Arduino.h>
+#include <Bluepad32.h>
+#include <WiFiUdp.h>
+#include "HostSim.h"
+#include "RcPulseTrain.h"
+#include "ControlFrame.h"
+#include "DriveScript.h"
+
+// Between gear button presses, for the backends that shift on edges
+static const uint32_t gearPressUs = 40000;
+
+static bool inputDropped = false;
+static uint64_t inputAtUs = 0;
+
+static inline uint64_t lastInputUs() {
+    return inputAtUs;
+}
+
+// Receiver pulse that maps to gear (1..5), with margin for rounding
+static inline uint16_t gearPulseUs(uint8_t gear) {
+    return (uint16_t)(1000 + (gear - 1) * 250 + 10);
+}
+
+#if defined(CONTROL_MODE_SERIAL)
+// A frame per change, and the state again every 50 ms while nothing
+// changes
+static const uint32_t keepAlivePeriodUs = 50000;
+static const bool linkReportsLoss = false;
+static ControlFrame::ControlStatePayload framePayload = {0, 0, 0, 0, 0, 1, 0};
+static uint64_t frameSentUs = 0;
+
+static inline void sendStateFrame() {
+    if (inputDropped) {
+        return;
+    }
+    framePayload.sequence++;
+    uint8_t frame[sizeof(framePayload) + ControlFrame::overhead];
+    size_t length = ControlFrame::encode(ControlFrame::TYPE_CONTROL_STATE, &framePayload, sizeof(framePayload),
+                                         frame, sizeof(frame));
+    Serial.inject(frame, length);
+    frameSentUs = HostSim::nowUs();
+    inputAtUs = frameSentUs;
+}
+
+static inline void keepAlive(uint64_t atUs) {
+    HostSim::schedule(atUs, [atUs]() {
+        if (HostSim::nowUs() - frameSentUs >= keepAlivePeriodUs) {
+            sendStateFrame();
+        }
+        keepAlive(atUs + keepAlivePeriodUs / 5);
+    });
+}
+
+static inline void connectInput() {
+    sendStateFrame();
+    keepAlive(HostSim::nowUs());
+}
+
+static inline void selectGear(uint8_t gear) {
+    framePayload.gear = gear;
+}
+
+static inline void applyInput(const Drive& input) {
+    framePayload.drive = input.drive;
+    framePayload.turn = input.turn;
+    framePayload.turretRotation = input.turretRotation;
+    framePayload.turretElevation = input.turretElevation;
+    framePayload.buttons = input.fire ? ControlFrame::BUTTON_FIRE : 0;
+    sendStateFrame();
+}
+
+static inline void dropInput() {
+    inputDropped = true;
+}
+
+static inline void restoreInput() {
+    inputDropped = false;
+    sendStateFrame();
+}
+
+#elif defined(CONTROL_MODE_BLUETOOTH)
+// A report every 10 ms, changed or not, as most gamepads send them
+static const uint32_t gamepadReportPeriodUs = 10000;
+static const bool linkReportsLoss = true;
+static Controller gamepad;
+static bool inputStalled = false;
+
+// -100..100 to a Bluepad32 axis
+static inline int32_t toAxis(int8_t percent) {
+    return (int32_t)percent * 511 / 100;
+}
+
+static inline void sendReport() {
+    if (!inputDropped) {
+        BP32.report();
+        inputAtUs = HostSim::nowUs();
+    }
+}
+
+static inline void reportStream(uint64_t atUs) {
+    HostSim::schedule(atUs, [atUs]() {
+        sendReport();
+        reportStream(atUs + gamepadReportPeriodUs);
+    });
+}
+
+static inline void connectInput() {
+    BP32.connect(&gamepad);
+    reportStream(HostSim::nowUs());
+}
+
+// D-pad up once per gear, a report pressed and one released
+static inline void selectGear(uint8_t gear) {
+    uint64_t atUs = HostSim::nowUs();
+    for (uint8_t i = 1; i < gear; i++) {
+        atUs += gearPressUs;
+        HostSim::schedule(atUs, []() { gamepad.setDpad(DPAD_UP); BP32.report(); });
+        HostSim::schedule(atUs + gearPressUs / 2, []() { gamepad.setDpad(0); BP32.report(); });
+    }
+}
+
+static inline void applyInput(const Drive& input) {
+    // Up is negative Y
+    gamepad.setAxes(toAxis(input.turn), -toAxis(input.drive),
+                    toAxis(input.turretRotation), -toAxis(input.turretElevation));
+    gamepad.setButtons(input.fire, false, false, false, false);
+    sendReport();
+}
+
+// The gamepad goes out of range; the stack notices and disconnects
+static inline void dropInput() {
+    inputDropped = true;
+    inputStalled = false;
+    inputAtUs = HostSim::nowUs();
+    BP32.disconnect();
+}
+
+// The gamepad stops reporting before the stack notices anything
+static inline void stallInput() {
+    inputDropped = true;
+    inputStalled = true;
+}
+
+static inline void restoreInput() {
+    inputDropped = false;
+    if (!inputStalled) {
+        BP32.connect(&gamepad);
+    }
+    inputStalled = false;
+    sendReport();
+}
+
+#elif defined(CONTROL_MODE_KEYBOARD)
+static const bool linkReportsLoss = true;
+static Controller keyboard(true);
+static bool inputStalled = false;
+
+static inline void connectInput() {
+    BP32.connect(&keyboard);
+}
+
+// Shift once per gear, a report pressed and one released
+static inline void selectGear(uint8_t gear) {
+    uint64_t atUs = HostSim::nowUs();
+    for (uint8_t i = 1; i < gear; i++) {
+        atUs += gearPressUs;
+        HostSim::schedule(atUs, []() { keyboard.setKey(KeyboardKey::Keyboard_LeftShift, true); BP32.report(); });
+        HostSim::schedule(atUs + gearPressUs / 2, []() {
+            keyboard.setKey(KeyboardKey::Keyboard_LeftShift, false);
+            BP32.report();
+        });
+    }
+}
+
+// Keyboards only report changes
+static inline void applyInput(const Drive& input) {
+    keyboard.setKey(KeyboardKey::Keyboard_W, input.drive > 0);
+    keyboard.setKey(KeyboardKey::Keyboard_S, input.drive < 0);
+    keyboard.setKey(KeyboardKey::Keyboard_D, input.turn > 0);
+    keyboard.setKey(KeyboardKey::Keyboard_A, input.turn < 0);
+    keyboard.setKey(KeyboardKey::Keyboard_E, input.turretRotation > 0);
+    keyboard.setKey(KeyboardKey::Keyboard_Q, input.turretRotation < 0);
+    keyboard.setKey(KeyboardKey::Keyboard_UpArrow, input.turretElevation > 0);
+    keyboard.setKey(KeyboardKey::Keyboard_DownArrow, input.turretElevation < 0);
+    keyboard.setKey(KeyboardKey::Keyboard_Spacebar, input.fire);
+    BP32.report();
+    inputAtUs = HostSim::nowUs();
+}
+
+static inline void dropInput() {
+    inputDropped = true;
+    inputStalled = false;
+    inputAtUs = HostSim::nowUs();
+    BP32.disconnect();
+}
+
+// The keyboard stops reporting before the stack notices anything
+static inline void stallInput() {
+    inputDropped = true;
+    inputStalled = true;
+}
+
+static inline void restoreInput() {
+    inputDropped = false;
+    if (!inputStalled) {
+        BP32.connect(&keyboard);
+    }
+    inputStalled = false;
+    BP32.report();
+    inputAtUs = HostSim::nowUs();
+}
+
+#elif defined(CONTROL_MODE_RC)
+static const bool linkReportsLoss = false;
+// RCControl's receiver pins, in channel order: throttle, steering, gear,
+// turret rotation, turret elevation, fire
+static const uint8_t receiverPins[] = {2, 3, 4, 5, 6, 7};
+static const uint8_t receiverChannels = sizeof(receiverPins);
+static RcPulseTrain receiver(receiverChannels);
+
+// Schedules the edges of one receiver frame, then the next frame; none
+// while the receiver has lost its signal
+static inline void scheduleFrame(uint32_t frameUs) {
+    if (!inputDropped) {
+        receiver.emitEdges(frameUs, frameUs + receiver.period(), [](uint8_t ch, bool level, uint32_t atUs) {
+            uint8_t pin = receiverPins[ch];
+            HostSim::schedule(atUs, [pin, level]() {
+                HostSim::setPin(pin, level);
+                // A pulse ends on the falling edge
+                if (!level) {
+                    inputAtUs = HostSim::nowUs();
+                }
+            });
+        });
+    }
+    HostSim::schedule(frameUs + receiver.period(), [frameUs]() { scheduleFrame(frameUs + receiver.period()); });
+}
+
+static inline void connectInput() {
+    receiver.setWidth(2, 1000);  // gear 1
+    receiver.setWidth(5, 1000);  // not firing
+    scheduleFrame(HostSim::nowUs());
+}
+
+static inline void selectGear(uint8_t gear) {
+    receiver.setWidth(2, gearPulseUs(gear));
+}
+
+static inline void applyInput(const Drive& input) {
+    receiver.setWidth(0, 1500 + input.drive * 5);
+    receiver.setWidth(1, 1500 + input.turn * 5);
+    receiver.setWidth(3, 1500 + input.turretRotation * 5);
+    receiver.setWidth(4, 1500 + input.turretElevation * 5);
+    receiver.setWidth(5, input.fire ? 2000 : 1000);
+}
+
+// Taken from the next frame on
+static inline void dropInput() {
+    inputDropped = true;
+}
+
+static inline void restoreInput() {
+    inputDropped = false;
+}
+
+#elif defined(CONTROL_MODE_RC_BUS)
+static const bool linkReportsLoss = false;
+static const uint32_t sbusPeriodUs = 14000;
+// Frames keep coming with the failsafe flag set, as from a receiver that
+// lost the transmitter
+static bool receiverFailsafe = false;
+static uint16_t channelUs[16] = {
+    1500, 1500, 1000, 1500, 1500, 1000, 1500, 1500,
+    1500, 1500, 1500, 1500, 1500, 1500, 1500, 1500
+};
+
+// One SBUS frame: header, 16 x 11-bit channels LSB first, flags, footer
+static inline void sendSbusFrame() {
+    uint8_t frame[25] = {0x0F};
+    uint32_t bits = 0;
+    uint8_t bitCount = 0;
+    size_t index = 1;
+    for (uint8_t ch = 0; ch < 16; ch++) {
+        uint32_t raw = ((uint32_t)(channelUs[ch] - 880) * 8 + 4) / 5;
+        bits |= (raw & 0x7FF) << bitCount;
+        bitCount += 11;
+        while (bitCount >= 8) {
+            frame[index++] = (uint8_t)bits;
+            bits >>= 8;
+            bitCount -= 8;
+        }
+    }
+    frame[23] = receiverFailsafe ? 0x08 : 0x00;
+    frame[24] = 0x00;
+    Serial2.inject(frame, sizeof(frame));
+}
+
+static inline void scheduleFrames(uint64_t atUs) {
+    HostSim::schedule(atUs, [atUs]() {
+        if (!inputDropped) {
+            sendSbusFrame();
+            inputAtUs = HostSim::nowUs();
+        }
+        scheduleFrames(atUs + sbusPeriodUs);
+    });
+}
+
+static inline void connectInput() {
+    scheduleFrames(HostSim::nowUs());
+}
+
+static inline void selectGear(uint8_t gear) {
+    channelUs[2] = gearPulseUs(gear);
+}
+
+static inline void applyInput(const Drive& input) {
+    channelUs[0] = 1500 + input.drive * 5;
+    channelUs[1] = 1500 + input.turn * 5;
+    channelUs[3] = 1500 + input.turretRotation * 5;
+    channelUs[4] = 1500 + input.turretElevation * 5;
+    channelUs[5] = input.fire ? 2000 : 1000;
+}
+
+static inline void dropInput() {
+    inputDropped = true;
+}
+
+static inline void restoreInput() {
+    inputDropped = false;
+}
+
+#elif defined(CONTROL_MODE_UDP)
+// The full state every 20 ms, like tank_controller.py does over either
+// link. Loopback delivers
+// a datagram as it is sent, so this works in virtual time.
+static const uint32_t datagramPeriodUs = 20000;
+static const bool linkReportsLoss = false;
+static WiFiUDP datagramSender;
+static ControlFrame::NetStatePayload netState = {};
+
+static inline void sendDatagrams(uint64_t atUs) {
+    HostSim::schedule(atUs, [atUs]() {
+        if (inputDropped) {
+            sendDatagrams(atUs + datagramPeriodUs);
+            return;
+        }
+        inputAtUs = HostSim::nowUs();
+        netState.sequence++;
+        netState.sendTimeMs = millis();
+        uint8_t frame[sizeof(netState) + ControlFrame::overhead];
+        size_t length = ControlFrame::encode(ControlFrame::TYPE_NET_STATE, &netState, sizeof(netState),
+                                             frame, sizeof(frame));
+        datagramSender.beginPacket(IPAddress(127, 0, 0, 1), UDP_CONTROL_PORT);
+        datagramSender.write(frame, length);
+        datagramSender.endPacket();
+        // The acks are checked by bench_udp_control
+        while (datagramSender.parsePacket() > 0) {
+        }
+        sendDatagrams(atUs + datagramPeriodUs);
+    });
+}
+
+static inline void connectInput() {
+    netState.gear = 1;
+    datagramSender.begin(0);
+    sendDatagrams(HostSim::nowUs());
+}
+
+static inline void selectGear(uint8_t gear) {
+    netState.gear = gear;
+}
+
+static inline void applyInput(const Drive& input) {
+    netState.drive = input.drive;
+    netState.turn = input.turn;
+    netState.turretRotation = input.turretRotation;
+    netState.turretElevation = input.turretElevation;
+    netState.buttons = input.fire ? ControlFrame::BUTTON_FIRE : 0;
+}
+
+static inline void dropInput() {
+    inputDropped = true;
+}
+
+static inline void restoreInput() {
+    inputDropped = false;
+}
+#endif
+
+#endif // SCRIPTED_INPUT_H
@@ -0,0 +1,73 @@
+#ifndef SERVO_PLANT_H
+#define SERVO_PLANT_H
+
+#include <stdint.h>
+#include <math.h>
+
+// Hobby servo for host runs. It only sees a new pulse width at the start
+// of each frame, then turns towards the matching angle with its own
+// position loop and speed limit (about 0.1 s per 60 degrees for a
+// standard servo), and ignores changes inside its deadband. With a load
+// on the horn (inertiaTime > 0) its speed follows the position loop with
+// that lag, so it overshoots a target it approaches fast.
+class ServoPlant {
+public:
+    ServoPlant(uint32_t frameHz, uint16_t minPulseUs, uint16_t maxPulseUs)
+        : frameHz(frameHz),
+          minPulseUs(minPulseUs),
+          maxPulseUs(maxPulseUs),
+          maxSpeed(600),
+          gain(40),
+          deadbandUs(2),
+          inertiaTime(0),
+          angle(0),
+          target(0),
+          velocity(0),
+          frameTime(0),
+          latchedPulseUs(0)
+    {
+    }
+
+    // pulseUs is what the PWM output currently sends; 0 = no pulses
+    void step(uint16_t pulseUs, double dt) {
+        frameTime += dt;
+        double frame = 1.0 / frameHz;
+        while (frameTime >= frame) {
+            frameTime -= frame;
+            int diff = (int)pulseUs - (int)latchedPulseUs;
+            if (pulseUs != 0 && (latchedPulseUs == 0 || diff > deadbandUs || diff < -deadbandUs)) {
+                latchedPulseUs = pulseUs;
+                target = -90 + 180.0 * ((int)pulseUs - minPulseUs) / (maxPulseUs - minPulseUs);
+            }
+        }
+        if (latchedPulseUs == 0) {
+            return;
+        }
+        double speed = gain * (target - angle);
+        speed = speed > maxSpeed ? maxSpeed : (speed < -maxSpeed ? -maxSpeed : speed);
+        if (inertiaTime > 0) {
+            velocity += (speed - velocity) * (dt < inertiaTime ? dt / inertiaTime : 1.0);
+        } else {
+            velocity = speed;
+        }
+        angle += velocity * dt;
+    }
+
+    uint32_t frameHz;
+    uint16_t minPulseUs;
+    uint16_t maxPulseUs;
+    double maxSpeed;   // degrees per second
+    double gain;       // 1/s, internal position loop
+    int deadbandUs;
+    double inertiaTime; // s, load inertia over the servo's torque gain; 0 = none
+
+    double angle;      // degrees
+    double target;     // degrees, from the last accepted pulse
+    double velocity;   // degrees per second
+
+private:
+    double frameTime;
+    uint16_t latchedPulseUs;
+};
+
+#endif // SERVO_PLANT_H
@@ -0,0 +1,115 @@
+#include "Sweep.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <map>
+
+namespace Sweep {
+
+struct Child {
+    size_t index;
+    int fd;
+};
+
+// Reads exactly size bytes unless the writer is gone first
+static bool readAll(int fd, uint8_t* out, size_t size) {
+    while (size > 0) {
+        ssize_t n = read(fd, out, size);
+        if (n <= 0) {
+            return false;
+        }
+        out += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+static bool writeAll(int fd, const uint8_t* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+// Collects one finished child; false if there are none left
+static bool reap(std::map<pid_t, Child>& running, size_t resultSize, uint8_t* results,
+                 std::vector<bool>& passed, const std::function<void(size_t)>& done) {
+    int status = 0;
+    pid_t pid = waitpid(-1, &status, 0);
+    if (pid < 0) {
+        return false;
+    }
+    std::map<pid_t, Child>::iterator it = running.find(pid);
+    if (it == running.end()) {
+        return true;
+    }
+    Child child = it->second;
+    running.erase(it);
+
+    // The child wrote its result before exiting; the pipe holds it
+    bool complete = readAll(child.fd, results + child.index * resultSize, resultSize);
+    close(child.fd);
+    passed[child.index] = complete && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    if (done) {
+        done(child.index);
+    }
+    return true;
+}
+
+void run(size_t count, unsigned jobs, size_t resultSize,
+         const std::function<bool(size_t, void*)>& job, void* results, std::vector<bool>& passed,
+         const std::function<void(size_t)>& done) {
+    uint8_t* out = static_cast<uint8_t*>(results);
+    passed.assign(count, false);
+    if (jobs == 0) {
+        jobs = 1;
+    }
+
+    std::map<pid_t, Child> running;
+    for (size_t index = 0; index < count; index++) {
+        while (running.size() >= jobs && reap(running, resultSize, out, passed, done)) {
+        }
+
+        int fds[2];
+        if (pipe(fds) != 0) {
+            perror("pipe");
+            continue;
+        }
+        // Anything buffered would be printed by the child as well
+        fflush(stdout);
+        fflush(stderr);
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            close(fds[0]);
+            close(fds[1]);
+            continue;
+        }
+        if (pid == 0) {
+            close(fds[0]);
+            uint8_t* result = out + index * resultSize;
+            bool pass = job(index, result);
+            bool sent = writeAll(fds[1], result, resultSize);
+            fflush(stdout);
+            _exit(pass && sent ? 0 : 1);
+        }
+        close(fds[1]);
+        running[pid] = Child{index, fds[0]};
+    }
+    while (!running.empty() && reap(running, resultSize, out, passed, done)) {
+    }
+}
+
+unsigned processors() {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (unsigned)n : 1;
+}
+
+} // namespace Sweep
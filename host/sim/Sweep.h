@@ -0,0 +1,41 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+// Runs of the firmware in parallel. The sketch's globals and the host
+// shim's clock exist once per process, so every run gets its own: a
+// forked child that starts from the parent's state (setup() not called
+// yet), does its run and sends its result back through a pipe.
+
+#include <stddef.h>
+#include <functional>
+#include <vector>
+
+namespace Sweep {
+
+// Calls job(index, result) for index 0..count-1, each in a child process,
+// up to `jobs` at once. A job fills resultSize bytes at result and
+// returns whether it passed; they are copied to results + index *
+// resultSize. passed[index] is false if the job failed or its child died.
+// done(index) runs in the parent as each one finishes. A result waits in
+// the pipe until its child is collected, so keep it well under 4 KB.
+void run(size_t count, unsigned jobs, size_t resultSize,
+         const std::function<bool(size_t, void*)>& job, void* results, std::vector<bool>& passed,
+         const std::function<void(size_t)>& done = nullptr);
+
+// Same with a plain-data Result
+template<typename Result>
+void run(size_t count, unsigned jobs, const std::function<bool(size_t, Result&)>& job,
+         std::vector<Result>& results, std::vector<bool>& passed,
+         const std::function<void(size_t)>& done = nullptr) {
+    results.assign(count, Result());
+    run(count, jobs, sizeof(Result),
+        [&job](size_t index, void* result) { return job(index, *static_cast<Result*>(result)); },
+        results.data(), passed, done);
+}
+
+// Processors available to run on
+unsigned processors();
+
+} // namespace Sweep
+
+#endif // SWEEP_H
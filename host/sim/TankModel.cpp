@@ -0,0 +1,117 @@
+#include "TankModel.h"
+#include "HostSim.h"
+
+TankModel::Params TankModel::defaults() {
+    Params params;
+    params.noLoadSpeed = 1.0f;
+    params.timeConstant = 0.15f;
+    params.load = 0.1f;
+    params.trackWidth = 0.25f;
+    params.skidFactor = 1.5f;
+    params.turnLoad = 0.05f;
+    params.relayDeadTime = 0.015;
+    params.pwmDelay = 0.00005;     // one period at 20 kHz
+    params.turretInertiaTime = 0.04;
+    params.servoFrameHz = 50;
+    params.servoMinPulseUs = 500;
+    params.servoMaxPulseUs = 2500;
+    return params;
+}
+
+TankModel::TankModel(const Params& params, const Pins& pins)
+    : rotation(params.servoFrameHz, params.servoMinPulseUs, params.servoMaxPulseUs),
+      elevation(params.servoFrameHz, params.servoMinPulseUs, params.servoMaxPulseUs),
+      params(params),
+      pins(pins),
+      rotationPulseUs(0),
+      elevationPulseUs(0),
+      nowUs(HostSim::nowUs())
+{
+    TankPlant::Track* tracks[] = {&plant.left, &plant.right};
+    for (TankPlant::Track* track : tracks) {
+        track->noLoadSpeed = params.noLoadSpeed;
+        track->timeConstant = params.timeConstant;
+        track->load = params.load;
+    }
+    plant.trackWidth = params.trackWidth;
+    plant.skidFactor = params.skidFactor;
+    plant.turnLoad = params.turnLoad;
+    rotation.inertiaTime = params.turretInertiaTime;
+    elevation.inertiaTime = params.turretInertiaTime;
+}
+
+void TankModel::latch() {
+    latchBridge(leftBridge, pins.leftPwm, pins.leftForward, pins.leftReverse);
+    latchBridge(rightBridge, pins.rightPwm, pins.rightForward, pins.rightReverse);
+    rotationPulseUs = servoPulse(pins.rotationServo);
+    elevationPulseUs = servoPulse(pins.elevationServo);
+}
+
+void TankModel::advanceTo(uint64_t timeUs) {
+    while (nowUs < timeUs) {
+        uint64_t stepUs = timeUs - nowUs < maxStepUs ? timeUs - nowUs : maxStepUs;
+        double dt = stepUs * 1e-6;
+        plant.left.duty = leftBridge.output(nowUs);
+        plant.right.duty = rightBridge.output(nowUs);
+        plant.step((float)dt);
+        rotation.step(rotationPulseUs, dt);
+        elevation.step(elevationPulseUs, dt);
+        nowUs += stepUs;
+    }
+}
+
+void TankModel::latchBridge(Bridge& bridge, uint8_t pwmPin, uint8_t forwardPin, uint8_t reversePin) {
+    const HostSim::PinState& pwm = HostSim::pin(pwmPin);
+    float duty = pwm.pwm ? (float)pwm.duty / ((1u << pwm.resolutionBits) - 1) : 0;
+    bool forward = HostSim::pin(forwardPin).level;
+    bool reverse = HostSim::pin(reversePin).level;
+    int direction = forward == reverse ? 0 : (forward ? 1 : -1);
+    bridge.command(duty, direction, nowUs, params);
+}
+
+// Pulse width the servo output sends, 0 if none
+uint16_t TankModel::servoPulse(uint8_t pin) {
+    const HostSim::PinState& state = HostSim::pin(pin);
+    if (!state.pwm || state.frequencyHz == 0) {
+        return 0;
+    }
+    return (uint16_t)(((uint64_t)state.duty * 1000000 / state.frequencyHz) >> state.resolutionBits);
+}
+
+// ----------------------
+// Bridge
+// ----------------------
+TankModel::Bridge::Bridge()
+    : targetDirection(0),
+      targetDuty(0),
+      appliedDirection(0),
+      appliedDuty(0),
+      directionChangeUs(0),
+      dutyChangeUs(0)
+{
+}
+
+void TankModel::Bridge::command(float duty, int direction, uint64_t nowUs, const Params& params) {
+    if (direction != targetDirection) {
+        targetDirection = direction;
+        directionChangeUs = nowUs + (uint64_t)(params.relayDeadTime * 1e6);
+    }
+    if (duty != targetDuty) {
+        targetDuty = duty;
+        dutyChangeUs = nowUs + (uint64_t)(params.pwmDelay * 1e6);
+    }
+}
+
+float TankModel::Bridge::output(uint64_t nowUs) {
+    if (appliedDuty != targetDuty && nowUs >= dutyChangeUs) {
+        appliedDuty = targetDuty;
+    }
+    if (appliedDirection != targetDirection) {
+        if (nowUs < directionChangeUs) {
+            // Relays changing over: the motor coasts
+            return 0;
+        }
+        appliedDirection = targetDirection;
+    }
+    return appliedDuty * appliedDirection;
+}
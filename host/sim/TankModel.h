@@ -0,0 +1,103 @@
+#ifndef TANK_MODEL_H
+#define TANK_MODEL_H
+
+#include <stdint.h>
+#include "TankPlant.h"
+#include "ServoPlant.h"
+
+// The whole tank for host runs, driven by what loop() wrote to the pins:
+// the H-bridge outputs through relay and PWM lag into the skid-steer
+// TankPlant, the turret servo pulses into ServoPlants carrying the
+// turret's inertia.
+//
+// latch() reads the pins, advanceTo() then runs the physics up to a
+// time with those outputs held. Call latch() before each loop() and
+// advanceTo(now) after it, so the outputs of a tick act from that tick on.
+class TankModel {
+public:
+    struct Params {
+        // Tracks (TankPlant)
+        float noLoadSpeed;     // m/s at full duty
+        float timeConstant;    // s
+        float load;            // fraction of noLoadSpeed
+        float trackWidth;      // m
+        float skidFactor;
+        float turnLoad;
+
+        // H-bridge: direction changes pass through coast for
+        // relayDeadTime, duty changes take pwmDelay to show
+        double relayDeadTime;  // s
+        double pwmDelay;       // s
+
+        // Turret servos
+        double turretInertiaTime;  // s, see ServoPlant
+        uint32_t servoFrameHz;
+        uint16_t servoMinPulseUs;
+        uint16_t servoMaxPulseUs;
+    };
+
+    struct Pins {
+        uint8_t leftPwm;
+        uint8_t leftForward;
+        uint8_t leftReverse;
+        uint8_t rightPwm;
+        uint8_t rightForward;
+        uint8_t rightReverse;
+        uint8_t rotationServo;
+        uint8_t elevationServo;
+    };
+
+    static Params defaults();
+
+    TankModel(const Params& params, const Pins& pins);
+
+    void latch();
+    void advanceTo(uint64_t timeUs);
+
+    uint64_t timeUs() const { return nowUs; }
+
+    // Signed duty the bridge currently gets from the firmware, -1..1
+    float leftCommand() const { return leftBridge.commandDuty(); }
+    float rightCommand() const { return rightBridge.commandDuty(); }
+
+    TankPlant plant;
+    ServoPlant rotation;
+    ServoPlant elevation;
+
+private:
+    // One H-bridge channel as the track sees it
+    class Bridge {
+    public:
+        Bridge();
+
+        void command(float duty, int direction, uint64_t nowUs, const Params& params);
+
+        // Signed duty reaching the motor at nowUs
+        float output(uint64_t nowUs);
+
+        float commandDuty() const { return targetDuty * targetDirection; }
+
+    private:
+        int targetDirection;
+        float targetDuty;
+        int appliedDirection;
+        float appliedDuty;
+        uint64_t directionChangeUs;  // when the relays are through
+        uint64_t dutyChangeUs;       // when the new duty shows
+    };
+
+    static const uint32_t maxStepUs = 500;
+
+    Params params;
+    Pins pins;
+    Bridge leftBridge;
+    Bridge rightBridge;
+    uint16_t rotationPulseUs;
+    uint16_t elevationPulseUs;
+    uint64_t nowUs;
+
+    void latchBridge(Bridge& bridge, uint8_t pwmPin, uint8_t forwardPin, uint8_t reversePin);
+    static uint16_t servoPulse(uint8_t pin);
+};
+
+#endif // TANK_MODEL_H
@@ -0,0 +1,131 @@
+#ifndef TANK_PLANT_H
+#define TANK_PLANT_H
+
+#include <stdint.h>
+#include <math.h>
+#include "MotorDriver.h"
+
+// Differential-drive model of the tank for host runs: two DC-motor
+// driven tracks with first-order speed response, battery voltage and a
+// friction load per track, quadrature encoders and the resulting pose.
+// Skid steering is optional: the tracks slip sideways when the tank
+// turns, so it yaws slower than the track speeds alone would make it
+// (skidFactor) and turning loads both tracks (turnLoad).
+// step() advances it by dt seconds; it runs as fast as the host allows.
+class TankPlant {
+public:
+    struct Track {
+        // Parameters
+        float noLoadSpeed;  // m/s at 100 % duty and nominal battery
+        float timeConstant; // s, motor + drivetrain
+        float load;         // friction as a fraction of noLoadSpeed
+        float countsPerMeter;
+
+        // State
+        float duty;         // -1..1, set through the motor driver
+        float speed;        // m/s
+        double distance;    // m
+
+        int32_t encoderCount() const { return (int32_t)floor(distance * countsPerMeter); }
+    };
+
+    // MotorDriver writing into one track of the plant
+    class Driver : public MotorDriver {
+    public:
+        explicit Driver(Track& track) : track(track), maxDuty(1) {}
+
+        bool begin(uint32_t, uint8_t resolutionBits) override {
+            maxDuty = (1u << resolutionBits) - 1;
+            return true;
+        }
+
+        void write(uint32_t duty, Direction direction) override {
+            track.duty = (float)direction * duty / maxDuty;
+        }
+
+    private:
+        Track& track;
+        uint32_t maxDuty;
+    };
+
+    TankPlant()
+        : left(defaultTrack()),
+          right(defaultTrack()),
+          trackWidth(0.25f),
+          battery(1.0f),
+          skidFactor(1.0f),
+          turnLoad(0),
+          x(0),
+          y(0),
+          heading(0),
+          yawRate(0)
+    {
+    }
+
+    void step(float dt) {
+        // Turning resistance from the last step's yaw rate
+        float extraLoad = turnLoad * (float)fabs(yawRate);
+        stepTrack(left, dt, extraLoad);
+        stepTrack(right, dt, extraLoad);
+        double v = 0.5 * (left.speed + right.speed);
+        yawRate = (right.speed - left.speed) / (trackWidth * skidFactor);
+        x += v * cos(heading) * dt;
+        y += v * sin(heading) * dt;
+        heading += yawRate * dt;
+    }
+
+    // Speed a track settles at with duty applied, straight ahead
+    float steadySpeed(const Track& track, float duty) const {
+        float drive = duty * battery * track.noLoadSpeed;
+        float friction = track.load * track.noLoadSpeed;
+        if (fabsf(drive) <= friction) {
+            return 0;
+        }
+        return drive > 0 ? drive - friction : drive + friction;
+    }
+
+    Track left;
+    Track right;
+    float trackWidth;  // m, between track centres
+    float battery;     // supply relative to nominal
+    float skidFactor;  // effective over geometric track width, >= 1
+    float turnLoad;    // extra friction per rad/s of yaw, fraction of noLoadSpeed
+
+    double x;          // m
+    double y;          // m
+    double heading;    // rad, counter-clockwise
+    double yawRate;    // rad/s
+
+private:
+    static Track defaultTrack() {
+        Track track = {};
+        track.noLoadSpeed = 1.0f;
+        track.timeConstant = 0.15f;
+        track.load = 0.1f;
+        track.countsPerMeter = 4000;
+        return track;
+    }
+
+    void stepTrack(Track& track, float dt, float extraLoad) {
+        // Drive pulls the speed towards duty * supply; friction opposes
+        // motion and holds the track until the drive overcomes it
+        float drive = track.duty * battery * track.noLoadSpeed;
+        float friction = (track.load + extraLoad) * track.noLoadSpeed;
+        float accel;
+        if (track.speed != 0) {
+            accel = (drive - track.speed - (track.speed > 0 ? friction : -friction)) / track.timeConstant;
+            float next = track.speed + accel * dt;
+            // Friction stops the track, it doesn't reverse it
+            if ((next > 0) != (track.speed > 0) && fabsf(drive) <= friction) {
+                next = 0;
+            }
+            track.speed = next;
+        } else if (fabsf(drive) > friction) {
+            accel = (drive - (drive > 0 ? friction : -friction)) / track.timeConstant;
+            track.speed = accel * dt;
+        }
+        track.distance += track.speed * dt;
+    }
+};
+
+#endif // TANK_PLANT_H
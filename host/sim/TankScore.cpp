@@ -0,0 +1,148 @@
+#include "TankScore.h"
+#include "TankMixer.h"
+#include <math.h>
+
+TankScore::TankScore(const DriveScript& script, uint8_t gear)
+    : script(script),
+      gear(gear),
+      noLoadSpeed(1),
+      refX(0),
+      refY(0),
+      refHeading(0),
+      pathSquareSum(0),
+      pathMax(0),
+      headingError(0)
+{
+    samples.reserve(script.endMs);
+}
+
+void TankScore::sample(const TankModel& model) {
+    const TankPlant& plant = model.plant;
+    noLoadSpeed = plant.left.noLoadSpeed;
+
+    Sample s;
+    s.leftSpeed = plant.left.speed;
+    s.rightSpeed = plant.right.speed;
+    s.turretAngle = (float)model.rotation.angle;
+    samples.push_back(s);
+
+    // Reference: the mixer's track speeds for this millisecond's input,
+    // reached at once
+    const Drive& drive = script.inputAt((uint32_t)samples.size() - 1);
+    MixerInput in = {drive.drive, drive.turn, drive.turretRotation, drive.turretElevation, drive.fire, gear};
+    ControlState mixed = {};
+    TankMixer::mix(in, mixed);
+    double left = plant.steadySpeed(plant.left, mixed.leftTrackSpeed / 100.0f);
+    double right = plant.steadySpeed(plant.right, mixed.rightTrackSpeed / 100.0f);
+    double dt = 0.001;
+    double v = 0.5 * (left + right);
+    refX += v * cos(refHeading) * dt;
+    refY += v * sin(refHeading) * dt;
+    refHeading += (right - left) / (plant.trackWidth * plant.skidFactor) * dt;
+
+    double error = hypot(plant.x - refX, plant.y - refY);
+    pathSquareSum += error * error;
+    pathMax = error > pathMax ? error : pathMax;
+    headingError = fabs(remainder(plant.heading - refHeading, 2 * M_PI)) * 180 / M_PI;
+}
+
+TankScore::Result TankScore::finish() const {
+    Result result = {};
+    result.pathRmsM = samples.empty() ? 0 : sqrt(pathSquareSum / samples.size());
+    result.pathMaxM = pathMax;
+    result.headingErrorDeg = headingError;
+
+    double trackResponse = 0;
+    double turretResponseSum = 0;
+    for (size_t i = 1; i < script.phaseCount; i++) {
+        stepResponse(i, 0, trackResponse, result.trackOvershootPct, result.trackSteps);
+        stepResponse(i, 1, trackResponse, result.trackOvershootPct, result.trackSteps);
+        turretResponse(i, turretResponseSum, result.turretOverrunDeg, result.turretSteps);
+    }
+    result.trackResponseMs = result.trackSteps ? trackResponse / result.trackSteps : 0;
+    result.turretResponseMs = result.turretSteps ? turretResponseSum / result.turretSteps : 0;
+    return result;
+}
+
+float TankScore::turretRateAt(size_t index) const {
+    if (index < rateWindowMs) {
+        return 0;
+    }
+    return (samples[index].turretAngle - samples[index - rateWindowMs].turretAngle) * 1000.0f / rateWindowMs;
+}
+
+// Speed step of one track (0 = left) over a phase: initial value at the
+// start, final value at its end
+void TankScore::stepResponse(size_t phase, int track, double& responseSum, double& overshootMax,
+                             uint16_t& steps) const {
+    size_t start = script.phases[phase].startMs;
+    size_t end = script.phaseEndMs(phase);
+    if (end > samples.size() || end - start <= settleWindowMs) {
+        return;
+    }
+    auto speed = [&](size_t i) { return track == 0 ? samples[i].leftSpeed : samples[i].rightSpeed; };
+
+    double initial = speed(start);
+    double final = 0;
+    for (size_t i = end - settleWindowMs; i < end; i++) {
+        final += speed(i);
+    }
+    final /= settleWindowMs;
+    double step = final - initial;
+    if (fabs(step) < minTrackStep * noLoadSpeed) {
+        return;
+    }
+
+    size_t reached = end;
+    double overshoot = 0;
+    for (size_t i = start; i < end; i++) {
+        double progress = (speed(i) - initial) / step;
+        if (reached == end && progress >= 0.9) {
+            reached = i;
+        }
+        overshoot = progress - 1 > overshoot ? progress - 1 : overshoot;
+    }
+    responseSum += reached - start;
+    overshootMax = overshoot * 100 > overshootMax ? overshoot * 100 : overshootMax;
+    steps++;
+}
+
+// Rate step of the turret rotation over a phase; after a stop also how
+// far it ran past where it came to rest
+void TankScore::turretResponse(size_t phase, double& responseSum, double& overrunMax, uint16_t& steps) const {
+    size_t start = script.phases[phase].startMs;
+    size_t end = script.phaseEndMs(phase);
+    if (end > samples.size() || end - start <= settleWindowMs) {
+        return;
+    }
+
+    double initial = turretRateAt(start);
+    double final = 0;
+    double rest = 0;
+    for (size_t i = end - settleWindowMs; i < end; i++) {
+        final += turretRateAt(i);
+        rest += samples[i].turretAngle;
+    }
+    final /= settleWindowMs;
+    rest /= settleWindowMs;
+    double step = final - initial;
+    if (fabs(step) >= minTurretStep) {
+        size_t reached = end;
+        for (size_t i = start; i < end && reached == end; i++) {
+            if ((turretRateAt(i) - initial) / step >= 0.9) {
+                reached = i;
+            }
+        }
+        responseSum += reached - start;
+        steps++;
+    }
+
+    int8_t before = script.phases[phase - 1].input.turretRotation;
+    if (script.phases[phase].input.turretRotation == 0 && before != 0) {
+        double direction = before > 0 ? 1 : -1;
+        for (size_t i = start; i < end; i++) {
+            double overrun = (samples[i].turretAngle - rest) * direction;
+            overrunMax = overrun > overrunMax ? overrun : overrunMax;
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef TANK_SCORE_H
+#define TANK_SCORE_H
+
+#include <stdint.h>
+#include <vector>
+#include "DriveScript.h"
+#include "TankModel.h"
+
+// Scores one scripted run of a TankModel:
+//  - path tracking against the path the commanded track speeds would
+//    drive with instant response (same mixer, gear and plant geometry)
+//  - response time and overshoot of the track speeds and the turret rate
+//    on each step of the script
+// sample() once per millisecond of the run, finish() at its end.
+class TankScore {
+public:
+    struct Result {
+        double pathRmsM;           // distance to the reference position
+        double pathMaxM;
+        double headingErrorDeg;    // at the end of the run
+        double trackResponseMs;    // mean time to 90 % of a speed step
+        double trackOvershootPct;  // worst, of the step size
+        double turretResponseMs;   // mean time to 90 % of a rate step
+        double turretOverrunDeg;   // worst travel past the rest angle after a stop
+        uint16_t trackSteps;       // steps measured; 0 = metric not set
+        uint16_t turretSteps;
+    };
+
+    TankScore(const DriveScript& script, uint8_t gear);
+
+    void sample(const TankModel& model);
+    Result finish() const;
+
+private:
+    struct Sample {
+        float leftSpeed;
+        float rightSpeed;
+        float turretAngle;
+    };
+
+    // Steps under these are ignored
+    static constexpr double minTrackStep = 0.05;   // of noLoadSpeed
+    static constexpr double minTurretStep = 5;     // deg/s
+    static const uint32_t settleWindowMs = 100;    // final value = mean over it
+    static const uint32_t rateWindowMs = 20;       // one servo frame
+
+    const DriveScript& script;
+    uint8_t gear;
+    float noLoadSpeed;
+    std::vector<Sample> samples;
+
+    // Reference pose
+    double refX;
+    double refY;
+    double refHeading;
+    double pathSquareSum;
+    double pathMax;
+    double headingError;
+
+    float turretRateAt(size_t index) const;
+    void stepResponse(size_t phase, int track, double& responseSum, double& overshootMax,
+                      uint16_t& steps) const;
+    void turretResponse(size_t phase, double& responseSum, double& overrunMax, uint16_t& steps) const;
+};
+
+#endif // TANK_SCORE_H
@@ -0,0 +1,303 @@
+// Link loss on the firmware's setup() and loop() in virtual time: the
+// backend selected at build time drives forward, then its input stops
+// the way it does on the tank (nothing more on Serial, the receiver
+// losing its signal, the gamepad disconnecting, ...).
+//
+// Built by CMake as failsafe_sim_<mode>, one per control mode:
+//   cmake -S . -B build && cmake --build build
+//   build/host/failsafe_sim_rc
+//
+// Checks that nothing moves before the first input, that gaps shorter
+// than the deadline ride through, that the tracks are stopped within
+// FAILSAFE_DEADLINE_MS plus one input and one actuation tick of the last
+// input (over dropouts at different points of the loop), that the
+// failsafe reports its detection latency and outages on a "stats" query,
+// and that the tank drives again once input is back. For a serial link,
+// line noise, broken frames and bare line ends after the last good frame
+// don't keep the tank driving, and neither do SBUS frames flagged
+// failsafe by the receiver. For a Bluetooth gamepad that stops reporting but stays connected, the tracks are
+// stopped within BluetoothControl::reportKeepAliveMs more; a keyboard
+// keeps its held keys until the link drops (KeyboardControl.h). Exits
+// non-zero if a check fails.
+
+#include "ProjectHephaistos.ino"
+#include "HostSim.h"
+#include "ScriptedInput.h"
+#include <stdio.h>
+#include <string>
+
+static const Drive forward = {100, 0, 0, 0, false};
+static const uint32_t dropouts = 10;
+
+// Tracks stopped within this of the last input
+static const uint32_t inputTickUs = 1000000UL / INPUT_RATE_HZ;
+static const uint32_t actuateTickUs = 1000000UL / ACTUATE_RATE_HZ;
+#ifdef CONTROL_MODE_UDP
+// The jitter buffer holds datagrams back
+static const uint32_t heldUs = UDP_JITTER_BUFFER_MS * 1000UL;
+#else
+static const uint32_t heldUs = 0;
+#endif
+static const uint32_t stopBoundUs =
+    (linkReportsLoss ? 0 : FAILSAFE_DEADLINE_MS * 1000UL + heldUs) + inputTickUs + actuateTickUs;
+#ifdef CONTROL_MODE_BLUETOOTH
+// The keep-alive counts in whole ms from the poll that got the last report
+static const uint32_t stalledStopBoundUs =
+    (BluetoothControl::reportKeepAliveMs + 1 + FAILSAFE_DEADLINE_MS) * 1000UL + 2 * inputTickUs + actuateTickUs;
+#endif
+
+static bool failed = false;
+static std::string logText;
+
+static void check(bool pass, const char* what) {
+    printf("  %-58s %s\n", what, pass ? "ok" : "FAIL");
+    failed = failed || !pass;
+}
+
+// 1 forward, -1 reverse, 0 coasting
+static int trackOutput(uint8_t pwmPin, uint8_t forwardPin, uint8_t reversePin) {
+    const HostSim::PinState& pwm = HostSim::pin(pwmPin);
+    if (!pwm.pwm || pwm.duty == 0) {
+        return 0;
+    }
+    if (HostSim::pin(forwardPin).level != HostSim::pin(reversePin).level) {
+        return HostSim::pin(forwardPin).level ? 1 : -1;
+    }
+    return 0;
+}
+
+static bool tracksDriven() {
+    return trackOutput(LEFT_MOTOR_PWM_PIN, LEFT_MOTOR_FORWARD_PIN, LEFT_MOTOR_REVERSE_PIN) != 0 ||
+           trackOutput(RIGHT_MOTOR_PWM_PIN, RIGHT_MOTOR_FORWARD_PIN, RIGHT_MOTOR_REVERSE_PIN) != 0;
+}
+
+static bool tracksForward() {
+    return trackOutput(LEFT_MOTOR_PWM_PIN, LEFT_MOTOR_FORWARD_PIN, LEFT_MOTOR_REVERSE_PIN) > 0 &&
+           trackOutput(RIGHT_MOTOR_PWM_PIN, RIGHT_MOTOR_FORWARD_PIN, RIGHT_MOTOR_REVERSE_PIN) > 0;
+}
+
+// One scheduler tick; the output is kept for the stats check, binary
+// telemetry frames and all
+static void tick() {
+    loop();
+    logText += Serial.takeOutput();
+}
+
+// Runs until untilUs; false if the tracks stopped on the way
+static bool runDriving(uint64_t untilUs) {
+    bool drove = true;
+    while (HostSim::nowUs() < untilUs) {
+        tick();
+        drove = drove && tracksForward();
+    }
+    return drove;
+}
+
+static void runUntil(uint64_t untilUs) {
+    while (HostSim::nowUs() < untilUs) {
+        tick();
+    }
+}
+
+#ifdef CONTROL_MODE_SERIAL
+// Garbage on the line every 5 ms while on: a state frame with a bad CRC
+// and a few random bytes, never a line end
+static bool lineNoise = false;
+
+static void noiseFrom(uint64_t atUs, uint32_t seed) {
+    HostSim::schedule(atUs, [atUs, seed]() {
+        if (!lineNoise) {
+            return;
+        }
+        ControlFrame::ControlStatePayload state = {0, 100, 0, 0, 0, 1, 0};
+        uint8_t bytes[sizeof(state) + ControlFrame::overhead + 6];
+        size_t length = ControlFrame::encode(ControlFrame::TYPE_CONTROL_STATE, &state, sizeof(state), bytes,
+                                             sizeof(bytes));
+        bytes[length - 1] ^= 0x5A;
+        uint32_t next = seed;
+        while (length < sizeof(bytes)) {
+            next = next * 1103515245 + 12345;
+            uint8_t byte = (uint8_t)(next >> 16);
+            bytes[length++] = byte == '\n' || byte == '\r' ? 'x' : byte;
+        }
+        Serial.inject(bytes, length);
+        noiseFrom(atUs + 5000, next);
+    });
+}
+
+static void dropIntoNoise() {
+    dropInput();
+    lineNoise = true;
+    noiseFrom(HostSim::nowUs(), 7);
+}
+
+// Bare line ends every 5 ms while on, as a terminal or a USB adapter
+// may send them
+static bool lineEnds = false;
+
+static void lineEndsFrom(uint64_t atUs) {
+    HostSim::schedule(atUs, [atUs]() {
+        if (lineEnds) {
+            Serial.inject("\r\n");
+            lineEndsFrom(atUs + 5000);
+        }
+    });
+}
+
+static void dropIntoLineEnds() {
+    dropInput();
+    lineEnds = true;
+    lineEndsFrom(HostSim::nowUs());
+}
+#endif
+
+// Cuts the input and runs until the tracks are stopped; returns how
+// long after the last input they were
+static uint32_t cutAndTimeStop(void (*cut)()) {
+    cut();
+    uint64_t limitUs = HostSim::nowUs() + 1000000;
+    while (tracksDriven() && HostSim::nowUs() < limitUs) {
+        tick();
+    }
+    return (uint32_t)(HostSim::nowUs() - lastInputUs());
+}
+
+int main() {
+    printf("Failsafe: " CONTROL_MODE_NAME ", deadline %u ms, stop within %lu us of the last input\n",
+           (unsigned)FAILSAFE_DEADLINE_MS, (unsigned long)stopBoundUs);
+
+    setup();
+    FailsafeMonitor::Stats stats;
+
+    printf("Before the first input\n");
+    bool moved = false;
+    while (HostSim::nowUs() < 300000) {
+        tick();
+        moved = moved || tracksDriven();
+    }
+    failsafe.stats(stats);
+    check(!moved && stats.trips == 0 && !failsafe.tripped(), "tracks still, no trip counted");
+
+    printf("Driving\n");
+    connectInput();
+    applyInput(forward);
+    runUntil(HostSim::nowUs() + 500000);
+    check(runDriving(HostSim::nowUs() + 500000), "tracks driven forward");
+
+    if (!linkReportsLoss) {
+        printf("Short gap\n");
+        uint64_t gapUs = FAILSAFE_DEADLINE_MS * 1000UL / 4;
+        dropInput();
+        bool drove = runDriving(HostSim::nowUs() + gapUs);
+        restoreInput();
+        drove = runDriving(HostSim::nowUs() + 300000) && drove;
+        failsafe.stats(stats);
+        check(drove && stats.trips == 0, "gap of a quarter deadline rides through");
+    }
+
+    printf("Dropouts\n");
+    uint32_t worstUs = 0;
+    uint32_t totalUs = 0;
+    for (uint32_t i = 0; i < dropouts; i++) {
+        // Each at a different point of the input and actuation ticks
+        runUntil(HostSim::nowUs() + 400000 + i * 1700);
+        uint32_t stopUs = cutAndTimeStop(dropInput);
+        worstUs = stopUs > worstUs ? stopUs : worstUs;
+        totalUs += stopUs;
+        runUntil(HostSim::nowUs() + 300000);
+        restoreInput();
+        runUntil(HostSim::nowUs() + 100000);
+    }
+    printf("  tracks stopped after avg %lu us, max %lu us\n", (unsigned long)(totalUs / dropouts),
+           (unsigned long)worstUs);
+    check(worstUs <= stopBoundUs, "tracks stopped within the bound");
+    failsafe.stats(stats);
+    check(stats.trips == dropouts, "one trip per dropout");
+    check(stats.maxDetectionUs > FAILSAFE_DEADLINE_MS * 1000UL &&
+              stats.maxDetectionUs <= FAILSAFE_DEADLINE_MS * 1000UL + inputTickUs + actuateTickUs + heldUs,
+          "detection latency within the deadline plus a tick");
+    check(stats.longestOutageMs >= 300 && stats.longestOutageMs <= 500, "outage length recorded");
+
+    printf("Input back\n");
+    check(runDriving(HostSim::nowUs() + 200000) && !failsafe.tripped(), "tracks driven again");
+
+#if defined(CONTROL_MODE_SERIAL)
+    printf("Line noise\n");
+    uint32_t noisyStopUs = cutAndTimeStop(dropIntoNoise);
+    runUntil(HostSim::nowUs() + 300000);
+    bool stayedStopped = !tracksDriven();
+    lineNoise = false;
+    printf("  tracks stopped after %lu us\n", (unsigned long)noisyStopUs);
+    check(noisyStopUs <= stopBoundUs && stayedStopped, "noise and broken frames don't feed the failsafe");
+    restoreInput();
+    runUntil(HostSim::nowUs() + 100000);
+    check(runDriving(HostSim::nowUs() + 200000), "tracks driven again");
+
+    printf("Bare line ends\n");
+    uint32_t lineEndStopUs = cutAndTimeStop(dropIntoLineEnds);
+    runUntil(HostSim::nowUs() + 300000);
+    stayedStopped = !tracksDriven();
+    lineEnds = false;
+    printf("  tracks stopped after %lu us\n", (unsigned long)lineEndStopUs);
+    check(lineEndStopUs <= stopBoundUs && stayedStopped, "empty lines don't feed the failsafe");
+    restoreInput();
+    runUntil(HostSim::nowUs() + 100000);
+    check(runDriving(HostSim::nowUs() + 200000), "tracks driven again");
+    failsafe.stats(stats);
+#elif defined(CONTROL_MODE_RC_BUS)
+    printf("Receiver failsafe\n");
+    receiverFailsafe = true;
+    uint64_t flaggedUs = HostSim::nowUs();
+    while (!failsafe.tripped() && HostSim::nowUs() - flaggedUs < 1000000) {
+        tick();
+    }
+    uint32_t flaggedTripUs = (uint32_t)(HostSim::nowUs() - flaggedUs);
+    receiverFailsafe = false;
+    printf("  failsafe tripped after %lu us\n", (unsigned long)flaggedTripUs);
+    check(flaggedTripUs <= stopBoundUs + sbusPeriodUs, "frames flagged failsafe don't feed the failsafe");
+    runUntil(HostSim::nowUs() + 100000);
+    check(runDriving(HostSim::nowUs() + 200000), "tracks driven again");
+    failsafe.stats(stats);
+#elif defined(CONTROL_MODE_BLUETOOTH)
+    printf("Stalled gamepad\n");
+    uint32_t stalledWorstUs = 0;
+    uint32_t stalledLeastUs = UINT32_MAX;
+    for (uint32_t i = 0; i < dropouts; i++) {
+        runUntil(HostSim::nowUs() + 400000 + i * 1700);
+        uint32_t stopUs = cutAndTimeStop(stallInput);
+        stalledWorstUs = stopUs > stalledWorstUs ? stopUs : stalledWorstUs;
+        stalledLeastUs = stopUs < stalledLeastUs ? stopUs : stalledLeastUs;
+        restoreInput();
+        runUntil(HostSim::nowUs() + 100000);
+    }
+    printf("  tracks stopped after %lu..%lu us, bound %lu us\n", (unsigned long)stalledLeastUs,
+           (unsigned long)stalledWorstUs, (unsigned long)stalledStopBoundUs);
+    check(stalledLeastUs > BluetoothControl::reportKeepAliveMs * 1000UL && stalledWorstUs <= stalledStopBoundUs,
+          "stopped within the keep-alive plus the deadline");
+    check(runDriving(HostSim::nowUs() + 200000), "tracks driven again");
+    failsafe.stats(stats);
+#elif defined(CONTROL_MODE_KEYBOARD)
+    printf("Stalled keyboard\n");
+    stallInput();
+    check(runDriving(HostSim::nowUs() + 1000000), "held keys kept while the link is up");
+    uint32_t droppedUs = cutAndTimeStop(dropInput);
+    check(droppedUs <= stopBoundUs, "stopped once the stack drops the link");
+    restoreInput();
+    runUntil(HostSim::nowUs() + 100000);
+    check(runDriving(HostSim::nowUs() + 200000), "tracks driven again");
+    failsafe.stats(stats);
+#endif
+
+    printf("Stats query\n");
+    logText.clear();
+    Serial.inject("stats\n");
+    runUntil(HostSim::nowUs() + 300000);
+    char expected[64];
+    snprintf(expected, sizeof(expected), "trips %lu ", (unsigned long)stats.trips);
+    size_t line = logText.find("Failsafe: deadline");
+    check(line != std::string::npos && logText.find(expected, line) != std::string::npos,
+          "failsafe stats reported");
+
+    printf("%s\n", failed ? "FAIL" : "PASS");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,328 @@
+// The firmware's setup() and loop() against the host shim, in virtual
+// time, with the backend selected at build time fed a scripted drive.
+//
+// Built by CMake as hephaistos_sim_<mode>, one per control mode:
+//   cmake -S . -B build && cmake --build build
+//   build/host/hephaistos_sim_serial [-v]
+//
+// Time only moves while the firmware waits for its next scheduler tick,
+// so ten seconds of driving take a few milliseconds. Inputs arrive the
+// way the backend gets them on the tank: state frames on Serial, gamepad
+// or keyboard reports through BP32, PWM edges on the receiver pins or
+// SBUS frames on Serial2. Outputs are read back from the pins the
+// actuators drove. -v prints the firmware's log lines. While it runs the
+// UART's free transmit space varies, and the log lines must still come
+// out whole between the binary telemetry frames.
+// Exits non-zero if an output is not what the script expects.
+//
+// hephaistos_sim_udp --listen SECONDS runs no script: the firmware runs
+// in real time for that long, driven by datagrams from outside (e.g.
+// ProjectHephaistos/test_udp.py), and prints the outputs as they change.
+// hephaistos_sim_serial --listen SECONDS [--baud RATE] does the same with
+// Serial on a pseudo-terminal, whose path it prints, taking at most RATE
+// baud (115200 unless set) from it like the UART would; e.g.
+//   python3 ProjectHephaistos/tank_controller.py --serial-port /dev/pts/N --load 20
+
+#include "ProjectHephaistos.ino"
+#include "HostSim.h"
+#include "ScriptedInput.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <functional>
+#ifdef CONTROL_MODE_SERIAL
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+// What the actuators drove: signed track outputs in percent and the
+// turret rotation servo pulse
+struct Outputs {
+    int leftTrack;
+    int rightTrack;
+    uint16_t rotationPulseUs;
+};
+
+static const uint32_t connectMs = 0;
+
+// ----------------------
+// Outputs
+// ----------------------
+static int trackOutput(uint8_t pwmPin, uint8_t forwardPin, uint8_t reversePin) {
+    const HostSim::PinState& pwm = HostSim::pin(pwmPin);
+    if (!pwm.pwm) {
+        return 0;
+    }
+    int percent = (int)((pwm.duty * 100 + ((1u << pwm.resolutionBits) - 1) / 2) / ((1u << pwm.resolutionBits) - 1));
+    if (HostSim::pin(forwardPin).level && !HostSim::pin(reversePin).level) {
+        return percent;
+    }
+    if (HostSim::pin(reversePin).level && !HostSim::pin(forwardPin).level) {
+        return -percent;
+    }
+    return 0;
+}
+
+static Outputs readOutputs() {
+    Outputs out;
+    out.leftTrack = trackOutput(LEFT_MOTOR_PWM_PIN, LEFT_MOTOR_FORWARD_PIN, LEFT_MOTOR_REVERSE_PIN);
+    out.rightTrack = trackOutput(RIGHT_MOTOR_PWM_PIN, RIGHT_MOTOR_FORWARD_PIN, RIGHT_MOTOR_REVERSE_PIN);
+    out.rotationPulseUs = rotationServo.pulseUs();
+    return out;
+}
+
+// ----------------------
+// Script
+// Each phase holds its input until the next one starts; its expectation
+// is checked on the outputs just before that
+// ----------------------
+struct Phase {
+    const char* name;
+    uint32_t startMs;
+    Drive input;
+    bool (*expect)(const Outputs& out);
+};
+
+static const uint16_t servoCentreUs = (TURRET_SERVO_MIN_PULSE_US + TURRET_SERVO_MAX_PULSE_US) / 2;
+
+static const Phase script[] = {
+    {"idle", 0, {0, 0, 0, 0, false},
+     [](const Outputs& out) { return out.leftTrack == 0 && out.rightTrack == 0; }},
+    {"forward", 1000, {100, 0, 0, 0, false},
+     [](const Outputs& out) { return out.leftTrack > 0 && out.leftTrack == out.rightTrack; }},
+    {"turn right", 3000, {100, 50, 0, 0, false},
+     [](const Outputs& out) { return out.leftTrack > out.rightTrack && out.rightTrack >= 0; }},
+    {"stop", 5000, {0, 0, 0, 0, false},
+     [](const Outputs& out) { return out.leftTrack == 0 && out.rightTrack == 0; }},
+    {"turret right", 7000, {0, 0, 100, 0, true},
+     [](const Outputs& out) { return out.rotationPulseUs > servoCentreUs + 100 && out.leftTrack == 0; }},
+    {"release", 9000, {0, 0, 0, 0, false},
+     [](const Outputs& out) { return out.leftTrack == 0 && out.rightTrack == 0 && out.rotationPulseUs > servoCentreUs; }},
+};
+static const size_t phaseCount = sizeof(script) / sizeof(script[0]);
+static const uint32_t scriptEndMs = 10000;
+
+static bool failed = false;
+
+static void checkPhase(size_t index) {
+    Outputs out = readOutputs();
+    bool pass = script[index].expect(out);
+    printf("%6lu ms  %-12s  tracks %4d %4d %%  turret servo %4u us  %s\n", millis(), script[index].name,
+           out.leftTrack, out.rightTrack, (unsigned)out.rotationPulseUs, pass ? "ok" : "UNEXPECTED");
+    failed = failed || !pass;
+}
+
+// Log lines whole and with a binary frame inside
+static uint32_t logLines = 0;
+static uint32_t splitLogLines = 0;
+
+// Log text goes to stdout if verbose; binary telemetry frames are skipped
+static void readLog(const std::string& output, bool verbose) {
+    static std::string pending;
+    static size_t frameIndex = 0;   // position in a binary frame, 0 = none
+    static size_t frameLength = 0;
+    for (size_t i = 0; i < output.size(); i++) {
+        uint8_t byte = (uint8_t)output[i];
+        if (frameIndex > 0) {
+            // Sync, type, length, payload, CRC
+            if (frameIndex == 2) {
+                frameLength = ControlFrame::overhead + byte;
+            }
+            frameIndex = frameIndex + 1 < frameLength ? frameIndex + 1 : 0;
+            continue;
+        }
+        if (byte == ControlFrame::syncByte) {
+            if (!pending.empty()) {
+                splitLogLines++;
+            }
+            frameIndex = 1;
+            frameLength = ControlFrame::overhead;
+            continue;
+        }
+        if (byte == '\n') {
+            if (verbose) {
+                printf("  | %s\n", pending.c_str());
+            }
+            logLines++;
+            pending.clear();
+        } else if (byte != '\r') {
+            pending.push_back((char)byte);
+        }
+    }
+}
+
+#if defined(CONTROL_MODE_SERIAL) || defined(CONTROL_MODE_UDP)
+#define LISTEN_MODE
+static const uint32_t listenPrintMs = 100;
+
+#ifdef CONTROL_MODE_SERIAL
+// Host end of the UART: a pseudo-terminal, read at the baud rate
+class PtyBridge {
+public:
+    PtyBridge(uint32_t baud) : master(-1), bytesPerSecond(baud / 10), creditBytes(0), lastUs(0), lost(0) {}
+
+    bool open() {
+        master = posix_openpt(O_RDWR | O_NOCTTY);
+        if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+            return false;
+        }
+        // Raw bytes, no echo or line editing
+        struct termios mode;
+        tcgetattr(master, &mode);
+        cfmakeraw(&mode);
+        tcsetattr(master, TCSANOW, &mode);
+        fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+        return true;
+    }
+
+    const char* path() const { return ptsname(master); }
+
+    // What the line delivered since the last call goes to Serial (what
+    // doesn't fit in its buffer is lost, as on the UART); what the
+    // firmware wrote goes out
+    void exchange(const std::string& output) {
+        uint64_t nowUs = HostSim::nowUs();
+        creditBytes += (double)(nowUs - lastUs) * bytesPerSecond / 1e6;
+        lastUs = nowUs;
+        // A full buffer's worth at most, as if the line had been idle
+        creditBytes = creditBytes > 256 ? 256 : creditBytes;
+        uint8_t data[256];
+        size_t want = (size_t)creditBytes;
+        if (want > 0) {
+            ssize_t count = read(master, data, want < sizeof(data) ? want : sizeof(data));
+            if (count > 0) {
+                creditBytes -= count;
+                lost += (uint32_t)(count - Serial.inject(data, (size_t)count));
+            }
+        }
+        // Dropped if nobody reads it
+        size_t written = 0;
+        while (written < output.size()) {
+            ssize_t count = write(master, output.data() + written, output.size() - written);
+            if (count <= 0) {
+                break;
+            }
+            written += (size_t)count;
+        }
+    }
+
+    uint32_t lostBytes() const { return lost; }
+
+private:
+    int master;
+    uint32_t bytesPerSecond;
+    double creditBytes;
+    uint64_t lastUs;
+    uint32_t lost;
+};
+#endif
+
+static int runListening(uint32_t seconds, uint32_t baud, bool verbose) {
+#ifdef CONTROL_MODE_SERIAL
+    PtyBridge bridge(baud);
+    if (!bridge.open()) {
+        perror("pseudo-terminal");
+        return 1;
+    }
+    printf("Listening for %lu s: " CONTROL_MODE_NAME " on %s at %lu baud\n", (unsigned long)seconds,
+           bridge.path(), (unsigned long)baud);
+#else
+    printf("Listening for %lu s: " CONTROL_MODE_NAME " on port %u\n", (unsigned long)seconds,
+           (unsigned)UDP_CONTROL_PORT);
+#endif
+    fflush(stdout);
+    HostSim::setRealTime(true);
+    setup();
+    Outputs last = {0, 0, 0};
+    uint32_t lastPrintMs = 0;
+    while (HostSim::nowUs() < seconds * 1000000ULL) {
+        loop();
+        std::string output = Serial.takeOutput();
+#ifdef CONTROL_MODE_SERIAL
+        bridge.exchange(output);
+#endif
+        readLog(output, verbose);
+        Outputs out = readOutputs();
+        bool changed = out.leftTrack != last.leftTrack || out.rightTrack != last.rightTrack ||
+                       out.rotationPulseUs != last.rotationPulseUs;
+        if (changed && millis() - lastPrintMs >= listenPrintMs) {
+            printf("%6lu ms  tracks %4d %4d %%  turret servo %4u us\n", millis(), out.leftTrack, out.rightTrack,
+                   (unsigned)out.rotationPulseUs);
+            fflush(stdout);
+            last = out;
+            lastPrintMs = millis();
+        }
+    }
+#ifdef CONTROL_MODE_SERIAL
+    printf("%lu bytes lost from a full receive buffer\n", (unsigned long)bridge.lostBytes());
+#endif
+    return 0;
+}
+#endif
+
+int main(int argc, char** argv) {
+    bool verbose = false;
+#ifdef LISTEN_MODE
+    uint32_t listenSeconds = 0;
+    uint32_t baud = 115200;
+#endif
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+#ifdef LISTEN_MODE
+        } else if (strcmp(argv[i], "--listen") == 0 && i + 1 < argc) {
+            listenSeconds = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--baud") == 0 && i + 1 < argc) {
+            baud = (uint32_t)atoi(argv[++i]);
+#endif
+        } else {
+            fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+            return 2;
+        }
+    }
+#ifdef LISTEN_MODE
+    if (listenSeconds > 0) {
+        return runListening(listenSeconds, baud, verbose);
+    }
+#endif
+
+    printf("Simulating: " CONTROL_MODE_NAME "\n");
+    std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+
+    HostSim::schedule(connectMs * 1000ULL, []() { connectInput(); });
+    for (size_t i = 0; i < phaseCount; i++) {
+        HostSim::schedule(script[i].startMs * 1000ULL, [i]() { applyInput(script[i].input); });
+        uint32_t endMs = i + 1 < phaseCount ? script[i + 1].startMs : scriptEndMs;
+        HostSim::schedule(endMs * 1000ULL - 1, [i]() { checkPhase(i); });
+    }
+
+    // The UART buffer's free space varies from pass to pass, as when it
+    // drains while the log and telemetry both write to it. A stats query
+    // every 250 ms keeps log lines coming.
+    for (uint32_t ms = 250; ms < scriptEndMs; ms += 250) {
+        HostSim::schedule(ms * 1000ULL, []() { Serial.inject("stats\n"); });
+    }
+    static const int txSpaces[] = {24, 48, 80, 16, 130, 64, 32, 150};
+    size_t pass = 0;
+
+    setup();
+    while (HostSim::nowUs() < scriptEndMs * 1000ULL) {
+        Serial.setTxSpace(txSpaces[pass++ % (sizeof(txSpaces) / sizeof(txSpaces[0]))]);
+        loop();
+        std::string output = Serial.takeOutput();
+        readLog(output, verbose);
+    }
+    Serial.setTxSpace(4096);
+
+    bool linesWhole = logLines > 0 && splitLogLines == 0;
+    printf("%6lu ms  log           %lu lines, %lu with a frame inside  %s\n", millis(), (unsigned long)logLines,
+           (unsigned long)splitLogLines, linesWhole ? "ok" : "UNEXPECTED");
+    failed = failed || !linesWhole;
+
+    double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+    printf("\n%lu ms simulated in %.1f ms (%.0fx real time)\n", millis(), wallMs,
+           wallMs > 0 ? millis() / wallMs : 0.0);
+    printf("%s\n", failed ? "FAIL" : "PASS");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,396 @@
+// The firmware driving a simulated tank: setup() and loop() run in
+// virtual time against TankModel (skid-steer tracks with motor lag, the
+// H-bridge's relay and PWM delay, turret servos with the turret's
+// inertia), fed a DriveScript through the backend selected at build time.
+// Each run is scored on path tracking, response time and overshoot (see
+// TankScore.h); sweeps over scripts, gears and loop rates run in
+// parallel, one process per run.
+//
+// Built by CMake as tank_sim_<mode>, one per control mode:
+//   cmake -S . -B build && cmake --build build
+//   build/host/tank_sim_serial [options]
+//
+//   --script a,b,...        scripts to run (default all; --list shows them)
+//   --gear 1,3,5            gears to drive in (default 5)
+//   --input-rate 100,250    input/mix rates in Hz (default 250)
+//   --actuate-rate 500      actuation rates in Hz (default 500); each
+//                           input rate must divide it, other pairs are
+//                           skipped. Both must be whole 1 ms ticks, as the
+//                           tank's scheduler needs (ControlScheduler.h).
+//   --jobs N                runs at once (default: one per processor)
+//   --csv FILE              also write the results as CSV
+//   --relay-ms MS           H-bridge direction change dead time (15)
+//   --turret-inertia-ms MS  turret servo load lag (40)
+//   --skid F                skid factor of the tracks (1.5)
+// Exits 1 if a run failed (crashed, or the tank did not respond to the
+// script), 2 on bad arguments.
+
+// The rates are variables here so one binary can sweep them; the sketch
+// reads them through its rate macros
+#include <stdint.h>
+static uint32_t inputRateHz = 250;
+static uint32_t actuateRateHz = 500;
+#define INPUT_RATE_HZ inputRateHz
+#define MIX_RATE_HZ inputRateHz
+#define ACTUATE_RATE_HZ actuateRateHz
+
+#ifdef CONTROL_MODE_UDP
+// Runs at once each need their own port
+static uint16_t udpControlPort = 4210;
+#define UDP_CONTROL_PORT udpControlPort
+#endif
+
+#include "ProjectHephaistos.ino"
+#include "HostSim.h"
+#include "ScriptedInput.h"
+#include "TankModel.h"
+#include "TankScore.h"
+#include "Sweep.h"
+#include "TankMixer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+struct RunConfig {
+    const DriveScript* script;
+    uint8_t gear;
+    uint32_t inputRateHz;
+    uint32_t actuateRateHz;
+};
+
+struct RunResult {
+    TankScore::Result score;
+    uint32_t simulatedMs;
+    double wallMs;
+};
+
+static TankModel::Params physics;
+
+// Operator input doesn't arrive in step with the poll ticks: each phase's
+// input is delivered 0..20 ms after the phase starts, at offsets that are
+// the same for every run, so a slower input rate shows in the scores
+static uint64_t arrivalUs(const DrivePhase& phase, size_t index) {
+    return phase.startMs * 1000ULL + (uint32_t)(index * 2654435761u) % 20000;
+}
+
+// Whether the script asks anything of the tracks or the turret
+static bool drivesTracks(const DriveScript& script) {
+    for (size_t i = 0; i < script.phaseCount; i++) {
+        if (script.phases[i].input.drive != 0 || script.phases[i].input.turn != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool drivesTurret(const DriveScript& script) {
+    for (size_t i = 0; i < script.phaseCount; i++) {
+        if (script.phases[i].input.turretRotation != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ----------------------
+// One run, in its own process
+// ----------------------
+static bool runOne(const RunConfig& config, RunResult& result) {
+    std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+    const DriveScript& script = *config.script;
+
+    inputRateHz = config.inputRateHz;
+    actuateRateHz = config.actuateRateHz;
+    inputScheduler = ControlScheduler(INPUT_RATE_HZ);
+    controlScheduler = ControlScheduler(ACTUATE_RATE_HZ);
+#ifdef CONTROL_MODE_UDP
+    udpControlPort = (uint16_t)(20000 + getpid() % 40000);
+#endif
+
+    uint8_t gear = config.gear;
+    HostSim::schedule(0, [gear]() {
+        connectInput();
+        selectGear(gear);
+    });
+    for (size_t i = 0; i < script.phaseCount; i++) {
+        const Drive& input = script.phases[i].input;
+        HostSim::schedule(arrivalUs(script.phases[i], i), [&input]() { applyInput(input); });
+    }
+
+    TankModel::Pins pins = {
+        LEFT_MOTOR_PWM_PIN, LEFT_MOTOR_FORWARD_PIN, LEFT_MOTOR_REVERSE_PIN,
+        RIGHT_MOTOR_PWM_PIN, RIGHT_MOTOR_FORWARD_PIN, RIGHT_MOTOR_REVERSE_PIN,
+        TURRET_ROTATION_SERVO_PIN, TURRET_ELEVATION_SERVO_PIN
+    };
+    TankModel model(physics, pins);
+    TankScore score(script, gear);
+
+    setup();
+    uint64_t endUs = script.endMs * 1000ULL;
+    uint64_t nextSampleUs = 0;
+    while (HostSim::nowUs() < endUs) {
+        // The outputs of the last tick hold until loop() has waited for
+        // the next one
+        model.latch();
+        loop();
+        Serial.takeOutput();
+        uint64_t now = HostSim::nowUs() < endUs ? HostSim::nowUs() : endUs;
+        while (nextSampleUs < now) {
+            model.advanceTo(nextSampleUs);
+            score.sample(model);
+            nextSampleUs += 1000;
+        }
+        model.advanceTo(now);
+    }
+
+    result.score = score.finish();
+    result.simulatedMs = script.endMs;
+    result.wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+    return (result.score.trackSteps > 0 || !drivesTracks(script)) &&
+           (result.score.turretSteps > 0 || !drivesTurret(script));
+}
+
+// ----------------------
+// Arguments
+// ----------------------
+static std::vector<std::string> splitList(const char* text) {
+    std::vector<std::string> items;
+    std::string item;
+    for (const char* p = text; ; p++) {
+        if (*p == ',' || *p == '\0') {
+            if (!item.empty()) {
+                items.push_back(item);
+            }
+            item.clear();
+            if (*p == '\0') {
+                break;
+            }
+        } else {
+            item.push_back(*p);
+        }
+    }
+    return items;
+}
+
+static bool parseNumbers(const char* text, uint32_t minimum, uint32_t maximum, std::vector<uint32_t>& out) {
+    out.clear();
+    for (const std::string& item : splitList(text)) {
+        char* end = nullptr;
+        unsigned long value = strtoul(item.c_str(), &end, 10);
+        if (*end != '\0' || value < minimum || value > maximum) {
+            return false;
+        }
+        out.push_back((uint32_t)value);
+    }
+    return !out.empty();
+}
+
+static void printScripts() {
+    for (size_t i = 0; i < DriveScripts::count(); i++) {
+        const DriveScript& script = DriveScripts::at(i);
+        printf("  %-8s %5.1f s  %s\n", script.name, script.endMs / 1000.0, script.description);
+    }
+}
+
+// FreeRTOS tick rate on the tank; rates that aren't a whole number of
+// ticks can't be run there
+static const uint32_t tankTickRateHz = 1000;
+
+static bool runsOnTank(const std::vector<uint32_t>& rates) {
+    for (uint32_t rate : rates) {
+        if (tankTickRateHz % rate != 0) {
+            fprintf(stderr, "%lu Hz is not a whole number of %lu ms ticks\n", (unsigned long)rate,
+                    (unsigned long)(1000 / tankTickRateHz));
+            return false;
+        }
+    }
+    return true;
+}
+
+static int usage(const char* program) {
+    fprintf(stderr,
+            "usage: %s [--script a,b] [--gear 1,5] [--input-rate 250] [--actuate-rate 500]\n"
+            "          [--jobs N] [--csv FILE] [--relay-ms MS] [--turret-inertia-ms MS] [--skid F] [--list]\n",
+            program);
+    return 2;
+}
+
+// ----------------------
+// Output
+// ----------------------
+static void printHeader() {
+    printf("%-8s %4s %5s %5s  %8s %8s %7s  %7s %7s  %7s %7s  %8s\n",
+           "script", "gear", "in", "act", "path rms", "path max", "heading",
+           "track", "over", "turret", "overrun", "speed");
+    printf("%-8s %4s %5s %5s  %8s %8s %7s  %7s %7s  %7s %7s  %8s\n",
+           "", "", "Hz", "Hz", "m", "m", "deg", "ms", "%", "ms", "deg", "x real");
+}
+
+static void printRow(const RunConfig& config, const RunResult& result, bool passed) {
+    const TankScore::Result& s = result.score;
+    char track[16] = "-";
+    char over[16] = "-";
+    char turret[16] = "-";
+    char overrun[16] = "-";
+    if (s.trackSteps > 0) {
+        snprintf(track, sizeof(track), "%.0f", s.trackResponseMs);
+        snprintf(over, sizeof(over), "%.1f", s.trackOvershootPct);
+    }
+    if (s.turretSteps > 0) {
+        snprintf(turret, sizeof(turret), "%.0f", s.turretResponseMs);
+        snprintf(overrun, sizeof(overrun), "%.2f", s.turretOverrunDeg);
+    }
+    printf("%-8s %4u %5lu %5lu  %8.3f %8.3f %7.1f  %7s %7s  %7s %7s  %8.0f%s\n",
+           config.script->name, (unsigned)config.gear,
+           (unsigned long)config.inputRateHz, (unsigned long)config.actuateRateHz,
+           s.pathRmsM, s.pathMaxM, s.headingErrorDeg, track, over, turret, overrun,
+           result.wallMs > 0 ? result.simulatedMs / result.wallMs : 0.0,
+           passed ? "" : "  FAILED");
+}
+
+static void writeCsv(FILE* file, const std::vector<RunConfig>& configs, const std::vector<RunResult>& results,
+                     const std::vector<bool>& passed) {
+    fprintf(file, "mode,script,gear,input_hz,actuate_hz,path_rms_m,path_max_m,heading_error_deg,"
+                  "track_response_ms,track_overshoot_pct,track_steps,turret_response_ms,turret_overrun_deg,"
+                  "turret_steps,simulated_ms,wall_ms,passed\n");
+    for (size_t i = 0; i < configs.size(); i++) {
+        const TankScore::Result& s = results[i].score;
+        fprintf(file, "%s,%s,%u,%lu,%lu,%.4f,%.4f,%.2f,%.1f,%.2f,%u,%.1f,%.3f,%u,%lu,%.2f,%d\n",
+                CONTROL_MODE_NAME, configs[i].script->name, (unsigned)configs[i].gear,
+                (unsigned long)configs[i].inputRateHz, (unsigned long)configs[i].actuateRateHz,
+                s.pathRmsM, s.pathMaxM, s.headingErrorDeg, s.trackResponseMs, s.trackOvershootPct,
+                (unsigned)s.trackSteps, s.turretResponseMs, s.turretOverrunDeg, (unsigned)s.turretSteps,
+                (unsigned long)results[i].simulatedMs, results[i].wallMs, passed[i] ? 1 : 0);
+    }
+}
+
+int main(int argc, char** argv) {
+    std::vector<const DriveScript*> scripts;
+    std::vector<uint32_t> gears = {5};
+    std::vector<uint32_t> inputRates = {250};
+    std::vector<uint32_t> actuateRates = {500};
+    unsigned jobs = Sweep::processors();
+    const char* csvPath = nullptr;
+
+    physics = TankModel::defaults();
+    physics.servoFrameHz = TURRET_SERVO_FREQUENCY_HZ;
+    physics.servoMinPulseUs = TURRET_SERVO_MIN_PULSE_US;
+    physics.servoMaxPulseUs = TURRET_SERVO_MAX_PULSE_US;
+
+    for (int i = 1; i < argc; i++) {
+        const char* option = argv[i];
+        if (strcmp(option, "--list") == 0) {
+            printScripts();
+            return 0;
+        }
+        if (i + 1 >= argc) {
+            return usage(argv[0]);
+        }
+        const char* value = argv[++i];
+        std::vector<uint32_t> numbers;
+        if (strcmp(option, "--script") == 0) {
+            for (const std::string& name : splitList(value)) {
+                const DriveScript* script = DriveScripts::find(name.c_str());
+                if (!script) {
+                    fprintf(stderr, "unknown script '%s'; there are:\n", name.c_str());
+                    printScripts();
+                    return 2;
+                }
+                scripts.push_back(script);
+            }
+        } else if (strcmp(option, "--gear") == 0) {
+            if (!parseNumbers(value, 1, TankMixer::maxGear, gears)) {
+                return usage(argv[0]);
+            }
+        } else if (strcmp(option, "--input-rate") == 0) {
+            if (!parseNumbers(value, 1, 10000, inputRates) || !runsOnTank(inputRates)) {
+                return usage(argv[0]);
+            }
+        } else if (strcmp(option, "--actuate-rate") == 0) {
+            if (!parseNumbers(value, 1, 10000, actuateRates) || !runsOnTank(actuateRates)) {
+                return usage(argv[0]);
+            }
+        } else if (strcmp(option, "--jobs") == 0) {
+            if (!parseNumbers(value, 1, 1024, numbers) || numbers.size() != 1) {
+                return usage(argv[0]);
+            }
+            jobs = numbers[0];
+        } else if (strcmp(option, "--csv") == 0) {
+            csvPath = value;
+        } else if (strcmp(option, "--relay-ms") == 0) {
+            physics.relayDeadTime = atof(value) / 1000;
+        } else if (strcmp(option, "--turret-inertia-ms") == 0) {
+            physics.turretInertiaTime = atof(value) / 1000;
+        } else if (strcmp(option, "--skid") == 0) {
+            physics.skidFactor = (float)atof(value);
+            if (physics.skidFactor < 1) {
+                return usage(argv[0]);
+            }
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (scripts.empty()) {
+        for (size_t i = 0; i < DriveScripts::count(); i++) {
+            scripts.push_back(&DriveScripts::at(i));
+        }
+    }
+
+    // Every combination; on the host all stages share the actuation
+    // scheduler, so the input rate has to divide its rate
+    std::vector<RunConfig> configs;
+    for (uint32_t actuate : actuateRates) {
+        for (uint32_t input : inputRates) {
+            if (input > actuate || actuate % input != 0) {
+                fprintf(stderr, "skipping %lu Hz input at %lu Hz actuation: does not divide it\n",
+                        (unsigned long)input, (unsigned long)actuate);
+                continue;
+            }
+            for (const DriveScript* script : scripts) {
+                for (uint32_t gear : gears) {
+                    configs.push_back(RunConfig{script, (uint8_t)gear, input, actuate});
+                }
+            }
+        }
+    }
+    if (configs.empty()) {
+        return usage(argv[0]);
+    }
+
+    printf("Simulating: " CONTROL_MODE_NAME ", %zu runs, %u at once\n\n", configs.size(), jobs);
+    printHeader();
+    std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+
+    std::vector<RunResult> results;
+    std::vector<bool> passed;
+    Sweep::run<RunResult>(configs.size(), jobs,
+                          [&configs](size_t index, RunResult& result) { return runOne(configs[index], result); },
+                          results, passed);
+
+    double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+    double simulatedMs = 0;
+    bool failed = false;
+    for (size_t i = 0; i < configs.size(); i++) {
+        printRow(configs[i], results[i], passed[i]);
+        simulatedMs += results[i].simulatedMs;
+        failed = failed || !passed[i];
+    }
+    printf("\n%.0f s simulated in %.2f s (%.0fx real time)\n", simulatedMs / 1000, wallMs / 1000,
+           wallMs > 0 ? simulatedMs / wallMs : 0.0);
+
+    if (csvPath) {
+        FILE* file = fopen(csvPath, "w");
+        if (!file) {
+            perror(csvPath);
+            return 1;
+        }
+        writeCsv(file, configs, results, passed);
+        fclose(file);
+    }
+    printf("%s\n", failed ? "FAIL" : "PASS");
+    return failed ? 1 : 0;
+}
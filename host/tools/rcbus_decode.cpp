@@ -0,0 +1,101 @@
+// Decode a recorded SBUS/iBUS/PPM capture with the firmware's RcBusDecoder.
+//
+// Build from the repository root:
+//   g++ -std=c++17 -O2 -IProjectHephaistos host/tools/rcbus_decode.cpp
+//       ProjectHephaistos/RcBusDecoder.cpp -o rcbus_decode
+//
+// Usage:
+//   rcbus_decode sbus capture.bin [-q]   raw UART bytes (e.g. from a USB-UART
+//   rcbus_decode ibus capture.bin [-q]   adapter or a logic analyzer export)
+//   rcbus_decode ppm  edges.txt   [-q]   one rising-edge timestamp in us per line
+//
+// Prints every decoded frame (unless -q) followed by the decoder counters.
+// Exits non-zero if the capture did not contain a single valid frame.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "RcBusDecoder.h"
+
+static bool quiet = false;
+
+static void printFrame(uint32_t index, const RcFrame& frame) {
+    if (quiet) {
+        return;
+    }
+    printf("%6u:", index);
+    for (uint8_t ch = 0; ch < frame.channelCount; ch++) {
+        printf(" %4u", frame.channelUs[ch]);
+    }
+    if (frame.frameLost) {
+        printf(" LOST");
+    }
+    if (frame.failsafe) {
+        printf(" FAILSAFE");
+    }
+    printf("\n");
+}
+
+static void printStats(const RcBusStats& stats, uint32_t inputCount, const char* inputUnit) {
+    printf("%u %s, %u frames decoded, %u rejected, %u lost, %u failsafe\n",
+           inputCount, inputUnit, stats.framesDecoded, stats.framesRejected,
+           stats.framesLost, stats.failsafeFrames);
+}
+
+template <typename Decoder>
+static int decodeBytes(FILE* file) {
+    Decoder decoder;
+    uint32_t bytes = 0;
+    int c;
+    while ((c = fgetc(file)) != EOF) {
+        bytes++;
+        if (decoder.feed((uint8_t)c)) {
+            printFrame(decoder.stats().framesDecoded, decoder.frame());
+        }
+    }
+    printStats(decoder.stats(), bytes, "bytes");
+    return decoder.stats().framesDecoded > 0 ? 0 : 1;
+}
+
+static int decodePpm(FILE* file) {
+    PpmDecoder decoder;
+    uint32_t edges = 0;
+    unsigned long timestamp;
+    while (fscanf(file, "%lu", &timestamp) == 1) {
+        edges++;
+        if (decoder.onEdge((uint32_t)timestamp)) {
+            printFrame(decoder.stats().framesDecoded, decoder.frame());
+        }
+    }
+    printStats(decoder.stats(), edges, "edges");
+    return decoder.stats().framesDecoded > 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s sbus|ibus|ppm <capture> [-q]\n", argv[0]);
+        return 2;
+    }
+    quiet = argc > 3 && strcmp(argv[3], "-q") == 0;
+
+    bool text = strcmp(argv[1], "ppm") == 0;
+    FILE* file = fopen(argv[2], text ? "r" : "rb");
+    if (!file) {
+        perror(argv[2]);
+        return 2;
+    }
+
+    int result;
+    if (strcmp(argv[1], "sbus") == 0) {
+        result = decodeBytes<SbusDecoder>(file);
+    } else if (strcmp(argv[1], "ibus") == 0) {
+        result = decodeBytes<IbusDecoder>(file);
+    } else if (text) {
+        result = decodePpm(file);
+    } else {
+        fprintf(stderr, "unknown protocol '%s'\n", argv[1]);
+        result = 2;
+    }
+    fclose(file);
+    return result;
+}
@@ -0,0 +1,45 @@
+#!/bin/sh
+# Flash/RAM report for the firmware, static vs. virtual controller dispatch.
+#
+# Run from the repository root (needs arduino-cli with the ESP32 core and
+# Bluepad32 installed):
+#   host/tools/size_report.sh [fqbn] [mode ...]
+#
+# fqbn defaults to esp32:esp32:esp32, modes to all of SERIAL BLUETOOTH
+# KEYBOARD RC RC_BUS UDP. Each mode is built twice, once as configured in
+# ControlConfig.h (static dispatch) and once with -DCONTROL_DISPATCH_VIRTUAL.
+# Loop time is reported by the firmware itself: the scheduler stats printed
+# every STATS_REPORT_MS include the average and maximum run time per stage.
+
+FQBN=${1:-esp32:esp32:esp32}
+[ $# -gt 0 ] && shift
+MODES=${*:-SERIAL BLUETOOTH KEYBOARD RC RC_BUS UDP}
+
+SKETCH=ProjectHephaistos
+BUILD_ROOT=${TMPDIR:-/tmp}/hephaistos-size
+
+# Prints "<flash> <ram>" for one build
+build_size() {
+    out=$(arduino-cli compile --fqbn "$FQBN" --build-path "$BUILD_ROOT/$1" \
+          --build-property "compiler.cpp.extra_flags=$2" "$SKETCH" 2>&1)
+    if [ $? -ne 0 ]; then
+        echo "$out" >&2
+        return 1
+    fi
+    flash=$(echo "$out" | sed -n 's/^Sketch uses \([0-9]*\) bytes.*/\1/p')
+    ram=$(echo "$out" | sed -n 's/^Global variables use \([0-9]*\) bytes.*/\1/p')
+    echo "$flash $ram"
+}
+
+printf "%-10s %12s %12s %12s %10s %10s %10s\n" \
+       mode "flash static" "flash virt" "delta" "ram static" "ram virt" "delta"
+
+status=0
+for mode in $MODES; do
+    static=$(build_size "$mode-static" "-DCONTROL_MODE_$mode") || { status=1; continue; }
+    virt=$(build_size "$mode-virtual" "-DCONTROL_MODE_$mode -DCONTROL_DISPATCH_VIRTUAL") || { status=1; continue; }
+    set -- $static $virt
+    printf "%-10s %12d %12d %12d %10d %10d %10d\n" \
+           "$mode" "$1" "$3" $(($1 - $3)) "$2" "$4" $(($2 - $4))
+done
+exit $status
@@ -0,0 +1,194 @@
+#!/usr/bin/env python3
+"""Input-to-actuation latency histograms from the tank's trace frames.
+
+Build the firmware with LATENCY_TRACE (ControlConfig.h), then either read
+the tank's serial port directly:
+
+    host/tools/trace_latency.py --port /dev/ttyUSB0 --seconds 30
+
+or save the raw serial stream first and analyse the captures later (one
+per control backend, or several; events are grouped by the backend that
+sent them):
+
+    host/tools/trace_latency.py --capture bluetooth.bin serial.bin
+
+For every control change the trace has up to four timestamps: input
+arrival, the backend's update(), the mix stage and the actuator commit.
+The report shows p50/p99/max and a histogram of each span per backend.
+Text output and other frame types on the same link are skipped.
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+SYNC_BYTE = 0xA5
+TYPE_TRACE = 0x03
+MAX_PAYLOAD = 64
+TRACE_HEADER = struct.Struct('<BHH')   # source, ticks per us, dropped
+TRACE_EVENT = struct.Struct('<IHB')    # ticks, sequence, point
+
+SOURCES = {0: 'unknown', 1: 'bluetooth', 2: 'serial', 3: 'keyboard', 4: 'rc', 5: 'rc_bus', 6: 'udp'}
+POINT_INPUT, POINT_UPDATE, POINT_MIX, POINT_COMMIT = range(4)
+SPANS = [
+    ('input -> commit', POINT_INPUT, POINT_COMMIT),
+    ('input -> update', POINT_INPUT, POINT_UPDATE),
+    ('update -> mix', POINT_UPDATE, POINT_MIX),
+    ('mix -> commit', POINT_MIX, POINT_COMMIT),
+]
+
+# Changes that never reach the actuators (superseded before the mix stage
+# saw them) are forgotten after this many newer ones
+MAX_PENDING = 512
+
+
+def crc8(data):
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+def frames(chunks):
+    """Yields (type, payload) of every valid frame in a byte stream."""
+    frame = None
+    for data in chunks:
+        for byte in data:
+            if frame is None:
+                if byte == SYNC_BYTE:
+                    frame = bytearray()
+                continue
+            frame.append(byte)
+            if len(frame) == 2 and frame[1] > MAX_PAYLOAD:
+                frame = None
+            elif len(frame) >= 2 and len(frame) == frame[1] + 3:
+                if crc8(frame[:-1]) == frame[-1]:
+                    yield frame[0], bytes(frame[2:-1])
+                frame = None
+
+
+class BackendTrace:
+    def __init__(self):
+        self.pending = {}
+        self.spans = {name: [] for name, _, _ in SPANS}
+        self.first_dropped = None
+        self.last_dropped = 0
+        self.changes = 0
+
+    def add(self, ticks_per_us, dropped, events):
+        if self.first_dropped is None:
+            self.first_dropped = dropped
+        self.last_dropped = dropped
+        for ticks, sequence, point in events:
+            points = self.pending.setdefault(sequence, {})
+            if point in points:
+                # Sequence numbers wrapped around: a new change
+                points.clear()
+            points[point] = ticks
+            if point == POINT_COMMIT:
+                self.complete(self.pending.pop(sequence), ticks_per_us)
+            elif len(self.pending) > MAX_PENDING:
+                del self.pending[next(iter(self.pending))]
+
+    def complete(self, points, ticks_per_us):
+        self.changes += 1
+        for name, start, end in SPANS:
+            if start in points and end in points:
+                ticks = (points[end] - points[start]) & 0xFFFFFFFF
+                self.spans[name].append(ticks / ticks_per_us)
+
+    def dropped(self):
+        return (self.last_dropped - (self.first_dropped or 0)) & 0xFFFF
+
+
+def percentile(values, fraction):
+    return values[min(len(values) - 1, int(fraction * len(values)))]
+
+
+def histogram(values, width=40):
+    # 1-2-5 microsecond buckets
+    buckets = {}
+    for value in values:
+        bucket, step = 1, 0
+        while bucket < value:
+            bucket = bucket * 5 // 2 if step % 3 == 1 else bucket * 2
+            step += 1
+        buckets[bucket] = buckets.get(bucket, 0) + 1
+    peak = max(buckets.values())
+    lines = []
+    for bucket in sorted(buckets):
+        count = buckets[bucket]
+        bar = '#' * max(1, round(count * width / peak))
+        lines.append('    <= %8d us %7d %s' % (bucket, count, bar))
+    return lines
+
+
+def report(traces):
+    for source in sorted(traces):
+        trace = traces[source]
+        print('%s: %d changes traced, %d events dropped' %
+              (SOURCES.get(source, 'source %d' % source), trace.changes, trace.dropped()))
+        for name, _, _ in SPANS:
+            values = sorted(trace.spans[name])
+            if not values:
+                continue
+            print('  %-16s p50 %9.1f us  p99 %9.1f us  max %9.1f us  (%d)' %
+                  (name, percentile(values, 0.5), percentile(values, 0.99), values[-1], len(values)))
+            if name == SPANS[0][0]:
+                print('\n'.join(histogram(values)))
+        print()
+
+
+def read_port(port, baud, seconds):
+    import serial
+    deadline = time.monotonic() + seconds
+    with serial.Serial(port, baud, timeout=0.1) as ser:
+        while time.monotonic() < deadline:
+            yield ser.read(ser.in_waiting or 1)
+
+
+def read_files(paths):
+    for path in paths:
+        with open(path, 'rb') as capture:
+            while True:
+                data = capture.read(65536)
+                if not data:
+                    break
+                yield data
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument('--port', help='serial port of the tank')
+    source.add_argument('--capture', nargs='+', help='raw serial captures')
+    parser.add_argument('--baud', type=int, default=115200)
+    parser.add_argument('--seconds', type=float, default=30.0, help='how long to read the port')
+    args = parser.parse_args()
+
+    chunks = read_port(args.port, args.baud, args.seconds) if args.port else read_files(args.capture)
+    traces = {}
+    try:
+        for frame_type, payload in frames(chunks):
+            if frame_type != TYPE_TRACE or len(payload) < TRACE_HEADER.size:
+                continue
+            source_id, ticks_per_us, dropped = TRACE_HEADER.unpack_from(payload)
+            events = [TRACE_EVENT.unpack_from(payload, offset)
+                      for offset in range(TRACE_HEADER.size, len(payload) - TRACE_EVENT.size + 1,
+                                          TRACE_EVENT.size)]
+            traces.setdefault(source_id, BackendTrace()).add(max(ticks_per_us, 1), dropped, events)
+    except KeyboardInterrupt:
+        pass
+
+    if not traces:
+        print('No trace frames found (is the firmware built with LATENCY_TRACE?)')
+        return 1
+    report(traces)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())